@@ -0,0 +1,1533 @@
+#include "assembler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+//
+// ELF64 (see the System V ABI and its x86-64 supplement)
+//
+
+#define ELF_HEADER_SIZE         64
+#define ELF_SECTION_HEADER_SIZE 64
+#define ELF_SYM_SIZE            24
+#define ELF_RELA_SIZE           24
+
+#define ELF_SHT_PROGBITS 1
+#define ELF_SHT_SYMTAB   2
+#define ELF_SHT_STRTAB   3
+#define ELF_SHT_RELA     4
+#define ELF_SHT_NOBITS   8
+
+#define ELF_SHF_WRITE     1
+#define ELF_SHF_ALLOC     2
+#define ELF_SHF_EXECINSTR 4
+#define ELF_SHF_INFO_LINK 64
+
+#define ELF_STB_LOCAL  0
+#define ELF_STB_GLOBAL 1
+#define ELF_STT_NOTYPE  0
+#define ELF_STT_OBJECT  1
+#define ELF_STT_FUNC    2
+#define ELF_STT_SECTION 3
+
+#define R_X86_64_64    1
+#define R_X86_64_PC32  2
+#define R_X86_64_PLT32 4
+
+// the sections of the object, by index in the section header table
+enum ElfSectionIndex {
+    ELF_SHN_UNDEF,
+    ELF_SHN_TEXT,
+    ELF_SHN_RELA_TEXT,
+    ELF_SHN_DATA,
+    ELF_SHN_RELA_DATA,
+    ELF_SHN_BSS,
+    ELF_SHN_RODATA,
+    ELF_SHN_SYMTAB,
+    ELF_SHN_STRTAB,
+    ELF_SHN_SHSTRTAB,
+    ELF_SHN_NOTE,       // .note.GNU-stack: the stack need not be executable
+    ELF_SHN_COUNT,
+};
+
+// the sections the assembly is put in; each has a section symbol, in this
+// order after the null symbol
+enum AsmSection {
+    ASM_TEXT,
+    ASM_DATA,
+    ASM_BSS,
+    ASM_RODATA,
+    ASM_SECTION_COUNT,
+};
+
+enum AsmOperandKind {
+    OPERAND_REG,
+    OPERAND_MEM,
+    OPERAND_IMM,
+    OPERAND_SYM,
+};
+
+// the registers by name, 16 of each size: their numbers are the indices
+// modulo 16
+static char* asm_registers[48] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+    "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+    "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d",
+    "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+    "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
+};
+
+// opcodes, those of two bytes after 0F as 0F00 + the second
+#define OPCODE_MOVZX_BYTE 4022 // 0F B6
+#define OPCODE_IMUL       4015 // 0F AF
+#define OPCODE_SETCC      3984 // 0F 90 + condition code
+#define OPCODE_JCC        128  // 0F 80 + condition code, after the 0F
+
+// the largest 32-bit immediate; the smallest is -IMM32_MAX - 1
+#define IMM32_MAX 2147483647
+
+typedef struct AsmSymbol AsmSymbol;
+typedef struct AsmFixup AsmFixup;
+typedef struct AsmOperand AsmOperand;
+typedef struct ElfSection ElfSection;
+typedef struct Assembler Assembler;
+
+struct AsmSymbol {
+    int  name;    // symbol id
+    int  section; // AsmSection, -1 while undefined
+    int  offset;
+    int  size;    // of a .comm variable, 0 otherwise
+    bool global;
+    bool common;  // defined by .comm, which a definition may replace
+    int  index;   // in .symtab, 0 if not in it
+};
+
+// a field the address of a symbol goes in, filled in once every symbol is
+// defined, or left to the linker with a relocation
+struct AsmFixup {
+    int section; // AsmSection of the field
+    int offset;
+    int type;    // R_X86_64_*: PC32 and PLT32 fields have 4 bytes, 64 ones 8
+    int sym;     // symbol id
+    int addend;
+};
+
+struct AsmOperand {
+    int kind;  // AsmOperandKind
+    int size;  // bytes: of the register, or of the PTR of a memory operand (0 if none)
+    int reg;   // OPERAND_REG: number, OPERAND_MEM: base register, -1 for rip
+    int value; // OPERAND_IMM: immediate, OPERAND_MEM: displacement
+    int sym;   // OPERAND_MEM relative to rip, OPERAND_SYM: symbol id
+};
+
+struct ElfSection {
+    int name;   // offset in .shstrtab
+    int type;
+    int flags;
+    int offset;
+    int size;
+    int link;
+    int info;
+    int align;
+    int entsize;
+};
+
+struct Assembler {
+    ByteBuffer* text;
+    ByteBuffer* data;
+    ByteBuffer* rodata;
+    int         bss_size;
+    int         section;    // AsmSection the lines go in
+    ByteBuffer* buf;        // its bytes, NULL for .bss
+
+    HashMap*    symbol_map; // symbol id => AsmSymbol
+    Vector*     symbols;    // in the order they were first seen
+    Vector*     fixups;
+    AsmFixup*   rip_fixup;  // of the instruction being encoded, whose end the addend depends on
+
+    char*       line;       // the line being assembled, NUL-terminated
+    int         line_capacity;
+    int         line_no;
+    AsmOperand* dst;        // the operands of the instruction being encoded
+    AsmOperand* src;
+    int         operand_count;
+};
+
+//
+// bytes
+//
+
+// little endian; a negative value is written as the complement of
+// -value - 1, which does not overflow
+static void set_le(char* dst, int value, int size) {
+    const bool negative = value < 0;
+    if (negative) {
+        value = -(value + 1);
+    }
+    for (int i = 0; i < size; ++i) {
+        int digit = value % 256;
+        if (negative) {
+            digit = 255 - digit;
+        }
+        const char byte = digit;
+        dst[i] = byte;
+        value /= 256;
+    }
+}
+
+static void put_le(ByteBuffer* buf, int value, int size) {
+    char bytes[8];
+    set_le(bytes, value, size);
+    bytebuffer_put_bytes(buf, bytes, size);
+}
+
+// zero bytes up to offset
+static void put_padding(ByteBuffer* buf, int offset) {
+    while (buf->size < offset) {
+        put_le(buf, 0, 1);
+    }
+}
+
+static int align_to(int offset, int align) {
+    return (offset + align - 1) / align * align;
+}
+
+static void emit_byte(Assembler* as, int byte) {
+    put_le(as->buf, byte, 1);
+}
+
+static void emit_le(Assembler* as, int value, int size) {
+    put_le(as->buf, value, size);
+}
+
+static bool is_imm8(int value) {
+    return value >= -128 && value <= 127;
+}
+
+static bool is_imm32(int value) {
+    return value >= -IMM32_MAX - 1 && value <= IMM32_MAX;
+}
+
+//
+// symbols
+//
+
+static AsmSymbol* get_asm_symbol(Assembler* as, int name) {
+    if (hashmap_contains(as->symbol_map, name)) {
+        return hashmap_get(as->symbol_map, name);
+    }
+
+    AsmSymbol* sym = calloc(1, sizeof(AsmSymbol));
+    sym->name    = name;
+    sym->section = -1;
+    hashmap_put(as->symbol_map, name, sym);
+    vector_push_back(as->symbols, sym);
+    return sym;
+}
+
+// labels the generator makes up for jumps and string literals, which are
+// left out of .symtab
+static bool is_local_label(int name) {
+    const char* str = symbol_name(name);
+    return str[0] == '.' && str[1] == 'L';
+}
+
+static int get_section_size(Assembler* as, int section) {
+    if (section == ASM_TEXT) {
+        return as->text->size;
+    }
+    if (section == ASM_DATA) {
+        return as->data->size;
+    }
+    if (section == ASM_RODATA) {
+        return as->rodata->size;
+    }
+    return as->bss_size;
+}
+
+static ByteBuffer* get_section_buffer(Assembler* as, int section) {
+    if (section == ASM_TEXT) {
+        return as->text;
+    }
+    if (section == ASM_DATA) {
+        return as->data;
+    }
+    if (section == ASM_RODATA) {
+        return as->rodata;
+    }
+    return NULL;
+}
+
+static void switch_section(Assembler* as, int section) {
+    as->section = section;
+    as->buf     = get_section_buffer(as, section);
+}
+
+static bool define_asm_symbol(Assembler* as, int name) {
+    AsmSymbol* sym = get_asm_symbol(as, name);
+    if (sym->section >= 0 && !sym->common) {
+        error("line %d: \"%s\" is already defined.\n", as->line_no, symbol_name(name));
+        return false;
+    }
+
+    sym->section = as->section;
+    sym->offset  = get_section_size(as, as->section);
+    sym->size    = 0;
+    sym->common  = false;
+    return true;
+}
+
+// a field of size bytes for the symbol, at the end of the section
+static AsmFixup* add_fixup(Assembler* as, int type, int name, int addend) {
+    AsmFixup* fixup = calloc(1, sizeof(AsmFixup));
+    fixup->section = as->section;
+    fixup->offset  = as->buf->size;
+    fixup->type    = type;
+    fixup->sym     = name;
+    fixup->addend  = addend;
+    vector_push_back(as->fixups, fixup);
+
+    get_asm_symbol(as, name);
+    if (type == R_X86_64_64) {
+        emit_le(as, 0, 8);
+    }
+    else {
+        emit_le(as, 0, 4);
+    }
+    return fixup;
+}
+
+//
+// operands
+//
+
+static char* skip_blanks(char* p) {
+    while (p[0] == ' ' || p[0] == '\t') {
+        ++p;
+    }
+    return p;
+}
+
+// cuts the spaces off the end of str
+static void trim_end(char* str) {
+    int len = strlen(str);
+    while (len > 0 && (str[len - 1] == ' ' || str[len - 1] == '\t' || str[len - 1] == '\r')) {
+        --len;
+        str[len] = '\0';
+    }
+}
+
+// a decimal integer, all of str
+static bool parse_int(const char* str, int* value_out) {
+    const bool negative = str[0] == '-';
+    int pos = 0;
+    if (negative) {
+        pos = 1;
+    }
+    if (str[pos] == '\0') {
+        return false;
+    }
+
+    // summed as a negative number, which reaches the smallest int
+    int value = 0;
+    while (str[pos] != '\0') {
+        if (str[pos] < '0' || str[pos] > '9') {
+            return false;
+        }
+        const int digit = str[pos] - '0';
+        value = value * 10 - digit;
+        ++pos;
+    }
+
+    if (!negative) {
+        value = -value;
+    }
+    *value_out = value;
+    return true;
+}
+
+// the index of the register in asm_registers, -1 if str names none
+static int find_register(const char* str) {
+    const int len = strlen(str);
+    if (len < 2 || len > 4) {
+        return -1;
+    }
+    for (int i = 0; i < 48; ++i) {
+        if (strcmp(asm_registers[i], str) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// "[base]", "[base+disp]", "[base-disp]" or "sym[rip]", str after the PTR
+static bool parse_memory_operand(char* str, char* bracket, AsmOperand* op) {
+    char* close = strchr(bracket, ']');
+    if (close == NULL) {
+        return false;
+    }
+    close[0] = '\0';
+    bracket[0] = '\0';
+    trim_end(str);
+
+    op->kind  = OPERAND_MEM;
+    op->value = 0;
+
+    char* base = bracket + 1;
+    char* disp = base;
+    while (disp[0] != '\0' && disp[0] != '+' && disp[0] != '-') {
+        ++disp;
+    }
+    if (disp[0] != '\0') {
+        const bool negative = (disp[0] == '-');
+        disp[0] = '\0';
+        if (!parse_int(disp + 1, &op->value)) {
+            return false;
+        }
+        if (negative) {
+            op->value = -op->value;
+        }
+    }
+
+    if (strcmp(base, "rip") == 0) {
+        if (str[0] == '\0') {
+            return false;
+        }
+        op->reg = -1;
+        op->sym = intern(str, strlen(str));
+        return true;
+    }
+
+    // a symbol only goes with rip
+    const int index = find_register(base);
+    if (index < 0 || index >= 16 || str[0] != '\0') {
+        return false;
+    }
+    op->reg = index;
+    return true;
+}
+
+static bool parse_operand(char* str, AsmOperand* op) {
+    str = skip_blanks(str);
+    trim_end(str);
+
+    op->size = 0;
+    if (strncmp(str, "BYTE PTR ", 9) == 0) {
+        op->size = 1;
+        str += 9;
+    }
+    else if (strncmp(str, "DWORD PTR ", 10) == 0) {
+        op->size = 4;
+        str += 10;
+    }
+    else if (strncmp(str, "QWORD PTR ", 10) == 0) {
+        op->size = 8;
+        str += 10;
+    }
+
+    char* bracket = strchr(str, '[');
+    if (bracket != NULL) {
+        return parse_memory_operand(str, bracket, op);
+    }
+
+    if (str[0] == '\0') {
+        return false;
+    }
+
+    if (str[0] == '-' || (str[0] >= '0' && str[0] <= '9')) {
+        op->kind = OPERAND_IMM;
+        return parse_int(str, &op->value);
+    }
+
+    const int index = find_register(str);
+    if (index >= 0) {
+        op->kind = OPERAND_REG;
+        op->reg  = index % 16;
+        if (index < 16) {
+            op->size = 8;
+        }
+        else if (index < 32) {
+            op->size = 4;
+        }
+        else {
+            op->size = 1;
+        }
+        return true;
+    }
+
+    op->kind = OPERAND_SYM;
+    op->sym  = intern(str, strlen(str));
+    return true;
+}
+
+//
+// instructions
+//
+
+// spl, bpl, sil and dil are only there with a REX prefix
+static bool needs_byte_rex(const AsmOperand* op) {
+    return op->kind == OPERAND_REG && op->size == 1 && op->reg >= 4 && op->reg <= 7;
+}
+
+// the REX prefix, if any is needed: W for 64-bit operands, and the high
+// bits of the reg field and of the r/m (or opcode) register
+static void emit_rex(Assembler* as, bool wide, int reg, int rm_reg, bool byte_rex) {
+    int rex = 0;
+    if (wide) {
+        rex += 8;
+    }
+    if (reg >= 8) {
+        rex += 4;
+    }
+    if (rm_reg >= 8) {
+        rex += 1;
+    }
+    if (rex != 0 || byte_rex) {
+        emit_byte(as, 64 + rex);
+    }
+}
+
+static void emit_opcode(Assembler* as, int opcode) {
+    if (opcode >= 256) {
+        emit_byte(as, opcode / 256);
+    }
+    emit_byte(as, opcode % 256);
+}
+
+// The prefix, opcode and ModRM byte (with SIB and displacement) of an
+// instruction whose ModRM reg field is reg, a register or an opcode
+// extension, and whose r/m operand is rm.
+static void emit_modrm_inst(Assembler* as, int opcode, int reg, const AsmOperand* rm, bool wide, bool byte_rex) {
+    emit_rex(as, wide, reg, rm->reg, byte_rex);
+    emit_opcode(as, opcode);
+
+    const int reg_bits = (reg % 8) * 8;
+    if (rm->kind == OPERAND_REG) {
+        emit_byte(as, 192 + reg_bits + rm->reg % 8);
+        return;
+    }
+
+    // rip plus a 32-bit displacement, taken from the end of the instruction
+    if (rm->reg < 0) {
+        emit_byte(as, reg_bits + 5);
+        as->rip_fixup = add_fixup(as, R_X86_64_PC32, rm->sym, rm->value);
+        return;
+    }
+
+    // rbp and r13 have no form without a displacement, rsp and r12 take a SIB
+    const int base = rm->reg % 8;
+    int mod = 2;
+    if (rm->value == 0 && base != 5) {
+        mod = 0;
+    }
+    else if (is_imm8(rm->value)) {
+        mod = 1;
+    }
+    emit_byte(as, mod * 64 + reg_bits + base);
+    if (base == 4) {
+        emit_byte(as, 36);
+    }
+    if (mod == 1) {
+        emit_le(as, rm->value, 1);
+    }
+    else if (mod == 2) {
+        emit_le(as, rm->value, 4);
+    }
+}
+
+static bool is_reg_or_mem(const AsmOperand* op) {
+    return op->kind == OPERAND_REG || op->kind == OPERAND_MEM;
+}
+
+// the operand size of an instruction on dst and src, from a register
+// operand or else the PTR of a memory one; 0 if none says
+static int get_operand_size(const AsmOperand* dst, const AsmOperand* src) {
+    if (dst->kind == OPERAND_REG || (dst->kind == OPERAND_MEM && dst->size != 0)) {
+        return dst->size;
+    }
+    if (src != NULL && src->kind == OPERAND_REG) {
+        return src->size;
+    }
+    return 0;
+}
+
+// the condition code of a jcc or setcc suffix, -1 if none
+static int get_condition_code(const char* suffix) {
+    if (strcmp(suffix, "e") == 0 || strcmp(suffix, "z") == 0) {
+        return 4;
+    }
+    if (strcmp(suffix, "ne") == 0 || strcmp(suffix, "nz") == 0) {
+        return 5;
+    }
+    if (strcmp(suffix, "l") == 0) {
+        return 12;
+    }
+    if (strcmp(suffix, "ge") == 0) {
+        return 13;
+    }
+    if (strcmp(suffix, "le") == 0) {
+        return 14;
+    }
+    if (strcmp(suffix, "g") == 0) {
+        return 15;
+    }
+    if (strcmp(suffix, "b") == 0) {
+        return 2;
+    }
+    if (strcmp(suffix, "ae") == 0) {
+        return 3;
+    }
+    if (strcmp(suffix, "be") == 0) {
+        return 6;
+    }
+    if (strcmp(suffix, "a") == 0) {
+        return 7;
+    }
+    if (strcmp(suffix, "s") == 0) {
+        return 8;
+    }
+    if (strcmp(suffix, "ns") == 0) {
+        return 9;
+    }
+    return -1;
+}
+
+// the /digit of add, or, and, sub, xor and cmp, -1 for other mnemonics
+static int get_alu_digit(const char* mnemonic) {
+    if (strcmp(mnemonic, "add") == 0) {
+        return 0;
+    }
+    if (strcmp(mnemonic, "or") == 0) {
+        return 1;
+    }
+    if (strcmp(mnemonic, "and") == 0) {
+        return 4;
+    }
+    if (strcmp(mnemonic, "sub") == 0) {
+        return 5;
+    }
+    if (strcmp(mnemonic, "xor") == 0) {
+        return 6;
+    }
+    if (strcmp(mnemonic, "cmp") == 0) {
+        return 7;
+    }
+    return -1;
+}
+
+// add r/m, reg / add reg, r/m / add r/m, imm and the like; the opcodes of
+// each are at digit * 8
+static bool encode_alu(Assembler* as, int digit, const AsmOperand* dst, const AsmOperand* src) {
+    const int size = get_operand_size(dst, src);
+    const bool wide = (size == 8);
+    int byte_op = 1;
+    if (size == 1) {
+        byte_op = 0;
+    }
+
+    if (src->kind == OPERAND_REG && is_reg_or_mem(dst)) {
+        emit_modrm_inst(as, digit * 8 + byte_op, src->reg, dst, wide, needs_byte_rex(src) || needs_byte_rex(dst));
+        return true;
+    }
+    if (src->kind == OPERAND_MEM && dst->kind == OPERAND_REG) {
+        emit_modrm_inst(as, digit * 8 + 2 + byte_op, dst->reg, src, wide, needs_byte_rex(dst));
+        return true;
+    }
+    if (src->kind != OPERAND_IMM || !is_reg_or_mem(dst) || size == 0 || !is_imm32(src->value)) {
+        return false;
+    }
+
+    if (size == 1) {
+        emit_modrm_inst(as, 128, digit, dst, false, needs_byte_rex(dst));
+        emit_le(as, src->value, 1);
+    }
+    else if (is_imm8(src->value)) {
+        emit_modrm_inst(as, 131, digit, dst, wide, false);
+        emit_le(as, src->value, 1);
+    }
+    else {
+        emit_modrm_inst(as, 129, digit, dst, wide, false);
+        emit_le(as, src->value, 4);
+    }
+    return true;
+}
+
+static bool encode_mov(Assembler* as, const AsmOperand* dst, const AsmOperand* src) {
+    const int size = get_operand_size(dst, src);
+    const bool wide = (size == 8);
+    int byte_op = 1;
+    if (size == 1) {
+        byte_op = 0;
+    }
+
+    if (src->kind == OPERAND_REG && is_reg_or_mem(dst)) {
+        emit_modrm_inst(as, 136 + byte_op, src->reg, dst, wide, needs_byte_rex(src) || needs_byte_rex(dst));
+        return true;
+    }
+    if (src->kind == OPERAND_MEM && dst->kind == OPERAND_REG) {
+        emit_modrm_inst(as, 138 + byte_op, dst->reg, src, wide, needs_byte_rex(dst));
+        return true;
+    }
+    if (src->kind != OPERAND_IMM || !is_reg_or_mem(dst) || size == 0) {
+        return false;
+    }
+
+    // a register takes B8 + reg with a full-size immediate, which is how
+    // a 64-bit one is loaded; a 32-bit one is sign-extended by C7 /0
+    if (dst->kind == OPERAND_REG && (size != 8 || !is_imm32(src->value))) {
+        emit_rex(as, wide, 0, dst->reg, needs_byte_rex(dst));
+        if (size == 1) {
+            emit_byte(as, 176 + dst->reg % 8);
+        }
+        else {
+            emit_byte(as, 184 + dst->reg % 8);
+        }
+        emit_le(as, src->value, size);
+        return true;
+    }
+    if (!is_imm32(src->value)) {
+        return false;
+    }
+
+    if (size == 1) {
+        emit_modrm_inst(as, 198, 0, dst, false, false);
+        emit_le(as, src->value, 1);
+    }
+    else {
+        emit_modrm_inst(as, 199, 0, dst, wide, false);
+        emit_le(as, src->value, 4);
+    }
+    return true;
+}
+
+static bool encode_push_pop(Assembler* as, bool push, const AsmOperand* op) {
+    if (op->kind == OPERAND_REG && op->size == 8) {
+        emit_rex(as, false, 0, op->reg, false);
+        if (push) {
+            emit_byte(as, 80 + op->reg % 8);
+        }
+        else {
+            emit_byte(as, 88 + op->reg % 8);
+        }
+        return true;
+    }
+    if (op->kind == OPERAND_MEM) {
+        if (push) {
+            emit_modrm_inst(as, 255, 6, op, false, false);
+        }
+        else {
+            emit_modrm_inst(as, 143, 0, op, false, false);
+        }
+        return true;
+    }
+    if (!push || op->kind != OPERAND_IMM || !is_imm32(op->value)) {
+        return false;
+    }
+
+    if (is_imm8(op->value)) {
+        emit_byte(as, 106);
+        emit_le(as, op->value, 1);
+    }
+    else {
+        emit_byte(as, 104);
+        emit_le(as, op->value, 4);
+    }
+    return true;
+}
+
+// jmp, jcc (cc >= 0) and call to a label or symbol, with a 32-bit
+// displacement
+static bool encode_branch(Assembler* as, int opcode, int cc, const AsmOperand* target) {
+    if (target->kind != OPERAND_SYM) {
+        return false;
+    }
+    if (cc >= 0) {
+        emit_byte(as, 15);
+        emit_byte(as, OPCODE_JCC + cc);
+    }
+    else {
+        emit_byte(as, opcode);
+    }
+    add_fixup(as, R_X86_64_PLT32, target->sym, -4);
+    return true;
+}
+
+static bool encode_inst(Assembler* as, const char* mnemonic) {
+    const AsmOperand* dst = as->dst;
+    const AsmOperand* src = as->src;
+    const int count = as->operand_count;
+
+    if (count == 2 && strcmp(mnemonic, "mov") == 0) {
+        return encode_mov(as, dst, src);
+    }
+    if (count == 1 && strcmp(mnemonic, "push") == 0) {
+        return encode_push_pop(as, true, dst);
+    }
+    if (count == 1 && strcmp(mnemonic, "pop") == 0) {
+        return encode_push_pop(as, false, dst);
+    }
+
+    const int digit = get_alu_digit(mnemonic);
+    if (count == 2 && digit >= 0) {
+        return encode_alu(as, digit, dst, src);
+    }
+
+    if (count == 2 && strcmp(mnemonic, "lea") == 0) {
+        if (dst->kind != OPERAND_REG || dst->size != 8 || src->kind != OPERAND_MEM) {
+            return false;
+        }
+        emit_modrm_inst(as, 141, dst->reg, src, true, false);
+        return true;
+    }
+    if (count == 2 && (strcmp(mnemonic, "movzx") == 0 || strcmp(mnemonic, "movzb") == 0)) {
+        if (dst->kind != OPERAND_REG || dst->size == 1 || !is_reg_or_mem(src) || src->size > 1) {
+            return false;
+        }
+        emit_modrm_inst(as, OPCODE_MOVZX_BYTE, dst->reg, src, dst->size == 8, needs_byte_rex(src));
+        return true;
+    }
+    if (count == 2 && strcmp(mnemonic, "imul") == 0) {
+        if (dst->kind != OPERAND_REG || dst->size != 8) {
+            return false;
+        }
+        if (is_reg_or_mem(src)) {
+            emit_modrm_inst(as, OPCODE_IMUL, dst->reg, src, true, false);
+            return true;
+        }
+        if (src->kind != OPERAND_IMM || !is_imm32(src->value)) {
+            return false;
+        }
+        if (is_imm8(src->value)) {
+            emit_modrm_inst(as, 107, dst->reg, dst, true, false);
+            emit_le(as, src->value, 1);
+        }
+        else {
+            emit_modrm_inst(as, 105, dst->reg, dst, true, false);
+            emit_le(as, src->value, 4);
+        }
+        return true;
+    }
+
+    if (count == 1 && strcmp(mnemonic, "call") == 0) {
+        return encode_branch(as, 232, -1, dst);
+    }
+    if (count == 1 && strcmp(mnemonic, "jmp") == 0) {
+        return encode_branch(as, 233, -1, dst);
+    }
+    if (count == 1 && mnemonic[0] == 'j') {
+        const int jcc = get_condition_code(mnemonic + 1);
+        return jcc >= 0 && encode_branch(as, 0, jcc, dst);
+    }
+    if (count == 1 && strncmp(mnemonic, "set", 3) == 0) {
+        const int setcc = get_condition_code(mnemonic + 3);
+        if (setcc < 0 || !is_reg_or_mem(dst) || dst->size > 1) {
+            return false;
+        }
+        emit_modrm_inst(as, OPCODE_SETCC + setcc, 0, dst, false, needs_byte_rex(dst));
+        return true;
+    }
+
+    // F7 /digit on a 64-bit operand
+    int unary_digit = -1;
+    if (strcmp(mnemonic, "not") == 0) {
+        unary_digit = 2;
+    }
+    else if (strcmp(mnemonic, "neg") == 0) {
+        unary_digit = 3;
+    }
+    else if (strcmp(mnemonic, "idiv") == 0) {
+        unary_digit = 7;
+    }
+    if (count == 1 && unary_digit >= 0) {
+        if (!is_reg_or_mem(dst) || get_operand_size(dst, NULL) != 8) {
+            return false;
+        }
+        emit_modrm_inst(as, 247, unary_digit, dst, true, false);
+        return true;
+    }
+
+    if (count == 0 && strcmp(mnemonic, "ret") == 0) {
+        emit_byte(as, 195);
+        return true;
+    }
+    if (count == 0 && strcmp(mnemonic, "cqo") == 0) {
+        emit_byte(as, 72);
+        emit_byte(as, 153);
+        return true;
+    }
+    if (count == 0 && strcmp(mnemonic, "leave") == 0) {
+        emit_byte(as, 201);
+        return true;
+    }
+    if (count == 0 && strcmp(mnemonic, "nop") == 0) {
+        emit_byte(as, 144);
+        return true;
+    }
+    return false;
+}
+
+// "mnemonic op, op"
+static bool process_inst(Assembler* as, char* p) {
+    if (as->section != ASM_TEXT) {
+        error("line %d: instruction outside of .text.\n", as->line_no);
+        return false;
+    }
+
+    char* mnemonic = p;
+    while (p[0] != '\0' && p[0] != ' ' && p[0] != '\t') {
+        ++p;
+    }
+    if (p[0] != '\0') {
+        p[0] = '\0';
+        ++p;
+    }
+    p = skip_blanks(p);
+
+    as->operand_count = 0;
+    while (p[0] != '\0') {
+        if (as->operand_count == 2) {
+            error("line %d: too many operands.\n", as->line_no);
+            return false;
+        }
+        char* comma = strchr(p, ',');
+        if (comma != NULL) {
+            comma[0] = '\0';
+        }
+        AsmOperand* op = as->dst;
+        if (as->operand_count == 1) {
+            op = as->src;
+        }
+        if (!parse_operand(p, op)) {
+            error("line %d: bad operand \"%s\".\n", as->line_no, p);
+            return false;
+        }
+        ++(as->operand_count);
+
+        if (comma == NULL) {
+            break;
+        }
+        p = comma + 1;
+    }
+
+    as->rip_fixup = NULL;
+    if (!encode_inst(as, mnemonic)) {
+        error("line %d: cannot encode \"%s\" with these operands.\n", as->line_no, mnemonic);
+        return false;
+    }
+
+    // rip is the address of the next instruction
+    if (as->rip_fixup != NULL) {
+        as->rip_fixup->addend -= as->buf->size - as->rip_fixup->offset;
+    }
+    return true;
+}
+
+//
+// directives
+//
+
+static int get_hex_digit(int c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// the escape after a backslash at p, whose end goes to *end_out
+static int decode_escape(const char* p, const char** end_out) {
+    *end_out = p + 1;
+    if (p[0] >= '0' && p[0] <= '7') {
+        int octal = 0;
+        int digits = 0;
+        while (digits < 3 && p[0] >= '0' && p[0] <= '7') {
+            const int octal_digit = p[0] - '0';
+            octal = octal * 8 + octal_digit;
+            ++p;
+            ++digits;
+        }
+        *end_out = p;
+        return octal % 256;
+    }
+    if (p[0] == 'x') {
+        int hex = 0;
+        ++p;
+        while (get_hex_digit(p[0]) >= 0) {
+            hex = (hex * 16 + get_hex_digit(p[0])) % 256;
+            ++p;
+        }
+        *end_out = p;
+        return hex;
+    }
+
+    switch (p[0]) {
+    case 'n':
+        return 10;
+    case 't':
+        return 9;
+    case 'r':
+        return 13;
+    case 'a':
+        return 7;
+    case 'b':
+        return 8;
+    case 'f':
+        return 12;
+    case 'v':
+        return 11;
+    case 'e':
+        return 27;
+    default:
+        return p[0];
+    }
+}
+
+// .string "...", with its terminating NUL
+static bool process_string(Assembler* as, const char* p) {
+    if (p[0] != '"') {
+        return false;
+    }
+    ++p;
+    while (p[0] != '"') {
+        if (p[0] == '\0') {
+            return false;
+        }
+        if (p[0] == '\\' && p[1] != '\0') {
+            const char* end = NULL;
+            emit_byte(as, decode_escape(p + 1, &end));
+            p = end;
+        }
+        else {
+            emit_byte(as, p[0]);
+            ++p;
+        }
+    }
+    emit_byte(as, 0);
+    return true;
+}
+
+// .comm name,size,align: a variable in .bss, unless it is defined
+static bool process_comm(Assembler* as, char* p) {
+    char* size_str = strchr(p, ',');
+    if (size_str == NULL) {
+        return false;
+    }
+    size_str[0] = '\0';
+    ++size_str;
+
+    int align = 1;
+    char* align_str = strchr(size_str, ',');
+    if (align_str != NULL) {
+        align_str[0] = '\0';
+        if (!parse_int(skip_blanks(align_str + 1), &align) || align <= 0) {
+            return false;
+        }
+    }
+    int size = 0;
+    if (!parse_int(skip_blanks(size_str), &size)) {
+        return false;
+    }
+    trim_end(p);
+
+    AsmSymbol* sym = get_asm_symbol(as, intern(p, strlen(p)));
+    sym->global = true;
+    if (sym->section >= 0) {
+        return true;
+    }
+    as->bss_size = align_to(as->bss_size, align);
+    sym->section = ASM_BSS;
+    sym->offset  = as->bss_size;
+    sym->size    = size;
+    sym->common  = true;
+    as->bss_size += size;
+    return true;
+}
+
+// the section named at p, -1 if unknown
+static int get_named_section(char* p) {
+    char* comma = strchr(p, ',');
+    if (comma != NULL) {
+        comma[0] = '\0';
+    }
+    trim_end(p);
+
+    if (strcmp(p, ".text") == 0) {
+        return ASM_TEXT;
+    }
+    if (strcmp(p, ".data") == 0) {
+        return ASM_DATA;
+    }
+    if (strcmp(p, ".bss") == 0) {
+        return ASM_BSS;
+    }
+    if (strcmp(p, ".rodata") == 0) {
+        return ASM_RODATA;
+    }
+    return -1;
+}
+
+static bool process_directive(Assembler* as, char* p) {
+    char* name = p;
+    while (p[0] != '\0' && p[0] != ' ' && p[0] != '\t') {
+        ++p;
+    }
+    if (p[0] != '\0') {
+        p[0] = '\0';
+        ++p;
+    }
+    p = skip_blanks(p);
+    trim_end(p);
+
+    if (strcmp(name, ".intel_syntax") == 0) {
+        return true;
+    }
+    if (strcmp(name, ".global") == 0 || strcmp(name, ".globl") == 0) {
+        if (p[0] == '\0') {
+            return false;
+        }
+        AsmSymbol* global_sym = get_asm_symbol(as, intern(p, strlen(p)));
+        global_sym->global = true;
+        return true;
+    }
+    if (strcmp(name, ".comm") == 0) {
+        return process_comm(as, p);
+    }
+
+    int section = get_named_section(name);
+    if (strcmp(name, ".section") == 0) {
+        section = get_named_section(p);
+    }
+    if (section >= 0) {
+        switch_section(as, section);
+        return true;
+    }
+    if (strcmp(name, ".section") == 0) {
+        error("line %d: unknown section \"%s\".\n", as->line_no, p);
+        return false;
+    }
+
+    // data from here on
+    if (as->section == ASM_BSS) {
+        error("line %d: %s in .bss.\n", as->line_no, name);
+        return false;
+    }
+    if (strcmp(name, ".string") == 0) {
+        return process_string(as, p);
+    }
+    if (strcmp(name, ".quad") == 0) {
+        int value = 0;
+        if (parse_int(p, &value)) {
+            emit_le(as, value, 8);
+            return true;
+        }
+        if (p[0] == '\0') {
+            return false;
+        }
+        add_fixup(as, R_X86_64_64, intern(p, strlen(p)), 0);
+        return true;
+    }
+    if (strcmp(name, ".zero") == 0) {
+        int zeros = 0;
+        if (!parse_int(p, &zeros) || zeros < 0) {
+            return false;
+        }
+        for (int i = 0; i < zeros; ++i) {
+            emit_byte(as, 0);
+        }
+        return true;
+    }
+
+    error("line %d: unknown directive \"%s\".\n", as->line_no, name);
+    return false;
+}
+
+static bool process_line(Assembler* as, char* p) {
+    p = skip_blanks(p);
+    trim_end(p);
+    if (p[0] == '\0') {
+        return true;
+    }
+
+    const int len = strlen(p);
+    if (p[len - 1] == ':') {
+        return define_asm_symbol(as, intern(p, len - 1));
+    }
+
+    if (p[0] == '.') {
+        if (!process_directive(as, p)) {
+            error("line %d: bad directive.\n", as->line_no);
+            return false;
+        }
+        return true;
+    }
+    return process_inst(as, p);
+}
+
+//
+// object file
+//
+
+// the index of the section symbol of an AsmSection
+static int get_section_symbol(int section) {
+    return section + 1;
+}
+
+static int get_elf_section_index(int section) {
+    if (section == ASM_TEXT) {
+        return ELF_SHN_TEXT;
+    }
+    if (section == ASM_DATA) {
+        return ELF_SHN_DATA;
+    }
+    if (section == ASM_BSS) {
+        return ELF_SHN_BSS;
+    }
+    return ELF_SHN_RODATA;
+}
+
+// appends str with its NUL, returns its offset
+static int add_elf_string(ByteBuffer* strtab, const char* str) {
+    const int offset = strtab->size;
+    bytebuffer_put_bytes(strtab, str, strlen(str) + 1);
+    return offset;
+}
+
+static void put_elf_symbol(ByteBuffer* symtab, int name, int info, int shndx, int value, int size) {
+    put_le(symtab, name, 4);
+    put_le(symtab, info, 1);
+    put_le(symtab, 0, 1);
+    put_le(symtab, shndx, 2);
+    put_le(symtab, value, 8);
+    put_le(symtab, size, 8);
+}
+
+// gives the symbols that go in .symtab their index there: the locals (the
+// null symbol and the section symbols first), then the globals. Returns
+// the index of the first global.
+static int number_asm_symbols(Assembler* as) {
+    int index = ASM_SECTION_COUNT + 1;
+    for (int i = 0; i < as->symbols->size; ++i) {
+        AsmSymbol* sym = as->symbols->elements[i];
+        if (!sym->global && !is_local_label(sym->name)) {
+            sym->index = index;
+            ++index;
+        }
+    }
+
+    const int first_global = index;
+    for (int j = 0; j < as->symbols->size; ++j) {
+        AsmSymbol* global_sym = as->symbols->elements[j];
+        if (global_sym->global) {
+            global_sym->index = index;
+            ++index;
+        }
+    }
+    return first_global;
+}
+
+static void write_symtab(Assembler* as, ByteBuffer* symtab, ByteBuffer* strtab) {
+    put_elf_symbol(symtab, 0, 0, 0, 0, 0);
+    for (int section = 0; section < ASM_SECTION_COUNT; ++section) {
+        put_elf_symbol(symtab, 0, ELF_STT_SECTION, get_elf_section_index(section), 0, 0);
+    }
+
+    // in index order: the locals, then the globals
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < as->symbols->size; ++i) {
+            const AsmSymbol* sym = as->symbols->elements[i];
+            if (sym->index == 0 || sym->global != (pass == 1)) {
+                continue;
+            }
+
+            int bind = ELF_STB_LOCAL;
+            if (sym->global) {
+                bind = ELF_STB_GLOBAL;
+            }
+            int type  = ELF_STT_NOTYPE;
+            int shndx = ELF_SHN_UNDEF;
+            if (sym->section == ASM_TEXT) {
+                type = ELF_STT_FUNC;
+            }
+            else if (sym->section >= 0) {
+                type = ELF_STT_OBJECT;
+            }
+            if (sym->section >= 0) {
+                shndx = get_elf_section_index(sym->section);
+            }
+            put_elf_symbol(symtab, add_elf_string(strtab, symbol_name(sym->name)), bind * 16 + type, shndx, sym->offset, sym->size);
+        }
+    }
+}
+
+// Fills in the fields whose symbols are in their own section, and turns
+// the others into relocations in rela_text and rela_data.
+static void resolve_fixups(Assembler* as, ByteBuffer* rela_text, ByteBuffer* rela_data) {
+    for (int i = 0; i < as->fixups->size; ++i) {
+        const AsmFixup* fixup = as->fixups->elements[i];
+        const AsmSymbol* sym = get_asm_symbol(as, fixup->sym);
+        const bool defined = (sym->section >= 0);
+
+        if (fixup->type != R_X86_64_64 && defined && !sym->global && sym->section == fixup->section) {
+            ByteBuffer* buf = get_section_buffer(as, fixup->section);
+            set_le(buf->data + fixup->offset, sym->offset + fixup->addend - fixup->offset, 4);
+            continue;
+        }
+
+        // a local symbol is reached from its section symbol
+        int sym_index = sym->index;
+        int addend    = fixup->addend;
+        if (defined && !sym->global) {
+            sym_index = get_section_symbol(sym->section);
+            addend += sym->offset;
+        }
+
+        ByteBuffer* rela = rela_data;
+        if (fixup->section == ASM_TEXT) {
+            rela = rela_text;
+        }
+        put_le(rela, fixup->offset, 8);
+        put_le(rela, fixup->type, 4);
+        put_le(rela, sym_index, 4);
+        put_le(rela, addend, 8);
+    }
+}
+
+static ElfSection* add_elf_section(Vector* sections, ByteBuffer* shstrtab, const char* name, int type, int flags, int align) {
+    ElfSection* section = calloc(1, sizeof(ElfSection));
+    section->name  = 0;
+    if (name[0] != '\0') {
+        section->name = add_elf_string(shstrtab, name);
+    }
+    section->type  = type;
+    section->flags = flags;
+    section->align = align;
+    vector_push_back(sections, section);
+    return section;
+}
+
+// places the contents of section at the end of out
+static void put_elf_section_data(ByteBuffer* out, ElfSection* section, const ByteBuffer* data) {
+    put_padding(out, align_to(out->size, section->align));
+    section->offset = out->size;
+    section->size   = data->size;
+    bytebuffer_put_bytes(out, data->data, data->size);
+}
+
+static void put_elf_section_header(ByteBuffer* out, const ElfSection* section) {
+    put_le(out, section->name, 4);
+    put_le(out, section->type, 4);
+    put_le(out, section->flags, 8);
+    put_le(out, 0, 8);
+    put_le(out, section->offset, 8);
+    put_le(out, section->size, 8);
+    put_le(out, section->link, 4);
+    put_le(out, section->info, 4);
+    put_le(out, section->align, 8);
+    put_le(out, section->entsize, 8);
+}
+
+static void put_elf_header(ByteBuffer* out, int shoff) {
+    put_le(out, 127, 1);
+    bytebuffer_put_bytes(out, "ELF", 3);
+    put_le(out, 2, 1);  // 64-bit
+    put_le(out, 1, 1);  // little endian
+    put_le(out, 1, 1);  // version
+    put_le(out, 0, 1);  // System V ABI
+    put_le(out, 0, 8);
+    put_le(out, 1, 2);  // relocatable
+    put_le(out, 62, 2); // x86-64
+    put_le(out, 1, 4);
+    put_le(out, 0, 8);  // entry
+    put_le(out, 0, 8);  // program headers
+    put_le(out, shoff, 8);
+    put_le(out, 0, 4);
+    put_le(out, ELF_HEADER_SIZE, 2);
+    put_le(out, 0, 2);
+    put_le(out, 0, 2);
+    put_le(out, ELF_SECTION_HEADER_SIZE, 2);
+    put_le(out, ELF_SHN_COUNT, 2);
+    put_le(out, ELF_SHN_SHSTRTAB, 2);
+}
+
+static void free_bytebuffer(ByteBuffer* buf) {
+    free(buf->data);
+    free(buf);
+}
+
+// the sections in the order of ElfSectionIndex, their contents after the
+// ELF header and the section header table last
+static bool write_object(Assembler* as, int fd) {
+    // a symbol used but not defined is an external one
+    for (int i = 0; i < as->symbols->size; ++i) {
+        AsmSymbol* sym = as->symbols->elements[i];
+        if (sym->section >= 0) {
+            continue;
+        }
+        if (is_local_label(sym->name)) {
+            error("\"%s\" is not defined.\n", symbol_name(sym->name));
+            return false;
+        }
+        sym->global = true;
+    }
+
+    ByteBuffer* rela_text = create_bytebuffer();
+    ByteBuffer* rela_data = create_bytebuffer();
+    ByteBuffer* symtab    = create_bytebuffer();
+    ByteBuffer* strtab    = create_bytebuffer();
+    ByteBuffer* shstrtab  = create_bytebuffer();
+    add_elf_string(strtab, "");
+    add_elf_string(shstrtab, "");
+
+    const int first_global = number_asm_symbols(as);
+    write_symtab(as, symtab, strtab);
+    resolve_fixups(as, rela_text, rela_data);
+
+    Vector* sections = create_vector();
+    add_elf_section(sections, shstrtab, "", 0, 0, 0);
+    ElfSection* text_section      = add_elf_section(sections, shstrtab, ".text", ELF_SHT_PROGBITS, ELF_SHF_ALLOC + ELF_SHF_EXECINSTR, 16);
+    ElfSection* rela_text_section = add_elf_section(sections, shstrtab, ".rela.text", ELF_SHT_RELA, ELF_SHF_INFO_LINK, 8);
+    ElfSection* data_section      = add_elf_section(sections, shstrtab, ".data", ELF_SHT_PROGBITS, ELF_SHF_WRITE + ELF_SHF_ALLOC, 8);
+    ElfSection* rela_data_section = add_elf_section(sections, shstrtab, ".rela.data", ELF_SHT_RELA, ELF_SHF_INFO_LINK, 8);
+    ElfSection* bss_section       = add_elf_section(sections, shstrtab, ".bss", ELF_SHT_NOBITS, ELF_SHF_WRITE + ELF_SHF_ALLOC, 8);
+    ElfSection* rodata_section    = add_elf_section(sections, shstrtab, ".rodata", ELF_SHT_PROGBITS, ELF_SHF_ALLOC, 1);
+    ElfSection* symtab_section    = add_elf_section(sections, shstrtab, ".symtab", ELF_SHT_SYMTAB, 0, 8);
+    ElfSection* strtab_section    = add_elf_section(sections, shstrtab, ".strtab", ELF_SHT_STRTAB, 0, 1);
+    ElfSection* shstrtab_section  = add_elf_section(sections, shstrtab, ".shstrtab", ELF_SHT_STRTAB, 0, 1);
+    add_elf_section(sections, shstrtab, ".note.GNU-stack", ELF_SHT_PROGBITS, 0, 1);
+
+    rela_text_section->link    = ELF_SHN_SYMTAB;
+    rela_text_section->info    = ELF_SHN_TEXT;
+    rela_text_section->entsize = ELF_RELA_SIZE;
+    rela_data_section->link    = ELF_SHN_SYMTAB;
+    rela_data_section->info    = ELF_SHN_DATA;
+    rela_data_section->entsize = ELF_RELA_SIZE;
+    bss_section->size          = as->bss_size;
+    symtab_section->link       = ELF_SHN_STRTAB;
+    symtab_section->info       = first_global;
+    symtab_section->entsize    = ELF_SYM_SIZE;
+
+    ByteBuffer* out = create_bytebuffer();
+    put_padding(out, ELF_HEADER_SIZE);
+    put_elf_section_data(out, text_section, as->text);
+    put_elf_section_data(out, rela_text_section, rela_text);
+    put_elf_section_data(out, data_section, as->data);
+    put_elf_section_data(out, rela_data_section, rela_data);
+    bss_section->offset = out->size;
+    put_elf_section_data(out, rodata_section, as->rodata);
+    put_elf_section_data(out, symtab_section, symtab);
+    put_elf_section_data(out, strtab_section, strtab);
+    put_elf_section_data(out, shstrtab_section, shstrtab);
+
+    const int shoff = align_to(out->size, 8);
+    put_padding(out, shoff);
+    for (int j = 0; j < sections->size; ++j) {
+        put_elf_section_header(out, sections->elements[j]);
+        free(sections->elements[j]);
+    }
+
+    // the header goes first, now that the table is placed
+    ByteBuffer* header = create_bytebuffer();
+    put_elf_header(header, shoff);
+    memcpy(out->data, header->data, ELF_HEADER_SIZE);
+
+    const bool written = bytebuffer_write(out, fd);
+    if (!written) {
+        error("Failed to write the object.\n");
+    }
+
+    free_bytebuffer(header);
+    free_bytebuffer(out);
+    free_bytebuffer(rela_text);
+    free_bytebuffer(rela_data);
+    free_bytebuffer(symtab);
+    free_bytebuffer(strtab);
+    free_bytebuffer(shstrtab);
+    free(sections->elements);
+    free(sections);
+    return written;
+}
+
+//
+// assembler
+//
+
+static Assembler* create_assembler() {
+    Assembler* as = calloc(1, sizeof(Assembler));
+    as->text          = create_bytebuffer();
+    as->data          = create_bytebuffer();
+    as->rodata        = create_bytebuffer();
+    as->symbol_map    = create_hashmap(1024);
+    as->symbols       = create_vector();
+    as->fixups        = create_vector();
+    as->line_capacity = 256;
+    as->line          = malloc(as->line_capacity);
+    as->dst           = calloc(1, sizeof(AsmOperand));
+    as->src           = calloc(1, sizeof(AsmOperand));
+    switch_section(as, ASM_TEXT);
+    return as;
+}
+
+static void free_assembler(Assembler* as) {
+    for (int i = 0; i < as->symbols->size; ++i) {
+        free(as->symbols->elements[i]);
+    }
+    for (int j = 0; j < as->fixups->size; ++j) {
+        free(as->fixups->elements[j]);
+    }
+    free(as->symbols->elements);
+    free(as->symbols);
+    free(as->fixups->elements);
+    free(as->fixups);
+    free(as->symbol_map->keys);
+    free(as->symbol_map->vals);
+    free(as->symbol_map->nums);
+    free(as->symbol_map);
+    free_bytebuffer(as->text);
+    free_bytebuffer(as->data);
+    free_bytebuffer(as->rodata);
+    free(as->dst);
+    free(as->src);
+    free(as->line);
+    free(as);
+}
+
+bool assemble(const char* text, int len, int fd) {
+    Assembler* as = create_assembler();
+
+    bool ok = true;
+    int pos = 0;
+    while (ok && pos < len) {
+        int end = pos;
+        while (end < len && text[end] != '\n') {
+            ++end;
+        }
+
+        // a copy to cut into operands
+        const int line_len = end - pos;
+        while (line_len + 1 > as->line_capacity) {
+            as->line_capacity *= 2;
+            as->line = realloc(as->line, as->line_capacity);
+        }
+        memcpy(as->line, text + pos, line_len);
+        as->line[line_len] = '\0';
+        ++(as->line_no);
+
+        ok = process_line(as, as->line);
+        pos = end + 1;
+    }
+
+    if (ok) {
+        ok = write_object(as, fd);
+    }
+    free_assembler(as);
+    return ok;
+}
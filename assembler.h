@@ -0,0 +1,18 @@
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include "util.h"
+
+//
+// Assembler for the x86-64 assembly the generator emits: Intel syntax, and
+// the instructions and directives it uses. It writes an ELF64 relocatable
+// object the system linker takes, with .text, .data, .bss (the .comm
+// variables) and .rodata (the string literals), the symbols, and
+// relocations for calls, rip-relative operands and .quad labels.
+//
+
+// Assembles len bytes of text and writes the object to fd. Reports the
+// first line it cannot encode with error() and returns false.
+bool assemble(const char* text, int len, int fd);
+
+#endif
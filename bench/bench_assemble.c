@@ -0,0 +1,132 @@
+//
+// End-to-end time from C source to object file: minic writing assembly
+// that as (or gcc -c, as the test scripts do) assembles, against minic -c
+// assembling it in memory. The objects are not linked.
+//
+// usage: bench_assemble [-r rounds] minic file.c...
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#define ASM_PATH "./bench/tmp_assemble.s"
+#define OBJ_PATH "./bench/tmp_assemble.o"
+
+enum Build {
+    BUILD_ASM,   // minic to assembly only
+    BUILD_AS,    // then as
+    BUILD_GCC,   // then gcc -c
+    BUILD_OBJ,   // minic -c
+    BUILD_COUNT,
+};
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// runs argv with stdout to out_path (or /dev/null) and stderr to
+// /dev/null, returns the exit status, -1 if it does not exit
+static int run(char** argv, const char* out_path) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        const int out_fd = open(out_path != NULL ? out_path : "/dev/null", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        const int null_fd = open("/dev/null", O_WRONLY);
+        dup2(out_fd, 1);
+        dup2(null_fd, 2);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+// builds file into OBJ_PATH (or ASM_PATH for BUILD_ASM) the given way
+static int build(const char* minic, int kind, const char* file) {
+    if (kind == BUILD_OBJ) {
+        char* obj_argv[] = { (char*)minic, "-c", "-o", OBJ_PATH, (char*)file, NULL };
+        return run(obj_argv, NULL);
+    }
+
+    char* minic_argv[] = { (char*)minic, (char*)file, NULL };
+    if (run(minic_argv, ASM_PATH) != 0) {
+        return 1;
+    }
+    if (kind == BUILD_AS) {
+        char* as_argv[] = { "as", "-o", OBJ_PATH, ASM_PATH, NULL };
+        return run(as_argv, NULL);
+    }
+    if (kind == BUILD_GCC) {
+        char* gcc_argv[] = { "gcc", "-c", "-o", OBJ_PATH, ASM_PATH, NULL };
+        return run(gcc_argv, NULL);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int rounds = 3;
+    int first  = 1;
+    if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+        rounds = atoi(argv[2]);
+        first  = 3;
+    }
+    if (first + 1 >= argc) {
+        fprintf(stderr, "usage: %s [-r rounds] minic file.c...\n", argv[0]);
+        return 1;
+    }
+    const char* minic = argv[first];
+
+    // the files minic compiles, as some tests are expected to fail
+    int* usable = calloc(argc, sizeof(int));
+    int file_count = 0;
+    for (int k = first + 1; k < argc; ++k) {
+        if (build(minic, BUILD_ASM, argv[k]) == 0) {
+            usable[k] = 1;
+            ++file_count;
+        }
+    }
+
+    const char* names[] = { "minic (assembly)", "minic + as", "minic + gcc -c", "minic -c" };
+    double best[BUILD_COUNT];
+    int failed = 0;
+    for (int kind = 0; kind < BUILD_COUNT; ++kind) {
+        best[kind] = -1;
+        for (int r = 0; r < rounds; ++r) {
+            const double start = now();
+            for (int k = first + 1; k < argc; ++k) {
+                if (usable[k] && build(minic, kind, argv[k]) != 0) {
+                    fprintf(stderr, "%s: %s failed\n", argv[k], names[kind]);
+                    failed = 1;
+                }
+            }
+            const double sec = now() - start;
+            if (best[kind] < 0 || sec < best[kind]) {
+                best[kind] = sec;
+            }
+        }
+    }
+
+    printf("%d files, best of %d rounds, seconds (ms per file)\n", file_count, rounds);
+    for (int kind = 0; kind < BUILD_COUNT; ++kind) {
+        printf("%-18s %8.3f (%6.2f)\n", names[kind], best[kind], best[kind] * 1000 / file_count);
+    }
+    printf("minic -c takes %.2fx the time of minic + as, %.2fx that of minic + gcc -c\n",
+           best[BUILD_OBJ] / best[BUILD_AS], best[BUILD_OBJ] / best[BUILD_GCC]);
+
+    unlink(ASM_PATH);
+    unlink(OBJ_PATH);
+    free(usable);
+
+    return failed;
+}
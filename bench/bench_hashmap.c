@@ -0,0 +1,174 @@
+//
+// Lookup throughput of the symbol HashMap against the chained string maps
+// it replaced, on the identifiers of the given source files.
+//
+// usage: bench_hashmap [-r rounds] file...
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../tokenizer.h"
+#include "../util.h"
+
+//
+// The former StrPtrMap: fixed capacity, characters summed as the hash,
+// collisions chained.
+//
+
+typedef struct OldMapEntry OldMapEntry;
+struct OldMapEntry {
+    char*        key;
+    void*        val;
+    OldMapEntry* next;
+};
+
+typedef struct OldMap OldMap;
+struct OldMap {
+    OldMapEntry** entries;
+    int           size;
+    int           capacity;
+};
+
+static OldMap* create_oldmap(int capacity) {
+    OldMap* map   = malloc(sizeof(OldMap));
+    map->size     = 0;
+    map->capacity = capacity;
+    map->entries  = calloc(capacity, sizeof(OldMapEntry*));
+
+    return map;
+}
+
+static int calc_old_hash(const char* str) {
+    int h = 0, pos = 0;
+    while (str[pos] != '\0') {
+        h += str[pos];
+        ++pos;
+    }
+
+    return h;
+}
+
+static void oldmap_put(OldMap* map, const char* key, void* val) {
+    const int index = calc_old_hash(key) % map->capacity;
+    OldMapEntry* entry = calloc(1, sizeof(OldMapEntry));
+    entry->key = strdup(key);
+    entry->val = val;
+
+    if (map->entries[index] == NULL) {
+        map->entries[index] = entry;
+    }
+    else {
+        OldMapEntry* current = map->entries[index];
+        while (current->next != NULL) {
+            current = current->next;
+        }
+        current->next = entry;
+    }
+
+    ++(map->size);
+}
+
+static void* oldmap_get(OldMap* map, const char* key) {
+    const int index = calc_old_hash(key) % map->capacity;
+    OldMapEntry* current = map->entries[index];
+    while (current != NULL) {
+        if (strcmp(current->key, key) == 0) {
+            return current->val;
+        }
+        current = current->next;
+    }
+
+    return NULL;
+}
+
+//
+// benchmark
+//
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char* name, int lookups, double sec, long hits) {
+    printf("%-28s %8.1f Mlookups/s  (%.3f s, %ld hits)\n", name, lookups / sec / 1e6, sec, hits);
+}
+
+int main(int argc, char** argv) {
+    int rounds = 100;
+    int first  = 1;
+    if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+        rounds = atoi(argv[2]);
+        first  = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: %s [-r rounds] file...\n", argv[0]);
+        return 1;
+    }
+
+    // every identifier occurrence of the input, in source order
+    IntVector* ids = create_intvector();
+    for (int i = first; i < argc; ++i) {
+        char* addr = read_file(argv[i]);
+        if (addr == NULL) {
+            fprintf(stderr, "Failed to read \"%s\".\n", argv[i]);
+            return 1;
+        }
+
+        const Vector* tokens = tokenize(addr);
+        for (int j = 0; j < tokens->size; ++j) {
+            const Token* token = tokens->elements[j];
+            if (token->type == TK_IDENT) {
+                intvector_push_back(ids, token->val);
+            }
+        }
+    }
+
+    // key every distinct identifier in both maps
+    OldMap*  old_map = create_oldmap(1024);
+    HashMap* new_map = create_hashmap(16);
+    for (int i = 0; i < ids->size; ++i) {
+        const int id = ids->elements[i];
+        if (!hashmap_contains(new_map, id)) {
+            hashmap_put(new_map, id, (void*)symbol_name(id));
+            oldmap_put(old_map, symbol_name(id), (void*)symbol_name(id));
+        }
+    }
+
+    printf("%d identifiers, %d distinct, %d rounds\n", ids->size, new_map->size, rounds);
+    const int lookups = ids->size * rounds;
+
+    long hits = 0;
+    double start = now();
+    for (int r = 0; r < rounds; ++r) {
+        for (int i = 0; i < ids->size; ++i) {
+            hits += (oldmap_get(old_map, symbol_name(ids->elements[i])) != NULL);
+        }
+    }
+    report("chained, string key", lookups, now() - start, hits);
+
+    hits = 0;
+    start = now();
+    for (int r = 0; r < rounds; ++r) {
+        for (int i = 0; i < ids->size; ++i) {
+            const int id = ids->elements[i];
+            hits += (hashmap_get(new_map, intern(symbol_name(id), symbol_len(id))) != NULL);
+        }
+    }
+    report("open addressing, intern+id", lookups, now() - start, hits);
+
+    hits = 0;
+    start = now();
+    for (int r = 0; r < rounds; ++r) {
+        for (int i = 0; i < ids->size; ++i) {
+            hits += (hashmap_get(new_map, ids->elements[i]) != NULL);
+        }
+    }
+    report("open addressing, id key", lookups, now() - start, hits);
+
+    return 0;
+}
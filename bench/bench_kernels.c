@@ -0,0 +1,141 @@
+//
+// Run time of the code minic generates for small int kernels, against the
+// same kernels built by gcc -O0. Each kernel returns a checksum as its exit
+// status, which every build must agree on.
+//
+// usage: bench_kernels [-r rounds] minic kernel.c...
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#define ASM_PATH "./bench/tmp_kernel.s"
+#define EXE_PATH "./bench/tmp_kernel"
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// runs argv with stdout to out_path (or /dev/null), returns the exit status,
+// -1 if it does not exit
+static int run(char** argv, const char* out_path) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        const int out_fd = open(out_path != NULL ? out_path : "/dev/null", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(out_fd, 1);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+// builds the kernel into EXE_PATH with gcc -O0 (minic NULL) or with minic
+// and the given option (or none)
+static int build(const char* minic, const char* option, const char* kernel) {
+    if (minic == NULL) {
+        char* gcc_argv[] = { "gcc", "-O0", "-o", EXE_PATH, (char*)kernel, NULL };
+        return run(gcc_argv, NULL);
+    }
+
+    char* minic_argv[] = { (char*)minic, (char*)kernel, NULL, NULL };
+    if (option != NULL) {
+        minic_argv[1] = (char*)option;
+        minic_argv[2] = (char*)kernel;
+    }
+    if (run(minic_argv, ASM_PATH) != 0) {
+        return 1;
+    }
+
+    char* as_argv[] = { "gcc", "-no-pie", "-o", EXE_PATH, ASM_PATH, NULL };
+    return run(as_argv, NULL);
+}
+
+// best seconds of the built kernel; *status_out is its exit status
+static double time_kernel(int rounds, int* status_out) {
+    double best = -1;
+    for (int r = 0; r < rounds; ++r) {
+        char* argv[] = { EXE_PATH, NULL };
+        const double start = now();
+        *status_out = run(argv, NULL);
+        const double sec = now() - start;
+        if (best < 0 || sec < best) {
+            best = sec;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int rounds = 3;
+    int first  = 1;
+    if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+        rounds = atoi(argv[2]);
+        first  = 3;
+    }
+    if (first + 1 >= argc) {
+        fprintf(stderr, "usage: %s [-r rounds] minic kernel.c...\n", argv[0]);
+        return 1;
+    }
+    const char* minic = argv[first];
+
+    const char* names[]   = { "gcc -O0", "minic", "minic -fir", "minic -O1", "minic -O2" };
+    const char* minics[]  = { NULL, minic, minic, minic, minic };
+    const char* options[] = { NULL, NULL, "-fir", "-O1", "-O2" };
+    const int build_count = 5;
+
+    printf("best of %d rounds, seconds (relative to gcc -O0)\n", rounds);
+    printf("%-12s", "kernel");
+    for (int i = 0; i < build_count; ++i) {
+        printf(" %20s", names[i]);
+    }
+    printf("\n");
+
+    int failed = 0;
+    for (int k = first + 1; k < argc; ++k) {
+        const char* kernel = argv[k];
+        const char* base = strrchr(kernel, '/');
+        printf("%-12s", base != NULL ? base + 1 : kernel);
+
+        double baseline = 0;
+        int expected = -1;
+        for (int i = 0; i < build_count; ++i) {
+            if (build(minics[i], options[i], kernel) != 0) {
+                printf(" %20s", "build failed");
+                failed = 1;
+                continue;
+            }
+
+            int status = 0;
+            const double sec = time_kernel(rounds, &status);
+            if (i == 0) {
+                baseline = sec;
+                expected = status;
+            }
+            if (status != expected) {
+                printf(" %11s %3d != %3d", "exit", status, expected);
+                failed = 1;
+                continue;
+            }
+            printf(" %11.3f (%5.2fx)", sec, sec / baseline);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    unlink(ASM_PATH);
+    unlink(EXE_PATH);
+
+    return failed;
+}
@@ -0,0 +1,169 @@
+//
+// Latency of the --server requests while a file is edited: at sites spread
+// over the file, a statement is typed one character per change and then
+// deleted the same way, with a symbols request after each change. Opening
+// the file, which parses it whole, is the baseline.
+//
+// usage: bench_server [-s sites] minic file
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#define STATEMENT "x = 1;\n    "
+
+static FILE* requests;
+static FILE* responses;
+static int   next_id = 1;
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// sends the request and waits for its response, returns the seconds taken
+static double call(const char* method, const char* path, const char* params) {
+    const double start = now();
+    fprintf(requests, "{\"id\":%d,\"method\":\"%s\",\"path\":\"%s\"%s}\n", next_id, method, path, params);
+    fflush(requests);
+    ++next_id;
+
+    char line[4096];
+    int  complete = 0;
+    while (!complete) {
+        if (fgets(line, sizeof(line), responses) == NULL) {
+            fprintf(stderr, "The server exited.\n");
+            exit(1);
+        }
+        complete = (strchr(line, '\n') != NULL);
+        if (strstr(line, "\"error\"") != NULL) {
+            fprintf(stderr, "%s", line);
+            exit(1);
+        }
+    }
+
+    return now() - start;
+}
+
+static int compare_double(const void* a, const void* b) {
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char* name, double* samples, int count) {
+    qsort(samples, count, sizeof(double), compare_double);
+    printf("%-8s %6d requests  p50 %8.1f us  p90 %8.1f us  p99 %8.1f us  max %8.1f us\n", name, count,
+           samples[count / 2] * 1e6, samples[count * 9 / 10] * 1e6, samples[count * 99 / 100] * 1e6, samples[count - 1] * 1e6);
+}
+
+int main(int argc, char** argv) {
+    int sites = 50;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+        sites = atoi(argv[2]);
+        first = 3;
+    }
+    if (first + 2 != argc) {
+        fprintf(stderr, "usage: %s [-s sites] minic file\n", argv[0]);
+        return 1;
+    }
+    const char* minic = argv[first];
+    char* path = realpath(argv[first + 1], NULL);
+    FILE* fp = (path != NULL) ? fopen(path, "r") : NULL;
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to read \"%s\".\n", argv[first + 1]);
+        return 1;
+    }
+    static char text[1 << 22];
+    const int size = fread(text, 1, sizeof(text) - 1, fp);
+    fclose(fp);
+    text[size] = '\0';
+
+    int to_server[2];
+    int from_server[2];
+    if (pipe(to_server) != 0 || pipe(from_server) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    const pid_t pid = fork();
+    if (pid == 0) {
+        dup2(to_server[0], 0);
+        dup2(from_server[1], 1);
+        const int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, 2);
+        close(to_server[1]);
+        close(from_server[0]);
+        execl(minic, minic, "--server", (char*)NULL);
+        perror("execl");
+        _exit(1);
+    }
+    close(to_server[0]);
+    close(from_server[1]);
+    requests  = fdopen(to_server[1], "w");
+    responses = fdopen(from_server[0], "r");
+
+    // the sites are the starts of the return statements, spread over the file
+    int* offsets = calloc(sites, sizeof(int));
+    int  count   = 0;
+    int  returns = 0;
+    for (const char* p = strstr(text, "    return "); p != NULL; p = strstr(p + 1, "    return ")) {
+        ++returns;
+    }
+    int seen = 0;
+    for (const char* p = strstr(text, "    return "); p != NULL && count < sites; p = strstr(p + 1, "    return ")) {
+        if (seen * sites / returns >= count) {
+            offsets[count] = p - text + 4;
+            ++count;
+        }
+        ++seen;
+    }
+
+    const int opens = 20;
+    double* open_samples = calloc(opens, sizeof(double));
+    for (int i = 0; i < opens; ++i) {
+        open_samples[i] = call("open", path, "");
+    }
+
+    const int len = strlen(STATEMENT);
+    const int edits = count * len * 2;
+    double* change_samples  = calloc(edits, sizeof(double));
+    double* symbols_samples = calloc(edits, sizeof(double));
+    int n = 0;
+    char params[256];
+    for (int i = 0; i < count; ++i) {
+        // typed forward, then deleted backward
+        for (int j = 0; j < len * 2; ++j) {
+            if (j < len) {
+                char c[3] = { STATEMENT[j], '\0', '\0' };
+                if (c[0] == '\n') {
+                    c[0] = '\\';
+                    c[1] = 'n';
+                }
+                snprintf(params, sizeof(params), ",\"offset\":%d,\"length\":0,\"text\":\"%s\"", offsets[i] + j, c);
+            }
+            else {
+                snprintf(params, sizeof(params), ",\"offset\":%d,\"length\":1,\"text\":\"\"", offsets[i] + len * 2 - j - 1);
+            }
+            change_samples[n]  = call("change", path, params);
+            symbols_samples[n] = call("symbols", path, "");
+            ++n;
+        }
+    }
+    call("shutdown", path, "");
+    fclose(requests);
+    waitpid(pid, NULL, 0);
+
+    printf("%s: %d bytes, %d edit sites\n", argv[first + 1], size, count);
+    report("open", open_samples, opens);
+    report("change", change_samples, n);
+    report("symbols", symbols_samples, n);
+
+    return 0;
+}
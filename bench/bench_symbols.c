@@ -0,0 +1,98 @@
+//
+// Code generation time of a file with many variables: a function with 10k
+// local variables and 100k global variables, each local initialized from a
+// global and then read again. Times each given compiler on it.
+//
+// usage: bench_symbols [-r rounds] minic...
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#define LOCAL_COUNT  10000
+#define GLOBAL_COUNT 100000
+#define SOURCE_PATH  "./bench/tmp_symbols.c"
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void write_source(const char* path) {
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open \"%s\".\n", path);
+        exit(1);
+    }
+
+    for (int i = 0; i < GLOBAL_COUNT; ++i) {
+        fprintf(fp, "int g%d;\n", i);
+    }
+    fprintf(fp, "int main() {\n    int s = 0;\n");
+    for (int i = 0; i < LOCAL_COUNT; ++i) {
+        fprintf(fp, "    int l%d = g%d;\n", i, (int)((long)i * GLOBAL_COUNT / LOCAL_COUNT));
+    }
+    for (int i = 0; i < LOCAL_COUNT; ++i) {
+        fprintf(fp, "    s = s + l%d;\n", i);
+    }
+    fprintf(fp, "    return s;\n}\n");
+    fclose(fp);
+}
+
+// seconds minic takes to compile path, -1 if it fails
+static double compile(const char* minic, const char* path) {
+    const double start = now();
+    const pid_t pid = fork();
+    if (pid == 0) {
+        const int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, 1);
+        execl(minic, minic, path, (char*)NULL);
+        _exit(127);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+    return now() - start;
+}
+
+int main(int argc, char** argv) {
+    int rounds = 3;
+    int first  = 1;
+    if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+        rounds = atoi(argv[2]);
+        first  = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: %s [-r rounds] minic...\n", argv[0]);
+        return 1;
+    }
+
+    write_source(SOURCE_PATH);
+    printf("%d locals, %d globals, best of %d rounds\n", LOCAL_COUNT, GLOBAL_COUNT, rounds);
+    for (int i = first; i < argc; ++i) {
+        double best = -1;
+        for (int r = 0; r < rounds; ++r) {
+            const double sec = compile(argv[i], SOURCE_PATH);
+            if (sec < 0) {
+                fprintf(stderr, "%s failed.\n", argv[i]);
+                return 1;
+            }
+            if (best < 0 || sec < best) {
+                best = sec;
+            }
+        }
+        printf("%-24s %8.3f s\n", argv[i], best);
+    }
+    unlink(SOURCE_PATH);
+
+    return 0;
+}
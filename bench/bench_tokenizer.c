@@ -0,0 +1,90 @@
+//
+// Tokenizer throughput in MB/s on the given source files, with the
+// byte-by-byte scanner and with the vector one (see set_vector_scan()).
+//
+// usage: bench_tokenizer [-r rounds] file...
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../tokenizer.h"
+#include "../util.h"
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// The tokens of each file are released after it, so that every round
+// tokenizes into memory already touched instead of growing the heap.
+static int run(char** sources, int count, int rounds) {
+    Arena* arena = create_arena(65536);
+    int tokens = 0;
+    for (int r = 0; r < rounds; ++r) {
+        tokens = 0;
+        for (int i = 0; i < count; ++i) {
+            Vector* vec = tokenize_range(sources[i], 0, -1, NULL, arena);
+            if (vec == NULL) {
+                exit(1);
+            }
+            tokens += vec->size;
+            free(vec->elements);
+            free(vec);
+            arena_release(arena);
+        }
+    }
+    free(arena);
+
+    return tokens;
+}
+
+int main(int argc, char** argv) {
+    int rounds = 50;
+    int first  = 1;
+    if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+        rounds = atoi(argv[2]);
+        first  = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: %s [-r rounds] file...\n", argv[0]);
+        return 1;
+    }
+
+    const int count = argc - first;
+    char** sources  = calloc(count, sizeof(char*));
+    long bytes = 0;
+    for (int i = 0; i < count; ++i) {
+        sources[i] = read_file(argv[first + i]);
+        if (sources[i] == NULL) {
+            fprintf(stderr, "Failed to read \"%s\".\n", argv[first + i]);
+            return 1;
+        }
+        bytes += strlen(sources[i]);
+    }
+
+    printf("%ld bytes, %d rounds\n", bytes, rounds);
+    const double mb = (double)bytes * rounds / 1e6;
+
+    set_vector_scan(false);
+    double start = now();
+    const int scalar_tokens = run(sources, count, rounds);
+    double sec = now() - start;
+    printf("%-12s %8.1f MB/s  (%.3f s, %d tokens)\n", "scalar", mb / sec, sec, scalar_tokens);
+
+    set_vector_scan(true);
+    start = now();
+    const int vector_tokens = run(sources, count, rounds);
+    sec = now() - start;
+    printf("%-12s %8.1f MB/s  (%.3f s, %d tokens)\n", "vector", mb / sec, sec, vector_tokens);
+
+    if (scalar_tokens != vector_tokens) {
+        fprintf(stderr, "Token counts differ.\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+int steps(int n) {
+    int count = 0;
+    while (n != 1) {
+        if (n % 2 == 0) {
+            n = n / 2;
+        }
+        else {
+            n = 3 * n + 1;
+        }
+        ++count;
+    }
+    return count;
+}
+
+int main() {
+    // below 100000 the values stay within 32 bits, as gcc ints do
+    int longest = 0;
+    for (int round = 0; round < 5; ++round) {
+        for (int i = 1; i < 100000; ++i) {
+            int s = steps(i) + round;
+            if (s > longest) {
+                longest = s;
+            }
+        }
+    }
+    return longest % 256;
+}
@@ -0,0 +1,9 @@
+int main() {
+    int sum = 0;
+    for (int i = 0; i < 6000; i++) {
+        for (int j = 0; j < 6000; j++) {
+            sum = (sum + i * j) % 1000003;
+        }
+    }
+    return sum % 256;
+}
@@ -51,7 +51,7 @@ void dump_tokens(const Vector* vec) {
         Token* token = vec->elements[i];
         printf("index=%d,token=\"%s\"", i, decode_token_type(token->type));
         if (token->type == TK_IDENT) {
-            printf("=\"%s\"", token->str);
+            printf("=\"%s\"", symbol_name(token->val));
         }
         printf("\n");
         fflush(stdout);
@@ -62,6 +62,8 @@ void dump_tokens(const Vector* vec) {
 // parser
 //
 
+static const ExprPool* expr_pool;
+
 void dump_nodes(const TransUnitNode* node); static void dump_external_decl_node(const ExternalDeclNode* node, int indent);
 static void dump_func_def_node(const FuncDefNode* node, int indent);
 static void dump_decl_specifier_node(const DeclSpecifierNode* node, int indent);
@@ -72,24 +74,7 @@ static void dump_declarator_node(const DeclaratorNode* node, int indent);
 static void dump_pointer_node(const PointerNode* node, int indent);
 static void dump_specifier_qualifier_node(const SpecifierQualifierNode* node, int indent);
 static void dump_direct_declarator_node(const DirectDeclaratorNode* node, int indent);
-static void dump_conditional_expr_node(const ConditionalExprNode* node, int indent);
-static void dump_logical_or_expr_node(const LogicalOrExprNode* node, int indent);
-static void dump_logical_and_expr_node(const LogicalAndExprNode* node, int indent);
-static void dump_inclusive_or_expr_node(const InclusiveOrExprNode* node, int indent);
-static void dump_exclusive_or_expr_node(const ExclusiveOrExprNode* node, int indent);
-static void dump_and_expr_node(const AndExprNode* node, int indent);
-static void dump_equality_expr_node(const EqualityExprNode* node, int indent);
-static void dump_relational_expr_node(const RelationalExprNode* node, int indent);
-static void dump_shift_expr_node(const ShiftExprNode* node, int indent);
-static void dump_additive_expr_node(const AdditiveExprNode* node, int indent);
-static void dump_multiplicative_expr_node(const MultiPlicativeExprNode* node, int indent);
-static void dump_cast_expr_node(const CastExprNode* node, int indent);
-static void dump_unary_expr_node(const UnaryExprNode* node, int indent);
-static void dump_postfix_expr_node(const PostfixExprNode* node, int indent);
-static void dump_primary_expr_node(const PrimaryExprNode* node, int indent);
-static void dump_constant_node(const ConstantNode* node, int indent);
-static void dump_expr_node(const ExprNode* node, int indent);
-static void dump_assign_expr_node(const AssignExprNode* node, int indent);
+static void dump_expr(int node, int indent);
 static void dump_type_name_node(const TypeNameNode* node, int indent);
 static void dump_param_type_list_node(const ParamTypeListNode* node, int indent);
 static void dump_param_list_node(const ParamListNode* node, int indent);
@@ -112,6 +97,7 @@ static void printf_indent(int indent, const char* fmt, ...);
 
 void dump_nodes(const TransUnitNode* node) {
     printf("TransUnitNode\n");
+    expr_pool = node->expr_pool;
 
     for (int i = 0; i < node->external_decl_nodes->size; ++i) {
         const ExternalDeclNode* external_decl_node = (const ExternalDeclNode*)(node->external_decl_nodes->elements[i]);
@@ -147,8 +133,17 @@ static void dump_func_def_node(const FuncDefNode* node, int indent) {
         dump_declarator_node(node->declarator_node, indent + 2);
     }
 
-    if (node->compound_stmt_node != NULL) {
-        dump_compound_stmt_node(node->compound_stmt_node, indent + 2);
+    if (!node->is_reachable) {
+        printf_indent(indent + 2, "(unreachable, body not parsed)\n");
+        return;
+    }
+
+    const CompoundStmtNode* compound_stmt_node = parse_func_body((FuncDefNode*)node);
+    if (compound_stmt_node != NULL) {
+        const ExprPool* global_expr_pool = expr_pool;
+        expr_pool = node->expr_pool;
+        dump_compound_stmt_node(compound_stmt_node, indent + 2);
+        expr_pool = global_expr_pool;
     }
 }
 
@@ -168,7 +163,7 @@ static void dump_type_specifier_node(const TypeSpecifierNode* node, int indent)
         indent, 
         "TypeSpecifierNode,Type=\"%s\",StructName=\"%s\"\n",
         decode_type_specifier(node->type_specifier),
-        node->struct_name
+        symbol_name(node->struct_name)
     );
 
     if (node->struct_specifier_node != NULL) {
@@ -180,7 +175,7 @@ static void dump_struct_specifier_node(const StructSpecifierNode* node, int inde
     printf_indent(
         indent,
         "StructSpecifierNode,Identifer=\"%s\"\n",
-        node->identifier
+        symbol_name(node->identifier)
     );
 
     for (int i = 0; i < node->struct_declaration_nodes->size; ++i) {
@@ -227,7 +222,7 @@ static void dump_direct_declarator_node(const DirectDeclaratorNode* node, int in
     printf_indent(
         indent, 
         "DirectDeclaratorNode,Identifier=\"%s\"\n",
-        node->identifier
+        symbol_name(node->identifier)
     );
 
     if (node->declarator_node != NULL) {
@@ -238,8 +233,8 @@ static void dump_direct_declarator_node(const DirectDeclaratorNode* node, int in
         dump_direct_declarator_node(node->direct_declarator_node, indent + 2);
     }
 
-    if (node->conditional_expr_node != NULL) {
-        dump_conditional_expr_node(node->conditional_expr_node, indent + 2);
+    if (node->conditional_expr != 0) {
+        dump_expr(node->conditional_expr, indent + 2);
     }
 
     if (node->param_type_list_node != NULL) {
@@ -247,255 +242,38 @@ static void dump_direct_declarator_node(const DirectDeclaratorNode* node, int in
     }
 
     for (int i = 0; i < node->identifier_list->size; ++i) {
-        printf_indent(indent, "identifier[%d]=%s\n", i, node->identifier_list->elements[i]);
-    }
-}
-
-static void dump_conditional_expr_node(const ConditionalExprNode* node, int indent) {
-    printf_indent(indent, "ConditionalExprNode\n");
-
-    if (node->logical_or_expr_node != NULL) {
-        dump_logical_or_expr_node(node->logical_or_expr_node, indent + 2);
-    }
-
-    if (node->expr_node != NULL) {
-        dump_expr_node(node->expr_node, indent + 2);
-    }
-
-    if (node->conditional_expr_node != NULL) {
-        dump_conditional_expr_node(node->conditional_expr_node, indent + 2);
-    }
-}
-
-static void dump_logical_or_expr_node(const LogicalOrExprNode* node, int indent) {
-    printf_indent(indent, "LogicalOrExprNode\n");
-
-    if (node->logical_and_expr_node != NULL) {
-        dump_logical_and_expr_node(node->logical_and_expr_node, indent + 2);
-    }
-
-    if (node->logical_or_expr_node != NULL) {
-        dump_logical_or_expr_node(node->logical_or_expr_node, indent + 2);
-    }
-}
-
-static void dump_logical_and_expr_node(const LogicalAndExprNode* node, int indent) {
-    printf_indent(indent, "LogicalAndExprNode\n");
-
-    if (node->inclusive_or_expr_node != NULL) {
-        dump_inclusive_or_expr_node(node->inclusive_or_expr_node, indent + 2);
-    }
-
-    if (node->logical_and_expr_node != NULL) {
-        dump_logical_and_expr_node(node->logical_and_expr_node, indent + 2);
-    }
-}
-
-static void dump_inclusive_or_expr_node(const InclusiveOrExprNode* node, int indent) {
-    printf_indent(indent, "InclusiveOrExprNode\n");
-
-    if (node->exclusive_or_expr_node != NULL) {
-        dump_exclusive_or_expr_node(node->exclusive_or_expr_node, indent + 2);
-    }
-
-    if (node->inclusive_or_expr_node != NULL) {
-        dump_inclusive_or_expr_node(node->inclusive_or_expr_node, indent + 2);
-    }
-}
-
-static void dump_exclusive_or_expr_node(const ExclusiveOrExprNode* node, int indent) {
-    printf_indent(indent, "ExclusiveOrExprNode\n");
-
-    if (node->and_expr_node != NULL) {
-        dump_and_expr_node(node->and_expr_node, indent + 2);
-    }
-
-    if (node->exclusive_or_expr_node != NULL) {
-        dump_exclusive_or_expr_node(node->exclusive_or_expr_node, indent + 2);
-    }
-
-}
-
-static void dump_and_expr_node(const AndExprNode* node, int indent) {
-    printf_indent(indent, "AndExprNode\n");
-
-    if (node->equality_expr_node != NULL) {
-        dump_equality_expr_node(node->equality_expr_node, indent + 2);
-    }
-
-    if (node->and_expr_node != NULL) {
-        dump_and_expr_node(node->and_expr_node, indent + 2);
+        printf_indent(indent, "identifier[%d]=%s\n", i, symbol_name(node->identifier_list->elements[i]));
     }
 }
 
-static void dump_equality_expr_node(const EqualityExprNode* node, int indent) {
-    printf_indent(
-        indent, 
-        "EqualityExprNode,CmpType=\"%s\"\n",
-        decode_comparison_operator_type(node->cmp_type)
-    );
-
-    if (node->relational_expr_node != NULL) {
-        dump_relational_expr_node(node->relational_expr_node, indent + 2);
-    }
+static void dump_expr(int node, int indent) {
+    printf_indent(indent, "Expr,Kind=\"%s\"", decode_expr_kind(expr_kind(expr_pool, node)));
 
-    if (node->equality_expr_node != NULL) {
-        dump_equality_expr_node(node->equality_expr_node, indent + 2);
-    }
-}
-
-static void dump_relational_expr_node(const RelationalExprNode* node, int indent) {
-    printf_indent(
-        indent,
-        "RelationalExprNode,CmpType=\"%s\"\n",
-        decode_comparison_operator_type(node->cmp_type)
-    );
-
-    if (node->shift_expr_node != NULL) {
-        dump_shift_expr_node(node->shift_expr_node, indent + 2);
-    }
-
-    if (node->relational_expr_node != NULL) {
-        dump_relational_expr_node(node->relational_expr_node, indent + 2);
-    }
-}
-
-static void dump_shift_expr_node(const ShiftExprNode* node, int indent) {
-    printf_indent(indent, "ShiftExprNode\n");
-
-    if (node->additive_expr_node != NULL) {
-        dump_additive_expr_node(node->additive_expr_node, indent + 2);
-    }
-
-    if (node->shift_expr_node != NULL) {
-        dump_shift_expr_node(node->shift_expr_node, indent + 2);
-    }
-}
-
-static void dump_additive_expr_node(const AdditiveExprNode* node, int indent) {
-    printf_indent(
-        indent, 
-        "AdditiveExprNode,OperatorType=\"%s\"\n", 
-        decode_operator_type(node->operator_type)
-    );
-
-    if (node->multiplicative_expr_node != NULL) {
-        dump_multiplicative_expr_node(node->multiplicative_expr_node, indent + 2);
-    }
-
-    if (node->additive_expr_node != NULL) {
-        dump_additive_expr_node(node->additive_expr_node, indent + 2);
-    }
-}
-
-static void dump_multiplicative_expr_node(const MultiPlicativeExprNode* node, int indent) {
-    printf_indent(
-        indent,
-        "MultiPlicativeExprNode,OperatorType=\"%s\"\n",
-        decode_operator_type(node->operator_type)
-    );
-
-    if (node->cast_expr_node != NULL) {
-        dump_cast_expr_node(node->cast_expr_node, indent + 2);
-    }
-
-    if (node->multiplicative_expr_node != NULL) {
-        dump_multiplicative_expr_node(node->multiplicative_expr_node, indent + 2);
-    }
-}
-
-static void dump_cast_expr_node(const CastExprNode* node, int indent) {
-    printf_indent(indent, "CastExprNode\n");
-
-    if (node->unary_expr_node != NULL) {
-        dump_unary_expr_node(node->unary_expr_node, indent + 2);
-    }
-
-    if (node->cast_expr_node != NULL) {
-        dump_cast_expr_node(node->cast_expr_node, indent + 2);
-    }
-
-    if (node->type_name_node != NULL) {
-        dump_type_name_node(node->type_name_node, indent + 2);
-    }
-}
-
-static void dump_unary_expr_node(const UnaryExprNode* node, int indent) {
-    printf_indent(
-        indent, 
-        "UnaryExprNode,UnaryType=\"%s\",OperatorType=\"%s\"\n", 
-        decode_unary_type(node->type),
-        decode_operator_type(node->op_type)
-    );
-
-    if (node->postfix_expr_node != NULL) {
-        dump_postfix_expr_node(node->postfix_expr_node, indent + 2);
-    }
-
-    if (node->unary_expr_node != NULL) {
-        dump_unary_expr_node(node->unary_expr_node, indent + 2);
-    }
-
-    if (node->cast_expr_node != NULL) {
-        dump_cast_expr_node(node->cast_expr_node, indent + 2);
-    }
-}
-
-static void dump_postfix_expr_node(const PostfixExprNode* node, int indent) {
-    printf_indent(
-        indent, 
-        "PostfixExprNode,PostfixExprType=\"%s\",Identifier=\"%s\"\n",
-        decode_postfix_type(node->postfix_expr_type),
-        node->identifier
-    );
-
-    if (node->primary_expr_node != NULL) {
-        dump_primary_expr_node(node->primary_expr_node, indent + 2);
-    }
-
-    if (node->postfix_expr_node != NULL) {
-        dump_postfix_expr_node(node->postfix_expr_node, indent + 2);
-    }
-
-    if (node->expr_node != NULL) {
-        dump_expr_node(node->expr_node, indent + 2);
-    }
-
-    for (int i = 0; i < node->assign_expr_nodes->size; ++i) {
-        dump_assign_expr_node(node->assign_expr_nodes->elements[i], indent + 2);
-    }
-}
-
-static void dump_primary_expr_node(const PrimaryExprNode* node, int indent) {
-    printf_indent(
-        indent, 
-        "PrimaryExprNode,Identifier=\"%s\"\n",
-        node->identifier
-    );
-
-    if (node->constant_node != NULL) {
-        dump_constant_node(node->constant_node, indent + 2);
+    switch (expr_kind(expr_pool, node)) {
+    case EXPR_CONST: {
+        if (expr_op(expr_pool, node) == CONST_STR) {
+            printf(",ConstType=\"%s\",CharacterConstant=\"%s\"\n", decode_const_type(expr_op(expr_pool, node)), symbol_name(expr_val(expr_pool, node)));
+        } else {
+            printf(",ConstType=\"%s\",IntegerConstant=%d\n", decode_const_type(expr_op(expr_pool, node)), expr_val(expr_pool, node));
+        }
+        break;
     }
-
-    if (node->expr_node != NULL) {
-        dump_expr_node(node->expr_node, indent + 2);
+    case EXPR_IDENT:
+    case EXPR_CALL:
+    case EXPR_DOT:
+    case EXPR_ARROW:
+    case EXPR_SIZEOF_IDENT: {
+        printf(",Identifier=\"%s\"\n", symbol_name(expr_val(expr_pool, node)));
+        break;
     }
-}
-
-static void dump_constant_node(const ConstantNode* node, int indent) {
-    printf_indent(
-        indent, 
-        "ConstantNode,ConstType=\"%s\"",
-        decode_const_type(node->const_type)
-    );
-
-    switch (node->const_type) {
-    case CONST_INT: {
-        printf("IntegerConstant=%d\n", node->integer_constant);
+    case EXPR_UNARY:
+    case EXPR_BINARY:
+    case EXPR_ASSIGN: {
+        printf(",OperatorType=\"%s\"\n", decode_operator_type(expr_op(expr_pool, node)));
         break;
     }
-    case CONST_STR: {
-        printf("CharacterConstant=\"%s\"\n", node->character_constant);
+    case EXPR_COMPARE: {
+        printf(",CmpType=\"%s\"\n", decode_comparison_operator_type(expr_op(expr_pool, node)));
         break;
     }
     default: {
@@ -503,34 +281,27 @@ static void dump_constant_node(const ConstantNode* node, int indent) {
         break;
     }
     }
-}
-
-static void dump_expr_node(const ExprNode* node, int indent) {
-    printf_indent(indent, "ExprNode\n");
 
-    if (node->assign_expr_node != NULL) {
-        dump_assign_expr_node(node->assign_expr_node, indent + 2);
+    if (expr_lhs(expr_pool, node) != 0) {
+        dump_expr(expr_lhs(expr_pool, node), indent + 2);
     }
 
-    if (node->expr_node != NULL) {
-        dump_expr_node(node->expr_node, indent + 2);
+    if (expr_kind(expr_pool, node) == EXPR_COND) {
+        dump_expr(expr_mid(expr_pool, node), indent + 2);
     }
-}
 
-static void dump_assign_expr_node(const AssignExprNode* node, int indent) {
-    printf_indent(
-        indent, 
-        "AssignExprNode,Operator=\"%s\"\n",
-        decode_operator_type(node->assign_operator)
-    );
+    if (expr_rhs(expr_pool, node) != 0) {
+        dump_expr(expr_rhs(expr_pool, node), indent + 2);
+    }
 
-    if (node->conditional_expr_node != NULL) {
-        dump_conditional_expr_node(node->conditional_expr_node, indent + 2);
+    if (expr_kind(expr_pool, node) == EXPR_CALL) {
+        for (int i = 0; i < expr_arg_count(expr_pool, node); ++i) {
+            dump_expr(expr_arg(expr_pool, node, i), indent + 2);
+        }
     }
 
-    if (node->unary_expr_node != NULL) {
-        dump_unary_expr_node(node->unary_expr_node, indent + 2);
-        dump_assign_expr_node(node->assign_expr_node, indent + 2);
+    if (expr_kind(expr_pool, node) == EXPR_SIZEOF_TYPE) {
+        dump_type_name_node(expr_type_name(expr_pool, node), indent + 2);
     }
 }
 
@@ -611,8 +382,8 @@ static void dump_init_declarator_node(const InitDeclaratorNode* node, int indent
 static void dump_initializer_node(const InitializerNode* node, int indent) {
     printf_indent(indent, "InitializerNode\n");
 
-    if (node->assign_expr_node != NULL) {
-        dump_assign_expr_node(node->assign_expr_node, indent + 2);
+    if (node->assign_expr != 0) {
+        dump_expr(node->assign_expr, indent + 2);
     }
 
     if (node->initializer_list_node != NULL) {
@@ -677,8 +448,8 @@ static void dump_labeled_stmt_node(const LabeledStmtNode* node, int indent) {
         decode_labeled_stmt_type(node->labeled_stmt_type)
     );
 
-    if (node->conditional_expr_node != NULL) {
-        dump_conditional_expr_node(node->conditional_expr_node, indent + 2 );
+    if (node->conditional_expr != 0) {
+        dump_expr(node->conditional_expr, indent + 2);
     }
 
     if (node->stmt_node != NULL) {
@@ -689,8 +460,8 @@ static void dump_labeled_stmt_node(const LabeledStmtNode* node, int indent) {
 static void dump_expr_stmt_node(const ExprStmtNode* node, int indent) {
     printf_indent(indent, "ExprStmtNode\n");
 
-    if (node->expr_node != NULL) {
-        dump_expr_node(node->expr_node, indent + 2);
+    if (node->expr != 0) {
+        dump_expr(node->expr, indent + 2);
     }
 }
 
@@ -701,8 +472,8 @@ static void dump_selection_stmt_node(const SelectionStmtNode* node, int indent)
         decode_selection_stmt_type(node->selection_type)
     );
 
-    if (node->expr_node != NULL) {
-        dump_expr_node(node->expr_node, indent + 2);
+    if (node->expr != 0) {
+        dump_expr(node->expr, indent + 2);
     }
 
     if (node->stmt_node_0 != NULL) {
@@ -725,16 +496,16 @@ static void dump_itr_stmt_node(const ItrStmtNode* node, int indent) {
         dump_declaration_node(node->declaration_nodes->elements[i], indent + 2);
     }
 
-    if (node->expr_node_0 != NULL) {
-        dump_expr_node(node->expr_node_0, indent + 2);
+    if (node->expr_0 != 0) {
+        dump_expr(node->expr_0, indent + 2);
     }
 
-    if (node->expr_node_1 != NULL) {
-        dump_expr_node(node->expr_node_1, indent + 2);
+    if (node->expr_1 != 0) {
+        dump_expr(node->expr_1, indent + 2);
     }
 
-    if (node->expr_node_2 != NULL) {
-        dump_expr_node(node->expr_node_2, indent + 2);
+    if (node->expr_2 != 0) {
+        dump_expr(node->expr_2, indent + 2);
     }
 
     if (node->stmt_node != NULL) {
@@ -747,11 +518,11 @@ static void dump_jump_stmt_node(const JumpStmtNode* node, int indent) {
         indent, 
         "JumpStmtNode,JumpType=\"%s\",Identifier=\"%s\"\n",
         decode_jump_type(node->jump_type),
-        node->identifier
+        symbol_name(node->identifier)
     );
 
-    if (node->expr_node != NULL) {
-        dump_expr_node(node->expr_node, indent + 2);
+    if (node->expr != 0) {
+        dump_expr(node->expr, indent + 2);
     }
 }
 
@@ -5,6 +5,9 @@
 #include <stdarg.h>
 #include <string.h>
 
+#include "ir.h"
+#include "opt.h"
+#include "regalloc.h"
 #include "util.h"
 
 //
@@ -18,15 +21,67 @@ static int label_index;
 static int string_index;
 static int current_offset;
 static char* ret_label;
-static Vector* localvar_list;
-static Vector* globalvar_list;
-static StrPtrMap* struct_map;  
-static StrIntMap* enum_map;
+static HashMap* localvar_map;    // name => innermost visible LocalVar of the function
+static Vector* localvar_list;    // visible local variables, in the order declared
+static IntStack* scope_stack;    // size of localvar_list when each scope began
+static HashMap* globalvar_map;   // name => GlobalVar
+static HashMap* struct_map;
+static HashMap* enum_map;
+static const ExprPool* expr_pool;
 static Stack* break_label_stack;
 static Stack* continue_label_stack;
+static IntStack* continue_depth_stack; // switch_depth when each loop began
+static int switch_depth;                // switch values pushed on the stack
 static Stack* current_stmt_label_stack;
 static Stack* type_stack;
 static IntStack* size_stack;
+static IntStack* expr_work_stack; // expressions and the steps they are at (see process_expr())
+static Stack* expr_label_stack;   // labels of the && and ?: being generated
+static int output_fd;
+static char* output_buffer;
+static int output_size;
+static bool output_failed; // a write failed, so gen() fails once it is done
+static const GenOptions* gen_options;
+static int rax_reg; // IR register whose value rax holds, 0 if none (see lower_ir())
+static const RegAlloc* ir_alloc;     // of the function lowered from the IR, NULL without regalloc
+static int ir_saved_base;            // the callee-saved registers it uses are kept in the slots after this
+static IntVector* ir_imms;           // by register, the constant it holds
+static IntVector* ir_use_counts;     // by register, the operands it is
+static IntVector* ir_move_dsts;      // the pending parallel move (see emit_ir_moves())
+static IntVector* ir_move_srcs;
+static IntVector* ir_imm_dsts;
+static IntVector* ir_imm_regs;
+
+// the locations of regalloc's machine registers by number (see regalloc.h),
+// then those the lowering of the IR uses besides
+static char* ir_registers[15] = {
+    "", "rcx", "rsi", "rdi", "r8", "r9", "r10", "rbx", "r12", "r13", "r14", "r15", "rax", "rdx", "r11"
+};
+#define IR_LOC_RAX 12
+#define IR_LOC_R11 14
+
+// the registers expressions are evaluated in, as a stack (see "register
+// expressions"), and their low bytes
+static char* expr_registers[9] = {
+    "rax", "rdi", "rsi", "rdx", "rcx", "r8", "r9", "r10", "r11"
+};
+static char* expr_byte_registers[9] = {
+    "al", "dil", "sil", "dl", "cl", "r8b", "r9b", "r10b", "r11b"
+};
+#define REG_EXPR_COUNT 9
+#define EXPR_REG_RAX   0
+#define EXPR_REG_RDX   3
+#define EXPR_REG_R11   8
+
+// deepest expression evaluated in registers, which bounds the recursion
+#define REG_EXPR_MAX_DEPTH 32
+
+// size of the buffer holding assembly until it is written out
+#define OUTPUT_BUFFER_SIZE 65536
+
+// most registers of a function emitted from the IR kept on the stack, which
+// takes 8 bytes for each
+#define IR_MAX_FRAME_REGS 65536
 
 //
 // forward declaration
@@ -34,17 +89,167 @@ static IntStack* size_stack;
 
 static int calc_localvar_size_in_compound_stmt(const CompoundStmtNode* node);
 static int calc_localvar_size_in_stmt(const StmtNode* node);
-static void process_expr(const ExprNode* node);
-static void process_expr_left(const ExprNode* node);
+static void process_expr(int node);
+static void process_expr_left(int node);
+static int get_reg_need(int node, int depth);
+static void process_reg_expr(int node, int reg);
 static void process_stmt(const StmtNode* node);
-static void process_conditional_expr(const ConditionalExprNode* node);
 static void process_compound_stmt(const CompoundStmtNode* node);
-static void process_cast_expr(const CastExprNode* node);
 static void process_declaration(const DeclarationNode* node);
 static Type* process_type_specifier_in_local(const TypeSpecifierNode* node);
-static int get_array_size_from_constant_expr(const ConditionalExprNode* node);
+static int get_array_size_from_constant_expr(int node);
 
-static const char* get_ident_from_direct_declarator(const DirectDeclaratorNode* node) {
+//
+// output
+//
+
+static void write_output(const char* buf, int len) {
+    if (gen_options->output != NULL) {
+        bytebuffer_put_bytes(gen_options->output, buf, len);
+        return;
+    }
+
+    if (output_failed) {
+        return;
+    }
+
+    while (len > 0) {
+        const int written = write(output_fd, buf, len);
+        if (written <= 0) {
+            error("Failed to write output.\n");
+            output_failed = true;
+            return;
+        }
+
+        buf += written;
+        len -= written;
+    }
+}
+
+static void flush_output() {
+    write_output(output_buffer, output_size);
+    output_size = 0;
+}
+
+static void emit_n(const char* str, int len) {
+    // only the IR is written
+    if (gen_options->dump_ir) {
+        return;
+    }
+
+    if (output_size + len > OUTPUT_BUFFER_SIZE) {
+        flush_output();
+    }
+
+    if (len > OUTPUT_BUFFER_SIZE) {
+        write_output(str, len);
+        return;
+    }
+
+    memcpy(output_buffer + output_size, str, len);
+    output_size += len;
+}
+
+static void emit(const char* str) {
+    emit_n(str, strlen(str));
+}
+
+// The digits of a negative n are taken from n itself, since -n overflows
+// for the minimum int.
+static void emit_int(int n) {
+    char buf[24];
+    int pos = 24;
+    const bool negative = (n < 0);
+
+    while (true) {
+        --pos;
+        int digit = n % 10;
+        if (negative) {
+            digit = -digit;
+        }
+        const char c = '0' + digit;
+        buf[pos] = c;
+        n /= 10;
+        if (n == 0) {
+            break;
+        }
+    }
+
+    if (negative) {
+        --pos;
+        buf[pos] = '-';
+    }
+
+    emit_n(buf + pos, 24 - pos);
+}
+
+// "label:"
+static void emit_label(const char* label) {
+    emit(label);
+    emit(":\n");
+}
+
+// ".directive operand"
+static void emit_directive(const char* directive, const char* operand) {
+    emit(directive);
+    emit(" ");
+    emit(operand);
+    emit("\n");
+}
+
+// "  inst n"
+static void emit_inst_int(const char* inst, int n) {
+    emit("  ");
+    emit(inst);
+    emit(" ");
+    emit_int(n);
+    emit("\n");
+}
+
+// "  inst operand" for a register or label operand
+static void emit_inst_op(const char* inst, const char* operand) {
+    emit("  ");
+    emit(inst);
+    emit(" ");
+    emit(operand);
+    emit("\n");
+}
+
+// "  inst [rbp-offset]"
+static void emit_inst_local(const char* inst, int offset) {
+    emit("  ");
+    emit(inst);
+    emit(" [rbp-");
+    emit_int(offset);
+    emit("]\n");
+}
+
+// "  mov [rbp-offset], reg"
+static void emit_store_local(int offset, const char* reg) {
+    emit("  mov [rbp-");
+    emit_int(offset);
+    emit("], ");
+    emit(reg);
+    emit("\n");
+}
+
+// "  inst name[rip]"
+static void emit_inst_global(const char* inst, const char* name) {
+    emit("  ");
+    emit(inst);
+    emit(" ");
+    emit(name);
+    emit("[rip]\n");
+}
+
+// "  .string \"str\""
+static void emit_string(const char* str) {
+    emit("  .string \"");
+    emit(str);
+    emit("\"\n");
+}
+
+static int get_ident_from_direct_declarator(const DirectDeclaratorNode* node) {
     const DirectDeclaratorNode* current = node;
     while (current->direct_declarator_node != NULL) {
         current = current->direct_declarator_node;
@@ -54,14 +259,14 @@ static const char* get_ident_from_direct_declarator(const DirectDeclaratorNode*
 }
 
 static char* get_label() {
-    char buf[8];
-    snprintf(buf, 8, ".L%d", label_index++);
+    char buf[16];
+    snprintf(buf, 16, ".L%d", label_index++);
     return strdup(buf);
 }
 
 static char* get_string_label() {
-    char buf[8];
-    snprintf(buf, 8, ".LC%d", string_index++);
+    char buf[16];
+    snprintf(buf, 16, ".LC%d", string_index++);
     return strdup(buf);
 }
 
@@ -106,63 +311,77 @@ static const char* get_reg(const char* base, int size) {
     }
 }
 
-static LocalVar* get_localvar(const char* str) {
-    for (int i = 0; i < localvar_list->size; ++i) {
-        LocalVar* localvar = localvar_list->elements[i];
-        if (strcmp(localvar->name, str) == 0) {
-            return localvar;
-        }
-    }
+//
+// scope
+//
 
-    return NULL;
+static LocalVar* get_localvar(int name) {
+    return hashmap_get(localvar_map, name);
 }
 
-static GlobalVar* get_globalvar(const char* str) {
-    for (int i = 0; i < globalvar_list->size; ++i) {
-        GlobalVar* gv = globalvar_list->elements[i];
-        if (strcmp(gv->name, str) == 0) {
-            return gv;
-        }
-    }
+static GlobalVar* get_globalvar(int name) {
+    return hashmap_get(globalvar_map, name);
+}
 
-    return NULL;
+// makes lv visible until the end of the current scope
+static void add_localvar(LocalVar* lv) {
+    lv->shadowed = hashmap_get(localvar_map, lv->name);
+    hashmap_put(localvar_map, lv->name, lv);
+    vector_push_back(localvar_list, lv);
+}
+
+static void enter_scope() {
+    intstack_push(scope_stack, localvar_list->size);
+}
+
+// drops the local variables declared since the matching enter_scope()
+static void leave_scope() {
+    const int scope_begin = intstack_top(scope_stack);
+    intstack_pop(scope_stack);
+
+    while (localvar_list->size > scope_begin) {
+        --localvar_list->size;
+        LocalVar* lv = localvar_list->elements[localvar_list->size];
+        hashmap_put(localvar_map, lv->name, lv->shadowed);
+        free(lv);
+    }
 }
 
-static void process_identifier_left(const char* identifier) {
+static void process_identifier_left(int identifier) {
     const LocalVar* lv = get_localvar(identifier);
     if (lv != NULL) {
-        printf("  lea rax, [rbp-%d]\n", lv->offset);
-        printf("  push rax\n");
+        emit_inst_local("lea rax,", lv->offset);
+        emit("  push rax\n");
         stack_push(type_stack, lv->type);
     } 
     else {
         const GlobalVar* gv = get_globalvar(identifier);    
-        printf("  lea rax, %s[rip]\n", gv->name);
-        printf("  push rax\n");
+        emit_inst_global("lea rax,", symbol_name(gv->name));
+        emit("  push rax\n");
         stack_push(type_stack, gv->type);
     }
     intstack_push(size_stack, 8);
 }
 
-static void process_identifier_right(const char* identifier) {
+static void process_identifier_right(int identifier) {
     // enum 
-    if (strintmap_contains(enum_map, identifier)) {
-        printf("  push %d\n", strintmap_get(enum_map, identifier));
+    if (hashmap_contains(enum_map, identifier)) {
+        emit_inst_int("push", hashmap_get_int(enum_map, identifier));
         return;
     } 
 
     // local variable
     const LocalVar* lv = get_localvar(identifier);
     if (lv != NULL) {
-        printf("  lea rax, [rbp-%d]\n", lv->offset);
+        emit_inst_local("lea rax,", lv->offset);
         if (lv->type->array_size == 0) { 
             if (lv->type->type_size == 1 && lv->type->ptr_count == 0) {
-                printf("  movzx eax, BYTE PTR [rax]\n");
+                emit("  movzx eax, BYTE PTR [rax]\n");
             } else { 
-                printf("  mov rax, [rax]\n");
+                emit("  mov rax, [rax]\n");
             }
         } 
-        printf("  push rax\n");
+        emit("  push rax\n");
         intstack_push(size_stack, lv->type->size);
         stack_push(type_stack, lv->type);
 
@@ -171,39 +390,46 @@ static void process_identifier_right(const char* identifier) {
 
     // global variable
     const GlobalVar* gv = get_globalvar(identifier);
-    printf("  lea rax, %s[rip]\n", gv->name);
+    emit_inst_global("lea rax,", symbol_name(gv->name));
     if (gv->type->array_size == 0) {
         if (gv->type->type_size == 1 && gv->type->ptr_count == 0) {
-            printf("  movzx eax, BYTE PTR [rax]\n");
+            emit("  movzx eax, BYTE PTR [rax]\n");
         } else { 
-            printf("  mov rax, [rax]\n");
+            emit("  mov rax, [rax]\n");
         }
     }
-    printf("  push rax\n");
+    emit("  push rax\n");
     intstack_push(size_stack, gv->type->size);
     stack_push(type_stack, gv->type);
 }
 
-static void process_constant_node(const ConstantNode* node) {
-    switch (node->const_type) {
+static void process_constant(int node) {
+    switch (expr_op(expr_pool, node)) {
     case CONST_BYTE: {
-        printf("  push %d\n", node->integer_constant);
+        emit_inst_int("push", expr_val(expr_pool, node));
         intstack_push(size_stack, 1);
         break;
     }
     case CONST_INT: {
-        printf("  push %d\n", node->integer_constant);
+        // push takes a 32-bit immediate, mov a 64-bit one
+        if (is_ir_immediate(expr_val(expr_pool, node))) {
+            emit_inst_int("push", expr_val(expr_pool, node));
+        }
+        else {
+            emit_inst_int("mov rax,", expr_val(expr_pool, node));
+            emit("  push rax\n");
+        }
         intstack_push(size_stack, 8);
         break;
     }
     case CONST_STR: {
         const char* label = get_string_label();
-        printf(".data\n");
-        printf("%s:\n", label);
-        printf("  .string \"%s\"\n", node->character_constant);
-        printf(".text\n");
-        printf("  lea rax, %s[rip]\n", label);
-        printf("  push rax\n");
+        emit(".section .rodata\n");
+        emit_label(label);
+        emit_string(symbol_name(expr_val(expr_pool, node)));
+        emit(".text\n");
+        emit_inst_global("lea rax,", label);
+        emit("  push rax\n");
         break;
     }
     case CONST_FLOAT: {
@@ -216,137 +442,144 @@ static void process_constant_node(const ConstantNode* node) {
     }
 }
 
-static void process_primary_expr_left(const PrimaryExprNode* node) {
-    // constant
-    if (node->constant_node != NULL) {
-        process_constant_node(node->constant_node);
-    }
-    // ( expression )
-    else if (node->expr_node != NULL) {
-        process_expr_left(node->expr_node);
-    }
-    // identifier
-    else if (node->identifier != NULL) {
-        process_identifier_left(node->identifier);
+static void process_sizeof_type(const TypeNameNode* type_name_node) {
+    int size = 0;
+    if (type_name_node->is_pointer) {
+        size = 8;
     }
     else {
-        // @todo
+        const TypeSpecifierNode* type_specifier_node = type_name_node->specifier_qualifier_node->type_specifier_node; 
+        switch (type_specifier_node->type_specifier) {
+        case TYPE_CHAR:   { size = 1; break; }
+        case TYPE_INT:    { size = 8; break; }
+        case TYPE_DOUBLE: { size = 8; break; } 
+        case TYPE_STRUCT: { 
+            const StructSpecifierNode* struct_specifier_node = type_specifier_node->struct_specifier_node;
+            const int ident = struct_specifier_node->identifier;
+            const StructInfo* struct_info1 = hashmap_get(struct_map, ident);
+            size = struct_info1->size;
+            break;                                   
+        }
+        case TYPE_TYPEDEFNAME: {
+            const StructInfo* struct_info2 = hashmap_get(struct_map, type_specifier_node->struct_name);
+            size = struct_info2->size;
+            break;
+        }
+        default: {
+            break;
+        }
+        }
     }
-}
 
-static void process_primary_expr_right(const PrimaryExprNode* node) {
-    // constant
-    if (node->constant_node != NULL) {
-        process_constant_node(node->constant_node);
-    }
-    // ( expression )
-    else if (node->expr_node != NULL) {
-        process_expr(node->expr_node);
-    }
-    // identifier
-    else if (node->identifier != NULL) {
-        process_identifier_right(node->identifier);
-    }
-    else {
-        // @todo
-    }
+    emit_inst_int("push", size);
 }
 
-static void process_postfix_expr_left(const PostfixExprNode* node) {
-    switch (node->postfix_expr_type) {
-    // primary-expression
-    case PS_PRIMARY: {
-        process_primary_expr_left(node->primary_expr_node);
+// pushes the address of an lvalue (or, for a few forms, its value)
+static void process_expr_left(int node) {
+    switch (expr_kind(expr_pool, node)) {
+    case EXPR_CONST: {
+        process_constant(node);
+        break;
+    }
+    case EXPR_IDENT: {
+        process_identifier_left(expr_val(expr_pool, node));
         break;
     }
-    // postfix-expression [ expression ]
-    case PS_LSQUARE: {
-        process_postfix_expr_left(node->postfix_expr_node);
+    // expression [ expression ]
+    case EXPR_INDEX: {
+        process_expr_left(expr_lhs(expr_pool, node));
 
         Type* type1 = stack_top(type_stack);
         stack_pop(type_stack);
 
-        process_expr(node->expr_node);
+        process_expr(expr_rhs(expr_pool, node));
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
+        emit("  pop rdi\n");
+        emit("  pop rax\n");
         if (type1->array_size) {
             if (type1->ptr_count > 0) {
-                printf("  imul rdi, 8\n");
-                printf("  mov rax, [rax]\n");
+                emit("  imul rdi, 8\n");
+                emit("  mov rax, [rax]\n");
             } else {
-                printf("  imul rdi, %d\n", type1->type_size);
+                emit_inst_int("imul rdi,", type1->type_size);
             }
         } else {
             if (type1->ptr_count > 1) {
-                printf("  imul rdi, 8\n");
-                printf("  mov rax, [rax]\n");
+                emit("  imul rdi, 8\n");
+                emit("  mov rax, [rax]\n");
             } else {
-                printf("  imul rdi, %d\n", type1->type_size);
-                printf("  mov rax, [rax]\n");
+                emit_inst_int("imul rdi,", type1->type_size);
+                emit("  mov rax, [rax]\n");
             }
         }
 
-        printf("  add rax, rdi\n");
-        printf("  push rax\n");
+        emit("  add rax, rdi\n");
+        emit("  push rax\n");
 
         stack_push(type_stack, type1);
         break;
     }
-    // postfix-expression . identifier
-    case PS_DOT: {
-        process_postfix_expr_left(node->postfix_expr_node);
+    // expression . identifier
+    case EXPR_DOT: {
+        process_expr_left(expr_lhs(expr_pool, node));
 
         Type* type2 = stack_top(type_stack);
         stack_pop(type_stack);
 
-        const FieldInfo* field_info1 = strptrmap_get(type2->struct_info->field_info_map, node->identifier);
+        const FieldInfo* field_info1 = hashmap_get(type2->struct_info->field_info_map, expr_val(expr_pool, node));
 
-        printf("  pop rax\n");
-        printf("  add rax, %d\n", field_info1->offset);
-        printf("  push rax\n");
+        emit("  pop rax\n");
+        emit_inst_int("add rax,", field_info1->offset);
+        emit("  push rax\n");
 
         break;        
     }
-    // postfix-expression -> identifier
-    case PS_ARROW: {
-        process_postfix_expr_left(node->postfix_expr_node);
+    // expression -> identifier
+    case EXPR_ARROW: {
+        process_expr_left(expr_lhs(expr_pool, node));
 
         Type* type3 = stack_top(type_stack);
         stack_pop(type_stack);
 
-        const FieldInfo* field_info2 = strptrmap_get(type3->struct_info->field_info_map, node->identifier);
+        const FieldInfo* field_info2 = hashmap_get(type3->struct_info->field_info_map, expr_val(expr_pool, node));
         stack_push(type_stack, field_info2->type);
 
-        printf("  pop rax\n");
-        printf("  mov rax, [rax]\n");
-        printf("  add rax, %d\n", field_info2->offset);
-        printf("  push rax\n");
+        emit("  pop rax\n");
+        emit("  mov rax, [rax]\n");
+        emit_inst_int("add rax,", field_info2->offset);
+        emit("  push rax\n");
 
         break;        
     }
-    // postfix-expression ++
-    case PS_INC: {
-        process_postfix_expr_left(node->postfix_expr_node);
-        printf("  pop rax\n");
-        printf("  mov rdi, [rax]\n");
-        printf("  push rdi\n");
-        printf("  push 1\n");
-        printf("  pop rdi\n");
-        printf("  add [rax], rdi\n");
+    // expression ++
+    case EXPR_POST_INC: {
+        process_expr_left(expr_lhs(expr_pool, node));
+        emit("  pop rax\n");
+        emit("  mov rdi, [rax]\n");
+        emit("  push rdi\n");
+        emit("  push 1\n");
+        emit("  pop rdi\n");
+        emit("  add [rax], rdi\n");
         break;                       
     }
-    // postfix-expression --
-    case PS_DEC: {
-        process_postfix_expr_left(node->postfix_expr_node);
-        printf("  pop rax\n");
-        printf("  mov rdi, [rax]\n");
-        printf("  push rdi\n");
-        printf("  push 1\n");
-        printf("  pop rdi\n");
-        printf("  sub [rax], rdi\n");
+    // expression --
+    case EXPR_POST_DEC: {
+        process_expr_left(expr_lhs(expr_pool, node));
+        emit("  pop rax\n");
+        emit("  mov rdi, [rax]\n");
+        emit("  push rdi\n");
+        emit("  push 1\n");
+        emit("  pop rdi\n");
+        emit("  sub [rax], rdi\n");
         break;                       
     }
+    // * expression
+    case EXPR_UNARY: {
+        if (expr_op(expr_pool, node) == OP_MUL) {
+            process_expr(expr_lhs(expr_pool, node));
+        }
+        break;
+    }
     default: {
         // @todo
         break;
@@ -354,163 +587,121 @@ static void process_postfix_expr_left(const PostfixExprNode* node) {
     }
 }
 
-static void process_postfix_expr_right(const PostfixExprNode* node) {
-    switch (node->postfix_expr_type) {
-    // primary-expression
-    case PS_PRIMARY: {
-        process_primary_expr_right(node->primary_expr_node);
-        break;
+static void process_call(int node) {
+    for (int i = 0; i < expr_arg_count(expr_pool, node); ++i) {
+        process_expr(expr_arg(expr_pool, node, i));
     }
-    // postfix-expression ( {assignment-expression}* )
-    case PS_LPAREN: {
-        for (int i = 0; i < node->assign_expr_nodes->size; ++i) {
-            const AssignExprNode* assign_expr_node = node->assign_expr_nodes->elements[i];
-            process_conditional_expr(assign_expr_node->conditional_expr_node);
-        }
-
-        for (int j = node->assign_expr_nodes->size - 1; j >= 0; --j) {
-            printf("  pop rax\n");
-            printf("  mov %s, rax\n", arg_registers[j]);
-        }
 
-        const char* identifier = node->postfix_expr_node->primary_expr_node->identifier;
-        printf("  mov rax, 0\n");
-        printf("  call %s\n", identifier);
-        printf("  push rax\n");
-        intstack_push(size_stack, 8);
-
-        break;
+    for (int j = expr_arg_count(expr_pool, node) - 1; j >= 0; --j) {
+        emit("  pop rax\n");
+        emit("  mov ");
+        emit(arg_registers[j]);
+        emit(", rax\n");
     }
-    // postfix-expression [ expression ]
-    case PS_LSQUARE: {
-        process_postfix_expr_right(node->postfix_expr_node);
 
-        Type* type1 = stack_top(type_stack);
-        stack_pop(type_stack);
+    emit("  mov rax, 0\n");
+    emit_inst_op("call", symbol_name(expr_val(expr_pool, node)));
+    emit("  push rax\n");
+    intstack_push(size_stack, 8);
+}
 
-        process_expr(node->expr_node);
+static void process_index_right(int node) {
+    process_expr(expr_lhs(expr_pool, node));
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
+    Type* type1 = stack_top(type_stack);
+    stack_pop(type_stack);
 
-        if (type1->array_size > 0) {
-            if (type1->ptr_count > 0) {
-                printf("  imul rdi, 8\n");
-            } else {
-                printf("  imul rdi, %d\n", type1->type_size);
-            }
+    process_expr(expr_rhs(expr_pool, node));
 
-            printf("  add rax, rdi\n");
-            printf("  mov rax, [rax]\n");
-        }
-        else {
-            if (type1->ptr_count > 1) {
-                printf("  imul rdi, 8\n");
-            } else {
-                printf("  imul rdi, %d\n", type1->type_size);
-            }
-            printf("  add rax, rdi\n");
-            if (type1->type_size == 1 && type1->ptr_count < 2) {
-                printf("  movzx eax, BYTE PTR [rax]\n");
-            } else {
-                printf("  mov rax, [rax]\n");
-            } 
+    emit("  pop rdi\n");
+    emit("  pop rax\n");
+
+    if (type1->array_size > 0) {
+        if (type1->ptr_count > 0) {
+            emit("  imul rdi, 8\n");
+        } else {
+            emit_inst_int("imul rdi,", type1->type_size);
         }
-        printf("  push rax\n");
 
-        break;
+        emit("  add rax, rdi\n");
+        emit("  mov rax, [rax]\n");
     }
-    // postfix-expression . identifier
-    case PS_DOT: {
-        process_postfix_expr_left(node->postfix_expr_node);
-
-        Type* type2 = stack_top(type_stack);
-        stack_pop(type_stack);
-
-        const FieldInfo* field_info1 = strptrmap_get(type2->struct_info->field_info_map, node->identifier);
-
-        printf("  pop rax\n");
-        printf("  add rax, %d\n", field_info1->offset);
-        printf("  push [rax]\n");
-        break;        
+    else {
+        if (type1->ptr_count > 1) {
+            emit("  imul rdi, 8\n");
+        } else {
+            emit_inst_int("imul rdi,", type1->type_size);
+        }
+        emit("  add rax, rdi\n");
+        if (type1->type_size == 1 && type1->ptr_count < 2) {
+            emit("  movzx eax, BYTE PTR [rax]\n");
+        } else {
+            emit("  mov rax, [rax]\n");
+        } 
     }
-    // postfix-expression -> identifier
-    case PS_ARROW: {
-        process_postfix_expr_left(node->postfix_expr_node);
-
-        Type* type3 = stack_top(type_stack);
-        stack_pop(type_stack);
-
-        const FieldInfo* field_info2 = strptrmap_get(type3->struct_info->field_info_map, node->identifier);
-        stack_push(type_stack, field_info2->type);
-
-        printf("  pop rax\n");
-        printf("  mov rax, [rax]\n");
-        printf("  add rax, %d\n", field_info2->offset);
-        printf("  push [rax]\n");
+    emit("  push rax\n");
+}
 
-        break;        
+// the operand is on the stack (see process_expr())
+static void process_unary_right(int node) {
+    switch (expr_op(expr_pool, node)) {
+    case OP_MUL: {
+        emit("  pop rax\n");
+        emit("  mov rax, [rax]\n");
+        emit("  push rax\n");
+        break;
     }
-    // postfix-expression ++
-    case PS_INC: {
-        process_postfix_expr_left(node->postfix_expr_node);
-        printf("  pop rax\n");
-        printf("  mov rdi, [rax]\n");
-        printf("  push rdi\n");
-        printf("  push 1\n");
-        printf("  pop rdi\n");
-        printf("  add [rax], rdi\n");
-        break;                       
+    case OP_SUB: {
+        emit("  pop rdi\n");
+        emit("  mov rax, 0\n");
+        emit("  sub rax, rdi\n");
+        emit("  push rax\n");
+        break;
     }
-    // postfix-expression --
-    case PS_DEC: {
-        process_postfix_expr_left(node->postfix_expr_node);
-        printf("  pop rax\n");
-        printf("  mov rdi, [rax]\n");
-        printf("  push rdi\n");
-        printf("  push 1\n");
-        printf("  pop rdi\n");
-        printf("  sub [rax], rdi\n");
-        break;                       
+    case OP_EXCLA: {
+        emit("  pop rax\n");
+        emit("  cmp rax, 0\n");
+        emit("  sete al\n");
+        emit("  movzb rax, al\n");
+        emit("  push rax\n");
+        break;
     }
     default: {
-        // @todo
         break;
     }
     }
 }
 
-static void process_unary_expr_left(const UnaryExprNode* node) {
-    switch (node->type) {
-    // postfix-expression
-    case UN_NONE: {
-        process_postfix_expr_left(node->postfix_expr_node);
+// the lhs and rhs are on the stack (see process_expr())
+static void process_binary(int node) {
+    emit("  pop rdi\n");
+    emit("  pop rax\n");
+    switch (expr_op(expr_pool, node)) {
+    case OP_MUL: {
+        emit("  imul rax, rdi\n");
+        emit("  push rax\n");
         break;
     }
-    // ++ unary-expression
-    case UN_INC: {
-        // @todo
+    case OP_DIV: {
+        emit("  cqo\n");
+        emit("  idiv rdi\n");
+        emit("  push rax\n");
         break;
     }
-    case UN_DEC: {
+    case OP_MOD: {
+        emit("  cqo\n");
+        emit("  idiv rdi\n");
+        emit("  push rdx\n");
         break;
     }
-    case UN_OP: {
-        switch (node->op_type) {
-        case OP_MUL: {
-            process_cast_expr(node->cast_expr_node);
-
-            break;
-        }
-        default: {
-            break;
-        }
-        }
-
+    case OP_ADD: {
+        emit("  add rax, rdi\n");
+        emit("  push rax\n");
         break;
     }
-    case UN_SIZEOF_IDENT: 
-    case UN_SIZEOF_TYPE: {
+    case OP_SUB: {
+        emit("  sub rax, rdi\n");
+        emit("  push rax\n");
         break;
     }
     default: {
@@ -519,576 +710,1039 @@ static void process_unary_expr_left(const UnaryExprNode* node) {
     }
 }
 
-static void process_cast_expr_left(const CastExprNode* node) {
-    // unary-expression
-    if (node->unary_expr_node != NULL) {
-        process_unary_expr_left(node->unary_expr_node);
-    }
-    // ( type-name ) cast-expression
-    else {
-        // @todo
+// the lhs and rhs are on the stack (see process_expr())
+static void process_compare(int node) {
+    emit("  pop rdi\n");
+    emit("  pop rax\n");
+    emit("  cmp rax, rdi\n");
+    switch (expr_op(expr_pool, node)) {
+    case CMP_LT: { emit("  setl al\n");  break; }
+    case CMP_GT: { emit("  setg al\n");  break; }
+    case CMP_LE: { emit("  setle al\n"); break; }
+    case CMP_GE: { emit("  setge al\n"); break; }
+    case CMP_EQ: { emit("  sete al\n");  break; }
+    case CMP_NE: { emit("  setne al\n"); break; }
+    default:     { break; }
     }
+    emit("  movzb rax, al\n");
+    emit("  push rax\n");
 }
 
-static void process_unary_expr_right(const UnaryExprNode* node) {
-    switch (node->type) {
-    // postfix-expression
-    case UN_NONE: {
-        process_postfix_expr_right(node->postfix_expr_node);
-        break;
+// the lhs is on the stack (see process_expr())
+static void process_logand_lhs(const char* label1) {
+    emit("  pop rax\n");
+    emit("  cmp rax, 0\n");
+    emit_inst_op("je", label1);
+}
+
+// the rhs is on the stack
+static void process_logand(const char* label1, const char* label2) {
+    emit("  pop rax\n");
+    emit("  cmp rax, 0\n");
+    emit_inst_op("je", label1);
+    emit("  push 1\n");
+    emit_inst_op("jmp", label2);
+    emit_label(label1);
+    emit("  push 0\n");
+    emit_label(label2);
+}
+
+//
+// register expressions
+//
+// With -O1 and up an expression without side effects (constants, variables,
+// arithmetic, compares, || and *) is evaluated in registers instead of on
+// the stack. Sethi-Ullman numbering gives each subtree the registers it
+// needs: the operand that needs more is evaluated first, into the register
+// of the depth it is at, and the other one into the next register, or not
+// at all if the instruction can take it as it is. The registers are taken
+// from expr_registers as a stack, and an operand that does not fit in
+// those left is evaluated after pushing the first one. size_stack and
+// type_stack get what process_expr() would push for the same expression.
+//
+
+// the type of the local or global variable named identifier, NULL if none
+static Type* get_ident_type(int identifier) {
+    const LocalVar* lv = get_localvar(identifier);
+    if (lv != NULL) {
+        return lv->type;
     }
-    // ++ unary-expression
-    case UN_INC: {
-        process_unary_expr_left(node->unary_expr_node);
+    const GlobalVar* gv = get_globalvar(identifier);
+    if (gv != NULL) {
+        return gv->type;
+    }
+    return NULL;
+}
 
-        printf("  pop rax\n");
-        printf("  mov rdi, [rax]\n");
-        printf("  add rdi, 1\n");
-        printf("  mov [rax], rdi\n");
+static bool is_byte_type(const Type* type) {
+    return type->type_size == 1 && type->ptr_count == 0;
+}
 
-        break;
+// "[rbp-offset]" or "name[rip]"
+static void emit_var_operand(int identifier) {
+    const LocalVar* lv = get_localvar(identifier);
+    if (lv != NULL) {
+        emit("[rbp-");
+        emit_int(lv->offset);
+        emit("]");
+        return;
     }
-    // -- unary-expression
-    case UN_DEC: {
-        process_unary_expr_left(node->unary_expr_node);
+    const GlobalVar* gv = get_globalvar(identifier);
+    emit(symbol_name(gv->name));
+    emit("[rip]");
+}
 
-        printf("  pop rax\n");
-        printf("  mov rdi, [rax]\n");
-        printf("  sub rdi, 1\n");
-        printf("  mov [rax], rdi\n");
+// true for an operand an instruction takes as it is: a constant that fits
+// in an immediate, or a variable of 8 bytes
+static bool is_direct_operand(int node) {
+    if (expr_kind(expr_pool, node) == EXPR_CONST) {
+        const int op = expr_op(expr_pool, node);
+        return (op == CONST_INT || op == CONST_BYTE) && is_ir_immediate(expr_val(expr_pool, node));
+    }
+    if (expr_kind(expr_pool, node) != EXPR_IDENT) {
+        return false;
+    }
 
-        break;
+    const int identifier = expr_val(expr_pool, node);
+    if (hashmap_contains(enum_map, identifier)) {
+        return is_ir_immediate(hashmap_get_int(enum_map, identifier));
     }
-    // unary-operator cast-expression
-    case UN_OP: {
-        switch (node->op_type) {
-        case OP_AND: {
-            process_cast_expr_left(node->cast_expr_node);
-            break;
-        }
-        case OP_MUL: {
-            process_cast_expr(node->cast_expr_node);
-            printf("  pop rax\n");
-            printf("  mov rax, [rax]\n");
-            printf("  push rax\n");
-            break;
+    const Type* type = get_ident_type(identifier);
+    return type != NULL && type->array_size == 0 && !is_byte_type(type);
+}
+
+// true if the rhs of a binary node is a direct operand of its instruction
+static bool is_direct_rhs(int node) {
+    if (expr_kind(expr_pool, node) == EXPR_BINARY) {
+        const int op = expr_op(expr_pool, node);
+        if (op == OP_DIV || op == OP_MOD) {
+            return false;
         }
-        case OP_ADD: {
-            break;
+    }
+    return is_direct_operand(expr_rhs(expr_pool, node));
+}
+
+static int get_binary_reg_need(int node, int depth) {
+    const int lhs_need = get_reg_need(expr_lhs(expr_pool, node), depth + 1);
+    if (lhs_need < 0) {
+        return -1;
+    }
+    int rhs_need = get_reg_need(expr_rhs(expr_pool, node), depth + 1);
+    if (rhs_need < 0) {
+        return -1;
+    }
+    if (is_direct_rhs(node)) {
+        rhs_need = 0;
+    }
+
+    if (lhs_need == rhs_need) {
+        return lhs_need + 1;
+    }
+    if (lhs_need > rhs_need) {
+        return lhs_need;
+    }
+    return rhs_need;
+}
+
+// the registers node needs, or -1 if it is not evaluated in registers
+static int get_reg_need(int node, int depth) {
+    if (depth > REG_EXPR_MAX_DEPTH) {
+        return -1;
+    }
+
+    switch (expr_kind(expr_pool, node)) {
+    case EXPR_CONST: {
+        const int const_op = expr_op(expr_pool, node);
+        if (const_op == CONST_INT || const_op == CONST_BYTE) {
+            return 1;
         }
-        case OP_SUB: {
-            process_cast_expr(node->cast_expr_node);
-            printf("  pop rdi\n");
-            printf("  mov rax, 0\n");
-            printf("  sub rax, rdi\n");
-            printf("  push rax\n");
-            break;
+        return -1;
+    }
+    case EXPR_IDENT: {
+        const int identifier = expr_val(expr_pool, node);
+        if (hashmap_contains(enum_map, identifier) || get_ident_type(identifier) != NULL) {
+            return 1;
         }
-        case OP_TILDE: {
-            break;
+        return -1;
+    }
+    case EXPR_UNARY: {
+        const int unary_op = expr_op(expr_pool, node);
+        if (unary_op == OP_ADD || unary_op == OP_SUB || unary_op == OP_EXCLA || unary_op == OP_MUL) {
+            return get_reg_need(expr_lhs(expr_pool, node), depth + 1);
         }
-        case OP_EXCLA: {
-            process_cast_expr(node->cast_expr_node);
-            printf("  pop rax\n");
-            printf("  cmp rax, 0\n");
-            printf("  sete al\n");
-            printf("  movzb rax, al\n");
-            printf("  push rax\n");
-            break;
+        return -1;
+    }
+    case EXPR_BINARY: {
+        const int binary_op = expr_op(expr_pool, node);
+        if (binary_op == OP_ADD || binary_op == OP_SUB || binary_op == OP_MUL || binary_op == OP_DIV || binary_op == OP_MOD) {
+            return get_binary_reg_need(node, depth);
         }
-        default: {
-            break;
+        return -1;
+    }
+    case EXPR_COMPARE:
+    case EXPR_LOGOR: {
+        return get_binary_reg_need(node, depth);
+    }
+    default: {
+        return -1;
+    }
+    }
+}
+
+// true if node is evaluated in registers
+static bool is_reg_expr(int node) {
+    return gen_options->reg_exprs && get_reg_need(node, 0) > 0;
+}
+
+// pushes to size_stack and type_stack what process_expr() would for node
+static void push_reg_expr_types(int node) {
+    switch (expr_kind(expr_pool, node)) {
+    case EXPR_CONST: {
+        if (expr_op(expr_pool, node) == CONST_BYTE) {
+            intstack_push(size_stack, 1);
         }
+        else {
+            intstack_push(size_stack, 8);
         }
-
         break;
     }
-    case UN_SIZEOF_IDENT: {
-        const LocalVar* lv = get_localvar(node->sizeof_name);
-        if (lv != NULL) {
-            printf("  push %d\n", lv->type->type_size);
-        } 
-        else {
-            const GlobalVar* gv = get_globalvar(node->sizeof_name);
-            printf("  push %d\n", gv->type->type_size);
+    case EXPR_IDENT: {
+        if (!hashmap_contains(enum_map, expr_val(expr_pool, node))) {
+            Type* type = get_ident_type(expr_val(expr_pool, node));
+            intstack_push(size_stack, type->size);
+            stack_push(type_stack, type);
         }
         break;
     }
-    case UN_SIZEOF_TYPE: {
-        const TypeNameNode* type_name_node = node->type_name_node;
-        int size = 0;
-        if (type_name_node->is_pointer) {
-            size = 8;
-        }
-        else {
-            const TypeSpecifierNode* type_specifier_node = type_name_node->specifier_qualifier_node->type_specifier_node; 
-            switch (type_specifier_node->type_specifier) {
-            case TYPE_CHAR:   { size = 1; break; }
-            case TYPE_INT:    { size = 8; break; }
-            case TYPE_DOUBLE: { size = 8; break; } 
-            case TYPE_STRUCT: { 
-                const StructSpecifierNode* struct_specifier_node = type_specifier_node->struct_specifier_node;
-                const char* ident = struct_specifier_node->identifier;
-                const StructInfo* struct_info1 = strptrmap_get(struct_map, ident);
-                size = struct_info1->size;
-                break;                                   
-            }
-            case TYPE_TYPEDEFNAME: {
-                const StructInfo* struct_info2 = strptrmap_get(struct_map, type_specifier_node->struct_name);
-                size = struct_info2->size;
-                break;
-            }
-            default: {
-                break;
-            }
-            }
-        }
-
-        printf("  push %d\n", size);
-
+    case EXPR_UNARY: {
+        push_reg_expr_types(expr_lhs(expr_pool, node));
         break;
     }
     default: {
+        push_reg_expr_types(expr_lhs(expr_pool, node));
+        push_reg_expr_types(expr_rhs(expr_pool, node));
         break;
     }
     }
 }
 
-static void process_cast_expr(const CastExprNode* node) {
-    // <unary-expression>
-    if (node->unary_expr_node != NULL) {
-        process_unary_expr_right(node->unary_expr_node);
+// "  inst dst, src" for registers
+static void emit_reg_inst(const char* inst, int dst, int src) {
+    emit("  ");
+    emit(inst);
+    emit(" ");
+    emit(expr_registers[dst]);
+    emit(", ");
+    emit(expr_registers[src]);
+    emit("\n");
+}
+
+// a constant or an enumerator as an immediate, or a variable as memory
+static void emit_leaf_operand(int node) {
+    if (expr_kind(expr_pool, node) == EXPR_CONST) {
+        emit_int(expr_val(expr_pool, node));
+    }
+    else if (hashmap_contains(enum_map, expr_val(expr_pool, node))) {
+        emit_int(hashmap_get_int(enum_map, expr_val(expr_pool, node)));
     }
-    // ( <type-name> ) <cast-expression>
     else {
-        // @todo
+        emit_var_operand(expr_val(expr_pool, node));
     }
 }
 
-static void process_multiplicative_expr(const MultiPlicativeExprNode* node) {
-    // <cast-expression>
-    if (node->multiplicative_expr_node == NULL) {
-        process_cast_expr(node->cast_expr_node);
+static void process_reg_leaf(int node, int reg) {
+    const char* inst = "mov";
+    if (expr_kind(expr_pool, node) == EXPR_IDENT && !hashmap_contains(enum_map, expr_val(expr_pool, node))) {
+        const Type* type = get_ident_type(expr_val(expr_pool, node));
+        if (type->array_size != 0) {
+            inst = "lea";
+        }
+        else if (is_byte_type(type)) {
+            inst = "movzx";
+        }
     }
-    //   <multiplicative-expression> * <cast-expression>
-    // | <multiplicative-expression> / <cast-expression>
-    // | <multiplicative-expression> % <cast-expression>
-    else if (node->operator_type == OP_MUL) {
-        process_multiplicative_expr(node->multiplicative_expr_node);
-        process_cast_expr(node->cast_expr_node);
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  imul rax, rdi\n");
-        printf("  push rax\n");
+    emit("  ");
+    emit(inst);
+    emit(" ");
+    emit(expr_registers[reg]);
+    emit(", ");
+    if (strcmp(inst, "movzx") == 0) {
+        emit("BYTE PTR ");
+    }
+    emit_leaf_operand(node);
+    emit("\n");
+}
+
+// Evaluates the operands of a binary node into reg and the register after
+// it, the one that needs more first, or only the lhs into reg if the rhs
+// is direct. Returns true if the rhs went first.
+static bool process_reg_operands(int node, int reg) {
+    const int lhs = expr_lhs(expr_pool, node);
+    const int rhs = expr_rhs(expr_pool, node);
+    if (is_direct_rhs(node)) {
+        process_reg_expr(lhs, reg);
+        return false;
+    }
+
+    int first  = lhs;
+    int second = rhs;
+    const bool swapped = (get_reg_need(rhs, 0) > get_reg_need(lhs, 0));
+    if (swapped) {
+        first  = rhs;
+        second = lhs;
+    }
+    process_reg_expr(first, reg);
+    if (get_reg_need(second, 0) < REG_EXPR_COUNT - reg) {
+        process_reg_expr(second, reg + 1);
+        return swapped;
+    }
+
+    // the registers ran out
+    emit_inst_op("push", expr_registers[reg]);
+    process_reg_expr(second, reg);
+    emit_reg_inst("mov", reg + 1, reg);
+    emit_inst_op("pop", expr_registers[reg]);
+    return swapped;
+}
+
+// "  inst reg, rhs" once process_reg_operands() put the lhs in reg
+static void emit_reg_rhs_inst(const char* inst, int node, int reg) {
+    emit("  ");
+    emit(inst);
+    emit(" ");
+    emit(expr_registers[reg]);
+    emit(", ");
+    if (is_direct_rhs(node)) {
+        emit_leaf_operand(expr_rhs(expr_pool, node));
+    }
+    else {
+        emit(expr_registers[reg + 1]);
     }
-    else if (node->operator_type == OP_DIV) {
-        process_multiplicative_expr(node->multiplicative_expr_node);
-        process_cast_expr(node->cast_expr_node);
+    emit("\n");
+}
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  cqo\n");
-        printf("  idiv rdi\n");
-        printf("  push rax\n");
+// reg = dividend / divisor, or % with is_mod, keeping the values the
+// registers below reg hold; idiv takes rax and rdx
+static void emit_reg_div(bool is_mod, int reg, int dividend, int divisor) {
+    const bool save_rax = (reg > EXPR_REG_RAX);
+    const bool save_rdx = (reg > EXPR_REG_RDX);
+    if (save_rax) {
+        emit("  push rax\n");
+    }
+    if (save_rdx) {
+        emit("  push rdx\n");
+    }
+    if (divisor == EXPR_REG_RAX || divisor == EXPR_REG_RDX) {
+        emit_reg_inst("mov", EXPR_REG_R11, divisor);
+        divisor = EXPR_REG_R11;
     }
-    else if (node->operator_type == OP_MOD) {
-        process_multiplicative_expr(node->multiplicative_expr_node);
-        process_cast_expr(node->cast_expr_node);
+    if (dividend != EXPR_REG_RAX) {
+        emit_reg_inst("mov", EXPR_REG_RAX, dividend);
+    }
+    emit("  cqo\n");
+    emit_inst_op("idiv", expr_registers[divisor]);
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  cqo\n");
-        printf("  idiv rdi\n");
-        printf("  push rdx\n");
+    int result = EXPR_REG_RAX;
+    if (is_mod) {
+        result = EXPR_REG_RDX;
+    }
+    if (reg != result) {
+        emit_reg_inst("mov", reg, result);
+    }
+    if (save_rdx) {
+        emit("  pop rdx\n");
+    }
+    if (save_rax) {
+        emit("  pop rax\n");
     }
 }
 
-static void process_additive_expr(const AdditiveExprNode* node) {
-    // <multiplicative-expression>
-    if (node->additive_expr_node == NULL) {
-        process_multiplicative_expr(node->multiplicative_expr_node);
+// sets the flags to compare the operands of node
+static void process_reg_compare(int node, int reg) {
+    if (process_reg_operands(node, reg)) {
+        emit_reg_inst("cmp", reg + 1, reg);
+    }
+    else {
+        emit_reg_rhs_inst("cmp", node, reg);
     }
-    //  <additive-expression> + <multiplicative-expression>
-    else if (node->operator_type == OP_ADD) {
-        process_additive_expr(node->additive_expr_node);
-        process_multiplicative_expr(node->multiplicative_expr_node);
+}
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  add rax, rdi\n");
-        printf("  push rax\n");
+// the condition of a compare, as in setl and jl
+static const char* get_compare_condition(int op) {
+    switch (op) {
+    case CMP_LT: { return "l"; }
+    case CMP_GT: { return "g"; }
+    case CMP_LE: { return "le"; }
+    case CMP_GE: { return "ge"; }
+    case CMP_EQ: { return "e"; }
+    default:     { return "ne"; }
     }
-    // <additive-expression> - <multiplicative-expression>
-    else if (node->operator_type == OP_SUB) {
-        process_additive_expr(node->additive_expr_node);
-        process_multiplicative_expr(node->multiplicative_expr_node);
+}
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  sub rax, rdi\n");
-        printf("  push rax\n");
+static int negate_compare(int op) {
+    switch (op) {
+    case CMP_LT: { return CMP_GE; }
+    case CMP_GT: { return CMP_LE; }
+    case CMP_LE: { return CMP_GT; }
+    case CMP_GE: { return CMP_LT; }
+    case CMP_EQ: { return CMP_NE; }
+    default:     { return CMP_EQ; }
     }
 }
 
-static void process_shift_expr(const ShiftExprNode* node) {
-    // <additive-expression>
-    if (node->shift_expr_node == NULL) {
-        process_additive_expr(node->additive_expr_node);
+// "  set<cc> reg" and its zero extension
+static void emit_reg_set(const char* condition, int reg) {
+    emit("  set");
+    emit(condition);
+    emit(" ");
+    emit(expr_byte_registers[reg]);
+    emit("\n");
+    emit("  movzx ");
+    emit(expr_registers[reg]);
+    emit(", ");
+    emit(expr_byte_registers[reg]);
+    emit("\n");
+}
+
+static void process_reg_binary(int node, int reg) {
+    const int op = expr_op(expr_pool, node);
+    const bool swapped = process_reg_operands(node, reg);
+    if (op == OP_DIV || op == OP_MOD) {
+        if (swapped) {
+            emit_reg_div(op == OP_MOD, reg, reg + 1, reg);
+        }
+        else {
+            emit_reg_div(op == OP_MOD, reg, reg, reg + 1);
+        }
+        return;
+    }
+
+    const char* inst = "or";
+    if (expr_kind(expr_pool, node) == EXPR_BINARY) {
+        switch (op) {
+        case OP_ADD: { inst = "add";  break; }
+        case OP_SUB: { inst = "sub";  break; }
+        case OP_MUL: { inst = "imul"; break; }
+        default:     { break; }
+        }
+    }
+    if (!swapped) {
+        emit_reg_rhs_inst(inst, node, reg);
+    }
+    else if (strcmp(inst, "sub") != 0) {
+        emit_reg_inst(inst, reg, reg + 1);
     }
-    //   <shift-expression> << <additive-expression>
-    // | <shift-expression> >> <additive-expression>
     else {
-        // @todo
+        emit_reg_inst("sub", reg + 1, reg);
+        emit_reg_inst("mov", reg, reg + 1);
     }
 }
 
-static void process_relational_expr(const RelationalExprNode* node) {
-    switch (node->cmp_type) {
-    // <shift-expression>
-    case CMP_NONE: {
-        process_shift_expr(node->shift_expr_node);
+// evaluates node, for which get_reg_need() is positive, into reg
+static void process_reg_expr(int node, int reg) {
+    switch (expr_kind(expr_pool, node)) {
+    case EXPR_CONST:
+    case EXPR_IDENT: {
+        process_reg_leaf(node, reg);
         break;
     }
-    // <relational-expression> <  <shift-expression>
-    case CMP_LT: {
-        process_relational_expr(node->relational_expr_node);
-        process_shift_expr(node->shift_expr_node);
-
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  cmp rax, rdi\n");
-        printf("  setl al\n");
-        printf("  movzb rax, al\n");
-        printf("  push rax\n");
-
+    case EXPR_UNARY: {
+        process_reg_expr(expr_lhs(expr_pool, node), reg);
+        const int op = expr_op(expr_pool, node);
+        if (op == OP_SUB) {
+            emit_inst_op("neg", expr_registers[reg]);
+        }
+        else if (op == OP_EXCLA) {
+            emit("  cmp ");
+            emit(expr_registers[reg]);
+            emit(", 0\n");
+            emit_reg_set("e", reg);
+        }
+        else if (op == OP_MUL) {
+            emit("  mov ");
+            emit(expr_registers[reg]);
+            emit(", [");
+            emit(expr_registers[reg]);
+            emit("]\n");
+        }
+        break;
+    }
+    case EXPR_COMPARE: {
+        process_reg_compare(node, reg);
+        emit_reg_set(get_compare_condition(expr_op(expr_pool, node)), reg);
+        break;
+    }
+    default: {
+        process_reg_binary(node, reg);
         break;
     }
-    // <relational-expression> >  <shift-expression>
-    case CMP_GT: {
-        process_relational_expr(node->relational_expr_node);
-        process_shift_expr(node->shift_expr_node);
+    }
+}
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  cmp rax, rdi\n");
-        printf("  setg al\n");
-        printf("  movzb rax, al\n");
-        printf("  push rax\n");
+// leaves the value of an expression in rax
+static void process_expr_value(int node) {
+    if (is_reg_expr(node)) {
+        push_reg_expr_types(node);
+        process_reg_expr(node, EXPR_REG_RAX);
+        return;
+    }
+    process_expr(node);
+    emit("  pop rax\n");
+}
 
-        break;
+// jumps to label if the value of an expression is 0
+static void process_cond_jump(int node, const char* label) {
+    if (expr_kind(expr_pool, node) == EXPR_COMPARE && is_reg_expr(node)) {
+        push_reg_expr_types(node);
+        process_reg_compare(node, EXPR_REG_RAX);
+        emit("  j");
+        emit(get_compare_condition(negate_compare(expr_op(expr_pool, node))));
+        emit(" ");
+        emit(label);
+        emit("\n");
+        return;
     }
-    // <relational-expression> <= <shift-expression>
-    case CMP_LE: {
-        process_relational_expr(node->relational_expr_node);
-        process_shift_expr(node->shift_expr_node);
+    process_expr_value(node);
+    emit("  cmp rax, 0\n");
+    emit_inst_op("je", label);
+}
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  cmp rax, rdi\n");
-        printf("  setle al\n");
-        printf("  movzb rax, al\n");
-        printf("  push rax\n");
+// the destination of an assignment (see process_reg_assign())
+static void emit_assign_dest(int lhs, bool is_var) {
+    if (is_var) {
+        emit_var_operand(expr_val(expr_pool, lhs));
+    }
+    else {
+        emit("[rdi]");
+    }
+}
 
-        break;
+// "  inst dest, reg"
+static void emit_assign_store(const char* inst, int lhs, bool is_var, const char* reg) {
+    emit("  ");
+    emit(inst);
+    emit(" ");
+    emit_assign_dest(lhs, is_var);
+    emit(", ");
+    emit(reg);
+    emit("\n");
+}
+
+// "  inst rax, dest"
+static void emit_assign_load(const char* inst, int lhs, bool is_var) {
+    emit("  ");
+    emit(inst);
+    emit(" rax, ");
+    emit_assign_dest(lhs, is_var);
+    emit("\n");
+}
+
+static bool is_reg_assign(int node) {
+    const int op = expr_op(expr_pool, node);
+    if (op != OP_ASSIGN && op != OP_MUL_EQ && op != OP_DIV_EQ && op != OP_MOD_EQ && op != OP_ADD_EQ && op != OP_SUB_EQ) {
+        return false;
     }
-    // <relational-expression> >= <shift-expression>
-    case CMP_GE: {
-        process_relational_expr(node->relational_expr_node);
-        process_shift_expr(node->shift_expr_node);
+    return is_reg_expr(expr_rhs(expr_pool, node));
+}
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  cmp rax, rdi\n");
-        printf("  setge al\n");
-        printf("  movzb rax, al\n");
-        printf("  push rax\n");
+// An assignment whose rhs is evaluated in registers. A variable is stored
+// to as it is, anything else through its address, which is popped into rdi.
+static void process_reg_assign(int node) {
+    const int lhs = expr_lhs(expr_pool, node);
+    bool is_var = false;
+    if (expr_kind(expr_pool, lhs) == EXPR_IDENT) {
+        Type* type = get_ident_type(expr_val(expr_pool, lhs));
+        if (type != NULL && type->array_size == 0) {
+            is_var = true;
+            stack_push(type_stack, type);
+            intstack_push(size_stack, 8);
+        }
+    }
+    if (!is_var) {
+        process_expr_left(lhs);
+    }
 
+    process_expr_value(expr_rhs(expr_pool, node));
+    if (!is_var) {
+        emit("  pop rdi\n");
+    }
+
+    switch (expr_op(expr_pool, node)) {
+    case OP_ASSIGN: {
+        const int size = intstack_top(size_stack);
+        intstack_pop(size_stack);
+        emit_assign_store("mov", lhs, is_var, get_reg("ax", size));
+        break;
+    }
+    case OP_ADD_EQ: {
+        emit_assign_store("add", lhs, is_var, "rax");
+        break;
+    }
+    case OP_SUB_EQ: {
+        emit_assign_store("sub", lhs, is_var, "rax");
+        break;
+    }
+    case OP_MUL_EQ: {
+        emit_assign_load("imul", lhs, is_var);
+        emit_assign_store("mov", lhs, is_var, "rax");
         break;
     }
     default: {
+        emit("  mov rsi, rax\n");
+        emit_assign_load("mov", lhs, is_var);
+        emit("  cqo\n");
+        emit("  idiv rsi\n");
+        if (expr_op(expr_pool, node) == OP_MOD_EQ) {
+            emit_assign_store("mov", lhs, is_var, "rdx");
+        }
+        else {
+            emit_assign_store("mov", lhs, is_var, "rax");
+        }
         break;
     }
     }
 }
 
-static void process_equality_expr(const EqualityExprNode* node) {
-    switch (node->cmp_type) {
-    // <relational-expression>
-    case CMP_NONE: {
-        process_relational_expr(node->relational_expr_node);
-        break;
+// false for the expressions process_expr() leaves nothing on the stack for:
+// assignments and prefix increments, and commas or conditionals ending in one
+static bool has_value(int node) {
+    int current = node;
+    while (true) {
+        switch (expr_kind(expr_pool, current)) {
+        case EXPR_ASSIGN:
+        case EXPR_PRE_INC:
+        case EXPR_PRE_DEC: {
+            return false;
+        }
+        case EXPR_COMMA: {
+            current = expr_rhs(expr_pool, current);
+            break;
+        }
+        case EXPR_COND: {
+            current = expr_mid(expr_pool, current);
+            break;
+        }
+        default: {
+            return true;
+        }
+        }
     }
-    // <equality-expression> == <relational-expression>
-    case CMP_EQ: {
-        process_equality_expr(node->equality_expr_node);
-        process_relational_expr(node->relational_expr_node);
+}
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  cmp rax, rdi\n");
-        printf("  sete al\n");
-        printf("  movzb rax, al\n");
-        printf("  push rax\n");
+// evaluates an expression for its side effects only
+static void process_expr_discard(int node) {
+    if (has_value(node)) {
+        process_expr_value(node);
+    }
+    else {
+        process_expr(node);
+    }
+}
 
-        break;
+// true if the expression evaluates its lhs and then its rhs
+static bool is_chain_expr(int node) {
+    switch (expr_kind(expr_pool, node)) {
+    case EXPR_BINARY:
+    case EXPR_COMPARE:
+    case EXPR_LOGAND:
+    case EXPR_LOGOR:
+    case EXPR_COMMA: {
+        return true;
     }
-    // <equality-expression> != <relational-expression>
-    case CMP_NE: {
-        process_equality_expr(node->equality_expr_node);
-        process_relational_expr(node->relational_expr_node);
+    default: {
+        return false;
+    }
+    }
+}
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  cmp rax, rdi\n");
-        printf("  setne al\n");
-        printf("  movzb rax, al\n");
-        printf("  push rax\n");
+// the address of the lhs and the rhs are on the stack (see process_expr())
+static void process_assign(int node) {
+    switch (expr_op(expr_pool, node)) {
+    case OP_ASSIGN: {
+        emit("  pop rdi\n");
+        emit("  pop rax\n");
+
+        const int size = intstack_top(size_stack); 
+        intstack_pop(size_stack);
+        emit_inst_op("mov [rax],", get_reg("di", size));
 
         break;
     }
-    default:{
+    case OP_MUL_EQ: {
+        emit("  pop rdi\n");
+        emit("  pop rax\n");
+        emit("  mov rsi, [rax]\n");
+        emit("  imul rdi, rsi\n");
+        emit("  mov [rax], rdi\n");
+
         break;
     }
+    case OP_DIV_EQ: {
+        emit("  pop rdi\n");
+        emit("  pop rsi\n");
+        emit("  mov rax, [rsi]\n");
+        emit("  cqo\n");
+        emit("  idiv rdi\n");
+        emit("  mov [rsi], rax\n");
+
+        break;
     }
-}
+    case OP_MOD_EQ: {
+        emit("  pop rdi\n");
+        emit("  pop rsi\n");
+        emit("  mov rax, [rsi]\n");
+        emit("  cqo\n");
+        emit("  idiv rdi\n");
+        emit("  mov [rsi], rdx\n");
 
-static void process_and_expr(const AndExprNode* node) {
-    // <equality-expression>
-    if (node->and_expr_node == NULL) {
-        process_equality_expr(node->equality_expr_node);
+        break;
     }
-    //
-    else {
-        // @todo
+    case OP_ADD_EQ: {
+        emit("  pop rdi\n");
+        emit("  pop rax\n");
+        emit("  add [rax], rdi\n");
+
+        break;
     }
-}
+    case OP_SUB_EQ: {
+        emit("  pop rdi\n");
+        emit("  pop rax\n");
+        emit("  sub [rax], rdi\n");
 
-static void process_exclusive_or_expr(const ExclusiveOrExprNode* node) {
-    // <and-expression>
-    if (node->exclusive_or_expr_node == NULL) {
-        process_and_expr(node->and_expr_node);
+        break;
     }
-    // <exclusive-or-expression> ^ <and-expression>
-    else {
+    case OP_AND_EQ:
+    case OP_XOR_EQ:
+    case OP_OR_EQ: {
         // @todo
+        break;
     }
-}
-
-static void process_inclusive_or_expr(const InclusiveOrExprNode* node) {
-    // <exclusive-or-expression>
-    if (node->inclusive_or_expr_node == NULL) {
-        process_exclusive_or_expr(node->exclusive_or_expr_node);
+    default: {
+        break;
     }
-    // <inclusive-or-expression> | <exclusive-or-expression>
-    else {
-        // @todo
     }
 }
 
-static void process_logical_and_expr(const LogicalAndExprNode* node) {
-    // <inclusive-or-expression>
-    if (node->logical_and_expr_node == NULL) {
-        process_inclusive_or_expr(node->inclusive_or_expr_node);
+//
+// process_expr() walks an expression with a stack of work instead of
+// recursion, so that however deep the operands of the binary, unary,
+// conditional and assignment operators nest, the C stack does not grow.
+// Each item is an expression and its step: EXPR_STEP_VISIT before any of
+// it is emitted, the others once the operands before them are on the
+// stack. The labels of && and ?: are taken at the visit, as a recursive
+// walk would, and kept on expr_label_stack until the last step.
+//
+
+#define EXPR_STEP_VISIT 0
+#define EXPR_STEP_RHS   1 // the lhs is on the stack
+#define EXPR_STEP_ELSE  2 // the then branch of ?: is on the stack
+#define EXPR_STEP_APPLY 3 // the operands are on the stack
+
+static void push_expr_work(int node, int step) {
+    intstack_push(expr_work_stack, node);
+    intstack_push(expr_work_stack, step);
+}
+
+static void process_expr_visit(int node) {
+    if (is_reg_expr(node)) {
+        process_expr_value(node);
+        emit("  push rax\n");
+        return;
     }
-    // <logical-and-expression> && <inclusive-or-expression>
-    else {
-        char* label1 = get_label();
-        char* label2 = get_label();
-        process_logical_and_expr(node->logical_and_expr_node);
-        printf("  pop rax\n");
-        printf("  cmp rax, 0\n");
-        printf("  je %s\n", label1);
-        process_inclusive_or_expr(node->inclusive_or_expr_node);
-        printf("  pop rax\n");
-        printf("  cmp rax, 0\n");
-        printf("  je %s\n", label1);
-        printf("  push 1\n");
-        printf("  jmp %s\n", label2);
-        printf("%s:\n", label1);
-        printf("  push 0\n");
-        printf("%s:\n", label2);
-    }
-}
-
-static void process_logical_or_expr(const LogicalOrExprNode* node) {
-    // <logical-and-expression>
-    if (node->logical_or_expr_node == NULL) {
-        process_logical_and_expr(node->logical_and_expr_node);
-    }
-    // <logical-or-expression> || <logical-and-expression>
-    else {
-        process_logical_or_expr(node->logical_or_expr_node);
-        process_logical_and_expr(node->logical_and_expr_node);
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  or rax, rdi\n");
-        printf("  push rax\n");
+    if (is_chain_expr(node)) {
+        if (expr_kind(expr_pool, node) == EXPR_LOGAND) {
+            char* label1 = get_label();
+            char* label2 = get_label();
+            stack_push(expr_label_stack, label2);
+            stack_push(expr_label_stack, label1);
+        }
+        push_expr_work(node, EXPR_STEP_RHS);
+        push_expr_work(expr_lhs(expr_pool, node), EXPR_STEP_VISIT);
+        return;
     }
-}
 
-static void process_conditional_expr(const ConditionalExprNode* node) {
-    // <logical-or-expression>
-    if (node->conditional_expr_node == NULL) {
-        process_logical_or_expr(node->logical_or_expr_node);
+    switch (expr_kind(expr_pool, node)) {
+    case EXPR_CONST: {
+        process_constant(node);
+        break;
     }
-    // <logical-or-expression> ? <expression> : <conditional-expression>
-    else {
-        const char* label1 = get_label();
-        const char* label2 = get_label();
- 
-        process_logical_or_expr(node->logical_or_expr_node);
-        printf("  pop rax\n");
-        printf("  cmp rax, 0\n");
-        printf("  je %s\n", label1);
-        process_expr(node->expr_node);
-        printf("  jmp %s\n", label2);
-        printf("%s:\n", label1);
-        process_conditional_expr(node->conditional_expr_node);
-        printf("%s:\n", label2);
-    }
-}
-
-static void process_assign_expr(const AssignExprNode* node) {
-    // <conditional-expression>
-    if (node->conditional_expr_node != NULL) {
-        process_conditional_expr(node->conditional_expr_node);
-    }
-    // <unary-expression> <assignment-operator> <assignment-expression>
-    else {
-        process_unary_expr_left(node->unary_expr_node);
-        process_assign_expr(node->assign_expr_node);
+    case EXPR_IDENT: {
+        process_identifier_right(expr_val(expr_pool, node));
+        break;
+    }
+    // identifier ( {assignment-expression}* )
+    case EXPR_CALL: {
+        process_call(node);
+        break;
+    }
+    // expression [ expression ]
+    case EXPR_INDEX: {
+        process_index_right(node);
+        break;
+    }
+    // expression . identifier
+    case EXPR_DOT: {
+        process_expr_left(expr_lhs(expr_pool, node));
 
-        switch (node->assign_operator) {
-        case OP_ASSIGN: {
-            printf("  pop rdi\n");
-            printf("  pop rax\n");
+        Type* type2 = stack_top(type_stack);
+        stack_pop(type_stack);
 
-            const int size = intstack_top(size_stack); 
-            intstack_pop(size_stack);
-            printf("  mov [rax], %s\n", get_reg("di", size));
+        const FieldInfo* field_info1 = hashmap_get(type2->struct_info->field_info_map, expr_val(expr_pool, node));
 
-            break;
-        }
-        case OP_MUL_EQ: {
-            printf("  pop rdi\n");
-            printf("  pop rax\n");
-            printf("  mov rsi, [rax]\n");
-            printf("  imul rdi, rsi\n");
-            printf("  mov [rax], rdi\n");
+        emit("  pop rax\n");
+        emit_inst_int("add rax,", field_info1->offset);
+        emit("  push [rax]\n");
+        break;        
+    }
+    // expression -> identifier
+    case EXPR_ARROW: {
+        process_expr_left(expr_lhs(expr_pool, node));
 
-            break;
-        }
-        case OP_DIV_EQ: {
-            printf("  pop rdi\n");
-            printf("  pop rsi\n");
-            printf("  mov rax, [rsi]\n");
-            printf("  cqo\n");
-            printf("  idiv rdi\n");
-            printf("  mov [rsi], rax\n");
+        Type* type3 = stack_top(type_stack);
+        stack_pop(type_stack);
 
-            break;
-        }
-        case OP_MOD_EQ: {
-            printf("  pop rdi\n");
-            printf("  pop rsi\n");
-            printf("  mov rax, [rsi]\n");
-            printf("  cqo\n");
-            printf("  idiv rdi\n");
-            printf("  mov [rsi], rdx\n");
+        const FieldInfo* field_info2 = hashmap_get(type3->struct_info->field_info_map, expr_val(expr_pool, node));
+        stack_push(type_stack, field_info2->type);
 
-            break;
-        }
-        case OP_ADD_EQ: {
-            printf("  pop rdi\n");
-            printf("  pop rax\n");
-            printf("  add [rax], rdi\n");
+        emit("  pop rax\n");
+        emit("  mov rax, [rax]\n");
+        emit_inst_int("add rax,", field_info2->offset);
+        emit("  push [rax]\n");
 
-            break;
-        }
-        case OP_SUB_EQ: {
-            printf("  pop rdi\n");
-            printf("  pop rax\n");
-            printf("  sub [rax], rdi\n");
+        break;        
+    }
+    // expression ++, expression --
+    case EXPR_POST_INC:
+    case EXPR_POST_DEC: {
+        process_expr_left(node);
+        break;
+    }
+    // ++ expression
+    case EXPR_PRE_INC: {
+        process_expr_left(expr_lhs(expr_pool, node));
 
-            break;
+        emit("  pop rax\n");
+        emit("  mov rdi, [rax]\n");
+        emit("  add rdi, 1\n");
+        emit("  mov [rax], rdi\n");
+
+        break;
+    }
+    // -- expression
+    case EXPR_PRE_DEC: {
+        process_expr_left(expr_lhs(expr_pool, node));
+
+        emit("  pop rax\n");
+        emit("  mov rdi, [rax]\n");
+        emit("  sub rdi, 1\n");
+        emit("  mov [rax], rdi\n");
+
+        break;
+    }
+    // unary-operator expression
+    case EXPR_UNARY: {
+        if (expr_op(expr_pool, node) == OP_AND) {
+            process_expr_left(expr_lhs(expr_pool, node));
         }
-        case OP_AND_EQ:
-        case OP_XOR_EQ:
-        case OP_OR_EQ: {
-            // @todo
-            break;
+        else if (expr_op(expr_pool, node) != OP_TILDE) {
+            push_expr_work(node, EXPR_STEP_APPLY);
+            push_expr_work(expr_lhs(expr_pool, node), EXPR_STEP_VISIT);
         }
-        default: {
+        break;
+    }
+    case EXPR_SIZEOF_IDENT: {
+        const LocalVar* lv = get_localvar(expr_val(expr_pool, node));
+        if (lv != NULL) {
+            emit_inst_int("push", lv->type->type_size);
+        } 
+        else {
+            const GlobalVar* gv = get_globalvar(expr_val(expr_pool, node));
+            emit_inst_int("push", gv->type->type_size);
+        }
+        break;
+    }
+    case EXPR_SIZEOF_TYPE: {
+        process_sizeof_type(expr_type_name(expr_pool, node));
+        break;
+    }
+    // expression ? expression : expression
+    case EXPR_COND: {
+        char* label3 = get_label();
+        char* label4 = get_label();
+        stack_push(expr_label_stack, label4);
+        stack_push(expr_label_stack, label3);
+
+        push_expr_work(node, EXPR_STEP_RHS);
+        push_expr_work(expr_lhs(expr_pool, node), EXPR_STEP_VISIT);
+        break;
+    }
+    case EXPR_ASSIGN: {
+        if (is_reg_assign(node)) {
+            process_reg_assign(node);
             break;
         }
+        process_expr_left(expr_lhs(expr_pool, node));
+        push_expr_work(node, EXPR_STEP_APPLY);
+        push_expr_work(expr_rhs(expr_pool, node), EXPR_STEP_VISIT);
+        break;
+    }
+    default: {
+        break;
+    }
+    }
+}
+
+static void process_expr_rhs(int node) {
+    switch (expr_kind(expr_pool, node)) {
+    // expression && expression
+    case EXPR_LOGAND: {
+        process_logand_lhs(stack_top(expr_label_stack));
+        break;
+    }
+    // expression , expression
+    case EXPR_COMMA: {
+        if (has_value(expr_lhs(expr_pool, node))) {
+            emit("  pop rax\n");
         }
+        break;
     }
+    case EXPR_COND: {
+        emit("  pop rax\n");
+        emit("  cmp rax, 0\n");
+        emit_inst_op("je", stack_top(expr_label_stack));
+
+        push_expr_work(node, EXPR_STEP_ELSE);
+        push_expr_work(expr_mid(expr_pool, node), EXPR_STEP_VISIT);
+        return;
+    }
+    default: {
+        break;
+    }
+    }
+
+    push_expr_work(node, EXPR_STEP_APPLY);
+    push_expr_work(expr_rhs(expr_pool, node), EXPR_STEP_VISIT);
 }
 
-static void process_expr_left(const ExprNode* node) {
-    process_unary_expr_left(node
-               ->assign_expr_node
-               ->conditional_expr_node
-               ->logical_or_expr_node
-               ->logical_and_expr_node
-               ->inclusive_or_expr_node
-               ->exclusive_or_expr_node
-               ->and_expr_node
-               ->equality_expr_node
-               ->relational_expr_node
-               ->shift_expr_node
-               ->additive_expr_node
-               ->multiplicative_expr_node
-               ->cast_expr_node
-               ->unary_expr_node
-    );
+// the else branch of ?:
+static void process_expr_else(int node) {
+    const char* label3 = stack_top(expr_label_stack);
+    stack_pop(expr_label_stack);
+
+    emit_inst_op("jmp", stack_top(expr_label_stack));
+    emit_label(label3);
+
+    push_expr_work(node, EXPR_STEP_APPLY);
+    push_expr_work(expr_rhs(expr_pool, node), EXPR_STEP_VISIT);
 }
 
+static void process_expr_apply(int node) {
+    switch (expr_kind(expr_pool, node)) {
+    case EXPR_BINARY: {
+        process_binary(node);
+        break;
+    }
+    case EXPR_COMPARE: {
+        process_compare(node);
+        break;
+    }
+    case EXPR_LOGAND: {
+        const char* label1 = stack_top(expr_label_stack);
+        stack_pop(expr_label_stack);
+        const char* label2 = stack_top(expr_label_stack);
+        stack_pop(expr_label_stack);
 
-static void process_expr(const ExprNode* node) {
-    // <assignment-expression>
-    if (node->expr_node == NULL) {
-        process_assign_expr(node->assign_expr_node);
+        process_logand(label1, label2);
+        break;
     }
-    // <expression> , <assignment-expression>
-    else {
-        const ExprNode* current = node;
-        while (current->expr_node != NULL) {
-            process_assign_expr(current->assign_expr_node);
-            current = current->expr_node;
+    // expression || expression
+    case EXPR_LOGOR: {
+        emit("  pop rdi\n");
+        emit("  pop rax\n");
+        emit("  or rax, rdi\n");
+        emit("  push rax\n");
+        break;
+    }
+    case EXPR_COND: {
+        emit_label(stack_top(expr_label_stack));
+        stack_pop(expr_label_stack);
+        break;
+    }
+    case EXPR_UNARY: {
+        process_unary_right(node);
+        break;
+    }
+    case EXPR_ASSIGN: {
+        process_assign(node);
+        break;
+    }
+    default: {
+        break;
+    }
+    }
+}
+
+// pushes the value of an expression
+static void process_expr(int node) {
+    const int base = expr_work_stack->top;
+    push_expr_work(node, EXPR_STEP_VISIT);
+    while (expr_work_stack->top > base) {
+        const int step = intstack_top(expr_work_stack);
+        intstack_pop(expr_work_stack);
+        const int current = intstack_top(expr_work_stack);
+        intstack_pop(expr_work_stack);
+
+        if (step == EXPR_STEP_VISIT) {
+            process_expr_visit(current);
+        }
+        else if (step == EXPR_STEP_RHS) {
+            process_expr_rhs(current);
+        }
+        else if (step == EXPR_STEP_ELSE) {
+            process_expr_else(current);
+        }
+        else {
+            process_expr_apply(current);
         }
     }
 }
 
 static void process_expr_stmt(const ExprStmtNode* node) {
-    if (node->expr_node != NULL) {
-        process_expr(node->expr_node);
+    if (node->expr != 0) {
+        process_expr_discard(node->expr);
     }
 }
 
 static void process_jump_stmt(const JumpStmtNode* node) {
     switch (node->jump_type) {
     case JMP_CONTINUE: {
+        // drop the values of the switches the continue leaves
+        const int depth = switch_depth - intstack_top(continue_depth_stack);
+        if (depth > 0) {
+            emit_inst_int("add rsp,", depth * 8);
+        }
         const char* label1 = stack_top(continue_label_stack);
-        printf("  jmp %s\n", label1);
+        emit_inst_op("jmp", label1);
         break;
     }
     case JMP_BREAK: {
         const char* label2 = stack_top(break_label_stack);
-        printf("  jmp %s\n", label2);
+        emit_inst_op("jmp", label2);
         break;
     }
     case JMP_RETURN: {
-        if (node->expr_node != NULL) {
-            process_expr(node->expr_node);
+        if (node->expr != 0) {
+            process_expr_value(node->expr);
+        }
+        else {
+            emit("  pop rax\n");
         }
-        printf("  pop rax\n");
         if (ret_label == NULL) {
             ret_label = get_label();
         }
-        printf("  jmp %s\n", ret_label);
+        emit_inst_op("jmp", ret_label);
         break;
     }
     default: {
@@ -1102,28 +1756,43 @@ static void process_selection_stmt(const SelectionStmtNode* node) {
     case SELECT_IF: {
         const char* label1 = get_label();
 
-        process_expr(node->expr_node);
-        printf("  pop rax\n");
-        printf("  cmp rax, 0\n");
-        printf("  je %s\n", label1);
+        process_cond_jump(node->expr, label1);
         process_stmt(node->stmt_node_0);
-        printf("%s:\n", label1);
+        emit_label(label1);
 
         break;
     }
+    // an "else if" chain is followed by this loop rather than by recursion;
+    // the end labels are placed innermost first once the chain is done
     case SELECT_IF_ELSE: {
-        const char* label2 = get_label();
-        const char* label3 = get_label();
+        Stack* end_labels = create_stack();
+        const SelectionStmtNode* current = node;
+        while (current != NULL) {
+            const char* label2 = get_label();
+            char* label3 = get_label();
+            stack_push(end_labels, label3);
+
+            process_cond_jump(current->expr, label2);
+            process_stmt(current->stmt_node_0);
+            emit_inst_op("jmp", label3);
+            emit_label(label2);
+
+            const StmtNode* else_stmt_node = current->stmt_node_1;
+            current = NULL;
+            if (else_stmt_node->selection_stmt_node != NULL && else_stmt_node->selection_stmt_node->selection_type == SELECT_IF_ELSE) {
+                current = else_stmt_node->selection_stmt_node;
+            }
+            else {
+                process_stmt(else_stmt_node);
+            }
+        }
 
-        process_expr(node->expr_node);
-        printf("  pop rax\n");
-        printf("  cmp rax, 0\n");
-        printf("  je %s\n", label2);
-        process_stmt(node->stmt_node_0);
-        printf("  jmp %s\n", label3);
-        printf("%s:\n", label2);
-        process_stmt(node->stmt_node_1);
-        printf("%s:\n", label3);
+        while (stack_top(end_labels) != NULL) {
+            emit_label(stack_top(end_labels));
+            stack_pop(end_labels);
+        }
+        free(end_labels->elements);
+        free(end_labels);
 
         break;
     }
@@ -1132,10 +1801,14 @@ static void process_selection_stmt(const SelectionStmtNode* node) {
         stack_push(break_label_stack, label4);
         stack_push(current_stmt_label_stack, get_label()); 
 
-        process_expr(node->expr_node);
+        // the value stays on the stack for the cases to compare with
+        process_expr(node->expr);
+        ++switch_depth;
         process_stmt(node->stmt_node_0);
+        --switch_depth;
 
-        printf("%s:\n", label4);
+        emit_label(label4);
+        emit("  pop rax\n");
         stack_pop(break_label_stack);
         stack_pop(current_stmt_label_stack); 
         break;
@@ -1152,18 +1825,17 @@ static void process_itr_stmt(const ItrStmtNode* node) {
         char* label1 = get_label();
         char* label2 = get_label();
         stack_push(continue_label_stack, label1);
+        intstack_push(continue_depth_stack, switch_depth);
         stack_push(break_label_stack, label2);
 
-        printf("%s:\n", label1);
-        process_expr(node->expr_node_0);
-        printf("  pop rax\n");
-        printf("  cmp rax, 0\n");
-        printf("  je %s\n", label2);
+        emit_label(label1);
+        process_cond_jump(node->expr_0, label2);
         process_stmt(node->stmt_node);
-        printf("  jmp %s\n", label1);
-        printf("%s:\n", label2);
+        emit_inst_op("jmp", label1);
+        emit_label(label2);
 
         stack_pop(continue_label_stack);
+        intstack_pop(continue_depth_stack);
         stack_pop(break_label_stack);
         break;
     }
@@ -1172,36 +1844,42 @@ static void process_itr_stmt(const ItrStmtNode* node) {
         char* label4 = get_label();
         char* label5 = get_label();
         stack_push(continue_label_stack, label4);
+        intstack_push(continue_depth_stack, switch_depth);
         stack_push(break_label_stack, label5);
 
+        // the variables of the first clause are visible in the loop only
+        enter_scope();
         if (node->declaration_nodes->size != 0) {
             for (int i = 0; i < node->declaration_nodes->size; ++i) {
                 process_declaration(node->declaration_nodes->elements[i]);
             }
         }
-        else if (node->expr_node_0 != NULL) {
-            process_expr(node->expr_node_0);
+        else if (node->expr_0 != 0) {
+            process_expr_discard(node->expr_0);
         }
-        printf("%s:\n", label3);
-        if (node->expr_node_1 != NULL) {
-            process_expr(node->expr_node_1);
+        emit_label(label3);
+        if (node->expr_1 != 0) {
+            process_cond_jump(node->expr_1, label5);
+        }
+        else {
+            emit("  pop rax\n");
+            emit("  cmp rax, 0\n");
+            emit_inst_op("je", label5);
         }
-
-        printf("  pop rax\n");
-        printf("  cmp rax, 0\n");
-        printf("  je %s\n", label5);
 
         process_stmt(node->stmt_node);
 
-        printf("%s:\n", label4);
-        if (node->expr_node_2 != NULL) {
-            process_expr(node->expr_node_2);
+        emit_label(label4);
+        if (node->expr_2 != 0) {
+            process_expr_discard(node->expr_2);
         }
 
-        printf("  jmp %s\n", label3);
-        printf("%s:\n", label5);
+        emit_inst_op("jmp", label3);
+        emit_label(label5);
+        leave_scope();
 
         stack_pop(continue_label_stack);
+        intstack_pop(continue_depth_stack);
         stack_pop(break_label_stack);
         break;
     }
@@ -1214,24 +1892,24 @@ static void process_itr_stmt(const ItrStmtNode* node) {
 static void process_labeled_stmt(const LabeledStmtNode* node) {
     switch (node->labeled_stmt_type) {
     case LABELED_CASE: {
-        process_conditional_expr(node->conditional_expr_node);
+        process_expr(node->conditional_expr);
 
-        printf("  pop rdi\n");
-        printf("  pop rax\n");
-        printf("  push rax\n");
-        printf("  cmp rax, rdi\n");
+        emit("  pop rdi\n");
+        emit("  pop rax\n");
+        emit("  push rax\n");
+        emit("  cmp rax, rdi\n");
         char* current_stmt_label = stack_top(current_stmt_label_stack);
         if (node->stmt_node->labeled_stmt_node == NULL) {
             const char* label = get_label();
-            printf("  jne %s\n", label);
-            printf("%s:\n", current_stmt_label);
+            emit_inst_op("jne", label);
+            emit_label(current_stmt_label);
             process_stmt(node->stmt_node);
-            printf("%s:\n", label); 
+            emit_label(label); 
            
             stack_pop(current_stmt_label_stack);
             stack_push(current_stmt_label_stack, get_label()); 
         } else {
-            printf("  je %s\n", current_stmt_label);
+            emit_inst_op("je", current_stmt_label);
             process_labeled_stmt(node->stmt_node->labeled_stmt_node);
         }
 
@@ -1307,36 +1985,48 @@ static void process_declaration(const DeclarationNode* node) {
         }
 
         const DirectDeclaratorNode* direct_declarator_node = declarator_node->direct_declarator_node;
-        const ConditionalExprNode*  conditional_expr_node  = direct_declarator_node->conditional_expr_node;
-        if (conditional_expr_node == NULL) {
+        const int                   conditional_expr       = direct_declarator_node->conditional_expr;
+        if (conditional_expr == 0) {
             lv->type->array_size = 0;
             current_offset += lv->type->size;
         } else {
-            lv->type->array_size = get_array_size_from_constant_expr(conditional_expr_node);
+            lv->type->array_size = get_array_size_from_constant_expr(conditional_expr);
             current_offset += (lv->type->array_size * lv->type->size);
 
         }
         lv->offset = align_offset(current_offset, lv->type->size);
 
         const DirectDeclaratorNode* ident_node = get_identifier_direct_declarator(direct_declarator_node);
-        lv->name = strdup(ident_node->identifier);
-        vector_push_back(localvar_list, lv);
+        lv->name = ident_node->identifier;
+        add_localvar(lv);
 
         if (init_declarator_node->initializer_node != NULL) {
             const InitializerNode* initializer_node = init_declarator_node->initializer_node;
-            printf("  lea rax, [rbp-%d]\n", lv->offset);
-            printf("  push rax\n");
+            if (initializer_node->assign_expr != 0 && is_reg_expr(initializer_node->assign_expr)) {
+                process_expr_value(initializer_node->assign_expr);
+                emit("  mov ");
+                emit_var_operand(lv->name);
+                if (lv->type->size == 1) {
+                    emit(", al\n");
+                } else {
+                    emit(", rax\n");
+                }
+                continue;
+            }
 
-            if (initializer_node->assign_expr_node != NULL) {
-                process_assign_expr(initializer_node->assign_expr_node);
+            emit_inst_local("lea rax,", lv->offset);
+            emit("  push rax\n");
+
+            if (initializer_node->assign_expr != 0) {
+                process_expr(initializer_node->assign_expr);
             }
 
-            printf("  pop rdi\n");
-            printf("  pop rax\n");
+            emit("  pop rdi\n");
+            emit("  pop rax\n");
             if (lv->type->size == 1) {
-                printf("  mov [rax], dil\n");
+                emit("  mov [rax], dil\n");
             } else {
-                printf("  mov [rax], rdi\n");
+                emit("  mov [rax], rdi\n");
             }
         }
     }
@@ -1351,9 +2041,11 @@ static void process_block_item(const BlockItemNode* node) {
 }
 
 static void process_compound_stmt(const CompoundStmtNode* node) {
+    enter_scope();
     for (int i = 0; i < node->block_item_nodes->size; ++i) {
         process_block_item(node->block_item_nodes->elements[i]);
     }
+    leave_scope();
 }
 
 static int calc_arg_size(const FuncDefNode* node) {
@@ -1378,35 +2070,29 @@ static int calc_arg_size(const FuncDefNode* node) {
     return cnt * 8;
 }
 
-static int get_array_size_from_constant_expr(const ConditionalExprNode* node) {
-    return node->logical_or_expr_node
-               ->logical_and_expr_node
-               ->inclusive_or_expr_node
-               ->exclusive_or_expr_node
-               ->and_expr_node
-               ->equality_expr_node
-               ->relational_expr_node
-               ->shift_expr_node
-               ->additive_expr_node
-               ->multiplicative_expr_node
-               ->cast_expr_node
-               ->unary_expr_node
-               ->postfix_expr_node
-               ->primary_expr_node
-               ->constant_node
-               ->integer_constant;
+static int get_array_size_from_constant_expr(int node) {
+    return expr_val(expr_pool, node);
 }
 
 static int calc_localvar_size_in_labeled_stmt(const LabeledStmtNode* node) {
     return calc_localvar_size_in_stmt(node->stmt_node);
 }
 
+// follows "else if" chains by a loop, like process_selection_stmt()
 static int calc_localvar_size_in_selection_stmt(const SelectionStmtNode* node) {
     int size = 0;
-    size += calc_localvar_size_in_stmt(node->stmt_node_0);
+    const SelectionStmtNode* current = node;
+    while (current != NULL) {
+        size += calc_localvar_size_in_stmt(current->stmt_node_0);
 
-    if (node->stmt_node_1 != NULL) {
-        size += calc_localvar_size_in_stmt(node->stmt_node_1);
+        const StmtNode* else_stmt_node = current->stmt_node_1;
+        current = NULL;
+        if (else_stmt_node != NULL && else_stmt_node->selection_stmt_node != NULL) {
+            current = else_stmt_node->selection_stmt_node;
+        }
+        else if (else_stmt_node != NULL) {
+            size += calc_localvar_size_in_stmt(else_stmt_node);
+        }
     }
 
     return size;
@@ -1423,10 +2109,10 @@ static int calc_localvar_size_in_itr_stmt(const ItrStmtNode* node) {
             const DeclaratorNode* declarator_node = init_declarator_node->declarator_node;
             const DirectDeclaratorNode* direct_declarator_node = declarator_node->direct_declarator_node;
 
-            if (direct_declarator_node->conditional_expr_node == NULL) {
+            if (direct_declarator_node->conditional_expr == 0) {
                 size += 8;
             } else {
-                const int array_size = get_array_size_from_constant_expr(direct_declarator_node->conditional_expr_node);
+                const int array_size = get_array_size_from_constant_expr(direct_declarator_node->conditional_expr);
                 size += (array_size * 8);
             }
         }
@@ -1464,12 +2150,12 @@ static int get_varsize_from_decl_specifier_nodes(const Vector* nodes) {
         const TypeSpecifierNode* type_specifier_node = decl_specifier_node->type_specifier_node;
         if (type_specifier_node->type_specifier == TYPE_STRUCT) {
             const StructSpecifierNode* struct_specifier_node = type_specifier_node->struct_specifier_node;
-            const char* ident = struct_specifier_node->identifier;
-            const StructInfo* struct_info1 = strptrmap_get(struct_map, ident);
+            const int ident = struct_specifier_node->identifier;
+            const StructInfo* struct_info1 = hashmap_get(struct_map, ident);
             return (struct_info1->field_info_map->size * 8);
         } 
         else if (type_specifier_node->type_specifier == TYPE_TYPEDEFNAME) {
-            const StructInfo* struct_info2 = strptrmap_get(struct_map, type_specifier_node->struct_name);
+            const StructInfo* struct_info2 = hashmap_get(struct_map, type_specifier_node->struct_name);
             return (struct_info2->field_info_map->size * 8);
         } 
         else {
@@ -1493,11 +2179,11 @@ static int calc_localvar_size_in_declaration(const DeclarationNode* node) {
         if (declarator_node->pointer_node != NULL) {
             size += 8;
         }
-        else if (direct_declarator_node->conditional_expr_node == NULL) {
+        else if (direct_declarator_node->conditional_expr == 0) {
             size += var_size;
         } 
         else {
-            const int array_size = get_array_size_from_constant_expr(direct_declarator_node->conditional_expr_node);
+            const int array_size = get_array_size_from_constant_expr(direct_declarator_node->conditional_expr);
             size += (array_size * var_size);
         }
     }
@@ -1550,9 +2236,9 @@ static Type* process_type_specifier_in_local(const TypeSpecifierNode* node) {
     case TYPE_STRUCT: { 
         type->base_type = VAR_STRUCT;   
 
-        type->struct_info = strptrmap_get(struct_map, node->struct_specifier_node->identifier); 
+        type->struct_info = hashmap_get(struct_map, node->struct_specifier_node->identifier); 
         if (type->struct_info == NULL) {
-            error("Invalid sturct name=\"%s\"\n", node->struct_specifier_node->identifier);
+            error("Invalid sturct name=\"%s\"\n", symbol_name(node->struct_specifier_node->identifier));
             return NULL;
         }
 
@@ -1562,9 +2248,9 @@ static Type* process_type_specifier_in_local(const TypeSpecifierNode* node) {
     case TYPE_TYPEDEFNAME: { 
         type->base_type = VAR_STRUCT;   
 
-        type->struct_info = strptrmap_get(struct_map, node->struct_name);
+        type->struct_info = hashmap_get(struct_map, node->struct_name);
         if (type->struct_info == NULL) {
-            error("Invalid sturct name=\"%s\"\n", node->struct_name);
+            error("Invalid sturct name=\"%s\"\n", symbol_name(node->struct_name));
             return NULL;
         }
 
@@ -1614,8 +2300,8 @@ static void process_param_list_node(const ParamListNode* node, int arg_index) {
     LocalVar* lv = malloc(sizeof(LocalVar));
     lv->type     = type;
     lv->offset   = current_offset;
-    lv->name     = strdup(direct_declarator_node->identifier);
-    vector_push_back(localvar_list, lv);
+    lv->name     = direct_declarator_node->identifier;
+    add_localvar(lv);
 
     const PointerNode* pointer_node = declarator_node->pointer_node;
     if (pointer_node != NULL) {
@@ -1625,7 +2311,7 @@ static void process_param_list_node(const ParamListNode* node, int arg_index) {
         lv->type->size = lv->type->type_size;
     }
 
-    printf("  mov [rbp-%d], %s\n", lv->offset, arg_registers[arg_index]);
+    emit_store_local(lv->offset, arg_registers[arg_index]);
 }
 
 static void process_args(const ParamListNode* node) {
@@ -1651,38 +2337,746 @@ static void process_func_declarator(const DeclaratorNode* node) {
     process_args(param_list_node);
 }
 
-static void process_func_def(const FuncDefNode* node) {
-    localvar_list = create_vector();
+//
+// IR
+//
+// With -fir or -O1 and up a function the IR holds (see ir.h) is emitted
+// from it instead of from the AST, after the passes (see opt.h). Each
+// register has a location: with regalloc a machine register, a spill slot
+// or, for a constant, none as it is an immediate operand (see regalloc.h),
+// and otherwise the slot [rbp-8*r] of register r. An instruction computes
+// its result in the machine register of it, else in rax, and rax_reg saves
+// the load of a result used right away. The phis of a block are assigned
+// at the end of each predecessor as one parallel move, so that a phi may
+// read another one; so are the arguments of a call and the parameters.
+//
+
+// the location of register reg: a machine register of ir_registers, -s for
+// the slot [rbp-8*s], or 0 for an immediate
+static int get_ir_loc(int reg) {
+    if (ir_alloc == NULL) {
+        return -reg;
+    }
+    return ir_alloc->locations->elements[reg];
+}
+
+// the location of argument register index
+static int get_arg_loc(int index) {
+    int loc = 1;
+    while (strcmp(ir_registers[loc], arg_registers[index]) != 0) {
+        ++loc;
+    }
+    return loc;
+}
+
+static void emit_ir_loc(int loc) {
+    if (loc > 0) {
+        emit(ir_registers[loc]);
+        return;
+    }
+    emit("[rbp-");
+    emit_int(-loc * 8);
+    emit("]");
+}
+
+// the location of reg, or the constant it holds
+static void emit_ir_operand(int reg) {
+    const int loc = get_ir_loc(reg);
+    if (loc == 0) {
+        emit_int(ir_imms->elements[reg]);
+        return;
+    }
+    emit_ir_loc(loc);
+}
+
+// "  inst loc, reg"
+static void emit_ir_inst(const char* inst, int loc, int reg) {
+    emit("  ");
+    emit(inst);
+    emit(" ");
+    emit_ir_loc(loc);
+    emit(", ");
+    emit_ir_operand(reg);
+    emit("\n");
+}
+
+static void load_rax(int reg) {
+    if (rax_reg != reg) {
+        emit_ir_inst("mov", IR_LOC_RAX, reg);
+        rax_reg = reg;
+    }
+}
+
+static void store_rax(int reg) {
+    emit("  mov ");
+    emit_ir_loc(get_ir_loc(reg));
+    emit(", rax\n");
+    rax_reg = reg;
+}
+
+// The register the result of inst is computed in: its own if it has one.
+// No operand is in it, as their intervals meet at inst.
+static int get_ir_work_loc(const IrInst* inst) {
+    const int loc = get_ir_loc(inst->dst);
+    if (loc <= 0) {
+        return IR_LOC_RAX;
+    }
+    return loc;
+}
+
+static void load_ir_work(int work, int reg) {
+    if (work == IR_LOC_RAX) {
+        load_rax(reg);
+    }
+    else {
+        emit_ir_inst("mov", work, reg);
+    }
+}
+
+static void store_ir_work(int work, int reg) {
+    if (work == IR_LOC_RAX) {
+        store_rax(reg);
+    }
+}
+
+// "  cmp reg, 0"
+static void emit_ir_test(int reg) {
+    int loc = get_ir_loc(reg);
+    if (loc <= 0) {
+        load_rax(reg);
+        loc = IR_LOC_RAX;
+    }
+    emit("  cmp ");
+    emit_ir_loc(loc);
+    emit(", 0\n");
+}
+
+//
+// parallel moves
+//
+
+// a move of the value of reg to the location dst, for emit_ir_moves()
+static void add_ir_move(int dst, int reg) {
+    const int src = get_ir_loc(reg);
+    if (src == 0) {
+        intvector_push_back(ir_imm_dsts, dst);
+        intvector_push_back(ir_imm_regs, reg);
+    }
+    else if (src != dst) {
+        intvector_push_back(ir_move_dsts, dst);
+        intvector_push_back(ir_move_srcs, src);
+    }
+}
+
+// a move between locations, for emit_ir_moves()
+static void add_ir_loc_move(int dst, int src) {
+    if (src != dst) {
+        intvector_push_back(ir_move_dsts, dst);
+        intvector_push_back(ir_move_srcs, src);
+    }
+}
+
+static void emit_ir_loc_move(int dst, int src) {
+    if (dst <= 0 && src <= 0) {
+        emit("  mov rax, ");
+        emit_ir_loc(src);
+        emit("\n");
+        rax_reg = 0;
+        src = IR_LOC_RAX;
+    }
+    emit("  mov ");
+    emit_ir_loc(dst);
+    emit(", ");
+    emit_ir_loc(src);
+    emit("\n");
+}
+
+// Emits the moves added as if they took place at once: a move waits until
+// no other one reads its destination, and a cycle of moves is broken by
+// keeping one destination in r11. The immediates go last.
+static void emit_ir_moves() {
+    while (ir_move_dsts->size > 0) {
+        int ready = -1;
+        for (int i = 0; i < ir_move_dsts->size && ready < 0; ++i) {
+            bool read = false;
+            for (int j = 0; j < ir_move_srcs->size; ++j) {
+                if (j != i && ir_move_srcs->elements[j] == ir_move_dsts->elements[i]) {
+                    read = true;
+                }
+            }
+            if (!read) {
+                ready = i;
+            }
+        }
+        if (ready < 0) {
+            const int saved = ir_move_dsts->elements[0];
+            emit_ir_loc_move(IR_LOC_R11, saved);
+            for (int k = 0; k < ir_move_srcs->size; ++k) {
+                if (ir_move_srcs->elements[k] == saved) {
+                    ir_move_srcs->elements[k] = IR_LOC_R11;
+                }
+            }
+            ready = 0;
+        }
+
+        emit_ir_loc_move(ir_move_dsts->elements[ready], ir_move_srcs->elements[ready]);
+        const int last = ir_move_dsts->size - 1;
+        ir_move_dsts->elements[ready] = ir_move_dsts->elements[last];
+        ir_move_srcs->elements[ready] = ir_move_srcs->elements[last];
+        --ir_move_dsts->size;
+        --ir_move_srcs->size;
+    }
+
+    for (int l = 0; l < ir_imm_dsts->size; ++l) {
+        const int dst = ir_imm_dsts->elements[l];
+        if (dst > 0) {
+            emit_ir_inst("mov", dst, ir_imm_regs->elements[l]);
+        }
+        else {
+            load_rax(ir_imm_regs->elements[l]);
+            emit("  mov ");
+            emit_ir_loc(dst);
+            emit(", rax\n");
+        }
+    }
+    ir_imm_dsts->size = 0;
+    ir_imm_regs->size = 0;
+}
+
+//
+// instructions
+//
+
+// the jump condition of a compare, as in jl and setl
+static const char* get_ir_condition(int op) {
+    switch (op) {
+    case IR_LT: { return "l"; }
+    case IR_GT: { return "g"; }
+    case IR_LE: { return "le"; }
+    case IR_GE: { return "ge"; }
+    case IR_EQ: { return "e"; }
+    default:    { return "ne"; }
+    }
+}
+
+static int negate_ir_compare(int op) {
+    switch (op) {
+    case IR_LT: { return IR_GE; }
+    case IR_GT: { return IR_LE; }
+    case IR_LE: { return IR_GT; }
+    case IR_GE: { return IR_LT; }
+    case IR_EQ: { return IR_NE; }
+    default:    { return IR_EQ; }
+    }
+}
+
+static void emit_ir_jcc(int op, const char* label) {
+    emit("  j");
+    emit(get_ir_condition(op));
+    emit(" ");
+    emit(label);
+    emit("\n");
+}
+
+// true if block->insts[index] is a compare only the branch after it uses,
+// which then jumps on the flags instead
+static bool is_fused_ir_compare(const IrBlock* block, int index) {
+    const IrInst* inst = block->insts->elements[index];
+    if (inst->op < IR_LT || inst->op > IR_NE || index + 2 != block->insts->size) {
+        return false;
+    }
+    const IrInst* next = block->insts->elements[index + 1];
+    return next->op == IR_BR && next->a == inst->dst && ir_use_counts->elements[inst->dst] == 1;
+}
+
+static void emit_ir_compare(const IrInst* inst) {
+    const int loc = get_ir_loc(inst->a);
+    if (loc > 0) {
+        emit_ir_inst("cmp", loc, inst->b);
+        return;
+    }
+    load_rax(inst->a);
+    emit_ir_inst("cmp", IR_LOC_RAX, inst->b);
+}
+
+static void emit_phi_copies(const IrBlock* from, const IrBlock* to) {
+    if (to->phis->size == 0) {
+        return;
+    }
+
+    int pred_index = 0;
+    while (to->preds->elements[pred_index] != from) {
+        ++pred_index;
+    }
+
+    for (int i = 0; i < to->phis->size; ++i) {
+        const IrInst* phi = to->phis->elements[i];
+        add_ir_move(get_ir_loc(phi->dst), phi->args->elements[pred_index]);
+    }
+    emit_ir_moves();
+}
+
+// copies the phis of to and jumps there, unless it comes next
+static void emit_ir_jump(const IrBlock* from, const IrBlock* to, const Vector* block_labels) {
+    emit_phi_copies(from, to);
+    if (to->id != from->id + 1) {
+        emit_inst_op("jmp", block_labels->elements[to->id]);
+    }
+}
+
+// fused_op is the compare whose flags decide, 0 if a is tested
+static void lower_ir_branch(const IrBlock* block, const IrInst* inst, const Vector* block_labels, int fused_op) {
+    const IrBlock* then_block = block->succs->elements[0];
+    const IrBlock* else_block = block->succs->elements[1];
+    int cond = fused_op;
+    if (cond == 0) {
+        emit_ir_test(inst->a);
+        cond = IR_NE;
+    }
+
+    // an edge without copies is a conditional jump of its own
+    if (else_block->phis->size == 0) {
+        emit_ir_jcc(negate_ir_compare(cond), block_labels->elements[else_block->id]);
+        emit_ir_jump(block, then_block, block_labels);
+    }
+    else if (then_block->phis->size == 0) {
+        emit_ir_jcc(cond, block_labels->elements[then_block->id]);
+        emit_ir_jump(block, else_block, block_labels);
+    }
+    else {
+        char* else_label = get_label();
+        const int branch_rax_reg = rax_reg;
+        emit_ir_jcc(negate_ir_compare(cond), else_label);
+        // the else edge follows, so the then block is not next even if
+        // its id is
+        emit_phi_copies(block, then_block);
+        emit_inst_op("jmp", block_labels->elements[then_block->id]);
+        emit_label(else_label);
+        rax_reg = branch_rax_reg;
+        emit_ir_jump(block, else_block, block_labels);
+        free(else_label);
+    }
+}
+
+// saves the callee-saved registers regalloc used to the slots after the
+// spill slots, or restores them
+static void emit_ir_saved_regs(bool restore) {
+    if (ir_alloc == NULL) {
+        return;
+    }
+    int slot = ir_saved_base;
+    for (int reg = REGALLOC_CALLER_SAVED + 1; reg <= REGALLOC_REGS; ++reg) {
+        if (ir_alloc->used->elements[reg] == 0) {
+            continue;
+        }
+        ++slot;
+        if (restore) {
+            add_ir_loc_move(reg, -slot);
+        }
+        else {
+            add_ir_loc_move(-slot, reg);
+        }
+    }
+    emit_ir_moves();
+}
+
+static void lower_ir_inst(const IrBlock* block, const IrInst* inst, const Vector* block_labels, int fused_op) {
+    const int work = get_ir_work_loc(inst);
+    switch (inst->op) {
+    case IR_CONST: {
+        if (get_ir_loc(inst->dst) == 0) {
+            break;
+        }
+        emit("  mov ");
+        emit_ir_loc(work);
+        emit(", ");
+        emit_int(inst->imm);
+        emit("\n");
+        store_ir_work(work, inst->dst);
+        break;
+    }
+    case IR_PARAM: {
+        // moved at the entry
+        break;
+    }
+    case IR_STR: {
+        const char* label = get_string_label();
+        emit(".section .rodata\n");
+        emit_label(label);
+        emit_string(symbol_name(inst->sym));
+        emit(".text\n");
+        emit("  lea ");
+        emit_ir_loc(work);
+        emit(", ");
+        emit(label);
+        emit("[rip]\n");
+        store_ir_work(work, inst->dst);
+        break;
+    }
+    case IR_LOAD: {
+        emit("  mov ");
+        emit_ir_loc(work);
+        emit(", ");
+        emit(symbol_name(inst->sym));
+        emit("[rip]\n");
+        store_ir_work(work, inst->dst);
+        break;
+    }
+    case IR_STORE: {
+        int src = get_ir_loc(inst->a);
+        if (src <= 0) {
+            load_rax(inst->a);
+            src = IR_LOC_RAX;
+        }
+        emit("  mov ");
+        emit(symbol_name(inst->sym));
+        emit("[rip], ");
+        emit_ir_loc(src);
+        emit("\n");
+        break;
+    }
+    case IR_NEG: {
+        load_ir_work(work, inst->a);
+        emit("  neg ");
+        emit_ir_loc(work);
+        emit("\n");
+        store_ir_work(work, inst->dst);
+        break;
+    }
+    case IR_NOT: {
+        emit_ir_test(inst->a);
+        emit("  sete al\n");
+        emit("  movzb rax, al\n");
+        store_rax(inst->dst);
+        break;
+    }
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_OR: {
+        // a constant goes second, as an immediate
+        int first  = inst->a;
+        int second = inst->b;
+        if (inst->op != IR_SUB && get_ir_loc(first) == 0) {
+            first  = inst->b;
+            second = inst->a;
+        }
+        load_ir_work(work, first);
+        if (inst->op == IR_ADD) {
+            emit_ir_inst("add", work, second);
+        }
+        else if (inst->op == IR_SUB) {
+            emit_ir_inst("sub", work, second);
+        }
+        else if (inst->op == IR_MUL) {
+            emit_ir_inst("imul", work, second);
+        }
+        else {
+            emit_ir_inst("or", work, second);
+        }
+        store_ir_work(work, inst->dst);
+        break;
+    }
+    case IR_DIV:
+    case IR_MOD: {
+        load_rax(inst->a);
+        int divisor = get_ir_loc(inst->b);
+        if (divisor <= 0) {
+            emit_ir_inst("mov", IR_LOC_R11, inst->b);
+            divisor = IR_LOC_R11;
+        }
+        emit("  cqo\n");
+        emit("  idiv ");
+        emit_ir_loc(divisor);
+        emit("\n");
+        if (inst->op == IR_MOD) {
+            emit("  mov rax, rdx\n");
+        }
+        store_rax(inst->dst);
+        break;
+    }
+    case IR_LT:
+    case IR_GT:
+    case IR_LE:
+    case IR_GE:
+    case IR_EQ:
+    case IR_NE: {
+        emit_ir_compare(inst);
+        emit("  set");
+        emit(get_ir_condition(inst->op));
+        emit(" al\n");
+        emit("  movzb rax, al\n");
+        store_rax(inst->dst);
+        break;
+    }
+    case IR_CALL: {
+        for (int i = 0; i < inst->args->size; ++i) {
+            add_ir_move(get_arg_loc(i), inst->args->elements[i]);
+        }
+        emit_ir_moves();
+        emit("  mov rax, 0\n");
+        emit_inst_op("call", symbol_name(inst->sym));
+        store_rax(inst->dst);
+        break;
+    }
+    case IR_JMP: {
+        emit_ir_jump(block, block->succs->elements[0], block_labels);
+        break;
+    }
+    case IR_BR: {
+        lower_ir_branch(block, inst, block_labels, fused_op);
+        break;
+    }
+    case IR_RET: {
+        if (inst->a != 0) {
+            load_rax(inst->a);
+        }
+        emit_ir_saved_regs(true);
+        emit("  mov rsp, rbp\n");
+        emit("  pop rbp\n");
+        emit("  ret\n");
+        break;
+    }
+    default: {
+        break;
+    }
+    }
+}
+
+static void free_lowered_intvector(IntVector* vec) {
+    free(vec->elements);
+    free(vec);
+}
+
+static void count_ir_use(int reg) {
+    if (reg != 0) {
+        ++ir_use_counts->elements[reg];
+    }
+}
+
+// sets ir_imms and ir_use_counts
+static void collect_ir_values(const IrFunc* func) {
+    ir_imms       = create_intvector();
+    ir_use_counts = create_intvector();
+    for (int i = 0; i <= func->reg_count; ++i) {
+        intvector_push_back(ir_imms, 0);
+        intvector_push_back(ir_use_counts, 0);
+    }
+
+    for (int j = 0; j < func->blocks->size; ++j) {
+        const IrBlock* block = func->blocks->elements[j];
+        for (int k = 0; k < block->phis->size + block->insts->size; ++k) {
+            const IrInst* inst = NULL;
+            if (k < block->phis->size) {
+                inst = block->phis->elements[k];
+            }
+            else {
+                inst = block->insts->elements[k - block->phis->size];
+            }
+            if (inst->op == IR_CONST) {
+                ir_imms->elements[inst->dst] = inst->imm;
+            }
+            count_ir_use(inst->a);
+            count_ir_use(inst->b);
+            if (inst->args != NULL) {
+                for (int l = 0; l < inst->args->size; ++l) {
+                    count_ir_use(inst->args->elements[l]);
+                }
+            }
+        }
+    }
+}
+
+// the stack slots of the registers of func that are not in machine ones
+static int get_ir_frame_regs(const IrFunc* func, const RegAlloc* alloc) {
+    if (alloc != NULL) {
+        return alloc->spill_count;
+    }
+    return func->reg_count;
+}
+
+// alloc is that of regalloc, NULL without it
+static void lower_ir(const IrFunc* func, const RegAlloc* alloc) {
+    ir_alloc      = alloc;
+    ir_move_dsts  = create_intvector();
+    ir_move_srcs  = create_intvector();
+    ir_imm_dsts   = create_intvector();
+    ir_imm_regs   = create_intvector();
+    collect_ir_values(func);
+
+    const char* func_name = symbol_name(func->name);
+    emit_directive(".global", func_name);
+    emit_label(func_name);
+
+    Vector* block_labels = create_vector();
+    for (int i = 0; i < func->blocks->size; ++i) {
+        vector_push_back(block_labels, get_label());
+    }
+
+    // prologue
+    ir_saved_base = get_ir_frame_regs(func, alloc);
+    int saved_count = 0;
+    if (alloc != NULL) {
+        for (int reg = REGALLOC_CALLER_SAVED + 1; reg <= REGALLOC_REGS; ++reg) {
+            saved_count += alloc->used->elements[reg];
+        }
+    }
+    emit("  push rbp\n");
+    emit("  mov rbp, rsp\n");
+    emit_inst_int("sub rsp,", ((ir_saved_base + saved_count) * 8 + 15) / 16 * 16);
+    emit_ir_saved_regs(false);
+
+    const IrBlock* entry = func->blocks->elements[0];
+    for (int j = 0; j < entry->insts->size; ++j) {
+        const IrInst* param = entry->insts->elements[j];
+        if (param->op == IR_PARAM) {
+            add_ir_loc_move(get_ir_loc(param->dst), get_arg_loc(param->imm));
+        }
+    }
+    emit_ir_moves();
+
+    for (int k = 0; k < func->blocks->size; ++k) {
+        const IrBlock* block = func->blocks->elements[k];
+        if (k != 0) {
+            emit_label(block_labels->elements[k]);
+        }
+        rax_reg = 0;
+        int fused_op = 0;
+        for (int l = 0; l < block->insts->size; ++l) {
+            const IrInst* inst = block->insts->elements[l];
+            if (is_fused_ir_compare(block, l)) {
+                emit_ir_compare(inst);
+                fused_op = inst->op;
+                continue;
+            }
+            lower_ir_inst(block, inst, block_labels, fused_op);
+        }
+    }
+
+    for (int m = 0; m < block_labels->size; ++m) {
+        free(block_labels->elements[m]);
+    }
+    free(block_labels->elements);
+    free(block_labels);
+    free_lowered_intvector(ir_move_dsts);
+    free_lowered_intvector(ir_move_srcs);
+    free_lowered_intvector(ir_imm_dsts);
+    free_lowered_intvector(ir_imm_regs);
+    free_lowered_intvector(ir_imms);
+    free_lowered_intvector(ir_use_counts);
+    ir_alloc = NULL;
+}
+
+// Emits a function from the IR, or with --dump-ir writes its IR. Returns
+// false if the function is to be emitted from the AST.
+static bool process_func_def_ir(const FuncDefNode* node) {
+    const char* reason = NULL;
+    IrFunc* func = build_ir(node, enum_map, globalvar_map, &reason);
+    RegAlloc* alloc = NULL;
+    if (func != NULL && gen_options->passes != NULL) {
+        run_passes(gen_options->passes, func);
+        alloc = gen_options->passes->reg_alloc;
+        gen_options->passes->reg_alloc = NULL;
+    }
+    if (func != NULL && !verify_ir(func)) {
+        error("Invalid IR of %s.\n", symbol_name(func->name));
+        free_ir(func);
+        func   = NULL;
+        reason = "the IR is invalid";
+    }
+
+    if (gen_options->dump_ir) {
+        ByteBuffer* buf = create_bytebuffer();
+        if (func != NULL) {
+            print_ir(func, buf);
+        }
+        else {
+            const char* func_name = symbol_name(get_ident_from_direct_declarator(node->declarator_node->direct_declarator_node));
+            bytebuffer_put_bytes(buf, "; ", 2);
+            bytebuffer_put_bytes(buf, func_name, strlen(func_name));
+            bytebuffer_put_bytes(buf, ": not in the IR: ", 17);
+            bytebuffer_put_bytes(buf, reason, strlen(reason));
+            bytebuffer_put_bytes(buf, "\n\n", 2);
+        }
+        write_output(buf->data, buf->size);
+        free(buf->data);
+        free(buf);
+    }
+    else if (func != NULL && get_ir_frame_regs(func, alloc) > IR_MAX_FRAME_REGS) {
+        free_ir(func);
+        func = NULL;
+    }
+    else if (func != NULL) {
+        lower_ir(func, alloc);
+    }
+    if (alloc != NULL) {
+        free_reg_alloc(alloc);
+    }
+
+    if (func == NULL) {
+        return gen_options->dump_ir;
+    }
+    free_ir(func);
+    return true;
+}
+
+// false if the body, parsed on first use, has a syntax error
+static bool process_func_def(FuncDefNode* node) {
+    const CompoundStmtNode* compound_stmt_node = parse_func_body(node);
+    if (compound_stmt_node == NULL) {
+        error("Failed to parse function body.\n");
+        return false;
+    }
+
+    if ((gen_options->use_ir || gen_options->dump_ir) && process_func_def_ir(node)) {
+        return true;
+    }
+
+    const ExprPool* global_expr_pool = expr_pool;
+    expr_pool = node->expr_pool;
+
+    localvar_map   = create_hashmap(64);
+    localvar_list  = create_vector();
     current_offset = 0;
+    enter_scope(); // the parameters
 
     const DeclaratorNode* declarator_node = node->declarator_node;
     const DirectDeclaratorNode* direct_declarator_node = declarator_node->direct_declarator_node;
-    printf(".global %s\n", get_ident_from_direct_declarator(direct_declarator_node));
-    printf("%s:\n",        get_ident_from_direct_declarator(direct_declarator_node));
+    const char* func_name = symbol_name(get_ident_from_direct_declarator(direct_declarator_node));
+    emit_directive(".global", func_name);
+    emit_label(func_name);
 
-    const int localvar_size = calc_localvar_size_in_compound_stmt(node->compound_stmt_node);
+    const int localvar_size = calc_localvar_size_in_compound_stmt(compound_stmt_node);
     const int arg_size      = calc_arg_size(node);
 
     // prologue
-    printf("  push rbp\n");
-    printf("  mov rbp, rsp\n");
-    printf("  sub rsp, %d\n", (localvar_size + arg_size));
+    emit("  push rbp\n");
+    emit("  mov rbp, rsp\n");
+    emit_inst_int("sub rsp,", (localvar_size + arg_size));
 
     process_func_declarator(declarator_node);
-    process_compound_stmt(node->compound_stmt_node);
+    process_compound_stmt(compound_stmt_node);
 
     // epilogue
     if (ret_label != NULL) {
-        printf("%s:\n", ret_label);
+        emit_label(ret_label);
     }
-    printf("  mov rsp, rbp\n");
-    printf("  pop rbp\n");
-    printf("  ret\n");
+    emit("  mov rsp, rbp\n");
+    emit("  pop rbp\n");
+    emit("  ret\n");
 
+    leave_scope();
+    free(localvar_list->elements);
     free(localvar_list);
+    free(localvar_map->keys);
+    free(localvar_map->vals);
+    free(localvar_map->nums);
+    free(localvar_map);
     free(ret_label);
     ret_label = NULL;
     current_offset = 0;
+    expr_pool = global_expr_pool;
+    return true;
 }
 
 static Type* process_type_specifier_in_global(const TypeSpecifierNode* node) {
@@ -1715,20 +3109,20 @@ static Type* process_type_specifier_in_global(const TypeSpecifierNode* node) {
 
         const StructSpecifierNode* struct_specifier_node = node->struct_specifier_node;         
 
-        const char* struct_name = struct_specifier_node->identifier;
+        const int struct_name = struct_specifier_node->identifier;
         const Vector* struct_declaration_nodes = struct_specifier_node->struct_declaration_nodes;
         //
         //  "struct" identifier { {struct-declaration}+ }
         //  
         if (struct_declaration_nodes->size != 0) {
-            type->struct_info = strptrmap_get(struct_map, struct_name);
+            type->struct_info = hashmap_get(struct_map, struct_name);
             if (type->struct_info == NULL) { 
                 type->struct_info = malloc(sizeof(StructInfo));
-                type->struct_info->field_info_map = create_strptrmap(1024);
+                type->struct_info->field_info_map = create_hashmap(16);
                 type->struct_info->size           = struct_declaration_nodes->size * 8; // @todo
-                strptrmap_put(struct_map, struct_name, type->struct_info);
+                hashmap_put(struct_map, struct_name, type->struct_info);
             } else {
-                type->struct_info->field_info_map = create_strptrmap(1024);
+                type->struct_info->field_info_map = create_hashmap(16);
                 type->struct_info->size           = struct_declaration_nodes->size * 8; // @todo
             }
 
@@ -1763,7 +3157,7 @@ static Type* process_type_specifier_in_global(const TypeSpecifierNode* node) {
                 field_info->offset = offset;
                 offset += field_info->type->size;
 
-                strptrmap_put(type->struct_info->field_info_map, struct_declaration_node->identifier, field_info);
+                hashmap_put(type->struct_info->field_info_map, struct_declaration_node->identifier, field_info);
             }
             type->struct_info->size = type->struct_info->field_info_map->size * 8;
         }
@@ -1778,10 +3172,10 @@ static Type* process_type_specifier_in_global(const TypeSpecifierNode* node) {
     }
     case TYPE_TYPEDEFNAME: {
         type->base_type = VAR_STRUCT;   
-        StructInfo* struct_info = strptrmap_get(struct_map, node->struct_name);
+        StructInfo* struct_info = hashmap_get(struct_map, node->struct_name);
         if (struct_info == NULL) {
             struct_info = calloc(1, sizeof(StructInfo));
-            strptrmap_put(struct_map, node->struct_name, struct_info);
+            hashmap_put(struct_map, node->struct_name, struct_info);
         }
         type->struct_info = struct_info;
         type->type_size   = struct_info->size;
@@ -1793,65 +3187,17 @@ static Type* process_type_specifier_in_global(const TypeSpecifierNode* node) {
     }
 }
 
-static int get_int_constant(const AssignExprNode* node) {
-    return node->conditional_expr_node
-               ->logical_or_expr_node
-               ->logical_and_expr_node
-               ->inclusive_or_expr_node
-               ->exclusive_or_expr_node
-               ->and_expr_node
-               ->equality_expr_node
-               ->relational_expr_node
-               ->shift_expr_node
-               ->additive_expr_node
-               ->multiplicative_expr_node
-               ->cast_expr_node
-               ->unary_expr_node
-               ->postfix_expr_node
-               ->primary_expr_node
-               ->constant_node
-               ->integer_constant;
-}
-
-static const char* get_character_constant(const AssignExprNode* node) {
-    return node->conditional_expr_node
-               ->logical_or_expr_node
-               ->logical_and_expr_node
-               ->inclusive_or_expr_node
-               ->exclusive_or_expr_node
-               ->and_expr_node
-               ->equality_expr_node
-               ->relational_expr_node
-               ->shift_expr_node
-               ->additive_expr_node
-               ->multiplicative_expr_node
-               ->cast_expr_node
-               ->unary_expr_node
-               ->postfix_expr_node
-               ->primary_expr_node
-               ->constant_node
-               ->character_constant;
-}
-
-
-static bool is_int_constant(const AssignExprNode* node) {
-     return (CONST_INT == node->conditional_expr_node
-                              ->logical_or_expr_node
-                              ->logical_and_expr_node
-                              ->inclusive_or_expr_node
-                              ->exclusive_or_expr_node
-                              ->and_expr_node
-                              ->equality_expr_node
-                              ->relational_expr_node
-                              ->shift_expr_node
-                              ->additive_expr_node
-                              ->multiplicative_expr_node
-                              ->cast_expr_node
-                              ->unary_expr_node
-                              ->postfix_expr_node
-                              ->primary_expr_node
-                              ->constant_node
-                              ->const_type);
+static int get_int_constant(int node) {
+    return expr_val(expr_pool, node);
+}
+
+static const char* get_character_constant(int node) {
+    return symbol_name(expr_val(expr_pool, node));
+}
+
+
+static bool is_int_constant(int node) {
+    return expr_kind(expr_pool, node) == EXPR_CONST && expr_op(expr_pool, node) == CONST_INT;
 }
 
 static void process_global_declaration(const DeclarationNode* node) {
@@ -1885,75 +3231,80 @@ static void process_global_declaration(const DeclarationNode* node) {
         }
 
         const DirectDeclaratorNode* direct_declarator_node = declarator_node->direct_declarator_node;
-        const ConditionalExprNode*  conditional_expr_node  = direct_declarator_node->conditional_expr_node;
-        if (conditional_expr_node == NULL) {
+        const int                   conditional_expr       = direct_declarator_node->conditional_expr;
+        if (conditional_expr == 0) {
             gv->type->array_size = 0;
         } else {
-            gv->type->array_size = get_array_size_from_constant_expr(conditional_expr_node);
+            gv->type->array_size = get_array_size_from_constant_expr(conditional_expr);
         }
 
         const DirectDeclaratorNode* ident_node = get_identifier_direct_declarator(direct_declarator_node);
         if (init_declarator_node->initializer_node != NULL) {
-            printf(".global %s\n", ident_node->identifier);
+            emit_directive(".global", symbol_name(ident_node->identifier));
         } else {
-            printf(".comm %s,8,8\n", ident_node->identifier);
+            emit(".comm ");
+            emit(symbol_name(ident_node->identifier));
+            emit(",8,8\n");
         }
 
-        gv->name = strdup(ident_node->identifier);
-        vector_push_back(globalvar_list, gv);
+        // a variable declared again keeps its first declaration
+        gv->name = ident_node->identifier;
+        if (!hashmap_contains(globalvar_map, gv->name)) {
+            hashmap_put(globalvar_map, gv->name, gv);
+        }
 
         if (init_declarator_node->initializer_node != NULL) {
             const InitializerNode* initializer_node = init_declarator_node->initializer_node;
 
-            if (initializer_node->assign_expr_node != NULL) {
-                if (is_int_constant(initializer_node->assign_expr_node)) {
-                    const int int_constant1 = get_int_constant(initializer_node->assign_expr_node);
-                    printf(".data\n");
-                    printf("%s:\n", gv->name);
-                    printf("  .quad %d\n", int_constant1); 
-                    printf(".text\n");
+            if (initializer_node->assign_expr != 0) {
+                if (is_int_constant(initializer_node->assign_expr)) {
+                    const int int_constant1 = get_int_constant(initializer_node->assign_expr);
+                    emit(".data\n");
+                    emit_label(symbol_name(gv->name));
+                    emit_inst_int(".quad", int_constant1); 
+                    emit(".text\n");
                 } 
                 else {
                     const char* label1 = get_string_label();
-                    printf(".data\n");
-                    printf("%s:\n", label1);
-                    printf("  .string \"%s\"\n", get_character_constant(initializer_node->assign_expr_node));
-                    printf("%s:\n", gv->name);
-                    printf("  .quad %s\n", label1); 
-                    printf(".text\n");
+                    emit(".data\n");
+                    emit_label(label1);
+                    emit_string(get_character_constant(initializer_node->assign_expr));
+                    emit_label(symbol_name(gv->name));
+                    emit_inst_op(".quad", label1); 
+                    emit(".text\n");
                 }
             } 
             else {
                 InitializerListNode* initializer_list_node = initializer_node->initializer_list_node;
                 const InitializerNode* first = initializer_list_node->initializer_nodes->elements[0];
-                if (is_int_constant(first->assign_expr_node)) {
-                    printf(".data\n");
-                    printf("%s:\n", gv->name);
+                if (is_int_constant(first->assign_expr)) {
+                    emit(".data\n");
+                    emit_label(symbol_name(gv->name));
 
                     for (int k = 0; k < initializer_list_node->initializer_nodes->size; ++k) {
                         const InitializerNode* init1 = initializer_list_node->initializer_nodes->elements[k];
-                        const int int_constant2 = get_int_constant(init1->assign_expr_node);
-                        printf("  .quad %d\n", int_constant2); 
+                        const int int_constant2 = get_int_constant(init1->assign_expr);
+                        emit_inst_int(".quad", int_constant2); 
                     }
-                    printf(".text\n");
+                    emit(".text\n");
                 } else {
                     Vector* label_list = create_vector();
-                    printf(".data\n");
+                    emit(".data\n");
                     for (int l = 0; l < initializer_list_node->initializer_nodes->size; ++l) {
                         const InitializerNode* init2 = initializer_list_node->initializer_nodes->elements[l];
                         char* label2 = get_string_label();
-                        printf("%s:\n", label2);
-                        printf("  .string \"%s\"\n", get_character_constant(init2->assign_expr_node));
+                        emit_label(label2);
+                        emit_string(get_character_constant(init2->assign_expr));
 
                         vector_push_back(label_list, label2);
                    }
 
-                   printf("%s:\n", gv->name);
+                   emit_label(symbol_name(gv->name));
                    for (int m = 0; m < label_list->size; ++m) {
                        char* label3 = label_list->elements[m];
-                       printf("  .quad %s\n", label3);
+                       emit_inst_op(".quad", label3);
                    }
-                   printf(".text\n");
+                   emit(".text\n");
                 }
             }
         }
@@ -1962,14 +3313,14 @@ static void process_global_declaration(const DeclarationNode* node) {
 
 static void process_enum_specifier(const EnumSpecifierNode* node) {
     const EnumeratorListNode* enumerator_list_node = node->enumerator_list_node;
-    const Vector* identifiers = enumerator_list_node->identifiers;
+    const IntVector* identifiers = enumerator_list_node->identifiers;
 
     for (int i = 0; i < identifiers->size; ++i) {
-        strintmap_put(enum_map, identifiers->elements[i], i);
+        hashmap_put_int(enum_map, identifiers->elements[i], i);
     }
 }
 
-static void process_external_decl(const ExternalDeclNode* node) {
+static bool process_external_decl(const ExternalDeclNode* node) {
     if (node->enum_specifier_node != NULL) {
         process_enum_specifier(node->enum_specifier_node);
     }
@@ -1978,27 +3329,44 @@ static void process_external_decl(const ExternalDeclNode* node) {
         process_global_declaration(node->declaration_node);
     }
 
-    if (node->func_def_node != NULL) {
-        process_func_def(node->func_def_node);
+    // static functions that are never called are neither parsed nor emitted
+    if (node->func_def_node != NULL && node->func_def_node->is_reachable) {
+        return process_func_def(node->func_def_node);
     }
+    return true;
 }
 
-void gen(const TransUnitNode* node) {
-    printf(".intel_syntax noprefix\n");
-
+bool gen(const TransUnitNode* node, int fd, const GenOptions* options) {
     // init
+    gen_options              = options;
+    output_fd                = fd;
+    output_buffer            = malloc(OUTPUT_BUFFER_SIZE);
+    output_size              = 0;
+    output_failed            = false;
     label_index              = 2;
     break_label_stack        = create_stack();
     continue_label_stack     = create_stack();
+    continue_depth_stack     = create_intstack();
+    switch_depth             = 0;
     type_stack               = create_stack();
     current_stmt_label_stack = create_stack();
     size_stack               = create_intstack();
-    globalvar_list           = create_vector();
-    struct_map               = create_strptrmap(1024);
-    enum_map                 = create_strintmap(1024);
+    expr_work_stack          = create_intstack();
+    expr_label_stack         = create_stack();
+    globalvar_map            = create_hashmap(256);
+    scope_stack              = create_intstack();
+    struct_map               = create_hashmap(256);
+    enum_map                 = create_hashmap(256);
+    expr_pool                = node->expr_pool;
 
     // gen
+    emit(".intel_syntax noprefix\n");
     for (int i = 0; i < node->external_decl_nodes->size; ++i) {
-        process_external_decl(node->external_decl_nodes->elements[i]);
+        if (!process_external_decl(node->external_decl_nodes->elements[i])) {
+            return false;
+        }
     }
+
+    flush_output();
+    return !output_failed;
 }
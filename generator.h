@@ -1,6 +1,7 @@
 #ifndef GENERATOR_H
 #define GENERATOR_H
 
+#include "opt.h"
 #include "parser.h"
 #include "util.h"
 
@@ -25,8 +26,8 @@ struct FieldInfo {
 };
 
 struct StructInfo {
-    StrPtrMap* field_info_map; // field-name => field-info
-    int        size;
+    HashMap* field_info_map; // field-name => field-info
+    int      size;
 };
 
 struct Type {
@@ -39,18 +40,29 @@ struct Type {
 };
 
 struct LocalVar {
-    Type* type; 
-    char* name;
-    int   name_len;
-    int   offset;
+    Type*     type; 
+    int       name;     // symbol id
+    int       offset;
+    LocalVar* shadowed; // same name in an enclosing scope, visible again when this one ends
 };
 
 struct GlobalVar {
     Type* type;
-    char* name;
-    int   name_len;
+    int   name;   // symbol id
+};
+
+typedef struct GenOptions GenOptions;
+
+struct GenOptions {
+    bool         use_ir;    // emit the functions the IR holds from it (see ir.h)
+    bool         dump_ir;   // write the IR of each function instead of assembly
+    PassManager* passes;    // run on the IR of each function, NULL for none (see opt.h)
+    bool         reg_exprs; // evaluate expressions without side effects in registers (-O1 and up)
+    ByteBuffer*  output;    // if not NULL, the assembly is appended to it instead of written to fd
 };
 
-void gen(const TransUnitNode* node);
+// Writes the assembly of node to fd. Returns false if a function body,
+// which is parsed as it is reached, has a syntax error.
+bool gen(const TransUnitNode* node, int fd, const GenOptions* options);
 
 #endif
@@ -0,0 +1,1828 @@
+#include "ir.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "generator.h"
+#include "util.h"
+
+// chunk size of the arena holding the blocks and instructions of a function
+#define IR_ARENA_CHUNK_SIZE 16384
+
+// deepest expression built into the IR, which bounds the recursion; a
+// function with a deeper one is left to the generator
+#define IR_EXPR_MAX_DEPTH 4096
+
+//
+// construction
+//
+// The SSA form is built while the AST is walked, after Braun et al.,
+// "Simple and Efficient Construction of Static Single Assignment Form":
+// each block remembers the register that holds each variable at its end,
+// and a read in a block that does not assign the variable asks the
+// predecessors, placing a phi where they may disagree. A block is sealed
+// once all its predecessors are known; until then the phis of a read in it
+// are incomplete and get their operands when it is sealed.
+//
+// Variables are numbered from 1 in the order declared, so a name declared
+// twice in nested scopes is two variables.
+//
+
+static IrFunc*         ir_func;
+static const ExprPool* ir_pool;
+static const HashMap*  ir_enum_map;
+static const HashMap*  ir_globalvar_map;
+static IrBlock*        ir_block;          // the block instructions are appended to
+static const char*     ir_unsupported;    // what keeps the function out of the IR, NULL if nothing
+static int             ir_undef;          // register read for a variable never assigned, 0 until needed
+static HashMap*        ir_var_map;        // name => innermost visible variable
+static IntVector*      ir_scope_names;    // names declared in the open scopes, innermost last
+static IntVector*      ir_scope_shadowed; // variable each of them hid, 0 if none
+static IntStack*       ir_scope_marks;    // size of ir_scope_names when each scope began
+static int             ir_var_count;
+static Stack*          ir_break_blocks;
+static Stack*          ir_continue_blocks;
+static int             ir_expr_depth;     // build_expr() calls in progress
+
+static int build_expr(int node);
+static void build_stmt(const StmtNode* node);
+static void build_compound_stmt(const CompoundStmtNode* node);
+static void free_ir_vector(Vector* vec);
+
+static void set_unsupported(const char* reason) {
+    if (ir_unsupported == NULL) {
+        ir_unsupported = reason;
+    }
+}
+
+static IrBlock* new_block() {
+    IrBlock* block         = arena_alloc(ir_func->arena, sizeof(IrBlock));
+    block->id              = ir_func->blocks->size;
+    block->phis            = create_vector();
+    block->insts           = create_vector();
+    block->preds           = create_vector();
+    block->succs           = create_vector();
+    block->defs            = create_hashmap(16);
+    block->incomplete_vars = create_intvector();
+    block->incomplete_phis = create_vector();
+    vector_push_back(ir_func->blocks, block);
+    return block;
+}
+
+static IrInst* new_inst(int op) {
+    IrInst* inst = arena_alloc(ir_func->arena, sizeof(IrInst));
+    inst->op = op;
+    return inst;
+}
+
+static int new_reg() {
+    ++ir_func->reg_count;
+    return ir_func->reg_count;
+}
+
+// appends an instruction that defines a new register, and returns it
+static int append_value(int op, int a, int b) {
+    IrInst* inst = new_inst(op);
+    inst->dst = new_reg();
+    inst->a   = a;
+    inst->b   = b;
+    vector_push_back(ir_block->insts, inst);
+    return inst->dst;
+}
+
+static int append_const(int imm) {
+    IrInst* inst = new_inst(IR_CONST);
+    inst->dst = new_reg();
+    inst->imm = imm;
+    vector_push_back(ir_block->insts, inst);
+    return inst->dst;
+}
+
+static int append_sym(int op, int sym) {
+    IrInst* inst = new_inst(op);
+    inst->dst = new_reg();
+    inst->sym = sym;
+    vector_push_back(ir_block->insts, inst);
+    return inst->dst;
+}
+
+static void add_edge(IrBlock* from, IrBlock* to) {
+    vector_push_back(from->succs, to);
+    vector_push_back(to->preds, from);
+}
+
+static void terminate_jmp(IrBlock* target) {
+    vector_push_back(ir_block->insts, new_inst(IR_JMP));
+    add_edge(ir_block, target);
+}
+
+static void terminate_br(int cond, IrBlock* then_block, IrBlock* else_block) {
+    IrInst* inst = new_inst(IR_BR);
+    inst->a = cond;
+    vector_push_back(ir_block->insts, inst);
+    add_edge(ir_block, then_block);
+    add_edge(ir_block, else_block);
+}
+
+static void terminate_ret(int value) {
+    IrInst* inst = new_inst(IR_RET);
+    inst->a = value;
+    vector_push_back(ir_block->insts, inst);
+}
+
+// what follows a jump until the next label is never executed, but is built
+// into a block of its own, which is dropped at the end
+static void start_dead_block() {
+    ir_block = new_block();
+    ir_block->sealed = true;
+}
+
+static IrInst* new_phi(IrBlock* block) {
+    IrInst* phi = new_inst(IR_PHI);
+    phi->dst  = new_reg();
+    phi->args = create_intvector();
+    vector_push_back(block->phis, phi);
+    return phi;
+}
+
+// a constant at the start of the entry block
+static int get_undef() {
+    if (ir_undef == 0) {
+        IrInst* inst = new_inst(IR_CONST);
+        inst->dst = new_reg();
+
+        IrBlock* entry = ir_func->blocks->elements[0];
+        vector_push_back(entry->insts, NULL);
+        for (int i = entry->insts->size - 1; i > 0; --i) {
+            entry->insts->elements[i] = entry->insts->elements[i - 1];
+        }
+        entry->insts->elements[0] = inst;
+        ir_undef = inst->dst;
+    }
+
+    return ir_undef;
+}
+
+static void write_variable(int var, int value) {
+    hashmap_put_int(ir_block->defs, var, value);
+}
+
+static int read_variable(int var, IrBlock* block);
+
+static void add_phi_operands(int var, IrBlock* block, IrInst* phi) {
+    for (int i = 0; i < block->preds->size; ++i) {
+        intvector_push_back(phi->args, read_variable(var, block->preds->elements[i]));
+    }
+}
+
+// The chain of blocks with a single predecessor above block is followed by
+// a loop, and the value found is remembered in each of them.
+static int read_variable(int var, IrBlock* block) {
+    IrBlock* current = block;
+    int value = 0;
+    while (true) {
+        if (hashmap_contains(current->defs, var)) {
+            value = hashmap_get_int(current->defs, var);
+            break;
+        }
+        if (!current->sealed) {
+            IrInst* incomplete_phi = new_phi(current);
+            intvector_push_back(current->incomplete_vars, var);
+            vector_push_back(current->incomplete_phis, incomplete_phi);
+            value = incomplete_phi->dst;
+            break;
+        }
+        if (current->preds->size == 0) {
+            value = get_undef();
+            break;
+        }
+        if (current->preds->size > 1) {
+            // the phi is the value while its operands are read, which ends loops
+            IrInst* join_phi = new_phi(current);
+            hashmap_put_int(current->defs, var, join_phi->dst);
+            add_phi_operands(var, current, join_phi);
+            value = join_phi->dst;
+            break;
+        }
+        current = current->preds->elements[0];
+    }
+
+    IrBlock* walked = block;
+    while (true) {
+        hashmap_put_int(walked->defs, var, value);
+        if (walked == current) {
+            break;
+        }
+        walked = walked->preds->elements[0];
+    }
+
+    return value;
+}
+
+static void seal_block(IrBlock* block) {
+    for (int i = 0; i < block->incomplete_vars->size; ++i) {
+        add_phi_operands(block->incomplete_vars->elements[i], block, block->incomplete_phis->elements[i]);
+    }
+    block->incomplete_vars->size = 0;
+    block->incomplete_phis->size = 0;
+    block->sealed = true;
+}
+
+//
+// scope
+//
+
+static void enter_ir_scope() {
+    intstack_push(ir_scope_marks, ir_scope_names->size);
+}
+
+static void leave_ir_scope() {
+    const int scope_begin = intstack_top(ir_scope_marks);
+    intstack_pop(ir_scope_marks);
+
+    while (ir_scope_names->size > scope_begin) {
+        --ir_scope_names->size;
+        --ir_scope_shadowed->size;
+        const int name = ir_scope_names->elements[ir_scope_names->size];
+        hashmap_put_int(ir_var_map, name, ir_scope_shadowed->elements[ir_scope_shadowed->size]);
+    }
+}
+
+static int declare_variable(int name) {
+    int shadowed = 0;
+    if (hashmap_contains(ir_var_map, name)) {
+        shadowed = hashmap_get_int(ir_var_map, name);
+    }
+
+    ++ir_var_count;
+    intvector_push_back(ir_scope_names, name);
+    intvector_push_back(ir_scope_shadowed, shadowed);
+    hashmap_put_int(ir_var_map, name, ir_var_count);
+    return ir_var_count;
+}
+
+// the variable a name refers to, 0 if it is not a local variable
+static int find_variable(int name) {
+    if (!hashmap_contains(ir_var_map, name)) {
+        return 0;
+    }
+    return hashmap_get_int(ir_var_map, name);
+}
+
+static bool is_int_global(int name) {
+    const GlobalVar* gv = hashmap_get(ir_globalvar_map, name);
+    if (gv == NULL) {
+        return false;
+    }
+
+    const Type* type = gv->type;
+    return type->base_type == VAR_INT && type->ptr_count == 0 && type->array_size == 0;
+}
+
+// true if the specifiers declare a non-static int
+static bool is_int_specifier(const Vector* decl_specifier_nodes) {
+    for (int i = 0; i < decl_specifier_nodes->size; ++i) {
+        const DeclSpecifierNode* decl_specifier_node = decl_specifier_nodes->elements[i];
+        if (decl_specifier_node->is_static) {
+            return false;
+        }
+    }
+
+    for (int j = 0; j < decl_specifier_nodes->size; ++j) {
+        const DeclSpecifierNode* type_decl_specifier_node = decl_specifier_nodes->elements[j];
+        const TypeSpecifierNode* type_specifier_node = type_decl_specifier_node->type_specifier_node;
+        if (type_specifier_node != NULL) {
+            return type_specifier_node->type_specifier == TYPE_INT;
+        }
+    }
+
+    return false;
+}
+
+// the value of an int variable or global named by an expression
+static int read_lvalue(int node) {
+    if (expr_kind(ir_pool, node) != EXPR_IDENT) {
+        set_unsupported("assignment to what is not a variable");
+        return get_undef();
+    }
+
+    const int name = expr_val(ir_pool, node);
+    const int var  = find_variable(name);
+    if (var != 0) {
+        return read_variable(var, ir_block);
+    }
+    if (is_int_global(name)) {
+        return append_sym(IR_LOAD, name);
+    }
+
+    set_unsupported("a variable that is not an int");
+    return get_undef();
+}
+
+static void write_lvalue(int node, int value) {
+    if (expr_kind(ir_pool, node) != EXPR_IDENT) {
+        set_unsupported("assignment to what is not a variable");
+        return;
+    }
+
+    const int name = expr_val(ir_pool, node);
+    const int var  = find_variable(name);
+    if (var != 0) {
+        write_variable(var, value);
+        return;
+    }
+    if (is_int_global(name)) {
+        IrInst* inst = new_inst(IR_STORE);
+        inst->a   = value;
+        inst->sym = name;
+        vector_push_back(ir_block->insts, inst);
+        return;
+    }
+
+    set_unsupported("a variable that is not an int");
+}
+
+//
+// expression
+//
+
+static int get_binary_ir_op(int op) {
+    switch (op) {
+    case OP_MUL:
+    case OP_MUL_EQ: { return IR_MUL; }
+    case OP_DIV:
+    case OP_DIV_EQ: { return IR_DIV; }
+    case OP_MOD:
+    case OP_MOD_EQ: { return IR_MOD; }
+    case OP_ADD:
+    case OP_ADD_EQ: { return IR_ADD; }
+    case OP_SUB:
+    case OP_SUB_EQ: { return IR_SUB; }
+    default:        { return IR_CONST; }
+    }
+}
+
+static int get_compare_ir_op(int op) {
+    switch (op) {
+    case CMP_LT: { return IR_LT; }
+    case CMP_GT: { return IR_GT; }
+    case CMP_LE: { return IR_LE; }
+    case CMP_GE: { return IR_GE; }
+    case CMP_EQ: { return IR_EQ; }
+    case CMP_NE: { return IR_NE; }
+    default:     { return IR_CONST; }
+    }
+}
+
+static int build_identifier(int name) {
+    if (hashmap_contains(ir_enum_map, name)) {
+        return append_const(hashmap_get_int(ir_enum_map, name));
+    }
+
+    const int var = find_variable(name);
+    if (var != 0) {
+        return read_variable(var, ir_block);
+    }
+    if (is_int_global(name)) {
+        return append_sym(IR_LOAD, name);
+    }
+
+    set_unsupported("a variable that is not an int");
+    return get_undef();
+}
+
+static int build_constant(int node) {
+    switch (expr_op(ir_pool, node)) {
+    case CONST_INT:
+    case CONST_BYTE: {
+        return append_const(expr_val(ir_pool, node));
+    }
+    case CONST_STR: {
+        return append_sym(IR_STR, expr_val(ir_pool, node));
+    }
+    default: {
+        set_unsupported("a floating constant");
+        return get_undef();
+    }
+    }
+}
+
+static int build_call(int node) {
+    const int arg_count = expr_arg_count(ir_pool, node);
+    if (arg_count > 6) {
+        set_unsupported("a call with more than 6 arguments");
+        return get_undef();
+    }
+
+    IntVector* args = create_intvector();
+    for (int i = 0; i < arg_count; ++i) {
+        intvector_push_back(args, build_expr(expr_arg(ir_pool, node, i)));
+    }
+
+    IrInst* inst = new_inst(IR_CALL);
+    inst->dst  = new_reg();
+    inst->sym  = expr_val(ir_pool, node);
+    inst->args = args;
+    vector_push_back(ir_block->insts, inst);
+    return inst->dst;
+}
+
+static int build_unary(int node) {
+    const int value = build_expr(expr_lhs(ir_pool, node));
+    switch (expr_op(ir_pool, node)) {
+    case OP_ADD:   { return value; }
+    case OP_SUB:   { return append_value(IR_NEG, value, 0); }
+    case OP_EXCLA: { return append_value(IR_NOT, value, 0); }
+    default: {
+        set_unsupported("a unary &, * or ~");
+        return value;
+    }
+    }
+}
+
+static int build_sizeof_type(const TypeNameNode* type_name_node) {
+    if (type_name_node->is_pointer) {
+        return append_const(8);
+    }
+
+    switch (type_name_node->specifier_qualifier_node->type_specifier_node->type_specifier) {
+    case TYPE_CHAR:   { return append_const(1); }
+    case TYPE_INT:    { return append_const(8); }
+    case TYPE_DOUBLE: { return append_const(8); }
+    default: {
+        set_unsupported("sizeof of a struct");
+        return get_undef();
+    }
+    }
+}
+
+// rhs is evaluated when lhs is false only; the value is 1 or 0
+static int build_logand(int lhs_value, int rhs_node) {
+    const int zero = append_const(0);
+    IrBlock* rhs_block  = new_block();
+    IrBlock* join_block = new_block();
+    terminate_br(lhs_value, rhs_block, join_block);
+    seal_block(rhs_block);
+
+    ir_block = rhs_block;
+    const int rhs_value = build_expr(rhs_node);
+    const int truth     = append_value(IR_NE, rhs_value, zero);
+    terminate_jmp(join_block);
+    seal_block(join_block);
+
+    ir_block = join_block;
+    IrInst* phi = new_phi(join_block);
+    intvector_push_back(phi->args, zero);
+    intvector_push_back(phi->args, truth);
+    return phi->dst;
+}
+
+static bool is_ir_chain_expr(int node) {
+    switch (expr_kind(ir_pool, node)) {
+    case EXPR_BINARY:
+    case EXPR_COMPARE:
+    case EXPR_LOGAND:
+    case EXPR_LOGOR:
+    case EXPR_COMMA: {
+        return true;
+    }
+    default: {
+        return false;
+    }
+    }
+}
+
+// a left spine of binary operators is walked by a loop, as in the generator
+static int build_expr_chain(int node) {
+    IntVector* spine = create_intvector();
+    int current = node;
+    while (is_ir_chain_expr(current)) {
+        intvector_push_back(spine, current);
+        current = expr_lhs(ir_pool, current);
+    }
+
+    int value = build_expr(current);
+    for (int i = spine->size - 1; i >= 0; --i) {
+        const int link = spine->elements[i];
+        switch (expr_kind(ir_pool, link)) {
+        case EXPR_BINARY: {
+            const int ir_op = get_binary_ir_op(expr_op(ir_pool, link));
+            const int rhs_value = build_expr(expr_rhs(ir_pool, link));
+            if (ir_op == IR_CONST) {
+                set_unsupported("a bitwise operator");
+            }
+            value = append_value(ir_op, value, rhs_value);
+            break;
+        }
+        case EXPR_COMPARE: {
+            const int cmp_op = get_compare_ir_op(expr_op(ir_pool, link));
+            const int cmp_rhs_value = build_expr(expr_rhs(ir_pool, link));
+            value = append_value(cmp_op, value, cmp_rhs_value);
+            break;
+        }
+        // both sides are evaluated and or-ed, as by the generator
+        case EXPR_LOGOR: {
+            const int or_rhs_value = build_expr(expr_rhs(ir_pool, link));
+            value = append_value(IR_OR, value, or_rhs_value);
+            break;
+        }
+        case EXPR_LOGAND: {
+            value = build_logand(value, expr_rhs(ir_pool, link));
+            break;
+        }
+        case EXPR_COMMA: {
+            value = build_expr(expr_rhs(ir_pool, link));
+            break;
+        }
+        default: {
+            break;
+        }
+        }
+    }
+
+    free(spine->elements);
+    free(spine);
+    return value;
+}
+
+static int build_cond(int node) {
+    const int cond = build_expr(expr_lhs(ir_pool, node));
+    IrBlock* then_block = new_block();
+    IrBlock* else_block = new_block();
+    IrBlock* join_block = new_block();
+    terminate_br(cond, then_block, else_block);
+    seal_block(then_block);
+    seal_block(else_block);
+
+    ir_block = then_block;
+    const int then_value = build_expr(expr_mid(ir_pool, node));
+    terminate_jmp(join_block);
+
+    ir_block = else_block;
+    const int else_value = build_expr(expr_rhs(ir_pool, node));
+    terminate_jmp(join_block);
+    seal_block(join_block);
+
+    ir_block = join_block;
+    IrInst* phi = new_phi(join_block);
+    intvector_push_back(phi->args, then_value);
+    intvector_push_back(phi->args, else_value);
+    return phi->dst;
+}
+
+// the rhs is evaluated before the lhs is read, as by the generator
+static int build_assign(int node) {
+    const int lhs   = expr_lhs(ir_pool, node);
+    const int op    = expr_op(ir_pool, node);
+    const int value = build_expr(expr_rhs(ir_pool, node));
+    if (op == OP_ASSIGN) {
+        write_lvalue(lhs, value);
+        return value;
+    }
+
+    const int ir_op = get_binary_ir_op(op);
+    if (ir_op == IR_CONST) {
+        set_unsupported("a bitwise assignment operator");
+        return value;
+    }
+    const int result = append_value(ir_op, read_lvalue(lhs), value);
+    write_lvalue(lhs, result);
+    return result;
+}
+
+// ++ and --, which give the new value when prefixed
+static int build_inc_dec(int node, int ir_op, bool prefix) {
+    const int lhs    = expr_lhs(ir_pool, node);
+    const int old    = read_lvalue(lhs);
+    const int result = append_value(ir_op, old, append_const(1));
+    write_lvalue(lhs, result);
+    if (prefix) {
+        return result;
+    }
+    return old;
+}
+
+static int build_expr_kind(int node) {
+    switch (expr_kind(ir_pool, node)) {
+    case EXPR_CONST: {
+        return build_constant(node);
+    }
+    case EXPR_IDENT: {
+        return build_identifier(expr_val(ir_pool, node));
+    }
+    case EXPR_CALL: {
+        return build_call(node);
+    }
+    case EXPR_POST_INC: { return build_inc_dec(node, IR_ADD, false); }
+    case EXPR_POST_DEC: { return build_inc_dec(node, IR_SUB, false); }
+    case EXPR_PRE_INC:  { return build_inc_dec(node, IR_ADD, true);  }
+    case EXPR_PRE_DEC:  { return build_inc_dec(node, IR_SUB, true);  }
+    case EXPR_UNARY: {
+        return build_unary(node);
+    }
+    case EXPR_SIZEOF_IDENT: {
+        const int name = expr_val(ir_pool, node);
+        if (find_variable(name) == 0 && !is_int_global(name)) {
+            set_unsupported("sizeof of a variable that is not an int");
+        }
+        return append_const(8);
+    }
+    case EXPR_SIZEOF_TYPE: {
+        return build_sizeof_type(expr_type_name(ir_pool, node));
+    }
+    case EXPR_BINARY:
+    case EXPR_COMPARE:
+    case EXPR_LOGAND:
+    case EXPR_LOGOR:
+    case EXPR_COMMA: {
+        return build_expr_chain(node);
+    }
+    case EXPR_COND: {
+        return build_cond(node);
+    }
+    case EXPR_ASSIGN: {
+        return build_assign(node);
+    }
+    default: {
+        set_unsupported("an index, member access or address");
+        return get_undef();
+    }
+    }
+}
+
+static int build_expr(int node) {
+    if (ir_expr_depth >= IR_EXPR_MAX_DEPTH) {
+        set_unsupported("an expression nested too deeply");
+        return get_undef();
+    }
+    ++ir_expr_depth;
+    const int value = build_expr_kind(node);
+    --ir_expr_depth;
+    return value;
+}
+
+//
+// statement
+//
+
+static void build_declaration(const DeclarationNode* node) {
+    if (!is_int_specifier(node->decl_specifier_nodes)) {
+        set_unsupported("a local variable that is not an int");
+        return;
+    }
+
+    for (int i = 0; i < node->init_declarator_nodes->size; ++i) {
+        const InitDeclaratorNode* init_declarator_node = node->init_declarator_nodes->elements[i];
+        const DeclaratorNode* declarator_node = init_declarator_node->declarator_node;
+        const DirectDeclaratorNode* direct_declarator_node = declarator_node->direct_declarator_node;
+        if (declarator_node->pointer_node != NULL || direct_declarator_node->conditional_expr != 0 || direct_declarator_node->direct_declarator_node != NULL) {
+            set_unsupported("a local pointer or array");
+            return;
+        }
+
+        // the variable is visible in its own initializer
+        const int var = declare_variable(direct_declarator_node->identifier);
+        const InitializerNode* initializer_node = init_declarator_node->initializer_node;
+        if (initializer_node != NULL) {
+            if (initializer_node->assign_expr == 0) {
+                set_unsupported("an initializer list");
+                return;
+            }
+            write_variable(var, build_expr(initializer_node->assign_expr));
+        }
+    }
+}
+
+static void build_jump_stmt(const JumpStmtNode* node) {
+    switch (node->jump_type) {
+    case JMP_CONTINUE: {
+        IrBlock* continue_block = stack_top(ir_continue_blocks);
+        if (continue_block == NULL) {
+            set_unsupported("a continue outside of a loop");
+            break;
+        }
+        terminate_jmp(continue_block);
+        break;
+    }
+    case JMP_BREAK: {
+        IrBlock* break_block = stack_top(ir_break_blocks);
+        if (break_block == NULL) {
+            set_unsupported("a break outside of a loop");
+            break;
+        }
+        terminate_jmp(break_block);
+        break;
+    }
+    case JMP_RETURN: {
+        int value = 0;
+        if (node->expr != 0) {
+            value = build_expr(node->expr);
+        }
+        terminate_ret(value);
+        break;
+    }
+    default: {
+        break;
+    }
+    }
+    start_dead_block();
+}
+
+// an if and the else-ifs chained to it share one join block
+static void build_selection_stmt(const SelectionStmtNode* node) {
+    if (node->selection_type == SELECT_SWITCH) {
+        set_unsupported("a switch statement");
+        return;
+    }
+
+    IrBlock* join_block = new_block();
+    const SelectionStmtNode* current = node;
+    while (current != NULL) {
+        const int cond = build_expr(current->expr);
+        IrBlock* then_block = new_block();
+        IrBlock* else_block = join_block;
+        if (current->selection_type == SELECT_IF_ELSE) {
+            else_block = new_block();
+        }
+        terminate_br(cond, then_block, else_block);
+        seal_block(then_block);
+
+        ir_block = then_block;
+        build_stmt(current->stmt_node_0);
+        terminate_jmp(join_block);
+
+        if (current->selection_type == SELECT_IF) {
+            break;
+        }
+
+        seal_block(else_block);
+        ir_block = else_block;
+        const StmtNode* else_stmt_node = current->stmt_node_1;
+        current = else_stmt_node->selection_stmt_node;
+        if (current != NULL && current->selection_type == SELECT_SWITCH) {
+            current = NULL;
+        }
+        if (current == NULL) {
+            build_stmt(else_stmt_node);
+            terminate_jmp(join_block);
+        }
+    }
+
+    seal_block(join_block);
+    ir_block = join_block;
+}
+
+static void build_loop_body(const StmtNode* node, IrBlock* break_block, IrBlock* continue_block) {
+    stack_push(ir_break_blocks, break_block);
+    stack_push(ir_continue_blocks, continue_block);
+    build_stmt(node);
+    stack_pop(ir_break_blocks);
+    stack_pop(ir_continue_blocks);
+}
+
+// The header is sealed after the body, when the back edges are known, and
+// the exit block after the breaks.
+static void build_itr_stmt(const ItrStmtNode* node) {
+    switch (node->itr_type) {
+    case ITR_WHILE: {
+        IrBlock* header_block = new_block();
+        IrBlock* body_block   = new_block();
+        IrBlock* exit_block   = new_block();
+        terminate_jmp(header_block);
+
+        ir_block = header_block;
+        terminate_br(build_expr(node->expr_0), body_block, exit_block);
+        seal_block(body_block);
+
+        ir_block = body_block;
+        build_loop_body(node->stmt_node, exit_block, header_block);
+        terminate_jmp(header_block);
+
+        seal_block(header_block);
+        seal_block(exit_block);
+        ir_block = exit_block;
+        break;
+    }
+    case ITR_FOR: {
+        enter_ir_scope();
+        if (node->declaration_nodes->size != 0) {
+            for (int i = 0; i < node->declaration_nodes->size; ++i) {
+                build_declaration(node->declaration_nodes->elements[i]);
+            }
+        }
+        else if (node->expr_0 != 0) {
+            build_expr(node->expr_0);
+        }
+
+        IrBlock* cond_block = new_block();
+        IrBlock* loop_block = new_block();
+        IrBlock* step_block = new_block();
+        IrBlock* done_block = new_block();
+        terminate_jmp(cond_block);
+
+        ir_block = cond_block;
+        if (node->expr_1 != 0) {
+            terminate_br(build_expr(node->expr_1), loop_block, done_block);
+        }
+        else {
+            terminate_jmp(loop_block);
+        }
+        seal_block(loop_block);
+
+        ir_block = loop_block;
+        build_loop_body(node->stmt_node, done_block, step_block);
+        terminate_jmp(step_block);
+
+        seal_block(step_block);
+        ir_block = step_block;
+        if (node->expr_2 != 0) {
+            build_expr(node->expr_2);
+        }
+        terminate_jmp(cond_block);
+
+        seal_block(cond_block);
+        seal_block(done_block);
+        ir_block = done_block;
+        leave_ir_scope();
+        break;
+    }
+    default: {
+        break;
+    }
+    }
+}
+
+static void build_stmt(const StmtNode* node) {
+    if (node->labeled_stmt_node != NULL) {
+        set_unsupported("a case or default label");
+    }
+    else if (node->expr_stmt_node != NULL) {
+        if (node->expr_stmt_node->expr != 0) {
+            build_expr(node->expr_stmt_node->expr);
+        }
+    }
+    else if (node->compound_stmt_node != NULL) {
+        build_compound_stmt(node->compound_stmt_node);
+    }
+    else if (node->selection_stmt_node != NULL) {
+        build_selection_stmt(node->selection_stmt_node);
+    }
+    else if (node->itr_stmt_node != NULL) {
+        build_itr_stmt(node->itr_stmt_node);
+    }
+    else if (node->jump_stmt_node != NULL) {
+        build_jump_stmt(node->jump_stmt_node);
+    }
+}
+
+static void build_compound_stmt(const CompoundStmtNode* node) {
+    enter_ir_scope();
+    for (int i = 0; i < node->block_item_nodes->size; ++i) {
+        const BlockItemNode* block_item_node = node->block_item_nodes->elements[i];
+        if (block_item_node->declaration_node != NULL) {
+            build_declaration(block_item_node->declaration_node);
+        }
+        else {
+            build_stmt(block_item_node->stmt_node);
+        }
+    }
+    leave_ir_scope();
+}
+
+// The parameters are in the registers of the calling convention, the first
+// one last in the list.
+static void build_params(const ParamTypeListNode* node) {
+    if (node == NULL) {
+        return;
+    }
+    if (node->has_ellipsis) {
+        set_unsupported("a variable argument list");
+        return;
+    }
+
+    int count = 0;
+    const ParamListNode* counted = node->param_list_node;
+    while (counted != NULL) {
+        ++count;
+        counted = counted->param_list_node;
+    }
+    if (count > 6) {
+        set_unsupported("more than 6 parameters");
+        return;
+    }
+    ir_func->param_count = count;
+
+    // the declarations, first parameter first
+    Vector* param_nodes = create_vector();
+    for (int i = 0; i < count; ++i) {
+        vector_push_back(param_nodes, NULL);
+    }
+    int index = count - 1;
+    const ParamListNode* current = node->param_list_node;
+    while (current != NULL) {
+        param_nodes->elements[index] = current->param_declaration_node;
+        current = current->param_list_node;
+        --index;
+    }
+
+    for (int j = 0; j < count; ++j) {
+        const ParamDeclarationNode* param_declaration_node = param_nodes->elements[j];
+        const DeclaratorNode* declarator_node = param_declaration_node->declarator_node;
+        if (declarator_node == NULL) {
+            continue;
+        }
+
+        const DirectDeclaratorNode* direct_declarator_node = declarator_node->direct_declarator_node;
+        if (!is_int_specifier(param_declaration_node->decl_spec_nodes) || declarator_node->pointer_node != NULL || direct_declarator_node->conditional_expr != 0) {
+            set_unsupported("a parameter that is not an int");
+            break;
+        }
+
+        IrInst* inst = new_inst(IR_PARAM);
+        inst->dst = new_reg();
+        inst->imm = j;
+        vector_push_back(ir_block->insts, inst);
+        write_variable(declare_variable(direct_declarator_node->identifier), inst->dst);
+    }
+    free_ir_vector(param_nodes);
+}
+
+//
+// editing
+//
+// Used at the end of the construction and by the passes (see opt.c).
+//
+
+static void free_ir_intvector(IntVector* vec) {
+    if (vec != NULL) {
+        free(vec->elements);
+        free(vec);
+    }
+}
+
+static void free_ir_vector(Vector* vec) {
+    free(vec->elements);
+    free(vec);
+}
+
+static void free_block_construction(IrBlock* block) {
+    free(block->defs->keys);
+    free(block->defs->vals);
+    free(block->defs->nums);
+    free(block->defs);
+    block->defs = NULL;
+    free_ir_intvector(block->incomplete_vars);
+    block->incomplete_vars = NULL;
+    free_ir_vector(block->incomplete_phis);
+    block->incomplete_phis = NULL;
+}
+
+static void free_block(IrBlock* block) {
+    for (int i = 0; i < block->phis->size; ++i) {
+        const IrInst* phi = block->phis->elements[i];
+        free_ir_intvector(phi->args);
+    }
+    for (int j = 0; j < block->insts->size; ++j) {
+        const IrInst* inst = block->insts->elements[j];
+        free_ir_intvector(inst->args);
+    }
+    free_ir_vector(block->phis);
+    free_ir_vector(block->insts);
+    free_ir_vector(block->preds);
+    free_ir_vector(block->succs);
+    if (block->defs != NULL) {
+        free_block_construction(block);
+    }
+}
+
+// blocks reachable from the entry, in reverse postorder; marks[id] is set
+// for them. The successors are visited last first, so that the first one
+// comes right after its block.
+static Vector* get_reverse_postorder(const IrFunc* func, IntVector* marks) {
+    Vector* order = create_vector();
+    Stack* block_stack = create_stack();
+    IntStack* next_succ_stack = create_intstack();
+
+    for (int i = 0; i < func->blocks->size; ++i) {
+        intvector_push_back(marks, 0);
+    }
+
+    IrBlock* entry = func->blocks->elements[0];
+    marks->elements[entry->id] = 1;
+    stack_push(block_stack, entry);
+    intstack_push(next_succ_stack, 0);
+    while (block_stack->top >= 0) {
+        IrBlock* block = stack_top(block_stack);
+        const int next = intstack_top(next_succ_stack);
+        if (next < block->succs->size) {
+            intstack_pop(next_succ_stack);
+            intstack_push(next_succ_stack, next + 1);
+            IrBlock* succ = block->succs->elements[block->succs->size - 1 - next];
+            if (marks->elements[succ->id] == 0) {
+                marks->elements[succ->id] = 1;
+                stack_push(block_stack, succ);
+                intstack_push(next_succ_stack, 0);
+            }
+        }
+        else {
+            vector_push_back(order, block);
+            stack_pop(block_stack);
+            intstack_pop(next_succ_stack);
+        }
+    }
+
+    for (int j = 0; j < order->size / 2; ++j) {
+        void* swapped = order->elements[j];
+        order->elements[j] = order->elements[order->size - 1 - j];
+        order->elements[order->size - 1 - j] = swapped;
+    }
+
+    free(block_stack->elements);
+    free(block_stack);
+    free(next_succ_stack->elements);
+    free(next_succ_stack);
+    return order;
+}
+
+// drops the edges from unreachable blocks, with their phi operands
+static void remove_unreachable_preds(IrBlock* block, const IntVector* reachable) {
+    int kept = 0;
+    for (int i = 0; i < block->preds->size; ++i) {
+        const IrBlock* pred = block->preds->elements[i];
+        if (reachable->elements[pred->id] == 0) {
+            continue;
+        }
+        block->preds->elements[kept] = block->preds->elements[i];
+        for (int j = 0; j < block->phis->size; ++j) {
+            const IrInst* phi = block->phis->elements[j];
+            phi->args->elements[kept] = phi->args->elements[i];
+        }
+        ++kept;
+    }
+
+    block->preds->size = kept;
+    for (int k = 0; k < block->phis->size; ++k) {
+        const IrInst* kept_phi = block->phis->elements[k];
+        kept_phi->args->size = kept;
+    }
+}
+
+void remove_unreachable_ir_blocks(IrFunc* func) {
+    IntVector* reachable = create_intvector();
+    Vector* order = get_reverse_postorder(func, reachable);
+
+    for (int i = 0; i < func->blocks->size; ++i) {
+        IrBlock* block = func->blocks->elements[i];
+        if (reachable->elements[i] == 0) {
+            free_block(block);
+        }
+        else {
+            remove_unreachable_preds(block, reachable);
+        }
+    }
+
+    free_ir_vector(func->blocks);
+    func->blocks = order;
+    for (int j = 0; j < order->size; ++j) {
+        IrBlock* renumbered = order->elements[j];
+        renumbered->id = j;
+    }
+    free_ir_intvector(reachable);
+}
+
+void remove_ir_pred(IrBlock* block, int index) {
+    for (int i = index + 1; i < block->preds->size; ++i) {
+        block->preds->elements[i - 1] = block->preds->elements[i];
+    }
+    --block->preds->size;
+
+    for (int j = 0; j < block->phis->size; ++j) {
+        const IrInst* phi = block->phis->elements[j];
+        for (int k = index + 1; k < phi->args->size; ++k) {
+            phi->args->elements[k - 1] = phi->args->elements[k];
+        }
+        --phi->args->size;
+    }
+}
+
+int count_ir_insts(const IrFunc* func) {
+    int count = 0;
+    for (int i = 0; i < func->blocks->size; ++i) {
+        const IrBlock* block = func->blocks->elements[i];
+        count += block->phis->size + block->insts->size;
+    }
+    return count;
+}
+
+static int resolve_reg(const IntVector* forward, int reg) {
+    int current = reg;
+    while (current != 0 && forward->elements[current] != 0) {
+        current = forward->elements[current];
+    }
+    return current;
+}
+
+// the one value a phi merges besides itself, or 0 if it merges several
+static int get_trivial_phi_value(const IntVector* forward, const IrInst* phi) {
+    int same = 0;
+    for (int i = 0; i < phi->args->size; ++i) {
+        const int arg = resolve_reg(forward, phi->args->elements[i]);
+        if (arg == phi->dst || arg == same) {
+            continue;
+        }
+        if (same != 0) {
+            return 0;
+        }
+        same = arg;
+    }
+
+    return same;
+}
+
+void replace_ir_regs(IrFunc* func, const IntVector* forward) {
+    for (int i = 0; i < func->blocks->size; ++i) {
+        const IrBlock* block = func->blocks->elements[i];
+        for (int j = 0; j < block->phis->size; ++j) {
+            const IrInst* phi = block->phis->elements[j];
+            for (int k = 0; k < phi->args->size; ++k) {
+                phi->args->elements[k] = resolve_reg(forward, phi->args->elements[k]);
+            }
+        }
+        for (int l = 0; l < block->insts->size; ++l) {
+            IrInst* inst = block->insts->elements[l];
+            inst->a = resolve_reg(forward, inst->a);
+            inst->b = resolve_reg(forward, inst->b);
+            if (inst->args != NULL) {
+                for (int m = 0; m < inst->args->size; ++m) {
+                    inst->args->elements[m] = resolve_reg(forward, inst->args->elements[m]);
+                }
+            }
+        }
+    }
+}
+
+// Phis placed for reads that found the same value on every path, and the
+// phis that only merge those, are replaced by the value.
+bool remove_trivial_ir_phis(IrFunc* func) {
+    IntVector* forward = create_intvector();
+    for (int i = 0; i <= func->reg_count; ++i) {
+        intvector_push_back(forward, 0);
+    }
+
+    bool removed = false;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int j = 0; j < func->blocks->size; ++j) {
+            const IrBlock* block = func->blocks->elements[j];
+            int kept = 0;
+            for (int k = 0; k < block->phis->size; ++k) {
+                IrInst* phi = block->phis->elements[k];
+                const int value = get_trivial_phi_value(forward, phi);
+                if (value != 0) {
+                    forward->elements[phi->dst] = value;
+                    free_ir_intvector(phi->args);
+                    changed = true;
+                    removed = true;
+                    continue;
+                }
+                block->phis->elements[kept] = phi;
+                ++kept;
+            }
+            block->phis->size = kept;
+        }
+    }
+
+    if (removed) {
+        replace_ir_regs(func, forward);
+    }
+    free_ir_intvector(forward);
+    return removed;
+}
+
+static bool is_reg_used(const IrFunc* func, int reg) {
+    for (int i = 0; i < func->blocks->size; ++i) {
+        const IrBlock* block = func->blocks->elements[i];
+        for (int j = 0; j < block->phis->size; ++j) {
+            const IrInst* phi = block->phis->elements[j];
+            for (int k = 0; k < phi->args->size; ++k) {
+                if (phi->args->elements[k] == reg) {
+                    return true;
+                }
+            }
+        }
+        for (int l = 0; l < block->insts->size; ++l) {
+            const IrInst* inst = block->insts->elements[l];
+            if (inst->a == reg || inst->b == reg) {
+                return true;
+            }
+            if (inst->args != NULL) {
+                for (int m = 0; m < inst->args->size; ++m) {
+                    if (inst->args->elements[m] == reg) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// the undefined value is often read only by code that turned out dead
+static void remove_unused_undef(IrFunc* func) {
+    if (ir_undef == 0 || is_reg_used(func, ir_undef)) {
+        return;
+    }
+
+    IrBlock* entry = func->blocks->elements[0];
+    for (int i = 1; i < entry->insts->size; ++i) {
+        entry->insts->elements[i - 1] = entry->insts->elements[i];
+    }
+    --entry->insts->size;
+}
+
+static void reset_construction() {
+    free(ir_var_map->keys);
+    free(ir_var_map->vals);
+    free(ir_var_map->nums);
+    free(ir_var_map);
+    free_ir_intvector(ir_scope_names);
+    free_ir_intvector(ir_scope_shadowed);
+    free(ir_scope_marks->elements);
+    free(ir_scope_marks);
+    free(ir_break_blocks->elements);
+    free(ir_break_blocks);
+    free(ir_continue_blocks->elements);
+    free(ir_continue_blocks);
+    ir_func  = NULL;
+    ir_block = NULL;
+}
+
+IrFunc* build_ir(const FuncDefNode* node, const HashMap* enum_map, const HashMap* globalvar_map, const char** reason_out) {
+    IrFunc* func = calloc(1, sizeof(IrFunc));
+    func->blocks = create_vector();
+    func->arena  = create_arena(IR_ARENA_CHUNK_SIZE);
+
+    ir_func            = func;
+    ir_pool            = node->expr_pool;
+    ir_enum_map        = enum_map;
+    ir_globalvar_map   = globalvar_map;
+    ir_unsupported     = NULL;
+    ir_undef           = 0;
+    ir_var_map         = create_hashmap(64);
+    ir_scope_names     = create_intvector();
+    ir_scope_shadowed  = create_intvector();
+    ir_scope_marks     = create_intstack();
+    ir_var_count       = 0;
+    ir_break_blocks    = create_stack();
+    ir_continue_blocks = create_stack();
+
+    const DirectDeclaratorNode* direct_declarator_node = node->declarator_node->direct_declarator_node;
+    const DirectDeclaratorNode* name_node = direct_declarator_node;
+    while (name_node->direct_declarator_node != NULL) {
+        name_node = name_node->direct_declarator_node;
+    }
+    func->name = name_node->identifier;
+
+    ir_block = new_block();
+    ir_block->sealed = true;
+    enter_ir_scope(); // the parameters
+    build_params(direct_declarator_node->param_type_list_node);
+    if (ir_unsupported == NULL) {
+        build_compound_stmt(node->compound_stmt_node);
+    }
+    terminate_ret(0);
+    leave_ir_scope();
+
+    for (int i = 0; i < func->blocks->size; ++i) {
+        free_block_construction(func->blocks->elements[i]);
+    }
+    if (ir_unsupported == NULL) {
+        remove_unreachable_ir_blocks(func);
+        remove_trivial_ir_phis(func);
+        remove_unused_undef(func);
+    }
+    reset_construction();
+
+    if (ir_unsupported != NULL) {
+        *reason_out = ir_unsupported;
+        free_ir(func);
+        return NULL;
+    }
+
+    return func;
+}
+
+void free_ir(IrFunc* func) {
+    for (int i = 0; i < func->blocks->size; ++i) {
+        free_block(func->blocks->elements[i]);
+    }
+    free_ir_vector(func->blocks);
+    arena_release(func->arena);
+    free(func->arena);
+    free(func);
+}
+
+//
+// verification
+//
+
+static bool is_terminator(int op) {
+    return op == IR_JMP || op == IR_BR || op == IR_RET;
+}
+
+static int count_blocks(const Vector* blocks, const IrBlock* block) {
+    int count = 0;
+    for (int i = 0; i < blocks->size; ++i) {
+        if (blocks->elements[i] == block) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// the number of operand registers an instruction must have: a, or a and b
+int get_ir_operand_count(int op) {
+    switch (op) {
+    case IR_STORE:
+    case IR_NEG:
+    case IR_NOT:
+    case IR_BR: {
+        return 1;
+    }
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_MOD:
+    case IR_OR:
+    case IR_LT:
+    case IR_GT:
+    case IR_LE:
+    case IR_GE:
+    case IR_EQ:
+    case IR_NE: {
+        return 2;
+    }
+    default: {
+        return 0;
+    }
+    }
+}
+
+static bool verify_block_shape(const IrBlock* block) {
+    if (block->insts->size == 0) {
+        error("ir: .B%d is empty.\n", block->id);
+        return false;
+    }
+
+    for (int i = 0; i < block->phis->size; ++i) {
+        const IrInst* phi = block->phis->elements[i];
+        if (phi->op != IR_PHI) {
+            error("ir: .B%d has a %s among its phis.\n", block->id, decode_ir_op(phi->op));
+            return false;
+        }
+        if (phi->args->size != block->preds->size) {
+            error("ir: %%%d has %d operands for %d predecessors.\n", phi->dst, phi->args->size, block->preds->size);
+            return false;
+        }
+    }
+
+    for (int j = 0; j < block->insts->size; ++j) {
+        const IrInst* inst = block->insts->elements[j];
+        const bool last = (j == block->insts->size - 1);
+        if (inst->op == IR_PHI || is_terminator(inst->op) != last) {
+            error("ir: .B%d has a misplaced %s.\n", block->id, decode_ir_op(inst->op));
+            return false;
+        }
+    }
+
+    const IrInst* terminator = block->insts->elements[block->insts->size - 1];
+    int succ_count = 0;
+    if (terminator->op == IR_JMP) {
+        succ_count = 1;
+    }
+    if (terminator->op == IR_BR) {
+        succ_count = 2;
+    }
+    if (block->succs->size != succ_count) {
+        error("ir: .B%d has %d successors for its %s.\n", block->id, block->succs->size, decode_ir_op(terminator->op));
+        return false;
+    }
+
+    for (int k = 0; k < block->succs->size; ++k) {
+        const IrBlock* succ = block->succs->elements[k];
+        if (count_blocks(succ->preds, block) != count_blocks(block->succs, succ)) {
+            error("ir: the edges between .B%d and .B%d do not match.\n", block->id, succ->id);
+            return false;
+        }
+    }
+    for (int l = 0; l < block->preds->size; ++l) {
+        const IrBlock* pred = block->preds->elements[l];
+        if (count_blocks(pred->succs, block) != count_blocks(block->preds, pred)) {
+            error("ir: the edges between .B%d and .B%d do not match.\n", pred->id, block->id);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"; idoms
+// and the positions are indexed by block id
+static int intersect_dominators(const IntVector* idoms, const IntVector* rpo_index, int b1, int b2) {
+    int finger1 = b1;
+    int finger2 = b2;
+    while (finger1 != finger2) {
+        while (rpo_index->elements[finger1] > rpo_index->elements[finger2]) {
+            finger1 = idoms->elements[finger1];
+        }
+        while (rpo_index->elements[finger2] > rpo_index->elements[finger1]) {
+            finger2 = idoms->elements[finger2];
+        }
+    }
+    return finger1;
+}
+
+static IntVector* compute_idoms(const Vector* order, int block_count) {
+    IntVector* idoms     = create_intvector();
+    IntVector* rpo_index = create_intvector();
+    for (int i = 0; i < block_count; ++i) {
+        intvector_push_back(idoms, -1);
+        intvector_push_back(rpo_index, 0);
+    }
+    for (int j = 0; j < order->size; ++j) {
+        const IrBlock* ordered = order->elements[j];
+        rpo_index->elements[ordered->id] = j;
+    }
+
+    const IrBlock* entry = order->elements[0];
+    idoms->elements[entry->id] = entry->id;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int k = 1; k < order->size; ++k) {
+            const IrBlock* block = order->elements[k];
+            int new_idom = -1;
+            for (int l = 0; l < block->preds->size; ++l) {
+                const IrBlock* pred = block->preds->elements[l];
+                if (idoms->elements[pred->id] == -1) {
+                    continue;
+                }
+                if (new_idom == -1) {
+                    new_idom = pred->id;
+                }
+                else {
+                    new_idom = intersect_dominators(idoms, rpo_index, pred->id, new_idom);
+                }
+            }
+            if (idoms->elements[block->id] != new_idom) {
+                idoms->elements[block->id] = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    free_ir_intvector(rpo_index);
+    return idoms;
+}
+
+IntVector* compute_ir_idoms(const IrFunc* func) {
+    IntVector* reachable = create_intvector();
+    Vector* order = get_reverse_postorder(func, reachable);
+    IntVector* idoms = compute_idoms(order, func->blocks->size);
+    free_ir_intvector(reachable);
+    free_ir_vector(order);
+    return idoms;
+}
+
+bool dominates_ir_block(const IntVector* idoms, int dominator, int block_id) {
+    int current = block_id;
+    while (current != dominator) {
+        const int parent = idoms->elements[current];
+        if (parent == current) {
+            return false;
+        }
+        current = parent;
+    }
+    return true;
+}
+
+// def_blocks and def_positions of a register are where it is defined; the
+// phis of a block come before its instructions, at positions -1
+static bool verify_use(const IntVector* idoms, const IntVector* def_blocks, const IntVector* def_positions, int reg, int block_id, int position) {
+    if (reg <= 0 || reg >= def_blocks->size) {
+        error("ir: .B%d uses %%%d, out of range.\n", block_id, reg);
+        return false;
+    }
+    if (def_blocks->elements[reg] == -1) {
+        error("ir: .B%d uses %%%d, which is not defined.\n", block_id, reg);
+        return false;
+    }
+
+    const int def_block = def_blocks->elements[reg];
+    if (def_block == block_id) {
+        if (def_positions->elements[reg] >= position) {
+            error("ir: .B%d uses %%%d before it is defined.\n", block_id, reg);
+            return false;
+        }
+        return true;
+    }
+    if (!dominates_ir_block(idoms, def_block, block_id)) {
+        error("ir: %%%d of .B%d does not dominate its use in .B%d.\n", reg, def_block, block_id);
+        return false;
+    }
+
+    return true;
+}
+
+static bool define_reg(IntVector* def_blocks, IntVector* def_positions, int reg, int block_id, int position) {
+    if (reg <= 0 || reg >= def_blocks->size) {
+        error("ir: .B%d defines %%%d, out of range.\n", block_id, reg);
+        return false;
+    }
+    if (def_blocks->elements[reg] != -1) {
+        error("ir: %%%d is defined twice.\n", reg);
+        return false;
+    }
+
+    def_blocks->elements[reg]    = block_id;
+    def_positions->elements[reg] = position;
+    return true;
+}
+
+static bool verify_defs(const IrFunc* func, IntVector* def_blocks, IntVector* def_positions) {
+    for (int i = 0; i < func->blocks->size; ++i) {
+        const IrBlock* block = func->blocks->elements[i];
+        for (int j = 0; j < block->phis->size; ++j) {
+            const IrInst* phi = block->phis->elements[j];
+            if (!define_reg(def_blocks, def_positions, phi->dst, block->id, -1)) {
+                return false;
+            }
+        }
+        for (int k = 0; k < block->insts->size; ++k) {
+            const IrInst* inst = block->insts->elements[k];
+            const bool has_dst = !(inst->op == IR_STORE || is_terminator(inst->op));
+            if (has_dst != (inst->dst != 0)) {
+                error("ir: .B%d has a %s with a wrong destination.\n", block->id, decode_ir_op(inst->op));
+                return false;
+            }
+            if (has_dst && !define_reg(def_blocks, def_positions, inst->dst, block->id, k)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool verify_uses(const IrFunc* func, const IntVector* idoms, const IntVector* def_blocks, const IntVector* def_positions) {
+    for (int i = 0; i < func->blocks->size; ++i) {
+        const IrBlock* block = func->blocks->elements[i];
+
+        // a phi operand is used at the end of its predecessor
+        for (int j = 0; j < block->phis->size; ++j) {
+            const IrInst* phi = block->phis->elements[j];
+            for (int k = 0; k < phi->args->size; ++k) {
+                const IrBlock* pred = block->preds->elements[k];
+                if (!verify_use(idoms, def_blocks, def_positions, phi->args->elements[k], pred->id, pred->insts->size)) {
+                    return false;
+                }
+            }
+        }
+
+        for (int l = 0; l < block->insts->size; ++l) {
+            const IrInst* inst = block->insts->elements[l];
+            const int operand_count = get_ir_operand_count(inst->op);
+            if (operand_count >= 1 && !verify_use(idoms, def_blocks, def_positions, inst->a, block->id, l)) {
+                return false;
+            }
+            if (operand_count == 2 && !verify_use(idoms, def_blocks, def_positions, inst->b, block->id, l)) {
+                return false;
+            }
+            if (inst->op == IR_RET && inst->a != 0 && !verify_use(idoms, def_blocks, def_positions, inst->a, block->id, l)) {
+                return false;
+            }
+            if (inst->op == IR_CALL) {
+                for (int m = 0; m < inst->args->size; ++m) {
+                    if (!verify_use(idoms, def_blocks, def_positions, inst->args->elements[m], block->id, l)) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool verify_ir(const IrFunc* func) {
+    if (func->blocks->size == 0) {
+        error("ir: no entry block.\n");
+        return false;
+    }
+
+    for (int i = 0; i < func->blocks->size; ++i) {
+        const IrBlock* block = func->blocks->elements[i];
+        if (block->id != i) {
+            error("ir: .B%d is block %d.\n", block->id, i);
+            return false;
+        }
+        if (!verify_block_shape(block)) {
+            return false;
+        }
+    }
+
+    IntVector* reachable = create_intvector();
+    Vector* order = get_reverse_postorder(func, reachable);
+    bool ok = (order->size == func->blocks->size);
+    if (!ok) {
+        error("ir: %d blocks are unreachable.\n", func->blocks->size - order->size);
+    }
+
+    IntVector* def_blocks    = create_intvector();
+    IntVector* def_positions = create_intvector();
+    for (int j = 0; j <= func->reg_count; ++j) {
+        intvector_push_back(def_blocks, -1);
+        intvector_push_back(def_positions, 0);
+    }
+    if (ok) {
+        ok = verify_defs(func, def_blocks, def_positions);
+    }
+    if (ok) {
+        IntVector* idoms = compute_idoms(order, func->blocks->size);
+        ok = verify_uses(func, idoms, def_blocks, def_positions);
+        free_ir_intvector(idoms);
+    }
+
+    free_ir_intvector(def_blocks);
+    free_ir_intvector(def_positions);
+    free_ir_intvector(reachable);
+    free_ir_vector(order);
+    return ok;
+}
+
+//
+// printer
+//
+
+const char* decode_ir_op(int op) {
+    switch (op) {
+    case IR_CONST: { return "const"; }
+    case IR_PARAM: { return "param"; }
+    case IR_STR:   { return "str";   }
+    case IR_LOAD:  { return "load";  }
+    case IR_STORE: { return "store"; }
+    case IR_NEG:   { return "neg";   }
+    case IR_NOT:   { return "not";   }
+    case IR_ADD:   { return "add";   }
+    case IR_SUB:   { return "sub";   }
+    case IR_MUL:   { return "mul";   }
+    case IR_DIV:   { return "div";   }
+    case IR_MOD:   { return "mod";   }
+    case IR_OR:    { return "or";    }
+    case IR_LT:    { return "lt";    }
+    case IR_GT:    { return "gt";    }
+    case IR_LE:    { return "le";    }
+    case IR_GE:    { return "ge";    }
+    case IR_EQ:    { return "eq";    }
+    case IR_NE:    { return "ne";    }
+    case IR_CALL:  { return "call";  }
+    case IR_PHI:   { return "phi";   }
+    case IR_JMP:   { return "jmp";   }
+    case IR_BR:    { return "br";    }
+    case IR_RET:   { return "ret";   }
+    default:       { return "?";     }
+    }
+}
+
+static void put_ir_text(ByteBuffer* buf, const char* text) {
+    bytebuffer_put_bytes(buf, text, strlen(text));
+}
+
+static void put_ir_number(ByteBuffer* buf, const char* prefix, int n) {
+    char number[32];
+    snprintf(number, 32, "%s%d", prefix, n);
+    put_ir_text(buf, number);
+}
+
+static void put_block_ref(ByteBuffer* buf, const IrBlock* block) {
+    put_ir_number(buf, ".B", block->id);
+}
+
+static void print_inst(const IrInst* inst, const IrBlock* block, ByteBuffer* buf) {
+    put_ir_text(buf, "  ");
+    if (inst->dst != 0) {
+        put_ir_number(buf, "%", inst->dst);
+        put_ir_text(buf, " = ");
+    }
+    put_ir_text(buf, decode_ir_op(inst->op));
+
+    switch (inst->op) {
+    case IR_CONST:
+    case IR_PARAM: {
+        put_ir_number(buf, " ", inst->imm);
+        break;
+    }
+    case IR_STR: {
+        put_ir_text(buf, " \"");
+        put_ir_text(buf, symbol_name(inst->sym));
+        put_ir_text(buf, "\"");
+        break;
+    }
+    case IR_LOAD: {
+        put_ir_text(buf, " ");
+        put_ir_text(buf, symbol_name(inst->sym));
+        break;
+    }
+    case IR_STORE: {
+        put_ir_text(buf, " ");
+        put_ir_text(buf, symbol_name(inst->sym));
+        put_ir_number(buf, ", %", inst->a);
+        break;
+    }
+    case IR_CALL: {
+        put_ir_text(buf, " ");
+        put_ir_text(buf, symbol_name(inst->sym));
+        put_ir_text(buf, "(");
+        for (int i = 0; i < inst->args->size; ++i) {
+            if (i > 0) {
+                put_ir_text(buf, ", ");
+            }
+            put_ir_number(buf, "%", inst->args->elements[i]);
+        }
+        put_ir_text(buf, ")");
+        break;
+    }
+    case IR_PHI: {
+        for (int j = 0; j < inst->args->size; ++j) {
+            if (j > 0) {
+                put_ir_text(buf, ",");
+            }
+            put_ir_number(buf, " [%", inst->args->elements[j]);
+            put_ir_text(buf, ", ");
+            put_block_ref(buf, block->preds->elements[j]);
+            put_ir_text(buf, "]");
+        }
+        break;
+    }
+    case IR_JMP: {
+        put_ir_text(buf, " ");
+        put_block_ref(buf, block->succs->elements[0]);
+        break;
+    }
+    case IR_BR: {
+        put_ir_number(buf, " %", inst->a);
+        put_ir_text(buf, ", ");
+        put_block_ref(buf, block->succs->elements[0]);
+        put_ir_text(buf, ", ");
+        put_block_ref(buf, block->succs->elements[1]);
+        break;
+    }
+    case IR_RET: {
+        if (inst->a != 0) {
+            put_ir_number(buf, " %", inst->a);
+        }
+        break;
+    }
+    default: {
+        put_ir_number(buf, " %", inst->a);
+        if (inst->b != 0) {
+            put_ir_number(buf, ", %", inst->b);
+        }
+        break;
+    }
+    }
+    put_ir_text(buf, "\n");
+}
+
+void print_ir(const IrFunc* func, ByteBuffer* buf) {
+    put_ir_text(buf, "function ");
+    put_ir_text(buf, symbol_name(func->name));
+    put_ir_number(buf, " (", func->param_count);
+    put_ir_number(buf, " params, ", func->reg_count);
+    put_ir_text(buf, " registers)\n");
+
+    for (int i = 0; i < func->blocks->size; ++i) {
+        const IrBlock* block = func->blocks->elements[i];
+        put_block_ref(buf, block);
+        put_ir_text(buf, ":");
+        if (block->preds->size != 0) {
+            put_ir_text(buf, "    ; preds");
+            for (int j = 0; j < block->preds->size; ++j) {
+                put_ir_text(buf, " ");
+                put_block_ref(buf, block->preds->elements[j]);
+            }
+        }
+        put_ir_text(buf, "\n");
+
+        for (int k = 0; k < block->phis->size; ++k) {
+            print_inst(block->phis->elements[k], block, buf);
+        }
+        for (int l = 0; l < block->insts->size; ++l) {
+            print_inst(block->insts->elements[l], block, buf);
+        }
+    }
+    put_ir_text(buf, "\n");
+}
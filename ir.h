@@ -0,0 +1,128 @@
+#ifndef IR_H
+#define IR_H
+
+#include "parser.h"
+#include "util.h"
+
+//
+// SSA intermediate representation of a function: basic blocks of
+// three-address instructions over virtual registers, each assigned by one
+// instruction, with phi instructions where control flow joins. Registers
+// are numbered from 1; 0 stands for "none".
+//
+// The IR holds the functions that only compute with int scalars: local
+// variables and parameters of type int, int globals, constants, string
+// literals as call arguments, and calls. Anything else (pointers, arrays,
+// structs, char variables, switch, ...) keeps the function out of it.
+//
+
+enum IrOp {
+    IR_CONST, // dst = imm
+    IR_PARAM, // dst = parameter imm, from 0
+    IR_STR,   // dst = address of the string literal sym
+    IR_LOAD,  // dst = global variable sym
+    IR_STORE, // global variable sym = a
+    IR_NEG,   // dst = -a
+    IR_NOT,   // dst = !a
+    IR_ADD,   // dst = a + b
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_MOD,
+    IR_OR,    // dst = a | b, the value of a || b
+    IR_LT,    // dst = a < b, 1 or 0
+    IR_GT,
+    IR_LE,
+    IR_GE,
+    IR_EQ,
+    IR_NE,
+    IR_CALL,  // dst = sym(args)
+    IR_PHI,   // dst = args[i] when entered from preds[i]
+    IR_JMP,   // go to succs[0]
+    IR_BR,    // go to succs[0] if a != 0, else to succs[1]
+    IR_RET,   // return a, or whatever rax holds if a is 0
+};
+
+typedef struct IrInst IrInst;
+typedef struct IrBlock IrBlock;
+typedef struct IrFunc IrFunc;
+
+struct IrInst {
+    int        op;   // IrOp
+    int        dst;  // register defined, 0 if none
+    int        a;    // operand registers
+    int        b;
+    int        imm;
+    int        sym;  // symbol of a call, string literal or global
+    IntVector* args; // call arguments and phi operands, NULL otherwise
+};
+
+struct IrBlock {
+    int        id;        // index in blocks
+    Vector*    phis;
+    Vector*    insts;     // ends with the only IR_JMP, IR_BR or IR_RET
+    Vector*    preds;
+    Vector*    succs;
+
+    // construction (see ir.c)
+    HashMap*   defs;      // variable => register holding it at the end of the block
+    IntVector* incomplete_vars;
+    Vector*    incomplete_phis;
+    bool       sealed;    // every predecessor is known
+};
+
+struct IrFunc {
+    int     name;        // symbol id
+    int     param_count;
+    Vector* blocks;      // blocks[0] is the entry
+    int     reg_count;   // registers are 1 .. reg_count
+    Arena*  arena;       // holds the blocks and instructions
+};
+
+// Builds the IR of a function whose body is parsed. Returns NULL if the
+// function uses what the IR does not hold, and sets *reason_out to what.
+// enum_map and globalvar_map are those of the generator.
+IrFunc* build_ir(const FuncDefNode* node, const HashMap* enum_map, const HashMap* globalvar_map, const char** reason_out);
+
+// Checks that func is well formed SSA: terminators, edges, phi operands,
+// and that every register is defined once, before its uses on every path.
+// Reports what is wrong with error().
+bool verify_ir(const IrFunc* func);
+
+void print_ir(const IrFunc* func, ByteBuffer* buf);
+void free_ir(IrFunc* func);
+
+//
+// editing, for the passes (see opt.h)
+//
+
+// Drops the blocks the entry does not reach, with their edges and phi
+// operands, and lays the others out in reverse postorder, each block
+// followed by its first successor where possible.
+void remove_unreachable_ir_blocks(IrFunc* func);
+
+// Replaces the phis that merge one value (besides themselves) by it.
+// Returns true if any was removed.
+bool remove_trivial_ir_phis(IrFunc* func);
+
+// Rewrites each operand r with forward[r] != 0 to forward[r], repeatedly.
+void replace_ir_regs(IrFunc* func, const IntVector* forward);
+
+// Drops preds[index] of block and the phi operands for it.
+void remove_ir_pred(IrBlock* block, int index);
+
+// The immediate dominator of each block by id; the entry is its own.
+IntVector* compute_ir_idoms(const IrFunc* func);
+
+// true if the block dominator dominates block_id, by the idoms above
+bool dominates_ir_block(const IntVector* idoms, int dominator, int block_id);
+
+// instructions and phis
+int count_ir_insts(const IrFunc* func);
+
+// the number of operand registers of op: 0, a, or a and b
+int get_ir_operand_count(int op);
+
+const char* decode_ir_op(int op);
+
+#endif
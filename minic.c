@@ -1,10 +1,14 @@
+#include "assembler.h"
 #include "tokenizer.h"
 #include "preprocessor.h"
 #include "parser.h"
 #include "generator.h"
+#include "opt.h"
+#include "server.h"
 #include "util.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef MINIC_DEV
@@ -12,24 +16,169 @@
 #endif
 
 bool debug_flag = false;
+bool stats_flag = false;
+
+// chunk size of the arena holding AST nodes
+#define NODE_ARENA_CHUNK_SIZE 65536
+
+// number of newlines, at least 1
+static int count_lines(const char* addr) {
+    int lines = 0;
+    const char* p = strchr(addr, '\n');
+    while (p != NULL) {
+        ++lines;
+        p = strchr(p + 1, '\n');
+    }
+
+    if (lines == 0) {
+        return 1;
+    }
+    return lines;
+}
+
+// "n.n" of bytes per line
+static void print_bytes_per_line(const char* name, int bytes, int lines) {
+    const int tenths = bytes * 10 / lines;
+    dprintf(2, "%s: %d bytes, %d.%d bytes/line\n", name, bytes, tenths / 10, tenths % 10);
+}
 
 static void usage() {
-    printf("Usage: minic [OPTION] file\n   -d, --debug    output debug-log.\n");
+    printf("Usage: minic [OPTION] file\n   (file \"-\" reads from stdin)\n\nOPTION:\n   -d, --debug           output debug-log.\n   -s, --stats           output allocation statistics to stderr.\n   -o file               write output to file instead of stdout.\n   -c                    write an ELF object instead of assembly.\n   --emit-pch header     write a precompiled header of header instead of assembly.\n   --include-pch file    start from the state saved in a precompiled header.\n   -fparallel-parse      parse the function bodies on one thread per core.\n   -j N                  parse the function bodies on N threads.\n   --server              answer JSON requests about open files on stdin, one per line.\n   -fir                  compile the functions the SSA IR holds through it.\n   --dump-ir             write the SSA IR of each function instead of assembly.\n   -O0, -O1, -O2         no optimization (default), expressions in registers, or the IR passes too.\n   -f<pass>, -fno-<pass> run or skip a pass: simplifycfg, constfold, cse, licm, dce, regalloc.\n   --time-passes         report the time and instruction count change of each pass to stderr.\n");
+}
+
+// Returns the descriptor to write the output to, or -1 if path cannot be opened.
+static int open_output(const char* path, FILE** fp) {
+    *fp = NULL;
+    if (path == NULL) {
+        return 1;
+    }
+
+    *fp = fopen(path, "w");
+    if (*fp == NULL) {
+        error("Failed to open \"%s\".\n", path);
+        return -1;
+    }
+
+    return fileno(*fp);
 }
 
 int main(int argc, char** argv) {
-    if (argc < 2) {
+    const char* input_path       = NULL;
+    const char* output_path      = NULL;
+    const char* include_pch_path = NULL;
+    bool emit_pch       = false;
+    bool server_mode    = false;
+    bool parallel_parse = false;
+    bool use_ir         = false;
+    bool dump_ir        = false;
+    bool time_passes    = false;
+    bool emit_object    = false;
+    int  parse_jobs     = 0;
+    int  opt_level      = 0;
+    IntVector* pass_toggles = create_intvector(); // indices in argv
+    for (int arg_index = 1; arg_index < argc; ++arg_index) {
+        const char* arg = argv[arg_index];
+        if (strcmp("-d", arg) == 0 || strcmp("--debug", arg) == 0) {
+            debug_flag = true;
+        }
+        else if (strcmp("-s", arg) == 0 || strcmp("--stats", arg) == 0) {
+            stats_flag = true;
+        }
+        else if (strcmp("-c", arg) == 0) {
+            emit_object = true;
+        }
+        else if (strcmp("-o", arg) == 0 && arg_index + 1 < argc) {
+            ++arg_index;
+            output_path = argv[arg_index];
+        }
+        else if (strcmp("--emit-pch", arg) == 0 && arg_index + 1 < argc && input_path == NULL) {
+            ++arg_index;
+            input_path = argv[arg_index];
+            emit_pch   = true;
+        }
+        else if (strcmp("--include-pch", arg) == 0 && arg_index + 1 < argc) {
+            ++arg_index;
+            include_pch_path = argv[arg_index];
+        }
+        else if (strcmp("--server", arg) == 0) {
+            server_mode = true;
+        }
+        else if (strcmp("-fparallel-parse", arg) == 0) {
+            parallel_parse = true;
+        }
+        else if (strcmp("-fir", arg) == 0) {
+            use_ir = true;
+        }
+        else if (strcmp("--dump-ir", arg) == 0) {
+            dump_ir = true;
+        }
+        else if (strcmp("-O0", arg) == 0 || strcmp("-O1", arg) == 0 || strcmp("-O2", arg) == 0) {
+            opt_level = arg[2] - '0';
+        }
+        else if (strcmp("--time-passes", arg) == 0) {
+            time_passes = true;
+        }
+        else if (strncmp("-f", arg, 2) == 0) {
+            intvector_push_back(pass_toggles, arg_index);
+        }
+        else if (strcmp("-j", arg) == 0 && arg_index + 1 < argc) {
+            ++arg_index;
+            parallel_parse = true;
+            parse_jobs     = atoi(argv[arg_index]);
+        }
+        else if (input_path == NULL && (arg[0] != '-' || strcmp("-", arg) == 0)) {
+            input_path = arg;
+        }
+        else {
+            usage();
+            return -1;
+        }
+    }
+
+    // -f<pass> and -fno-<pass> apply on top of the -O level, wherever they are
+    PassManager* passes = create_pass_manager(opt_level);
+    passes->time_passes = time_passes;
+    for (int toggle_index = 0; toggle_index < pass_toggles->size; ++toggle_index) {
+        const char* toggle = argv[pass_toggles->elements[toggle_index]];
+        bool known = false;
+        if (strncmp("-fno-", toggle, 5) == 0) {
+            known = set_pass_enabled(passes, toggle + 5, false);
+        }
+        else {
+            known = set_pass_enabled(passes, toggle + 2, true);
+        }
+        if (!known) {
+            usage();
+            return -1;
+        }
+    }
+    if (opt_level >= 2 || has_enabled_passes(passes)) {
+        use_ir = true;
+    }
+
+    // the responses own stdout, so diagnostics of the parser go to stderr
+    if (server_mode) {
+        const int out_fd = dup(1);
+        dup2(2, 1);
+        return serve(0, out_fd);
+    }
+
+    if (input_path == NULL) {
         usage();
         return -1;
     }
 
-    int arg_index = 1;
-    if (strncmp("-d", argv[1], 2) == 0 || strncmp("--debug", argv[1], 7) == 0) {
-        debug_flag = true;
-        arg_index = 2;
-    } 
+    // the macros of the precompiled header apply to the file
+    Vector* pch_vec = NULL;
+    if (include_pch_path != NULL) {
+        pch_vec = read_pch(include_pch_path);
+        if (pch_vec == NULL) {
+            error("Failed to load precompiled header.\n");
+            return -1;
+        }
+    }
 
-    char* addr = read_file(argv[arg_index]);
+    char* addr = read_file(input_path);
     if (addr == NULL) {
         error("Failed to load file.\n"); 
         return -1;
@@ -47,31 +196,125 @@ int main(int argc, char** argv) {
     }
 #endif
 
-    const Vector* processed_vec = preprocess(vec); 
+    Vector* processed_vec = preprocess(vec); 
     if (processed_vec == NULL) {
         error("Failed to preprocess.\n");
         return -1;
     }
 
+    if (pch_vec != NULL) {
+        for (int i = 0; i < processed_vec->size; ++i) {
+            vector_push_back(pch_vec, processed_vec->elements[i]);
+        }
+        processed_vec = pch_vec;
+    }
+
 #ifdef MINIC_DEV
     if (debug_flag) {
         dump_tokens(processed_vec);
     }
 #endif
 
-    const TransUnitNode* node = parse(processed_vec);
+    FILE* output_fp = NULL;
+    if (emit_pch) {
+        const int pch_fd = open_output(output_path, &output_fp);
+        if (pch_fd < 0) {
+            return -1;
+        }
+        if (!write_pch(processed_vec, pch_fd)) {
+            error("Failed to write precompiled header.\n");
+            return -1;
+        }
+        if (output_fp != NULL) {
+            fclose(output_fp);
+        }
+        return 0;
+    }
+
+    Arena* node_arena = create_arena(NODE_ARENA_CHUNK_SIZE);
+    TransUnitNode* node = parse(processed_vec, node_arena);
     if (node == NULL) {
         error("Failed to parse.\n");
         return -1;
     }
 
+    // otherwise the generator parses each body when it reaches it
+    if (parallel_parse && !parse_func_bodies(node, parse_jobs)) {
+        error("Failed to parse.\n");
+        return -1;
+    }
+
 #ifdef MINIC_DEV
     if (debug_flag) {
         dump_nodes(node);
+
+        // gen() writes to the descriptor directly, behind the back of stdio
+        fflush(stdout);
     }
 #endif
 
-    gen(node);
+    const int output_fd = open_output(output_path, &output_fp);
+    if (output_fd < 0) {
+        return -1;
+    }
+
+    GenOptions* gen_options = calloc(1, sizeof(GenOptions));
+    gen_options->use_ir    = use_ir;
+    gen_options->dump_ir   = dump_ir;
+    gen_options->passes    = passes;
+    gen_options->reg_exprs = (opt_level >= 1);
+    if (emit_object && !dump_ir) {
+        gen_options->output = create_bytebuffer();
+    }
+    if (!gen(node, output_fd, gen_options)) {
+        error("Failed to generate.\n");
+        return -1;
+    }
+
+    // the assembly is kept in memory and assembled here
+    if (gen_options->output != NULL) {
+        const bool assembled = assemble(gen_options->output->data, gen_options->output->size, output_fd);
+        free(gen_options->output->data);
+        free(gen_options->output);
+        if (!assembled) {
+            error("Failed to assemble.\n");
+            return -1;
+        }
+    }
+    free(gen_options);
+
+    if (time_passes) {
+        print_pass_times(passes, 2);
+    }
+    free_pass_manager(passes);
+
+    if (output_fp != NULL) {
+        fclose(output_fp);
+    }
+
+    if (stats_flag) {
+        const int lines = count_lines(addr);
+        dprintf(2, "nodes: %d allocations, %d bytes in %d chunks\n", node_arena->alloc_count, node_arena->alloc_bytes, node_arena->chunk_count);
+        dprintf(2, "function bodies: %d of %d parsed\n", count_func_defs(node, true), count_func_defs(node, false));
+
+        // with -j, the bodies are in the pools of the parser threads
+        int expr_count    = 0;
+        int pointer_bytes = 0;
+        int index_bytes   = 0;
+        Vector* pools = get_expr_pools(node);
+        for (int pool_index = 0; pool_index < pools->size; ++pool_index) {
+            const ExprPool* pool = pools->elements[pool_index];
+            expr_count    += pool->kinds->size - 1;
+            pointer_bytes += expr_pointer_layout_bytes(pool);
+            index_bytes   += expr_pool_bytes(pool);
+        }
+        free(pools->elements);
+        free(pools);
+        dprintf(2, "expressions: %d in %d lines\n", expr_count, lines);
+        print_bytes_per_line("expressions, pointer layout", pointer_bytes, lines);
+        print_bytes_per_line("expressions, index layout", index_bytes, lines);
+    }
+    arena_release(node_arena);
 
     return 0;
 }
@@ -0,0 +1,1184 @@
+#include "opt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir.h"
+#include "regalloc.h"
+#include "util.h"
+
+// the largest magnitude a folded constant may have, so that the compiler
+// and the code it generates agree however wide its int is
+#define OPT_INT_LIMIT 2147483647
+
+typedef struct IrLoop IrLoop;
+
+struct IrLoop {
+    IrBlock*   header;
+    IntVector* body;   // by block id, 1 for the blocks of the loop
+    int        size;   // number of blocks
+};
+
+static IntVector* opt_idoms;      // PASS_DOMTREE, NULL until computed
+static Vector*    opt_loops;      // PASS_LOOPS, innermost first, NULL until computed
+static int        opt_fold_value; // result of fold_unary and fold_binary
+static RegAlloc*  opt_reg_alloc;  // PASS_REGALLOC, NULL until computed
+
+//
+// helpers
+//
+
+static void free_opt_intvector(IntVector* vec) {
+    free(vec->elements);
+    free(vec);
+}
+
+static void free_opt_vector(Vector* vec) {
+    free(vec->elements);
+    free(vec);
+}
+
+static IntVector* create_filled_intvector(int size, int value) {
+    IntVector* vec = create_intvector();
+    for (int i = 0; i < size; ++i) {
+        intvector_push_back(vec, value);
+    }
+    return vec;
+}
+
+static int follow_reg(const IntVector* forward, int reg) {
+    int current = reg;
+    while (current != 0 && forward->elements[current] != 0) {
+        current = forward->elements[current];
+    }
+    return current;
+}
+
+// the phi or instruction defining each register, NULL if none does
+static Vector* collect_defs(const IrFunc* func) {
+    Vector* defs = create_vector();
+    for (int i = 0; i <= func->reg_count; ++i) {
+        vector_push_back(defs, NULL);
+    }
+
+    for (int j = 0; j < func->blocks->size; ++j) {
+        const IrBlock* block = func->blocks->elements[j];
+        for (int k = 0; k < block->phis->size; ++k) {
+            IrInst* phi = block->phis->elements[k];
+            defs->elements[phi->dst] = phi;
+        }
+        for (int l = 0; l < block->insts->size; ++l) {
+            IrInst* inst = block->insts->elements[l];
+            if (inst->dst != 0) {
+                defs->elements[inst->dst] = inst;
+            }
+        }
+    }
+    return defs;
+}
+
+static void insert_inst(Vector* insts, int index, IrInst* inst) {
+    vector_push_back(insts, inst);
+    for (int i = insts->size - 1; i > index; --i) {
+        insts->elements[i] = insts->elements[i - 1];
+    }
+    insts->elements[index] = inst;
+}
+
+// drops the instructions whose values are forwarded to other registers,
+// and rewrites the uses of those
+static void remove_forwarded_insts(IrFunc* func, const IntVector* forward) {
+    for (int i = 0; i < func->blocks->size; ++i) {
+        const IrBlock* block = func->blocks->elements[i];
+        int kept = 0;
+        for (int j = 0; j < block->insts->size; ++j) {
+            IrInst* inst = block->insts->elements[j];
+            if (inst->dst != 0 && forward->elements[inst->dst] != 0) {
+                continue;
+            }
+            block->insts->elements[kept] = inst;
+            ++kept;
+        }
+        block->insts->size = kept;
+    }
+    replace_ir_regs(func, forward);
+}
+
+// operations whose value depends on their operands only: not loads or calls
+static bool is_pure_op(int op) {
+    switch (op) {
+    case IR_CONST:
+    case IR_STR:
+    case IR_NEG:
+    case IR_NOT:
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+    case IR_MOD:
+    case IR_OR:
+    case IR_LT:
+    case IR_GT:
+    case IR_LE:
+    case IR_GE:
+    case IR_EQ:
+    case IR_NE: {
+        return true;
+    }
+    default: {
+        return false;
+    }
+    }
+}
+
+static bool is_const_inst(const IrInst* inst) {
+    return inst != NULL && inst->op == IR_CONST;
+}
+
+static bool is_const_value(const IrInst* inst, int value) {
+    return inst != NULL && inst->op == IR_CONST && inst->imm == value;
+}
+
+static void make_const(IrInst* inst, int value) {
+    inst->op  = IR_CONST;
+    inst->a   = 0;
+    inst->b   = 0;
+    inst->imm = value;
+    inst->sym = 0;
+}
+
+static int find_pred_index(const IrBlock* block, const IrBlock* pred, bool last) {
+    int index = -1;
+    for (int i = 0; i < block->preds->size; ++i) {
+        if (block->preds->elements[i] == pred) {
+            index = i;
+            if (!last) {
+                return index;
+            }
+        }
+    }
+    return index;
+}
+
+static void replace_block_refs(Vector* blocks, const IrBlock* from, IrBlock* to) {
+    for (int i = 0; i < blocks->size; ++i) {
+        if (blocks->elements[i] == from) {
+            blocks->elements[i] = to;
+        }
+    }
+}
+
+//
+// simplifycfg
+//
+
+// A branch on a constant, or to one block without phis either way, becomes
+// a jump.
+static bool fold_constant_branches(IrFunc* func) {
+    Vector* defs = collect_defs(func);
+    bool changed = false;
+    for (int i = 0; i < func->blocks->size; ++i) {
+        IrBlock* block = func->blocks->elements[i];
+        IrInst* term = block->insts->elements[block->insts->size - 1];
+        if (term->op != IR_BR) {
+            continue;
+        }
+
+        IrBlock* then_block = block->succs->elements[0];
+        IrBlock* else_block = block->succs->elements[1];
+        const IrInst* cond = defs->elements[term->a];
+        int taken = -1;
+        if (is_const_inst(cond)) {
+            taken = 0;
+            if (cond->imm == 0) {
+                taken = 1;
+            }
+        }
+        else if (then_block == else_block && then_block->phis->size == 0) {
+            taken = 0;
+        }
+        if (taken < 0) {
+            continue;
+        }
+
+        // when both edges go to one block, preds holds the then edge first
+        IrBlock* kept = block->succs->elements[taken];
+        IrBlock* dropped = block->succs->elements[1 - taken];
+        term->op = IR_JMP;
+        term->a  = 0;
+        block->succs->elements[0] = kept;
+        block->succs->size = 1;
+        remove_ir_pred(dropped, find_pred_index(dropped, block, taken == 0));
+        changed = true;
+    }
+
+    free_opt_vector(defs);
+    return changed;
+}
+
+// A block whose jump goes to a block with no other predecessor takes over
+// that block's instructions and successors.
+static bool merge_blocks(IrFunc* func) {
+    IntVector* forward = create_filled_intvector(func->reg_count + 1, 0);
+    const IrBlock* entry = func->blocks->elements[0];
+    bool changed = false;
+    for (int i = 0; i < func->blocks->size; ++i) {
+        IrBlock* block = func->blocks->elements[i];
+        while (block->insts->size > 0) {
+            const IrInst* term = block->insts->elements[block->insts->size - 1];
+            if (term->op != IR_JMP) {
+                break;
+            }
+            IrBlock* succ = block->succs->elements[0];
+            if (succ == block || succ == entry || succ->preds->size != 1) {
+                break;
+            }
+
+            for (int j = 0; j < succ->phis->size; ++j) {
+                IrInst* phi = succ->phis->elements[j];
+                forward->elements[phi->dst] = phi->args->elements[0];
+                free_opt_intvector(phi->args);
+                phi->args = NULL;
+            }
+            succ->phis->size = 0;
+
+            --block->insts->size;
+            for (int k = 0; k < succ->insts->size; ++k) {
+                vector_push_back(block->insts, succ->insts->elements[k]);
+            }
+            succ->insts->size = 0;
+
+            block->succs->size = 0;
+            for (int l = 0; l < succ->succs->size; ++l) {
+                IrBlock* next = succ->succs->elements[l];
+                vector_push_back(block->succs, next);
+                replace_block_refs(next->preds, succ, block);
+            }
+            succ->succs->size = 0;
+            succ->preds->size = 0;
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        replace_ir_regs(func, forward);
+    }
+    free_opt_intvector(forward);
+    return changed;
+}
+
+// A block holding a jump only is bypassed: its predecessors jump to its
+// successor. Not where a predecessor already goes to a successor with phis,
+// which could not tell the two edges apart.
+static bool bypass_empty_blocks(IrFunc* func) {
+    bool changed = false;
+    for (int i = 1; i < func->blocks->size; ++i) {
+        IrBlock* block = func->blocks->elements[i];
+        if (block->phis->size != 0 || block->insts->size != 1 || block->preds->size == 0) {
+            continue;
+        }
+        const IrInst* term = block->insts->elements[0];
+        if (term->op != IR_JMP) {
+            continue;
+        }
+        IrBlock* target = block->succs->elements[0];
+        if (target == block) {
+            continue;
+        }
+
+        bool shared = false;
+        if (target->phis->size != 0) {
+            for (int j = 0; j < block->preds->size; ++j) {
+                if (find_pred_index(target, block->preds->elements[j], false) >= 0) {
+                    shared = true;
+                }
+            }
+        }
+        if (shared) {
+            continue;
+        }
+
+        const int index = find_pred_index(target, block, false);
+        for (int k = 0; k < block->preds->size; ++k) {
+            IrBlock* pred = block->preds->elements[k];
+            replace_block_refs(pred->succs, block, target);
+            vector_push_back(target->preds, pred);
+            for (int l = 0; l < target->phis->size; ++l) {
+                const IrInst* phi = target->phis->elements[l];
+                intvector_push_back(phi->args, phi->args->elements[index]);
+            }
+        }
+        remove_ir_pred(target, index);
+        block->preds->size = 0;
+        block->succs->size = 0;
+        changed = true;
+    }
+    return changed;
+}
+
+static bool run_simplifycfg(IrFunc* func) {
+    bool changed = false;
+    bool again = true;
+    while (again) {
+        again = false;
+        if (fold_constant_branches(func)) {
+            again = true;
+        }
+        if (merge_blocks(func)) {
+            again = true;
+        }
+        if (bypass_empty_blocks(func)) {
+            again = true;
+        }
+        if (again) {
+            remove_unreachable_ir_blocks(func);
+        }
+        if (remove_trivial_ir_phis(func)) {
+            again = true;
+        }
+        if (again) {
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+//
+// constfold
+//
+
+// sets opt_fold_value to op of x, false if op is not folded
+static bool fold_unary(int op, int x) {
+    if (op == IR_NEG) {
+        if (x < -OPT_INT_LIMIT) {
+            return false;
+        }
+        opt_fold_value = -x;
+        return true;
+    }
+    if (op == IR_NOT) {
+        opt_fold_value = (x == 0);
+        return true;
+    }
+    return false;
+}
+
+// sets opt_fold_value to x op y, false if it is left to run time: a
+// division by 0, a result too large, or an or of other values than 0 and 1
+static bool fold_binary(int op, int x, int y) {
+    if (x > OPT_INT_LIMIT || x < -OPT_INT_LIMIT || y > OPT_INT_LIMIT || y < -OPT_INT_LIMIT) {
+        return false;
+    }
+
+    switch (op) {
+    case IR_ADD: {
+        if ((y > 0 && x > OPT_INT_LIMIT - y) || (y < 0 && x < -OPT_INT_LIMIT - y)) {
+            return false;
+        }
+        opt_fold_value = x + y;
+        return true;
+    }
+    case IR_SUB: {
+        if ((y < 0 && x > OPT_INT_LIMIT + y) || (y > 0 && x < -OPT_INT_LIMIT + y)) {
+            return false;
+        }
+        opt_fold_value = x - y;
+        return true;
+    }
+    case IR_MUL: {
+        int abs_x = x;
+        int abs_y = y;
+        if (abs_x < 0) {
+            abs_x = -abs_x;
+        }
+        if (abs_y < 0) {
+            abs_y = -abs_y;
+        }
+        if (abs_y != 0 && abs_x > OPT_INT_LIMIT / abs_y) {
+            return false;
+        }
+        opt_fold_value = x * y;
+        return true;
+    }
+    case IR_DIV: {
+        if (y == 0) {
+            return false;
+        }
+        opt_fold_value = x / y;
+        return true;
+    }
+    case IR_MOD: {
+        if (y == 0) {
+            return false;
+        }
+        opt_fold_value = x % y;
+        return true;
+    }
+    case IR_OR: {
+        if (x == 0) {
+            opt_fold_value = y;
+        }
+        else if (y == 0) {
+            opt_fold_value = x;
+        }
+        else if (x == 1 && y == 1) {
+            opt_fold_value = 1;
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+    case IR_LT: { opt_fold_value = (x < y);  return true; }
+    case IR_GT: { opt_fold_value = (x > y);  return true; }
+    case IR_LE: { opt_fold_value = (x <= y); return true; }
+    case IR_GE: { opt_fold_value = (x >= y); return true; }
+    case IR_EQ: { opt_fold_value = (x == y); return true; }
+    case IR_NE: { opt_fold_value = (x != y); return true; }
+    default:    { return false; }
+    }
+}
+
+// the operand an operation with one constant operand always equals, 0 if
+// there is none
+static int get_identity_operand(const IrInst* inst, const IrInst* a_def, const IrInst* b_def) {
+    switch (inst->op) {
+    case IR_ADD:
+    case IR_OR: {
+        if (is_const_value(b_def, 0)) {
+            return inst->a;
+        }
+        if (is_const_value(a_def, 0)) {
+            return inst->b;
+        }
+        return 0;
+    }
+    case IR_SUB: {
+        if (is_const_value(b_def, 0)) {
+            return inst->a;
+        }
+        return 0;
+    }
+    case IR_MUL: {
+        if (is_const_value(b_def, 1)) {
+            return inst->a;
+        }
+        if (is_const_value(a_def, 1)) {
+            return inst->b;
+        }
+        return 0;
+    }
+    case IR_DIV: {
+        if (is_const_value(b_def, 1)) {
+            return inst->a;
+        }
+        return 0;
+    }
+    default: {
+        return 0;
+    }
+    }
+}
+
+// a phi whose operands are all the same constant becomes that constant,
+// at the start of its block
+static bool fold_const_phis(IrBlock* block, const Vector* defs, const IntVector* forward) {
+    bool changed = false;
+    int kept = 0;
+    const int phi_count = block->phis->size;
+    for (int i = 0; i < phi_count; ++i) {
+        IrInst* phi = block->phis->elements[i];
+        const IrInst* first = defs->elements[follow_reg(forward, phi->args->elements[0])];
+        bool same = is_const_inst(first);
+        for (int j = 1; j < phi->args->size && same; ++j) {
+            const IrInst* arg_def = defs->elements[follow_reg(forward, phi->args->elements[j])];
+            same = is_const_value(arg_def, first->imm);
+        }
+        if (!same) {
+            block->phis->elements[kept] = phi;
+            ++kept;
+            continue;
+        }
+
+        free_opt_intvector(phi->args);
+        phi->args = NULL;
+        make_const(phi, first->imm);
+        insert_inst(block->insts, 0, phi);
+        changed = true;
+    }
+    block->phis->size = kept;
+    return changed;
+}
+
+static bool run_constfold(IrFunc* func) {
+    Vector* defs = collect_defs(func);
+    IntVector* forward = create_filled_intvector(func->reg_count + 1, 0);
+    bool changed = false;
+    bool forwarded = false;
+    for (int i = 0; i < func->blocks->size; ++i) {
+        IrBlock* block = func->blocks->elements[i];
+        if (fold_const_phis(block, defs, forward)) {
+            changed = true;
+        }
+
+        for (int j = 0; j < block->insts->size; ++j) {
+            IrInst* inst = block->insts->elements[j];
+            const int operand_count = get_ir_operand_count(inst->op);
+            if (inst->dst == 0 || operand_count == 0) {
+                continue;
+            }
+
+            inst->a = follow_reg(forward, inst->a);
+            const IrInst* a_def = defs->elements[inst->a];
+            if (operand_count == 1) {
+                if (is_const_inst(a_def) && fold_unary(inst->op, a_def->imm)) {
+                    make_const(inst, opt_fold_value);
+                    changed = true;
+                }
+                continue;
+            }
+
+            inst->b = follow_reg(forward, inst->b);
+            const IrInst* b_def = defs->elements[inst->b];
+            const int identity = get_identity_operand(inst, a_def, b_def);
+            if (is_const_inst(a_def) && is_const_inst(b_def) && fold_binary(inst->op, a_def->imm, b_def->imm)) {
+                make_const(inst, opt_fold_value);
+                changed = true;
+            }
+            else if (identity != 0) {
+                forward->elements[inst->dst] = identity;
+                forwarded = true;
+                changed = true;
+            }
+            else if (inst->op == IR_MUL && (is_const_value(a_def, 0) || is_const_value(b_def, 0))) {
+                make_const(inst, 0);
+                changed = true;
+            }
+        }
+    }
+
+    if (forwarded) {
+        remove_forwarded_insts(func, forward);
+    }
+    free_opt_intvector(forward);
+    free_opt_vector(defs);
+    return changed;
+}
+
+//
+// loops
+//
+// A natural loop is the header of a back edge, an edge to a block that
+// dominates its source, with the blocks that reach the source without
+// passing the header. Back edges to one header make one loop.
+//
+
+static IrLoop* find_loop(const Vector* loops, const IrBlock* header) {
+    for (int i = 0; i < loops->size; ++i) {
+        IrLoop* loop = loops->elements[i];
+        if (loop->header == header) {
+            return loop;
+        }
+    }
+    return NULL;
+}
+
+static void add_loop_body(IrLoop* loop, IrBlock* latch) {
+    Stack* worklist = create_stack();
+    if (loop->body->elements[latch->id] == 0) {
+        loop->body->elements[latch->id] = 1;
+        ++loop->size;
+        stack_push(worklist, latch);
+    }
+    while (worklist->top >= 0) {
+        const IrBlock* block = stack_top(worklist);
+        stack_pop(worklist);
+        for (int i = 0; i < block->preds->size; ++i) {
+            IrBlock* pred = block->preds->elements[i];
+            if (loop->body->elements[pred->id] == 0) {
+                loop->body->elements[pred->id] = 1;
+                ++loop->size;
+                stack_push(worklist, pred);
+            }
+        }
+    }
+    free(worklist->elements);
+    free(worklist);
+}
+
+static Vector* find_loops(const IrFunc* func) {
+    Vector* loops = create_vector();
+    for (int i = 0; i < func->blocks->size; ++i) {
+        IrBlock* block = func->blocks->elements[i];
+        for (int j = 0; j < block->succs->size; ++j) {
+            IrBlock* header = block->succs->elements[j];
+            if (!dominates_ir_block(opt_idoms, header->id, block->id)) {
+                continue;
+            }
+
+            IrLoop* loop = find_loop(loops, header);
+            if (loop == NULL) {
+                loop = calloc(1, sizeof(IrLoop));
+                loop->header = header;
+                loop->body   = create_filled_intvector(func->blocks->size, 0);
+                loop->body->elements[header->id] = 1;
+                loop->size   = 1;
+                vector_push_back(loops, loop);
+            }
+            add_loop_body(loop, block);
+        }
+    }
+
+    // innermost first: a loop inside another has fewer blocks
+    for (int k = 1; k < loops->size; ++k) {
+        IrLoop* moved = loops->elements[k];
+        int l = k;
+        while (l > 0) {
+            const IrLoop* previous = loops->elements[l - 1];
+            if (previous->size <= moved->size) {
+                break;
+            }
+            loops->elements[l] = loops->elements[l - 1];
+            --l;
+        }
+        loops->elements[l] = moved;
+    }
+    return loops;
+}
+
+static void free_loops(Vector* loops) {
+    for (int i = 0; i < loops->size; ++i) {
+        IrLoop* loop = loops->elements[i];
+        free_opt_intvector(loop->body);
+        free(loop);
+    }
+    free_opt_vector(loops);
+}
+
+//
+// licm
+//
+
+// the one block outside the loop that enters it, if it has no other
+// successor
+static IrBlock* find_preheader(const IrLoop* loop) {
+    IrBlock* preheader = NULL;
+    for (int i = 0; i < loop->header->preds->size; ++i) {
+        IrBlock* pred = loop->header->preds->elements[i];
+        if (loop->body->elements[pred->id] != 0) {
+            continue;
+        }
+        if (preheader != NULL) {
+            return NULL;
+        }
+        preheader = pred;
+    }
+
+    if (preheader != NULL && preheader->succs->size != 1) {
+        return NULL;
+    }
+    return preheader;
+}
+
+// operations that are executed ahead of time without harm: no loads,
+// calls, or divisions, which may trap
+static bool is_hoistable(int op) {
+    return is_pure_op(op) && op != IR_DIV && op != IR_MOD;
+}
+
+// moves the invariant operations of the loop, those whose operands are all
+// defined outside it, to the end of the preheader
+static bool hoist_invariants(const IrFunc* func, const IrLoop* loop, IrBlock* preheader, IntVector* def_blocks) {
+    bool changed = false;
+    for (int i = 0; i < func->blocks->size; ++i) {
+        const IrBlock* block = func->blocks->elements[i];
+        if (loop->body->elements[i] == 0) {
+            continue;
+        }
+
+        int kept = 0;
+        for (int j = 0; j < block->insts->size; ++j) {
+            IrInst* inst = block->insts->elements[j];
+            bool invariant = is_hoistable(inst->op);
+            const int operand_count = get_ir_operand_count(inst->op);
+            if (invariant && operand_count >= 1 && loop->body->elements[def_blocks->elements[inst->a]] != 0) {
+                invariant = false;
+            }
+            if (invariant && operand_count == 2 && loop->body->elements[def_blocks->elements[inst->b]] != 0) {
+                invariant = false;
+            }
+            if (!invariant) {
+                block->insts->elements[kept] = inst;
+                ++kept;
+                continue;
+            }
+
+            insert_inst(preheader->insts, preheader->insts->size - 1, inst);
+            def_blocks->elements[inst->dst] = preheader->id;
+            changed = true;
+        }
+        block->insts->size = kept;
+    }
+    return changed;
+}
+
+static bool run_licm(IrFunc* func) {
+    IntVector* def_blocks = create_filled_intvector(func->reg_count + 1, 0);
+    for (int i = 0; i < func->blocks->size; ++i) {
+        const IrBlock* block = func->blocks->elements[i];
+        for (int j = 0; j < block->phis->size; ++j) {
+            const IrInst* phi = block->phis->elements[j];
+            def_blocks->elements[phi->dst] = i;
+        }
+        for (int k = 0; k < block->insts->size; ++k) {
+            const IrInst* inst = block->insts->elements[k];
+            def_blocks->elements[inst->dst] = i;
+        }
+    }
+
+    bool changed = false;
+    for (int l = 0; l < opt_loops->size; ++l) {
+        const IrLoop* loop = opt_loops->elements[l];
+        IrBlock* preheader = find_preheader(loop);
+        if (preheader != NULL && hoist_invariants(func, loop, preheader, def_blocks)) {
+            changed = true;
+        }
+    }
+
+    free_opt_intvector(def_blocks);
+    return changed;
+}
+
+//
+// cse
+//
+// The dominator tree is walked in preorder, with the operations of the
+// blocks above the current one in hash buckets, so that an operation equal
+// to one of them is replaced by it. Loads and calls are never equal.
+//
+
+#define CSE_BUCKET_MOD 4093
+
+// orders the operands of a commutative operation, and turns a > b into
+// b < a, so that equal values look the same
+static void canonicalize_inst(IrInst* inst) {
+    const int a = inst->a;
+    const int b = inst->b;
+    if (inst->op == IR_GT || inst->op == IR_GE) {
+        if (inst->op == IR_GT) {
+            inst->op = IR_LT;
+        }
+        else {
+            inst->op = IR_LE;
+        }
+        inst->a = b;
+        inst->b = a;
+        return;
+    }
+
+    const bool commutative = (inst->op == IR_ADD || inst->op == IR_MUL || inst->op == IR_OR || inst->op == IR_EQ || inst->op == IR_NE);
+    if (commutative && a > b) {
+        inst->a = b;
+        inst->b = a;
+    }
+}
+
+static int add_cse_hash(int hash, int x) {
+    // reduced before the sign is dropped, as the minimum int has no negation
+    int part = x % CSE_BUCKET_MOD;
+    if (part < 0) {
+        part = -part;
+    }
+    return (hash * 31 + part) % CSE_BUCKET_MOD;
+}
+
+// bucket key of an operation, positive as the map needs
+static int get_cse_key(const IrInst* inst) {
+    int hash = add_cse_hash(inst->op, inst->a);
+    hash = add_cse_hash(hash, inst->b);
+    hash = add_cse_hash(hash, inst->imm);
+    hash = add_cse_hash(hash, inst->sym);
+    return hash + 1;
+}
+
+static bool is_same_operation(const IrInst* x, const IrInst* y) {
+    return x->op == y->op && x->a == y->a && x->b == y->b && x->imm == y->imm && x->sym == y->sym;
+}
+
+// children of each block in the dominator tree
+static Vector* get_dom_children(const IrFunc* func) {
+    Vector* children = create_vector();
+    for (int i = 0; i < func->blocks->size; ++i) {
+        vector_push_back(children, create_intvector());
+    }
+    for (int j = 1; j < func->blocks->size; ++j) {
+        intvector_push_back(children->elements[opt_idoms->elements[j]], j);
+    }
+    return children;
+}
+
+// replaces the operations of block equal to an available one, and makes
+// the others available
+static void cse_block(const IrBlock* block, HashMap* buckets, Vector* available, IntVector* forward) {
+    for (int i = 0; i < block->insts->size; ++i) {
+        IrInst* inst = block->insts->elements[i];
+        if (!is_pure_op(inst->op)) {
+            continue;
+        }
+        inst->a = follow_reg(forward, inst->a);
+        inst->b = follow_reg(forward, inst->b);
+        canonicalize_inst(inst);
+
+        const int key = get_cse_key(inst);
+        if (!hashmap_contains(buckets, key)) {
+            hashmap_put(buckets, key, create_vector());
+        }
+        Vector* bucket = hashmap_get(buckets, key);
+        const IrInst* found = NULL;
+        for (int j = bucket->size - 1; j >= 0 && found == NULL; --j) {
+            const IrInst* candidate = bucket->elements[j];
+            if (is_same_operation(candidate, inst)) {
+                found = candidate;
+            }
+        }
+        if (found != NULL) {
+            forward->elements[inst->dst] = found->dst;
+            continue;
+        }
+        vector_push_back(bucket, inst);
+        vector_push_back(available, inst);
+    }
+}
+
+static bool run_cse(IrFunc* func) {
+    Vector* children = get_dom_children(func);
+    HashMap* buckets = create_hashmap(64);
+    Vector* available = create_vector();
+    IntStack* marks = create_intstack();
+    IntVector* forward = create_filled_intvector(func->reg_count + 1, 0);
+
+    // a block id is entered, and -1 - id left
+    IntStack* walk = create_intstack();
+    intstack_push(walk, 0);
+    while (walk->top >= 0) {
+        const int item = intstack_top(walk);
+        intstack_pop(walk);
+        if (item >= 0) {
+            intstack_push(marks, available->size);
+            cse_block(func->blocks->elements[item], buckets, available, forward);
+            intstack_push(walk, -1 - item);
+            const IntVector* block_children = children->elements[item];
+            for (int i = block_children->size - 1; i >= 0; --i) {
+                intstack_push(walk, block_children->elements[i]);
+            }
+            continue;
+        }
+
+        const int mark = intstack_top(marks);
+        intstack_pop(marks);
+        while (available->size > mark) {
+            const IrInst* left = available->elements[available->size - 1];
+            --available->size;
+            Vector* bucket = hashmap_get(buckets, get_cse_key(left));
+            --bucket->size;
+        }
+    }
+
+    bool changed = false;
+    for (int j = 1; j < forward->size; ++j) {
+        if (forward->elements[j] != 0) {
+            changed = true;
+        }
+    }
+    if (changed) {
+        remove_forwarded_insts(func, forward);
+    }
+
+    for (int k = 0; k < buckets->capacity; ++k) {
+        if (buckets->keys[k] != 0) {
+            free_opt_vector(buckets->vals[k]);
+        }
+    }
+    free(buckets->keys);
+    free(buckets->vals);
+    free(buckets->nums);
+    free(buckets);
+    for (int l = 0; l < children->size; ++l) {
+        free_opt_intvector(children->elements[l]);
+    }
+    free_opt_vector(children);
+    free_opt_vector(available);
+    free(marks->elements);
+    free(marks);
+    free(walk->elements);
+    free(walk);
+    free_opt_intvector(forward);
+    return changed;
+}
+
+//
+// dce
+//
+
+static bool has_side_effect(int op) {
+    return op == IR_STORE || op == IR_CALL || op == IR_JMP || op == IR_BR || op == IR_RET;
+}
+
+static void mark_live(IntVector* live, IntVector* worklist, int reg) {
+    if (reg != 0 && live->elements[reg] == 0) {
+        live->elements[reg] = 1;
+        intvector_push_back(worklist, reg);
+    }
+}
+
+static void mark_operands(const IrInst* inst, IntVector* live, IntVector* worklist) {
+    mark_live(live, worklist, inst->a);
+    mark_live(live, worklist, inst->b);
+    if (inst->args != NULL) {
+        for (int i = 0; i < inst->args->size; ++i) {
+            mark_live(live, worklist, inst->args->elements[i]);
+        }
+    }
+}
+
+static bool run_dce(IrFunc* func) {
+    Vector* defs = collect_defs(func);
+    IntVector* live = create_filled_intvector(func->reg_count + 1, 0);
+    IntVector* worklist = create_intvector();
+    for (int i = 0; i < func->blocks->size; ++i) {
+        const IrBlock* block = func->blocks->elements[i];
+        for (int j = 0; j < block->insts->size; ++j) {
+            const IrInst* inst = block->insts->elements[j];
+            if (has_side_effect(inst->op)) {
+                mark_operands(inst, live, worklist);
+            }
+        }
+    }
+    while (worklist->size > 0) {
+        const IrInst* def = defs->elements[worklist->elements[worklist->size - 1]];
+        --worklist->size;
+        if (def != NULL) {
+            mark_operands(def, live, worklist);
+        }
+    }
+
+    bool changed = false;
+    for (int k = 0; k < func->blocks->size; ++k) {
+        const IrBlock* swept = func->blocks->elements[k];
+        int kept_phis = 0;
+        for (int l = 0; l < swept->phis->size; ++l) {
+            IrInst* phi = swept->phis->elements[l];
+            if (live->elements[phi->dst] == 0) {
+                free_opt_intvector(phi->args);
+                phi->args = NULL;
+                changed = true;
+                continue;
+            }
+            swept->phis->elements[kept_phis] = phi;
+            ++kept_phis;
+        }
+        swept->phis->size = kept_phis;
+
+        int kept = 0;
+        for (int m = 0; m < swept->insts->size; ++m) {
+            IrInst* kept_inst = swept->insts->elements[m];
+            if (!has_side_effect(kept_inst->op) && live->elements[kept_inst->dst] == 0) {
+                changed = true;
+                continue;
+            }
+            swept->insts->elements[kept] = kept_inst;
+            ++kept;
+        }
+        swept->insts->size = kept;
+    }
+
+    free_opt_intvector(worklist);
+    free_opt_intvector(live);
+    free_opt_vector(defs);
+    return changed;
+}
+
+//
+// pass manager
+//
+
+const char* decode_pass_id(int id) {
+    switch (id) {
+    case PASS_SIMPLIFYCFG: { return "simplifycfg"; }
+    case PASS_CONSTFOLD:   { return "constfold"; }
+    case PASS_LICM:        { return "licm"; }
+    case PASS_CSE:         { return "cse"; }
+    case PASS_DCE:         { return "dce"; }
+    case PASS_REGALLOC:    { return "regalloc"; }
+    case PASS_DOMTREE:     { return "domtree"; }
+    case PASS_LOOPS:       { return "loops"; }
+    default:               { return "unknown"; }
+    }
+}
+
+PassManager* create_pass_manager(int level) {
+    PassManager* pm = calloc(1, sizeof(PassManager));
+    pm->pipeline = create_intvector();
+    intvector_push_back(pm->pipeline, PASS_SIMPLIFYCFG);
+    intvector_push_back(pm->pipeline, PASS_CONSTFOLD);
+    intvector_push_back(pm->pipeline, PASS_LICM);
+    intvector_push_back(pm->pipeline, PASS_CSE);
+    intvector_push_back(pm->pipeline, PASS_SIMPLIFYCFG);
+    intvector_push_back(pm->pipeline, PASS_DCE);
+    intvector_push_back(pm->pipeline, PASS_REGALLOC);
+
+    pm->enabled = create_filled_intvector(PASS_COUNT, 0);
+    if (level >= 2) {
+        pm->enabled->elements[PASS_SIMPLIFYCFG] = 1;
+        pm->enabled->elements[PASS_CONSTFOLD]   = 1;
+        pm->enabled->elements[PASS_LICM]        = 1;
+        pm->enabled->elements[PASS_CSE]         = 1;
+        pm->enabled->elements[PASS_DCE]         = 1;
+        pm->enabled->elements[PASS_REGALLOC]    = 1;
+    }
+
+    pm->runs         = create_filled_intvector(PASS_COUNT, 0);
+    pm->usecs        = create_filled_intvector(PASS_COUNT, 0);
+    pm->insts_before = create_filled_intvector(PASS_COUNT, 0);
+    pm->insts_after  = create_filled_intvector(PASS_COUNT, 0);
+    return pm;
+}
+
+bool set_pass_enabled(PassManager* pm, const char* name, bool enabled) {
+    for (int id = 0; id < PASS_DOMTREE; ++id) {
+        if (strcmp(decode_pass_id(id), name) == 0) {
+            pm->enabled->elements[id] = enabled;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool has_enabled_passes(const PassManager* pm) {
+    for (int id = 0; id < PASS_DOMTREE; ++id) {
+        if (pm->enabled->elements[id] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void invalidate_analyses() {
+    if (opt_idoms != NULL) {
+        free_opt_intvector(opt_idoms);
+        opt_idoms = NULL;
+    }
+    if (opt_loops != NULL) {
+        free_loops(opt_loops);
+        opt_loops = NULL;
+    }
+}
+
+// returns true if the pass changed the function
+static bool run_pass(int id, IrFunc* func) {
+    switch (id) {
+    case PASS_SIMPLIFYCFG: { return run_simplifycfg(func); }
+    case PASS_CONSTFOLD:   { return run_constfold(func); }
+    case PASS_LICM:        { return run_licm(func); }
+    case PASS_CSE:         { return run_cse(func); }
+    case PASS_DCE:         { return run_dce(func); }
+    case PASS_REGALLOC: {
+        opt_reg_alloc = allocate_ir_registers(func);
+        return false;
+    }
+    case PASS_DOMTREE: {
+        opt_idoms = compute_ir_idoms(func);
+        return false;
+    }
+    case PASS_LOOPS: {
+        opt_loops = find_loops(func);
+        return false;
+    }
+    default: {
+        return false;
+    }
+    }
+}
+
+static bool run_timed_pass(PassManager* pm, int id, IrFunc* func) {
+    int before = 0;
+    int start  = 0;
+    if (pm->time_passes) {
+        before = count_ir_insts(func);
+        start  = clock_usec();
+    }
+
+    const bool changed = run_pass(id, func);
+
+    if (pm->time_passes) {
+        pm->usecs->elements[id] += elapsed_usec(start);
+        pm->insts_before->elements[id] += before;
+        pm->insts_after->elements[id] += count_ir_insts(func);
+    }
+    ++pm->runs->elements[id];
+    return changed;
+}
+
+void run_passes(PassManager* pm, IrFunc* func) {
+    ++pm->func_count;
+    if (pm->time_passes) {
+        pm->total_before += count_ir_insts(func);
+    }
+
+    for (int i = 0; i < pm->pipeline->size; ++i) {
+        const int id = pm->pipeline->elements[i];
+        if (pm->enabled->elements[id] == 0) {
+            continue;
+        }
+
+        // the analyses the pass needs
+        if ((id == PASS_CSE || id == PASS_LICM) && opt_idoms == NULL) {
+            run_timed_pass(pm, PASS_DOMTREE, func);
+        }
+        if (id == PASS_LICM && opt_loops == NULL) {
+            run_timed_pass(pm, PASS_LOOPS, func);
+        }
+
+        // only simplifycfg changes the blocks and edges
+        if (run_timed_pass(pm, id, func) && id == PASS_SIMPLIFYCFG) {
+            invalidate_analyses();
+        }
+    }
+    invalidate_analyses();
+    pm->reg_alloc = opt_reg_alloc;
+    opt_reg_alloc = NULL;
+
+    if (pm->time_passes) {
+        pm->total_after += count_ir_insts(func);
+    }
+}
+
+void print_pass_times(const PassManager* pm, int fd) {
+    int total_usec = 0;
+    dprintf(fd, "===== pass execution times, %d functions =====\n", pm->func_count);
+    dprintf(fd, "%-12s %6s %10s", "pass", "runs", "usec");
+    dprintf(fd, " %14s %14s %8s\n", "insts before", "insts after", "delta");
+    for (int id = 0; id < PASS_COUNT; ++id) {
+        if (pm->runs->elements[id] == 0) {
+            continue;
+        }
+        const int before = pm->insts_before->elements[id];
+        const int after  = pm->insts_after->elements[id];
+        dprintf(fd, "%-12s %6d %10d", decode_pass_id(id), pm->runs->elements[id], pm->usecs->elements[id]);
+        dprintf(fd, " %14d %14d %8d\n", before, after, after - before);
+        total_usec += pm->usecs->elements[id];
+    }
+    dprintf(fd, "%-12s %6s %10d", "total", "", total_usec);
+    dprintf(fd, " %14d %14d %8d\n", pm->total_before, pm->total_after, pm->total_after - pm->total_before);
+}
+
+void free_pass_manager(PassManager* pm) {
+    free_opt_intvector(pm->pipeline);
+    free_opt_intvector(pm->enabled);
+    free_opt_intvector(pm->runs);
+    free_opt_intvector(pm->usecs);
+    free_opt_intvector(pm->insts_before);
+    free_opt_intvector(pm->insts_after);
+    free(pm);
+}
@@ -0,0 +1,67 @@
+#ifndef OPT_H
+#define OPT_H
+
+#include "ir.h"
+#include "regalloc.h"
+#include "util.h"
+
+//
+// Passes over the IR of a function (see ir.h). A pass manager runs the
+// enabled transform passes of a fixed pipeline on each function, and the
+// analyses they need before them; an analysis is kept until a pass changes
+// the control flow graph.
+//
+
+enum PassId {
+    PASS_SIMPLIFYCFG, // folds constant branches, merges blocks, drops empty ones
+    PASS_CONSTFOLD,   // computes operations on constants, simplifies x + 0 and the like
+    PASS_LICM,        // hoists loop-invariant operations into the loop preheader
+    PASS_CSE,         // reuses the value of an equal operation that dominates
+    PASS_DCE,         // drops operations whose values are never used
+    PASS_REGALLOC,    // gives the registers machine registers (see regalloc.h)
+    PASS_DOMTREE,     // analysis: immediate dominators
+    PASS_LOOPS,       // analysis: natural loops
+    PASS_COUNT,
+};
+
+typedef struct PassManager PassManager;
+
+struct PassManager {
+    IntVector* pipeline;       // transform pass ids, in the order they run
+    IntVector* enabled;        // by pass id, 1 if the pass runs
+    bool       time_passes;    // measure each run for print_pass_times
+
+    // by pass id, summed over the functions
+    IntVector* runs;
+    IntVector* usecs;
+    IntVector* insts_before;
+    IntVector* insts_after;
+
+    int        func_count;
+    int        total_before;   // instructions of the functions as built
+    int        total_after;    // and once the passes ran
+
+    RegAlloc*  reg_alloc;      // of the function the passes last ran on if regalloc did,
+                               // which the caller takes and frees
+};
+
+// the passes of -O<level>: all of them from 2, none below, as -O1 does not
+// go through the IR (see generator.h). regalloc runs last, on the IR the
+// generator emits.
+PassManager* create_pass_manager(int level);
+
+// -f<name> and -fno-<name>. Returns false if no transform pass is named so.
+bool set_pass_enabled(PassManager* pm, const char* name, bool enabled);
+
+bool has_enabled_passes(const PassManager* pm);
+
+void run_passes(PassManager* pm, IrFunc* func);
+
+// the --time-passes report
+void print_pass_times(const PassManager* pm, int fd);
+
+void free_pass_manager(PassManager* pm);
+
+const char* decode_pass_id(int id);
+
+#endif
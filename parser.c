@@ -4,244 +4,119 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef MINIC_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL
+#endif
+
 //
 // global
 //
+// Once the top level is parsed, typedef_map and token_vec are only read,
+// and bodies can be parsed on several threads, each with its own arena
+// and expression pool (see parse_func_bodies()).
+//
 
-static StrPtrMap* typedef_map;
+static HashMap* typedef_map; // typedef-name => struct name, each marked SYMBOL_TYPEDEF_NAME
+static HashMap* typedef_end_map; // typedef-name => token index after its declaration (see is_typedef_name())
+static THREAD_LOCAL int typedef_limit; // only typedef-names declared before this token index are known
+static THREAD_LOCAL Arena* node_arena;
+static THREAD_LOCAL ExprPool* expr_pool;
+static THREAD_LOCAL IntStack* expr_operands;  // of the expressions being parsed (see create_expr_at_level())
+static THREAD_LOCAL IntStack* expr_operators;
+static const Vector* token_vec; // tokens of the translation unit, for parse_func_body()
 
 //
 // forward declaration
 //
 
-static ExprNode* create_expr_node(const Vector* vec, int* index);
-static AssignExprNode* create_assign_expr_node(const Vector* vec, int* index);
 static DeclSpecifierNode* create_decl_specifier_node(const Vector* vec, int* index);
 static DeclaratorNode* create_declarator_node(const Vector* vec, int* index);
 static DeclarationNode* create_declaration_node(const Vector* vec, int* index);
 static StmtNode* create_stmt_node(const Vector* vec, int* index);
 static CompoundStmtNode* create_compound_stmt_node(const Vector* vec, int* index);
-static CastExprNode* create_cast_expr_node(const Vector* vec, int* index);
 static TypeSpecifierNode* create_type_specifier_node(const Vector* vec, int* index);
 static InitializerNode* create_initializer_node(const Vector* vec, int* index);
 static SpecifierQualifierNode* create_specifier_qualifier_node(const Vector* vec, int* index);
 static bool is_declaration_specifier(const Vector* vec, int index);
 static bool is_type_specifier(const Vector* vec, int index);
 
-static ConstantNode* create_constant_node(const Vector* vec, int* index) {
-    ConstantNode* constant_node = calloc(1, sizeof(ConstantNode));
-
-    const Token* token = vec->elements[*index];
-    switch (token->type) {
-    case TK_NUM: {
-        constant_node->const_type       = CONST_INT;
-        constant_node->integer_constant = token->num;
-        break;
-    }
-    case TK_BYTE: {
-        constant_node->const_type       = CONST_BYTE;
-        constant_node->integer_constant = token->num;
-        break;
-    }
-    case TK_STR: {
-        constant_node->const_type         = CONST_STR;
-        constant_node->character_constant = strdup(token->str);
-        break;
-    }
-    default: {
-        error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
-        return NULL;
-    }
-    }
-    ++(*index);
-
-    return constant_node;
-}
-
-static PrimaryExprNode* create_primary_expr_node(const Vector* vec, int* index) {
-    PrimaryExprNode* primary_expr_node = calloc(1, sizeof(PrimaryExprNode));
-
-    const Token* token = vec->elements[*index];
-    switch (token->type) {
-    case TK_IDENT: {
-        primary_expr_node->identifier = strdup(token->str);
-        ++(*index);
-        break;
-    }
-    case TK_NUM:
-    case TK_BYTE:
-    case TK_STR: {
-        primary_expr_node->constant_node = create_constant_node(vec, index);
-        if (primary_expr_node->constant_node == NULL) {
-            error("Failed to create constant node.\n");
-            return NULL;
-        }
-        break;
-    }
-    case TK_LPAREN: {
-        ++(*index);
-        primary_expr_node->expr_node = create_expr_node(vec, index);
-        if (primary_expr_node->expr_node == NULL) {
-            error("Failed to create expression-node.\n");
-            return NULL;
-        }
+//
+// expression
+//
+// Expressions are parsed by one loop over operands and operators (see
+// parse_operators()), with one expression per operator actually present in
+// the source. Expressions are appended to expr_pool and referred to by
+// index; the functions below return 0 on failure.
+//
 
-        Token* rparen_token = vec->elements[*index];
-        if (rparen_token->type != TK_RPAREN) {
-            error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(rparen_token->type));
-            return NULL;
-        }
-        ++(*index);
+static int create_expr(const Vector* vec, int* index);
+static int create_assign_expr(const Vector* vec, int* index);
+static int create_conditional_expr(const Vector* vec, int* index);
 
-        break;
-    }
-    default: {
-        error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
-        return NULL;
+// typedef-names are marked on their symbols, so telling one from another
+// identifier needs no lookup. parse() parses the bodies after the whole
+// unit, when every typedef is marked, so a body only knows the typedef-names
+// declared before it; a later one is still an identifier there.
+static bool is_typedef_name(const Token* token) {
+    if (token->type != TK_IDENT || symbol_kind(token->val) != SYMBOL_TYPEDEF_NAME) {
+        return false;
     }
+    if (typedef_end_map == NULL) {
+        return true;
     }
 
-    return primary_expr_node;
+    return hashmap_get_int(typedef_end_map, token->val) <= typedef_limit;
 }
 
-static PostfixExprNode* create_postfix_expr_node(const Vector* vec, int* index) {
-    PostfixExprNode* postfix_expr_node = calloc(1, sizeof(PostfixExprNode));
-
-    postfix_expr_node->assign_expr_nodes = create_vector();
-    postfix_expr_node->postfix_expr_type = PS_PRIMARY;
-
-    postfix_expr_node->primary_expr_node = create_primary_expr_node(vec, index);
-    if (postfix_expr_node->primary_expr_node == NULL) {
-        error("Failed to create primary-expression node.\n");
-        return NULL;
-    }
-
-    PostfixExprNode* current = postfix_expr_node;
-    const Token* token = vec->elements[*index];
-    while (token->type == TK_LSQUARE || token->type == TK_LPAREN || token->type == TK_DOT
-        || token->type == TK_ARROW   || token->type == TK_INC    || token->type == TK_DEC) {
-        
-        PostfixExprNode* p_postfix_expr_node = NULL;
-        switch (token->type) {
-        case TK_LSQUARE: {
-            ++(*index);
-
-            p_postfix_expr_node                     = calloc(1, sizeof(PostfixExprNode));
-            p_postfix_expr_node->postfix_expr_node  = current;
-            p_postfix_expr_node->assign_expr_nodes  = create_vector();
-            p_postfix_expr_node->postfix_expr_type  = PS_LSQUARE;
-            p_postfix_expr_node->expr_node          = create_expr_node(vec, index);
-            if (p_postfix_expr_node->expr_node == NULL) {
-                error("Failed to create assignment-expression node.\n");
-                return NULL;
-            }
-
-            token = vec->elements[*index];
-            if (token->type != TK_RSQUARE) {
-                error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
-                return NULL;    
-            }
-            ++(*index);
-
-            break;
-        }
-        case TK_LPAREN: {
-            ++(*index);
-
-            p_postfix_expr_node                     = calloc(1, sizeof(PostfixExprNode));
-            p_postfix_expr_node->postfix_expr_node  = current;
-            p_postfix_expr_node->assign_expr_nodes  = create_vector();
-            p_postfix_expr_node->postfix_expr_type  = PS_LPAREN;
-
-            token = vec->elements[*index];
-            while (token->type != TK_RPAREN) {
-                AssignExprNode* assign_expr_node = create_assign_expr_node(vec, index);
-                if (assign_expr_node == NULL) {
-                    error("Failed to create assignment-expression node.\n");
-                    return NULL;
-                }
-
-                vector_push_back(p_postfix_expr_node->assign_expr_nodes, assign_expr_node); 
-                token = vec->elements[*index];
-
-                if (token->type == TK_COMMA) {
-                    ++(*index);   
-                    token = vec->elements[*index];
-                }
-            }
-
-            ++(*index);
-            break;
-        }
-        case TK_DOT: {
-            ++(*index);
-
-            p_postfix_expr_node                     = calloc(1, sizeof(PostfixExprNode));
-            p_postfix_expr_node->postfix_expr_node  = current;
-            p_postfix_expr_node->assign_expr_nodes  = create_vector();
-            p_postfix_expr_node->postfix_expr_type  = PS_DOT;
-
-            token = vec->elements[*index];
-            if (token->type != TK_IDENT) {
-                error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
-                return NULL;    
-            }
-            p_postfix_expr_node->identifier = strdup(token->str);
-
-            ++(*index);
+static int new_expr(int kind, int op, int val, int lhs, int rhs) {
+    const int expr = expr_pool->kinds->size;
+    intvector_push_back(expr_pool->kinds, kind);
+    intvector_push_back(expr_pool->ops,   op);
+    intvector_push_back(expr_pool->vals,  val);
+    intvector_push_back(expr_pool->lhs,   lhs);
+    intvector_push_back(expr_pool->rhs,   rhs);
+    intvector_push_back(expr_pool->mid,   0);
 
-            break;
-        }
-        case TK_ARROW: {
-            ++(*index);
-
-            p_postfix_expr_node                     = calloc(1, sizeof(PostfixExprNode));
-            p_postfix_expr_node->postfix_expr_node  = current;
-            p_postfix_expr_node->assign_expr_nodes  = create_vector();
-            p_postfix_expr_node->postfix_expr_type  = PS_ARROW;
-            
-            token = vec->elements[*index];
-            if (token->type != TK_IDENT) {
-                error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
-                return NULL;    
-            }
-            p_postfix_expr_node->identifier = strdup(token->str);
-
-            ++(*index);
+    return expr;
+}
 
-            break;
-        }
-        case TK_INC: {
-            ++(*index);
-            p_postfix_expr_node                    = calloc(1, sizeof(PostfixExprNode));
-            p_postfix_expr_node->assign_expr_nodes = create_vector();
-            p_postfix_expr_node->postfix_expr_node = current;
-            p_postfix_expr_node->postfix_expr_type = PS_INC;
-            break;
-        }
-        case TK_DEC: {
-            ++(*index);
-            p_postfix_expr_node                    = calloc(1, sizeof(PostfixExprNode));
-            p_postfix_expr_node->assign_expr_nodes = create_vector();
-            p_postfix_expr_node->postfix_expr_node = current;
-            p_postfix_expr_node->postfix_expr_type = PS_DEC;
-            break;
-        }
-        default: {
-            error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
-            return NULL;
-        }
-        }
+static ExprPool* create_expr_pool() {
+    ExprPool* pool        = arena_alloc(node_arena, sizeof(ExprPool));
+    pool->kinds           = create_intvector();
+    pool->ops             = create_intvector();
+    pool->vals            = create_intvector();
+    pool->lhs             = create_intvector();
+    pool->rhs             = create_intvector();
+    pool->mid             = create_intvector();
+    pool->edges           = create_intvector();
+    pool->type_name_nodes = create_vector();
+
+    return pool;
+}
 
-        current = p_postfix_expr_node;
-        token = vec->elements[*index];
-    }
+static void free_intvector(IntVector* vec) {
+    free(vec->elements);
+    free(vec);
+}
 
-    return current;
+void free_expr_pool(ExprPool* pool) {
+    free_intvector(pool->kinds);
+    free_intvector(pool->ops);
+    free_intvector(pool->vals);
+    free_intvector(pool->lhs);
+    free_intvector(pool->rhs);
+    free_intvector(pool->mid);
+    free_intvector(pool->edges);
+    free(pool->type_name_nodes->elements);
+    free(pool->type_name_nodes);
 }
 
 static TypeNameNode* create_type_name_node(const Vector* vec, int* index) {
-    TypeNameNode* type_name_node = calloc(1, sizeof(TypeNameNode));
+    TypeNameNode* type_name_node = arena_alloc(node_arena, sizeof(TypeNameNode));
 
     type_name_node->specifier_qualifier_node = create_specifier_qualifier_node(vec, index);
     if (type_name_node->specifier_qualifier_node == NULL) {
@@ -258,36 +133,23 @@ static TypeNameNode* create_type_name_node(const Vector* vec, int* index) {
     return type_name_node;
 }
 
-static UnaryExprNode* create_unary_expr_node(const Vector* vec, int* index) {
-    UnaryExprNode* unary_expr_node = calloc(1, sizeof(UnaryExprNode));
-
-    unary_expr_node->type = UN_NONE;
-
+// an identifier, a constant or a sizeof: a primary-expression other than a
+// parenthesized one, which the operator loop takes apart
+static int create_operand(const Vector* vec, int* index) {
     const Token* token = vec->elements[*index];
     switch (token->type) {
-    case TK_INC: {
-        unary_expr_node->type = UN_INC;
+    case TK_IDENT: {
         ++(*index);
-
-        unary_expr_node->unary_expr_node = create_unary_expr_node(vec, index);
-        if (unary_expr_node->unary_expr_node == NULL) {
-            error("Failed to create unary-expression node.\n");
-            return NULL;
-        }
-
-        break;
+        return new_expr(EXPR_IDENT, 0, token->val, 0, 0);
     }
-    case TK_DEC: {
-        unary_expr_node->type = UN_DEC;
+    case TK_NUM:
+    case TK_BYTE:
+    case TK_STR: {
+        int const_type = CONST_INT;
+        if      (token->type == TK_BYTE) { const_type = CONST_BYTE; }
+        else if (token->type == TK_STR)  { const_type = CONST_STR;  }
         ++(*index);
-
-        unary_expr_node->unary_expr_node = create_unary_expr_node(vec, index);
-        if (unary_expr_node->unary_expr_node == NULL) {
-            error("Failed to create unary-expression node.\n");
-            return NULL;
-        }
-
-        break;
+        return new_expr(EXPR_CONST, const_type, token->val, 0, 0);
     }
     case TK_SIZEOF: {
         ++(*index);
@@ -295,449 +157,533 @@ static UnaryExprNode* create_unary_expr_node(const Vector* vec, int* index) {
         token = vec->elements[*index];
         if (token->type != TK_LPAREN) {
             error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
-            return NULL;
+            return 0;
         }
         ++(*index);
 
+        int size = 0;
         token = vec->elements[*index];
         //
         // sizeof ( identifier )
         //
-        if (token->type == TK_IDENT &&  !strptrmap_contains(typedef_map, token->str)) {
-            unary_expr_node->type        = UN_SIZEOF_IDENT;
-            unary_expr_node->sizeof_name = strdup(token->str);
+        if (token->type == TK_IDENT && !is_typedef_name(token)) {
+            size = new_expr(EXPR_SIZEOF_IDENT, 0, token->val, 0, 0);
             ++(*index);
         }
         //
         // sizeof ( type-name )
         //
         else {
-            unary_expr_node->type = UN_SIZEOF_TYPE;
-
-            unary_expr_node->type_name_node = create_type_name_node(vec, index);
-            if (unary_expr_node->type_name_node == NULL) {
+            TypeNameNode* type_name_node = create_type_name_node(vec, index);
+            if (type_name_node == NULL) {
                 error("Failed to create type-name node.\n");
-                return NULL;
+                return 0;
             }
+
+            size = new_expr(EXPR_SIZEOF_TYPE, 0, expr_pool->type_name_nodes->size, 0, 0);
+            vector_push_back(expr_pool->type_name_nodes, type_name_node);
         }
 
         token = vec->elements[*index];
         if (token->type != TK_RPAREN) {
             error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
-            return NULL;
+            return 0;
         }
         ++(*index);
 
-        break;
+        return size;
+    }
+    default: {
+        error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+        return 0;
     }
-    case TK_AMP:   case TK_ASTER:
-    case TK_PLUS:  case TK_MINUS:
-    case TK_TILDE: case TK_EXCLA: {
-        unary_expr_node->type = UN_OP;
-        if      (token->type == TK_AMP)   { unary_expr_node->op_type = OP_AND;   }
-        else if (token->type == TK_ASTER) { unary_expr_node->op_type = OP_MUL;   }
-        else if (token->type == TK_PLUS)  { unary_expr_node->op_type = OP_ADD;   }
-        else if (token->type == TK_MINUS) { unary_expr_node->op_type = OP_SUB;   }
-        else if (token->type == TK_TILDE) { unary_expr_node->op_type = OP_TILDE; }
-        else if (token->type == TK_EXCLA) { unary_expr_node->op_type = OP_EXCLA; }
+    }
+}
 
-        ++(*index);
+// identifier ( {assignment-expression}* ), the '(' already consumed
+static int create_call_expr(const Vector* vec, int* index, int callee) {
+    // nested calls append their own arguments, so collect these first
+    IntVector* args = create_intvector();
 
-        unary_expr_node->cast_expr_node = create_cast_expr_node(vec, index);
-        if (unary_expr_node->cast_expr_node == NULL) {
-            error("Failed to create cast-expression node.\n");
-            return NULL;
+    const Token* token = vec->elements[*index];
+    while (token->type != TK_RPAREN) {
+        const int arg = create_assign_expr(vec, index);
+        if (arg == 0) {
+            error("Failed to create assignment-expression.\n");
+            return 0;
         }
+        intvector_push_back(args, arg);
 
-        break;
-    }
-    default: {
-        unary_expr_node->type = UN_NONE;
-
-        unary_expr_node->postfix_expr_node = create_postfix_expr_node(vec, index);
-        if (unary_expr_node->postfix_expr_node == NULL) {
-            error("Failed to create postfix-expression node.\n");
-            return NULL;
+        token = vec->elements[*index];
+        if (token->type == TK_COMMA) {
+            ++(*index);
+            token = vec->elements[*index];
         }
-
-        break;
-    }
     }
+    ++(*index);
 
-    return unary_expr_node;
-}
-
-static CastExprNode* create_cast_expr_node(const Vector* vec, int* index) {
-    CastExprNode* cast_expr_node = calloc(1, sizeof(CastExprNode));
-
-    cast_expr_node->unary_expr_node = create_unary_expr_node(vec, index);
-    if (cast_expr_node->unary_expr_node == NULL) {
-        error("Failed to create unary-expression node.\n");
-        return NULL;
+    const int call = new_expr(EXPR_CALL, args->size, callee, 0, 0);
+    expr_pool->mid->elements[call] = expr_pool->edges->size;
+    for (int i = 0; i < args->size; ++i) {
+        intvector_push_back(expr_pool->edges, args->elements[i]);
     }
+    free(args->elements);
+    free(args);
 
-    return cast_expr_node;
+    return call;
 }
 
-static MultiPlicativeExprNode* create_multiplicative_expr_node(const Vector* vec, int* index) {
-    MultiPlicativeExprNode* multiplicative_expr_node = calloc(1, sizeof(MultiPlicativeExprNode));
-
-    multiplicative_expr_node->operator_type  = OP_NONE;
-    multiplicative_expr_node->cast_expr_node = create_cast_expr_node(vec, index);
-    if (multiplicative_expr_node->cast_expr_node == NULL) {
-        error("Failed to create cast-expression node.\n");
-        return NULL;
-    }
-
-    MultiPlicativeExprNode* current = multiplicative_expr_node;
+// applies the postfix operators after the operand current
+static int create_postfix_expr(const Vector* vec, int* index, int current) {
     const Token* token = vec->elements[*index];
-    while (token->type == TK_ASTER || token->type == TK_SLASH || token->type == TK_PER) {
+    while (token->type == TK_LSQUARE || token->type == TK_LPAREN || token->type == TK_DOT
+        || token->type == TK_ARROW   || token->type == TK_INC    || token->type == TK_DEC) {
         ++(*index);
 
-        MultiPlicativeExprNode* p_multiplicative_expr_node = malloc(sizeof(MultiPlicativeExprNode));
-        p_multiplicative_expr_node->multiplicative_expr_node = current;
-        p_multiplicative_expr_node->cast_expr_node           = create_cast_expr_node(vec, index);
-        if (p_multiplicative_expr_node->cast_expr_node == NULL) {
-            error("Failed to create cast-expression node.\n");
-            return NULL;
-        }
-
-        if      (token->type == TK_ASTER) { p_multiplicative_expr_node->operator_type = OP_MUL; }
-        else if (token->type == TK_SLASH) { p_multiplicative_expr_node->operator_type = OP_DIV; }
-        else if (token->type == TK_PER)   { p_multiplicative_expr_node->operator_type = OP_MOD; }
-
-        token = vec->elements[*index];
-        current = p_multiplicative_expr_node;
-    }
-
-    return current;
-}
+        switch (token->type) {
+        case TK_LSQUARE: {
+            const int subscript = create_expr(vec, index);
+            if (subscript == 0) {
+                error("Failed to create expression.\n");
+                return 0;
+            }
 
-static AdditiveExprNode* create_additive_expr_node(const Vector* vec, int* index) {
-    AdditiveExprNode* additive_expr_node = calloc(1, sizeof(AdditiveExprNode));
+            token = vec->elements[*index];
+            if (token->type != TK_RSQUARE) {
+                error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+                return 0;
+            }
+            ++(*index);
 
-    additive_expr_node->operator_type            = OP_NONE;
-    additive_expr_node->multiplicative_expr_node = create_multiplicative_expr_node(vec, index);
-    if (additive_expr_node->multiplicative_expr_node == NULL) {
-        error("Failed to create multiplicative-expression node.\n");
-        return NULL;
-    }
+            current = new_expr(EXPR_INDEX, 0, 0, current, subscript);
+            break;
+        }
+        case TK_LPAREN: {
+            // only named functions can be called
+            if (expr_kind(expr_pool, current) != EXPR_IDENT) {
+                error("Invalid token[%d]=\"%s\".\n", *index - 1, decode_token_type(token->type));
+                return 0;
+            }
 
-    AdditiveExprNode* current = additive_expr_node;
-    const Token* token = vec->elements[*index];
-    while (token->type == TK_PLUS || token->type == TK_MINUS) {
-        ++(*index);
+            current = create_call_expr(vec, index, expr_val(expr_pool, current));
+            if (current == 0) {
+                error("Failed to create call-expression.\n");
+                return 0;
+            }
+            break;
+        }
+        case TK_DOT:
+        case TK_ARROW: {
+            const int member_kind = (token->type == TK_DOT) ? EXPR_DOT : EXPR_ARROW;
 
-        AdditiveExprNode* p_additive_expr_node = malloc(sizeof(AdditiveExprNode));
+            token = vec->elements[*index];
+            if (token->type != TK_IDENT) {
+                error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+                return 0;
+            }
+            ++(*index);
 
-        p_additive_expr_node->operator_type            = (token->type == TK_PLUS) ? OP_ADD: OP_SUB;
-        p_additive_expr_node->additive_expr_node       = current;
-        p_additive_expr_node->multiplicative_expr_node = create_multiplicative_expr_node(vec, index);
-        if (p_additive_expr_node->multiplicative_expr_node == NULL) {
-            error("Failed to create multiplicative-expression node.\n");
-            return NULL;
+            current = new_expr(member_kind, 0, token->val, current, 0);
+            break;
+        }
+        case TK_INC:
+        case TK_DEC: {
+            current = new_expr((token->type == TK_INC) ? EXPR_POST_INC : EXPR_POST_DEC, 0, 0, current, 0);
+            break;
+        }
+        default: {
+            error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+            return 0;
+        }
         }
 
         token = vec->elements[*index];
-        current = p_additive_expr_node;
     }
 
     return current;
 }
 
-static ShiftExprNode* create_shift_expr(const Vector* vec, int* index) {
-    ShiftExprNode* shift_expr_node = calloc(1, sizeof(ShiftExprNode));
-
-    shift_expr_node->additive_expr_node = create_additive_expr_node(vec, index);
-    if (shift_expr_node->additive_expr_node == NULL) {
-        error("Failed to additive-expression node.\n");
-        return NULL;
+// binding power of a binary operator, 0 if the token is not one
+static int get_binary_precedence(int type) {
+    switch (type) {
+    case TK_ASTER:  case TK_SLASH:  case TK_PER: { return 6; }
+    case TK_PLUS:   case TK_MINUS:               { return 5; }
+    case TK_LANGLE: case TK_RANGLE:
+    case TK_LE:     case TK_GE:                  { return 4; }
+    case TK_EQ:     case TK_NE:                  { return 3; }
+    case TK_LOGAND:                              { return 2; }
+    case TK_LOGOR:                               { return 1; }
+    default:                                     { return 0; }
     }
-
-    return shift_expr_node;
 }
 
-static RelationalExprNode* create_relational_expr_node(const Vector* vec, int* index) {
-    RelationalExprNode* relational_expr_node = calloc(1, sizeof(RelationalExprNode));
-
-    relational_expr_node->cmp_type             = CMP_NONE;
-    relational_expr_node->shift_expr_node      = create_shift_expr(vec, index);
-    if (relational_expr_node->shift_expr_node == NULL) {
-        error("Failed to create shift-expression node.\n");
-        return NULL;
+static int create_binary_node(int type, int lhs, int rhs) {
+    switch (type) {
+    case TK_ASTER:  { return new_expr(EXPR_BINARY,  OP_MUL, 0, lhs, rhs); }
+    case TK_SLASH:  { return new_expr(EXPR_BINARY,  OP_DIV, 0, lhs, rhs); }
+    case TK_PER:    { return new_expr(EXPR_BINARY,  OP_MOD, 0, lhs, rhs); }
+    case TK_PLUS:   { return new_expr(EXPR_BINARY,  OP_ADD, 0, lhs, rhs); }
+    case TK_MINUS:  { return new_expr(EXPR_BINARY,  OP_SUB, 0, lhs, rhs); }
+    case TK_LANGLE: { return new_expr(EXPR_COMPARE, CMP_LT, 0, lhs, rhs); }
+    case TK_RANGLE: { return new_expr(EXPR_COMPARE, CMP_GT, 0, lhs, rhs); }
+    case TK_LE:     { return new_expr(EXPR_COMPARE, CMP_LE, 0, lhs, rhs); }
+    case TK_GE:     { return new_expr(EXPR_COMPARE, CMP_GE, 0, lhs, rhs); }
+    case TK_EQ:     { return new_expr(EXPR_COMPARE, CMP_EQ, 0, lhs, rhs); }
+    case TK_NE:     { return new_expr(EXPR_COMPARE, CMP_NE, 0, lhs, rhs); }
+    case TK_LOGAND: { return new_expr(EXPR_LOGAND,  0,      0, lhs, rhs); }
+    case TK_LOGOR:  { return new_expr(EXPR_LOGOR,   0,      0, lhs, rhs); }
+    default: {
+        error("Invalid binary operator \"%s\".\n", decode_token_type(type));
+        return 0;
     }
-    
-    RelationalExprNode* current = relational_expr_node;
-    const Token* token = vec->elements[*index];
-    while (token->type == TK_LANGLE || token->type == TK_RANGLE || token->type == TK_LE || token->type == TK_GE) {
-        ++(*index);
-    
-        RelationalExprNode* parent = calloc(1, sizeof(EqualityExprNode));
-
-        parent->relational_expr_node = current;
-        parent->shift_expr_node      = create_shift_expr(vec, index);
-        if (parent->shift_expr_node == NULL) {
-            error("Failed to create shif-texpression node.\n");
-            return NULL;
-        }
-
-        if      (token->type == TK_LANGLE) { parent->cmp_type = CMP_LT; }
-        else if (token->type == TK_RANGLE) { parent->cmp_type = CMP_GT; }
-        else if (token->type == TK_LE)     { parent->cmp_type = CMP_LE; }
-        else if (token->type == TK_GE)     { parent->cmp_type = CMP_GE; }
-     
-        token = vec->elements[*index];
-        current = parent;
     }
-
-    return current;
 }
 
-static EqualityExprNode* create_equality_expr_node(const Vector* vec, int* index) {
-    EqualityExprNode* equality_expr_node = calloc(1, sizeof(EqualityExprNode));
-
-    equality_expr_node->cmp_type             = CMP_NONE;
-    equality_expr_node->relational_expr_node = create_relational_expr_node(vec, index);
-    if (equality_expr_node->relational_expr_node == NULL) {
-        error("Failed to create relational-expression node.\n");
-        return NULL;
+// assignment operator of a token, OP_NONE if the token is not one
+static int get_assign_operator(int type) {
+    switch (type) {
+    case TK_ASSIGN: { return OP_ASSIGN; }
+    case TK_MUL_EQ: { return OP_MUL_EQ; }
+    case TK_DIV_EQ: { return OP_DIV_EQ; }
+    case TK_MOD_EQ: { return OP_MOD_EQ; }
+    case TK_ADD_EQ: { return OP_ADD_EQ; }
+    case TK_SUB_EQ: { return OP_SUB_EQ; }
+    case TK_AND_EQ: { return OP_AND_EQ; }
+    case TK_XOR_EQ: { return OP_XOR_EQ; }
+    case TK_OR_EQ:  { return OP_OR_EQ;  }
+    default:        { return OP_NONE;   }
     }
+}
 
-    EqualityExprNode* current = equality_expr_node;
-    const Token* token = vec->elements[*index];
-    while (token->type == TK_EQ || token->type == TK_NE) {
-        ++(*index);
-    
-        EqualityExprNode* p_equality_expr_node = calloc(1, sizeof(EqualityExprNode));
-
-        p_equality_expr_node->equality_expr_node   = current;
-        p_equality_expr_node->relational_expr_node = create_relational_expr_node(vec, index);
-        if (equality_expr_node->relational_expr_node == NULL) {
-            error("Failed to create relational-expression node.\n");
-            return NULL;
-        }
-
-        if      (token->type == TK_EQ) { p_equality_expr_node->cmp_type = CMP_EQ; }
-        else if (token->type == TK_NE) { p_equality_expr_node->cmp_type = CMP_NE; }
-
-        token = vec->elements[*index];
-        current = p_equality_expr_node;
+static bool is_unary_expr(int expr) {
+    switch (expr_kind(expr_pool, expr)) {
+    case EXPR_BINARY:
+    case EXPR_COMPARE:
+    case EXPR_LOGAND:
+    case EXPR_LOGOR:
+    case EXPR_COND: {
+        return false;
+    }
+    default: {
+        return true;
+    }
     }
-
-    return current;
 }
 
-static AndExprNode* create_and_expr_node(const Vector* vec, int* index) {
-    AndExprNode* and_expr_node = calloc(1, sizeof(AndExprNode));
-
-    and_expr_node->equality_expr_node = create_equality_expr_node(vec, index);
-    if (and_expr_node->equality_expr_node == NULL) {
-        error("Failed to create equality-expression node.\n");
-        return NULL;
+// the operator of a prefix token other than ++ and --, OP_NONE if the
+// token is not one
+static int get_prefix_operator(int type) {
+    switch (type) {
+    case TK_AMP:   { return OP_AND;   }
+    case TK_ASTER: { return OP_MUL;   }
+    case TK_PLUS:  { return OP_ADD;   }
+    case TK_MINUS: { return OP_SUB;   }
+    case TK_TILDE: { return OP_TILDE; }
+    case TK_EXCLA: { return OP_EXCLA; }
+    default:       { return OP_NONE;  }
     }
+}
 
-    return and_expr_node;
+static bool is_prefix_token(int type) {
+    return type == TK_INC || type == TK_DEC || get_prefix_operator(type) != OP_NONE;
 }
 
-static ExclusiveOrExprNode* create_exclusive_or_expr_node(const Vector* vec, int* index) {
-    ExclusiveOrExprNode* exclusive_or_expr_node = calloc(1, sizeof(ExclusiveOrExprNode));
+//
+// Operators are parsed by one loop with a stack of operands and a stack of
+// operators, in place of a function per precedence level: prefix
+// operators, parentheses, right operands and the branches of ?: nest as
+// deep as the source does, and would otherwise take as much C stack.
+// Subscripts and the arguments of calls are parsed by calls again.
+//
+// An operator on the stack is the token type of a binary, assignment or
+// comma operator, TK_COLON for a ?: whose else branch is being read, or
+// -1 - the token type of a prefix operator. TK_LPAREN and TK_QUESTION
+// open a parenthesized expression and the then branch of a ?:, in which
+// any operator may appear.
+//
+
+// levels of the operators from the loosest; binary operators follow
+#define LEVEL_COMMA  1
+#define LEVEL_ASSIGN 2
+#define LEVEL_COND   3
 
-    exclusive_or_expr_node->and_expr_node = create_and_expr_node(vec, index);
-    if (exclusive_or_expr_node->and_expr_node == NULL) {
-        error("Failed to create and-expression node.\n");
-        return NULL;
+// level of an infix operator, 0 if the token is not one
+static int get_operator_level(int type) {
+    if (type == TK_COMMA) {
+        return LEVEL_COMMA;
+    }
+    if (get_assign_operator(type) != OP_NONE) {
+        return LEVEL_ASSIGN;
+    }
+    if (type == TK_QUESTION || type == TK_COLON) {
+        return LEVEL_COND;
     }
 
-    return exclusive_or_expr_node;
+    const int prec = get_binary_precedence(type);
+    if (prec == 0) {
+        return 0;
+    }
+    return LEVEL_COND + prec;
 }
 
-static InclusiveOrExprNode* create_inclusive_or_expr_node(const Vector* vec, int* index) {
-    InclusiveOrExprNode* inclusive_or_expr_node = malloc(sizeof(InclusiveOrExprNode));
+static bool is_open_operator(int entry) {
+    return entry == TK_LPAREN || entry == TK_QUESTION;
+}
 
-    inclusive_or_expr_node->inclusive_or_expr_node = NULL;
-    inclusive_or_expr_node->exclusive_or_expr_node = create_exclusive_or_expr_node(vec, index);
-    if (inclusive_or_expr_node->exclusive_or_expr_node  == NULL) {
-        error("Failed to create exclusive-or-expression node.\n");
-        return NULL;
+// replaces the operands of the operator on top of the stack by the
+// expression it makes
+static int reduce_operator() {
+    const int entry = intstack_top(expr_operators);
+    intstack_pop(expr_operators);
+    const int rhs = intstack_top(expr_operands);
+    intstack_pop(expr_operands);
+
+    int expr = 0;
+    if (entry < 0) {
+        const int prefix = -1 - entry;
+        if (prefix == TK_INC) {
+            expr = new_expr(EXPR_PRE_INC, 0, 0, rhs, 0);
+        }
+        else if (prefix == TK_DEC) {
+            expr = new_expr(EXPR_PRE_DEC, 0, 0, rhs, 0);
+        }
+        else {
+            expr = new_expr(EXPR_UNARY, get_prefix_operator(prefix), 0, rhs, 0);
+        }
+        intstack_push(expr_operands, expr);
+        return expr;
     }
 
-    return inclusive_or_expr_node;
+    const int lhs = intstack_top(expr_operands);
+    intstack_pop(expr_operands);
+    if (entry == TK_COLON) {
+        // the condition is below the then branch
+        const int cond = intstack_top(expr_operands);
+        intstack_pop(expr_operands);
+        expr = new_expr(EXPR_COND, 0, 0, cond, rhs);
+        expr_pool->mid->elements[expr] = lhs;
+    }
+    else if (entry == TK_COMMA) {
+        expr = new_expr(EXPR_COMMA, 0, 0, lhs, rhs);
+    }
+    else if (get_assign_operator(entry) != OP_NONE) {
+        expr = new_expr(EXPR_ASSIGN, get_assign_operator(entry), 0, lhs, rhs);
+    }
+    else {
+        expr = create_binary_node(entry, lhs, rhs);
+    }
+    intstack_push(expr_operands, expr);
+    return expr;
 }
 
-static LogicalAndExprNode* create_logical_and_expr_node(const Vector* vec, int* index) {
-    LogicalAndExprNode* logical_and_expr_node = calloc(1, sizeof(LogicalAndExprNode));
-
-    logical_and_expr_node->inclusive_or_expr_node = create_inclusive_or_expr_node(vec, index);
-    if (logical_and_expr_node->inclusive_or_expr_node == NULL) {
-        error("Failed to create inclusive-or-expression node.\n");
-        return NULL;
+// reduces the operators above base down to the innermost open one
+static bool reduce_to_open(int base) {
+    while (expr_operators->top > base && !is_open_operator(intstack_top(expr_operators))) {
+        if (reduce_operator() == 0) {
+            return false;
+        }
     }
+    return true;
+}
 
-    const Token* token = vec->elements[*index];
-    LogicalAndExprNode* current = logical_and_expr_node;
-    while (token->type == TK_LOGAND) {
-        ++(*index);
-
-        LogicalAndExprNode* p_logical_and_expr_node = calloc(1, sizeof(LogicalAndExprNode));
+//
+// Parses an expression whose operators outside parentheses and then
+// branches are at least at level lowest, on the stacks above their tops
+// at base: an operand with its prefix operators and open parentheses, then
+// its postfix operators and closing parentheses, then an infix operator,
+// and so on until a token that does not continue the expression.
+//
+static int parse_operators(const Vector* vec, int* index, int lowest, int base) {
+    int open = 0; // open entries on the stack
+    while (true) {
+        const Token* token = vec->elements[*index];
+        if (is_prefix_token(token->type)) {
+            intstack_push(expr_operators, -1 - token->type);
+            ++(*index);
+            continue;
+        }
+        if (token->type == TK_LPAREN) {
+            intstack_push(expr_operators, TK_LPAREN);
+            ++open;
+            ++(*index);
+            continue;
+        }
 
-        p_logical_and_expr_node->logical_and_expr_node  = current;
-        p_logical_and_expr_node->inclusive_or_expr_node = create_inclusive_or_expr_node(vec, index);
-        if (p_logical_and_expr_node->inclusive_or_expr_node == NULL) {
-            error("Failed to create inclusive-or-expression node.\n");
-            return NULL;
+        const int operand = create_operand(vec, index);
+        if (operand == 0) {
+            error("Failed to create primary-expression.\n");
+            return 0;
         }
+        intstack_push(expr_operands, operand);
 
-        token = vec->elements[*index];
-        current = p_logical_and_expr_node;
-    }
+        int level = 0;
+        while (level == 0) {
+            const int postfix = create_postfix_expr(vec, index, intstack_top(expr_operands));
+            if (postfix == 0) {
+                error("Failed to create postfix-expression.\n");
+                return 0;
+            }
+            intstack_pop(expr_operands);
+            intstack_push(expr_operands, postfix);
 
-    return current;
-}
+            // prefix operators bind tighter than any infix one
+            while (expr_operators->top > base && intstack_top(expr_operators) < 0) {
+                reduce_operator();
+            }
 
-static LogicalOrExprNode* create_logical_or_expr_node(const Vector* vec, int* index) {
-    LogicalOrExprNode* logical_or_expr_node = calloc(1, sizeof(LogicalOrExprNode));
+            token = vec->elements[*index];
+            const bool closes = (token->type == TK_RPAREN || token->type == TK_COLON);
+            if (closes && open > 0) {
+                if (!reduce_to_open(base)) {
+                    return 0;
+                }
+                const int opener = (token->type == TK_RPAREN) ? TK_LPAREN : TK_QUESTION;
+                if (intstack_top(expr_operators) != opener) {
+                    error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+                    return 0;
+                }
+                intstack_pop(expr_operators);
+                --open;
+                ++(*index);
 
-    logical_or_expr_node->logical_and_expr_node = create_logical_and_expr_node(vec, index);
-    if (logical_or_expr_node->logical_and_expr_node == NULL) {
-        error("Failed to create logical-and-expression node.\n");
-        return NULL;
-    }
+                // a parenthesized expression takes postfix operators, an
+                // else branch is an operand of its own
+                if (token->type == TK_COLON) {
+                    intstack_push(expr_operators, TK_COLON);
+                    level = LEVEL_COND;
+                }
+                continue;
+            }
 
-    const Token* token = vec->elements[*index];
-    LogicalOrExprNode* current = logical_or_expr_node;
-    while (token->type == TK_LOGOR) {
-        ++(*index);
+            if (token->type != TK_COLON) {
+                level = get_operator_level(token->type);
+            }
+            if (level == 0 || (open == 0 && level < lowest)) {
+                if (open > 0) {
+                    error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+                    return 0;
+                }
+                if (!reduce_to_open(base)) {
+                    return 0;
+                }
+                return intstack_top(expr_operands);
+            }
 
-        LogicalOrExprNode* p_logical_or_expr_node = calloc(1, sizeof(LogicalOrExprNode));
+            // operators of the same level associate to the left, except
+            // assignments and ?:
+            const bool right_assoc = (level == LEVEL_ASSIGN || level == LEVEL_COND);
+            while (expr_operators->top > base && !is_open_operator(intstack_top(expr_operators))) {
+                const int top_level = get_operator_level(intstack_top(expr_operators));
+                if (top_level < level || (right_assoc && top_level == level)) {
+                    break;
+                }
+                if (reduce_operator() == 0) {
+                    return 0;
+                }
+            }
 
-        p_logical_or_expr_node->logical_or_expr_node  = current;
-        p_logical_or_expr_node->logical_and_expr_node = create_logical_and_expr_node(vec, index);
-        if (p_logical_or_expr_node->logical_and_expr_node == NULL) {
-            error("Failed to create logical-and-expression node.\n");
-            return NULL;
+            // <unary-expression> <assignment-operator> <assignment-expression>
+            if (level == LEVEL_ASSIGN && !is_unary_expr(intstack_top(expr_operands))) {
+                error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+                return 0;
+            }
+            intstack_push(expr_operators, token->type);
+            if (token->type == TK_QUESTION) {
+                ++open;
+            }
+            ++(*index);
         }
-        
-        token = vec->elements[*index];
-        current = p_logical_or_expr_node;
     }
-
-    return current;
 }
 
-static ConditionalExprNode* create_conditional_expr_node(const Vector* vec, int* index) {
-    ConditionalExprNode* conditional_expr_node = calloc(1, sizeof(ConditionalExprNode));
-
-    conditional_expr_node->logical_or_expr_node  = create_logical_or_expr_node(vec, index);
-    if (conditional_expr_node->logical_or_expr_node == NULL) {
-        error("Failed to create logical-or-expression node.\n");
-        return NULL;
+// the stacks are shared by the expressions being parsed, as those in
+// subscripts and arguments are parsed within the enclosing one
+static int create_expr_at_level(const Vector* vec, int* index, int lowest) {
+    if (expr_operands == NULL) {
+        expr_operands  = create_intstack();
+        expr_operators = create_intstack();
     }
 
-    const Token* token = vec->elements[*index];
-    if (token->type == TK_QUESTION) {
-        ++(*index);
+    const int operand_base  = expr_operands->top;
+    const int operator_base = expr_operators->top;
+    const int expr = parse_operators(vec, index, lowest, operator_base);
+    expr_operands->top  = operand_base;
+    expr_operators->top = operator_base;
 
-        conditional_expr_node->expr_node = create_expr_node(vec, index);
-        if (conditional_expr_node->expr_node == NULL) {
-            error("Failed to create expression node.\n");
-            return NULL;
-        }
+    return expr;
+}
 
-        token = vec->elements[*index];
-        if (token->type != TK_COLON) {
-            error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
-            return NULL;
-        }
-        ++(*index);
+static int create_conditional_expr(const Vector* vec, int* index) {
+    return create_expr_at_level(vec, index, LEVEL_COND);
+}
 
-        conditional_expr_node->conditional_expr_node = create_conditional_expr_node(vec, index);
-        if (conditional_expr_node->conditional_expr_node == NULL) {
-            error("Failed to create conditional-expression node.\n");
-            return NULL;
-        }
-    }
+static int create_assign_expr(const Vector* vec, int* index) {
+    return create_expr_at_level(vec, index, LEVEL_ASSIGN);
+}
 
-    return conditional_expr_node;
+static int create_expr(const Vector* vec, int* index) {
+    return create_expr_at_level(vec, index, LEVEL_COMMA);
 }
 
-static AssignExprNode* create_assign_expr_node(const Vector* vec, int* index) {
-    AssignExprNode* assign_expr_node = calloc(1, sizeof(AssignExprNode));
+int expr_kind(const ExprPool* pool, int expr) {
+    return pool->kinds->elements[expr];
+}
 
-    assign_expr_node->assign_operator = OP_NONE;
+int expr_op(const ExprPool* pool, int expr) {
+    return pool->ops->elements[expr];
+}
 
-    const int buf = *index;
-    assign_expr_node->unary_expr_node = create_unary_expr_node(vec, index);
-    if (assign_expr_node->unary_expr_node == NULL) {
-        error("Failed to create unary-expression node.\n");
-        return NULL;
-    }
+int expr_val(const ExprPool* pool, int expr) {
+    return pool->vals->elements[expr];
+}
 
-    const Token* token = vec->elements[*index];
-    if (token->type == TK_ASSIGN || token->type == TK_MUL_EQ || token->type == TK_DIV_EQ
-     || token->type == TK_MOD_EQ || token->type == TK_ADD_EQ || token->type == TK_SUB_EQ
-     || token->type == TK_AND_EQ || token->type == TK_XOR_EQ || token->type == TK_OR_EQ) {
-        if      (token->type == TK_ASSIGN) { assign_expr_node->assign_operator = OP_ASSIGN; }
-        else if (token->type == TK_MUL_EQ) { assign_expr_node->assign_operator = OP_MUL_EQ; }
-        else if (token->type == TK_DIV_EQ) { assign_expr_node->assign_operator = OP_DIV_EQ; }
-        else if (token->type == TK_MOD_EQ) { assign_expr_node->assign_operator = OP_MOD_EQ; }
-        else if (token->type == TK_ADD_EQ) { assign_expr_node->assign_operator = OP_ADD_EQ; }
-        else if (token->type == TK_SUB_EQ) { assign_expr_node->assign_operator = OP_SUB_EQ; }
-        else if (token->type == TK_AND_EQ) { assign_expr_node->assign_operator = OP_AND_EQ; }
-        else if (token->type == TK_XOR_EQ) { assign_expr_node->assign_operator = OP_XOR_EQ; }
-        else if (token->type == TK_OR_EQ)  { assign_expr_node->assign_operator = OP_OR_EQ;  }
+int expr_lhs(const ExprPool* pool, int expr) {
+    return pool->lhs->elements[expr];
+}
 
-        ++(*index);
-        assign_expr_node->assign_expr_node = create_assign_expr_node(vec, index);
-        if (assign_expr_node->assign_expr_node == NULL) {
-            error("Failed to create assign-expression node.\n");
-            return NULL;
-        }
-    } else {
-        assign_expr_node->unary_expr_node = NULL;
-        *index = buf; // restore index
+int expr_rhs(const ExprPool* pool, int expr) {
+    return pool->rhs->elements[expr];
+}
 
-        assign_expr_node->conditional_expr_node = create_conditional_expr_node(vec, index);
-        if (assign_expr_node->conditional_expr_node == NULL) {
-            error("Failed to create conditional-expression node.\n");
-            return NULL;
-        }
-    }
+int expr_mid(const ExprPool* pool, int expr) {
+    return pool->mid->elements[expr];
+}
 
-    return assign_expr_node;
+int expr_arg_count(const ExprPool* pool, int expr) {
+    return pool->ops->elements[expr];
 }
 
-static ExprNode* create_expr_node(const Vector* vec, int* index) {
-    ExprNode* expr_node = calloc(1, sizeof(ExprNode));
+int expr_arg(const ExprPool* pool, int expr, int i) {
+    return pool->edges->elements[pool->mid->elements[expr] + i];
+}
 
-    expr_node->assign_expr_node = create_assign_expr_node(vec, index);
-    if (expr_node->assign_expr_node == NULL) {
-        error("Failed to create assignment-expression node.\n");
-        return NULL;
-    }
+TypeNameNode* expr_type_name(const ExprPool* pool, int expr) {
+    return pool->type_name_nodes->elements[pool->vals->elements[expr]];
+}
 
-    ExprNode* current = expr_node;
-    const Token* token = vec->elements[*index];
-    while (token->type == TK_COMMA) {
-        ++(*index);
+int expr_pool_bytes(const ExprPool* pool) {
+    const int columns = 6 * pool->kinds->size + pool->edges->size;
+    return columns * sizeof(int) + pool->type_name_nodes->size * sizeof(void*)
+         + 7 * sizeof(IntVector) + sizeof(Vector) + sizeof(ExprPool);
+}
 
-        ExprNode* p_expr_node = calloc(1, sizeof(ExprNode));
+int expr_pointer_layout_bytes(const ExprPool* pool) {
+    // kind, op and val, four operand pointers and a type-name pointer
+    const int node_size = (3 * sizeof(int) + 5 * sizeof(void*) + 7) / 8 * 8;
 
-        p_expr_node->expr_node        = current;
-        p_expr_node->assign_expr_node = create_assign_expr_node(vec, index);
-        if (p_expr_node->assign_expr_node == NULL) {
-            error("Failed to create assing-expression node.\n");
-            return NULL;
+    // every call also owns a Vector of its arguments
+    int call_count = 0;
+    for (int i = 1; i < pool->kinds->size; ++i) {
+        if (pool->kinds->elements[i] == EXPR_CALL) {
+            ++call_count;
         }
-
-        token = vec->elements[*index];
-        current = p_expr_node;
     }
 
-    return current;
+    return (pool->kinds->size - 1) * node_size + call_count * (sizeof(Vector) + 16 * sizeof(void*));
 }
 
 static JumpStmtNode* create_jump_stmt_node(const Vector* vec, int* index) {
-    JumpStmtNode* jump_stmt_node = calloc(1, sizeof(JumpStmtNode));
+    JumpStmtNode* jump_stmt_node = arena_alloc(node_arena, sizeof(JumpStmtNode));
 
     const Token* token = vec->elements[*index];
     switch (token->type) {
@@ -773,8 +719,8 @@ static JumpStmtNode* create_jump_stmt_node(const Vector* vec, int* index) {
         ++(*index);
         token = vec->elements[*index];
         if (token->type != TK_SEMICOL) {
-            jump_stmt_node->expr_node = create_expr_node(vec, index);
-            if (jump_stmt_node->expr_node == NULL) {
+            jump_stmt_node->expr = create_expr(vec, index);
+            if (jump_stmt_node->expr == 0) {
                 error("Failed to create expression node.\n");
                 return NULL;
             }
@@ -800,16 +746,16 @@ static JumpStmtNode* create_jump_stmt_node(const Vector* vec, int* index) {
 }
 
 static ExprStmtNode* create_expr_stmt_node(const Vector* vec, int* index) {
-    ExprStmtNode* expr_stmt_node = calloc(1, sizeof(ExprStmtNode));
+    ExprStmtNode* expr_stmt_node = arena_alloc(node_arena, sizeof(ExprStmtNode));
 
     const Token* token = vec->elements[*index];
     if (token->type == TK_SEMICOL) {
-        expr_stmt_node->expr_node = NULL;
+        expr_stmt_node->expr = 0;
         ++(*index);
     }
     else {
-        expr_stmt_node->expr_node = create_expr_node(vec, index);
-        if (expr_stmt_node->expr_node == NULL) {
+        expr_stmt_node->expr = create_expr(vec, index);
+        if (expr_stmt_node->expr == 0) {
             error("Failed to create expression-node.\n");
             return NULL;
         }
@@ -825,51 +771,64 @@ static ExprStmtNode* create_expr_stmt_node(const Vector* vec, int* index) {
 }
 
 static SelectionStmtNode* create_selection_stmt_node(const Vector* vec, int* index) {
-    SelectionStmtNode* selection_stmt_node = calloc(1, sizeof(SelectionStmtNode));
+    SelectionStmtNode* selection_stmt_node = arena_alloc(node_arena, sizeof(SelectionStmtNode));
 
     const Token* token = vec->elements[*index];
     switch (token->type) {
+    // an "else if" chain is parsed by this loop rather than by recursion
     case TK_IF: {
-        ++(*index);
-        token = vec->elements[*index];
-        if (token->type != TK_LPAREN) {
-            error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
-            return NULL;
-        }
-        ++(*index);
-
-        selection_stmt_node->expr_node = create_expr_node(vec, index);
-        if (selection_stmt_node->expr_node == NULL) {
-            error("Failed to create expression-statement node.\n");
-            return NULL;
-        }
-
-        token = vec->elements[*index];
-        if (token->type != TK_RPAREN) {
-            error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
-            return NULL;
-        }
-        ++(*index);
+        SelectionStmtNode* current = selection_stmt_node;
+        while (current != NULL) {
+            ++(*index);
+            token = vec->elements[*index];
+            if (token->type != TK_LPAREN) {
+                error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+                return NULL;
+            }
+            ++(*index);
 
-        selection_stmt_node->stmt_node_0 = create_stmt_node(vec, index);
-        if (selection_stmt_node->stmt_node_0 == NULL) {
-            error("Failed to create statement node.\n");
-            return NULL;
-        }
+            current->expr = create_expr(vec, index);
+            if (current->expr == 0) {
+                error("Failed to create expression-statement node.\n");
+                return NULL;
+            }
 
-        token = vec->elements[*index];
-        if (token->type == TK_ELSE) {
+            token = vec->elements[*index];
+            if (token->type != TK_RPAREN) {
+                error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+                return NULL;
+            }
             ++(*index);
-            selection_stmt_node->selection_type = SELECT_IF_ELSE;
 
-            selection_stmt_node->stmt_node_1 = create_stmt_node(vec, index);
-            if (selection_stmt_node->stmt_node_1 == NULL) {
+            current->stmt_node_0 = create_stmt_node(vec, index);
+            if (current->stmt_node_0 == NULL) {
                 error("Failed to create statement node.\n");
                 return NULL;
             }
-        } 
-        else {
-            selection_stmt_node->selection_type = SELECT_IF;
+
+            token = vec->elements[*index];
+            if (token->type != TK_ELSE) {
+                current->selection_type = SELECT_IF;
+                break;
+            }
+            ++(*index);
+            current->selection_type = SELECT_IF_ELSE;
+
+            token = vec->elements[*index];
+            if (token->type == TK_IF) {
+                StmtNode* else_stmt_node = arena_alloc(node_arena, sizeof(StmtNode));
+                else_stmt_node->selection_stmt_node = arena_alloc(node_arena, sizeof(SelectionStmtNode));
+                current->stmt_node_1 = else_stmt_node;
+                current = else_stmt_node->selection_stmt_node;
+            }
+            else {
+                current->stmt_node_1 = create_stmt_node(vec, index);
+                if (current->stmt_node_1 == NULL) {
+                    error("Failed to create statement node.\n");
+                    return NULL;
+                }
+                current = NULL;
+            }
         }
 
         break;
@@ -885,8 +844,8 @@ static SelectionStmtNode* create_selection_stmt_node(const Vector* vec, int* ind
         }
         ++(*index);
 
-        selection_stmt_node->expr_node = create_expr_node(vec, index);
-        if (selection_stmt_node->expr_node == NULL) {
+        selection_stmt_node->expr = create_expr(vec, index);
+        if (selection_stmt_node->expr == 0) {
             error("Failed to create expression node.\n");
             return NULL;
         }
@@ -916,9 +875,9 @@ static SelectionStmtNode* create_selection_stmt_node(const Vector* vec, int* ind
 }
 
 static ItrStmtNode* create_itr_stmt_node(const Vector* vec, int* index) {
-    ItrStmtNode* itr_stmt_node = calloc(1, sizeof(ItrStmtNode));
+    ItrStmtNode* itr_stmt_node = arena_alloc(node_arena, sizeof(ItrStmtNode));
 
-    itr_stmt_node->declaration_nodes = create_vector();
+    itr_stmt_node->declaration_nodes = create_vector_in(node_arena);
     
     const Token* token = vec->elements[*index];
     switch (token->type) {
@@ -935,8 +894,8 @@ static ItrStmtNode* create_itr_stmt_node(const Vector* vec, int* index) {
         ++(*index);
 
         // expression
-        itr_stmt_node->expr_node_0 = create_expr_node(vec, index);
-        if (itr_stmt_node->expr_node_0 == NULL) {
+        itr_stmt_node->expr_0 = create_expr(vec, index);
+        if (itr_stmt_node->expr_0 == 0) {
             error("Failed to create expression-node.\n");
             return NULL;
         }
@@ -987,8 +946,8 @@ static ItrStmtNode* create_itr_stmt_node(const Vector* vec, int* index) {
         } 
         // {expression}? ;
         else {
-            itr_stmt_node->expr_node_0 = create_expr_node(vec, index);
-            if (itr_stmt_node->expr_node_0 == NULL) {
+            itr_stmt_node->expr_0 = create_expr(vec, index);
+            if (itr_stmt_node->expr_0 == 0) {
                 error("Failed to create expression-node.\n");
                 return NULL;
             }
@@ -1007,8 +966,8 @@ static ItrStmtNode* create_itr_stmt_node(const Vector* vec, int* index) {
         if (token->type == TK_SEMICOL) {
             ++(*index);
         } else {
-            itr_stmt_node->expr_node_1 = create_expr_node(vec, index);
-            if (itr_stmt_node->expr_node_1 == NULL) {
+            itr_stmt_node->expr_1 = create_expr(vec, index);
+            if (itr_stmt_node->expr_1 == 0) {
                 error("Failed to create expression-node.\n");
                 return NULL;
             }
@@ -1027,8 +986,8 @@ static ItrStmtNode* create_itr_stmt_node(const Vector* vec, int* index) {
         if (token->type == TK_RPAREN) {
             ++(*index);
         } else {
-            itr_stmt_node->expr_node_2 = create_expr_node(vec, index);
-            if (itr_stmt_node->expr_node_2 == NULL) {
+            itr_stmt_node->expr_2 = create_expr(vec, index);
+            if (itr_stmt_node->expr_2 == 0) {
                 error("Failed to create expression-node.\n");
                 return NULL;
             }
@@ -1060,7 +1019,7 @@ static ItrStmtNode* create_itr_stmt_node(const Vector* vec, int* index) {
 }
 
 static LabeledStmtNode* create_labeled_stmt_node(const Vector* vec, int* index) {
-    LabeledStmtNode* labeled_stmt_node = calloc(1, sizeof(LabeledStmtNode));
+    LabeledStmtNode* labeled_stmt_node = arena_alloc(node_arena, sizeof(LabeledStmtNode));
 
     const Token* token = vec->elements[*index];
     switch (token->type) {
@@ -1068,8 +1027,8 @@ static LabeledStmtNode* create_labeled_stmt_node(const Vector* vec, int* index)
         ++(*index);
         labeled_stmt_node->labeled_stmt_type = LABELED_CASE;
 
-        labeled_stmt_node->conditional_expr_node = create_conditional_expr_node(vec, index);
-        if (labeled_stmt_node->conditional_expr_node == NULL) {
+        labeled_stmt_node->conditional_expr = create_conditional_expr(vec, index);
+        if (labeled_stmt_node->conditional_expr == 0) {
             error("Failed to create conditional-expression node.\n");
             return NULL;
         }
@@ -1118,7 +1077,7 @@ static LabeledStmtNode* create_labeled_stmt_node(const Vector* vec, int* index)
 }
 
 static StmtNode* create_stmt_node(const Vector* vec, int* index) {
-    StmtNode* stmt_node = calloc(1, sizeof(StmtNode));
+    StmtNode* stmt_node = arena_alloc(node_arena, sizeof(StmtNode));
 
     const Token* token = vec->elements[*index];
     switch (token->type) {
@@ -1187,9 +1146,9 @@ static StmtNode* create_stmt_node(const Vector* vec, int* index) {
 }
 
 static InitializerListNode* create_initializer_list_node(const Vector* vec, int* index) {
-    InitializerListNode* initializer_list_node = malloc(sizeof(InitializerListNode));
+    InitializerListNode* initializer_list_node = arena_alloc(node_arena, sizeof(InitializerListNode));
 
-    initializer_list_node->initializer_nodes = create_vector();
+    initializer_list_node->initializer_nodes = create_vector_in(node_arena);
 
     InitializerNode* initializer_node = create_initializer_node(vec, index);
     if (initializer_node == NULL) {
@@ -1203,7 +1162,7 @@ static InitializerListNode* create_initializer_list_node(const Vector* vec, int*
         ++(*index);
 
         InitializerNode* node = create_initializer_node(vec, index);
-        if (initializer_node == NULL) {
+        if (node == NULL) {
             error("Failed to create initializer node.\n");
             return NULL;
         }
@@ -1216,7 +1175,7 @@ static InitializerListNode* create_initializer_list_node(const Vector* vec, int*
 }
 
 static InitializerNode* create_initializer_node(const Vector* vec, int* index) {
-    InitializerNode* initializer_node = calloc(1, sizeof(InitializerNode));
+    InitializerNode* initializer_node = arena_alloc(node_arena, sizeof(InitializerNode));
 
     const Token* token = vec->elements[*index];
     if (token->type == TK_LBRCKT) {
@@ -1236,8 +1195,8 @@ static InitializerNode* create_initializer_node(const Vector* vec, int* index) {
         ++(*index); 
     }
     else {
-        initializer_node->assign_expr_node = create_assign_expr_node(vec, index);
-        if (initializer_node->assign_expr_node == NULL) {
+        initializer_node->assign_expr = create_assign_expr(vec, index);
+        if (initializer_node->assign_expr == 0) {
             error("Failed to create assignment-expression node.\n");
             return NULL;
         }
@@ -1252,9 +1211,9 @@ static bool is_declarator(const Vector* vec, int index) {
 }
 
 static ParamDeclarationNode* create_param_declaration_node(const Vector* vec, int* index) {
-    ParamDeclarationNode* param_declaration_node = calloc(1, sizeof(ParamDeclarationNode));
+    ParamDeclarationNode* param_declaration_node = arena_alloc(node_arena, sizeof(ParamDeclarationNode));
 
-    param_declaration_node->decl_spec_nodes          = create_vector();
+    param_declaration_node->decl_spec_nodes          = create_vector_in(node_arena);
 
     while (is_declaration_specifier(vec, *index)) {
         DeclSpecifierNode* decl_spec_node = create_decl_specifier_node(vec, index);
@@ -1274,7 +1233,7 @@ static ParamDeclarationNode* create_param_declaration_node(const Vector* vec, in
 }
 
 static ParamListNode* create_param_list_node(const Vector* vec, int* index) {
-    ParamListNode* param_list_node = calloc(1, sizeof(ParamListNode));
+    ParamListNode* param_list_node = arena_alloc(node_arena, sizeof(ParamListNode));
     
     param_list_node->param_declaration_node = create_param_declaration_node(vec, index);
     if (param_list_node->param_declaration_node == NULL) {
@@ -1291,7 +1250,7 @@ static ParamListNode* create_param_list_node(const Vector* vec, int* index) {
         }
         ++(*index);
 
-        ParamListNode* p_param_list_node = calloc(1, sizeof(ParamListNode));
+        ParamListNode* p_param_list_node = arena_alloc(node_arena, sizeof(ParamListNode));
 
         p_param_list_node->param_list_node        = current;
         p_param_list_node->param_declaration_node = create_param_declaration_node(vec, index);
@@ -1308,7 +1267,7 @@ static ParamListNode* create_param_list_node(const Vector* vec, int* index) {
 }
 
 static ParamTypeListNode* create_param_type_list_node(const Vector* vec, int* index) {
-    ParamTypeListNode* param_type_list_node = calloc(1, sizeof(ParamTypeListNode));
+    ParamTypeListNode* param_type_list_node = arena_alloc(node_arena, sizeof(ParamTypeListNode));
     
     param_type_list_node->param_list_node = create_param_list_node(vec, index);
     if (param_type_list_node->param_list_node == NULL) {
@@ -1333,20 +1292,39 @@ static ParamTypeListNode* create_param_type_list_node(const Vector* vec, int* in
 }
 
 static DirectDeclaratorNode* create_direct_declarator_node(const Vector* vec, int* index) {
-    DirectDeclaratorNode* direct_declarator_node = calloc(1, sizeof(DirectDeclaratorNode));
+    DirectDeclaratorNode* direct_declarator_node = arena_alloc(node_arena, sizeof(DirectDeclaratorNode));
 
-    direct_declarator_node->identifier_list = create_vector();
+    direct_declarator_node->identifier_list = create_intvector_in(node_arena);
 
     const Token* token = vec->elements[*index];
     switch (token->type) {
     case TK_IDENT: {
-        direct_declarator_node->identifier = strdup(token->str);
+        direct_declarator_node->identifier = token->val;
         ++(*index);
         break;
     }
+    // ( declarator ): without a pointer the parentheses only group, and the
+    // declarator inside is the one the suffixes below apply to
     case TK_LPAREN: {
         ++(*index);
-        // @todo
+        const DeclaratorNode* declarator_node = create_declarator_node(vec, index);
+        if (declarator_node == NULL) {
+            error("Failed to create declarator node.\n");
+            return NULL;
+        }
+        if (declarator_node->pointer_node != NULL) {
+            error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+            return NULL;
+        }
+
+        token = vec->elements[*index];
+        if (token->type != TK_RPAREN) {
+            error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+            return NULL;
+        }
+        ++(*index);
+
+        direct_declarator_node = declarator_node->direct_declarator_node;
         break;
     }
     default: {
@@ -1359,10 +1337,10 @@ static DirectDeclaratorNode* create_direct_declarator_node(const Vector* vec, in
     while (token->type == TK_LSQUARE || token->type == TK_LPAREN) {
         ++(*index);
    
-        DirectDeclaratorNode* p_direct_declarator_node = calloc(1, sizeof(DirectDeclaratorNode));
+        DirectDeclaratorNode* p_direct_declarator_node = arena_alloc(node_arena, sizeof(DirectDeclaratorNode));
         
         p_direct_declarator_node->direct_declarator_node = current;
-        p_direct_declarator_node->identifier_list        = create_vector();
+        p_direct_declarator_node->identifier_list        = create_intvector_in(node_arena);
 
         switch (token->type) {
         case TK_LSQUARE: {
@@ -1372,8 +1350,8 @@ static DirectDeclaratorNode* create_direct_declarator_node(const Vector* vec, in
                 break;
             }
 
-            p_direct_declarator_node->conditional_expr_node = create_conditional_expr_node(vec, index);
-            if (p_direct_declarator_node->conditional_expr_node == NULL) {
+            p_direct_declarator_node->conditional_expr = create_conditional_expr(vec, index);
+            if (p_direct_declarator_node->conditional_expr == 0) {
                 error("Failed to create constant-expression node.\n");
                 return NULL;
             }
@@ -1388,6 +1366,7 @@ static DirectDeclaratorNode* create_direct_declarator_node(const Vector* vec, in
             break;
         }
         case TK_LPAREN: {
+            p_direct_declarator_node->is_function = true;
             if (is_declaration_specifier(vec, *index)) {
                 p_direct_declarator_node->param_type_list_node = create_param_type_list_node(vec, index);
                 if (p_direct_declarator_node->param_type_list_node == NULL) {
@@ -1405,8 +1384,7 @@ static DirectDeclaratorNode* create_direct_declarator_node(const Vector* vec, in
             else {
                 token = vec->elements[*index];
                 while (token->type == TK_IDENT) {
-                    char* identifier = strdup(token->str);
-                    vector_push_back(p_direct_declarator_node->identifier_list, identifier);
+                    intvector_push_back(p_direct_declarator_node->identifier_list, token->val);
 
                     ++(*index);
                     token = vec->elements[*index];
@@ -1434,7 +1412,7 @@ static DirectDeclaratorNode* create_direct_declarator_node(const Vector* vec, in
 }
 
 static PointerNode* create_pointer_node(const Vector* vec, int* index) {
-    PointerNode* pointer_node = malloc(sizeof(PointerNode));
+    PointerNode* pointer_node = arena_alloc(node_arena, sizeof(PointerNode));
 
     pointer_node->count = 1;
     const Token* token = vec->elements[*index];
@@ -1455,7 +1433,7 @@ static PointerNode* create_pointer_node(const Vector* vec, int* index) {
 }
 
 static DeclaratorNode* create_declarator_node(const Vector* vec, int* index) {
-    DeclaratorNode* declarator_node = calloc(1, sizeof(DeclaratorNode));
+    DeclaratorNode* declarator_node = arena_alloc(node_arena, sizeof(DeclaratorNode));
 
     const Token* token = vec->elements[*index];
     if (token->type == TK_ASTER) {
@@ -1471,14 +1449,11 @@ static DeclaratorNode* create_declarator_node(const Vector* vec, int* index) {
     return declarator_node;
 }
 
-static InitDeclaratorNode* create_init_declarator_node(const Vector* vec, int* index) {
-    InitDeclaratorNode* init_declarator_node = calloc(1, sizeof(InitDeclaratorNode));
+// parses the optional "= initializer" after an already parsed declarator
+static InitDeclaratorNode* complete_init_declarator_node(const Vector* vec, int* index, DeclaratorNode* declarator_node) {
+    InitDeclaratorNode* init_declarator_node = arena_alloc(node_arena, sizeof(InitDeclaratorNode));
 
-    init_declarator_node->declarator_node = create_declarator_node(vec, index);
-    if (init_declarator_node->declarator_node == NULL) {
-        error("Failed to create declarator-node.\n");
-        return NULL;
-    }
+    init_declarator_node->declarator_node = declarator_node;
 
     const Token* token = vec->elements[*index];
     if (token->type == TK_ASSIGN) {
@@ -1494,8 +1469,18 @@ static InitDeclaratorNode* create_init_declarator_node(const Vector* vec, int* i
     return init_declarator_node;
 }
 
+static InitDeclaratorNode* create_init_declarator_node(const Vector* vec, int* index) {
+    DeclaratorNode* declarator_node = create_declarator_node(vec, index);
+    if (declarator_node == NULL) {
+        error("Failed to create declarator-node.\n");
+        return NULL;
+    }
+
+    return complete_init_declarator_node(vec, index, declarator_node);
+}
+
 static SpecifierQualifierNode* create_specifier_qualifier_node(const Vector* vec, int* index) {
-    SpecifierQualifierNode* specifier_qualifier_node = calloc(1, sizeof(SpecifierQualifierNode));
+    SpecifierQualifierNode* specifier_qualifier_node = arena_alloc(node_arena, sizeof(SpecifierQualifierNode));
 
     const Token* token = vec->elements[*index];
     if (is_type_specifier(vec, *index)) {
@@ -1518,8 +1503,8 @@ static SpecifierQualifierNode* create_specifier_qualifier_node(const Vector* vec
 }
 
 static StructDeclarationNode* create_struct_declaration_node(const Vector* vec, int* index) {
-    StructDeclarationNode* struct_declaration_node = calloc(1, sizeof(StructDeclarationNode));  
-    struct_declaration_node->specifier_qualifier_nodes = create_vector();
+    StructDeclarationNode* struct_declaration_node = arena_alloc(node_arena, sizeof(StructDeclarationNode));  
+    struct_declaration_node->specifier_qualifier_nodes = create_vector_in(node_arena);
     
     const Token* token = vec->elements[*index];
     if (is_type_specifier(vec, *index) || token->type == TK_CONST) {
@@ -1550,7 +1535,7 @@ static StructDeclarationNode* create_struct_declaration_node(const Vector* vec,
         error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
         return NULL;
     }
-    struct_declaration_node->identifier = strdup(token->str);
+    struct_declaration_node->identifier = token->val;
     ++(*index);
 
     token = vec->elements[*index];
@@ -1564,8 +1549,8 @@ static StructDeclarationNode* create_struct_declaration_node(const Vector* vec,
 }
 
 static StructSpecifierNode* create_struct_specifier_node(const Vector* vec, int* index) {
-    StructSpecifierNode* struct_specifier_node = malloc(sizeof(StructSpecifierNode));
-    struct_specifier_node->struct_declaration_nodes = create_vector();
+    StructSpecifierNode* struct_specifier_node = arena_alloc(node_arena, sizeof(StructSpecifierNode));
+    struct_specifier_node->struct_declaration_nodes = create_vector_in(node_arena);
 
     const Token* token = vec->elements[*index];
     if (token->type != TK_STRUCT) {
@@ -1581,7 +1566,7 @@ static StructSpecifierNode* create_struct_specifier_node(const Vector* vec, int*
     }
     ++(*index);
 
-    struct_specifier_node->identifier = strdup(token->str);
+    struct_specifier_node->identifier = token->val;
 
     token = vec->elements[*index];
     if (token->type == TK_LBRCKT) {
@@ -1605,8 +1590,8 @@ static StructSpecifierNode* create_struct_specifier_node(const Vector* vec, int*
 }
 
 static EnumeratorListNode* create_enumerator_list_node(const Vector* vec, int* index) {
-    EnumeratorListNode* enumerator_list_node = malloc(sizeof(EnumeratorListNode));
-    enumerator_list_node->identifiers = create_vector();
+    EnumeratorListNode* enumerator_list_node = arena_alloc(node_arena, sizeof(EnumeratorListNode));
+    enumerator_list_node->identifiers = create_intvector_in(node_arena);
 
     const Token* token = vec->elements[*index];
     while (true) {
@@ -1615,8 +1600,7 @@ static EnumeratorListNode* create_enumerator_list_node(const Vector* vec, int* i
             return NULL;
         }
 
-        char* identifier = strdup(token->str);
-        vector_push_back(enumerator_list_node->identifiers, identifier);
+        intvector_push_back(enumerator_list_node->identifiers, token->val);
 
         ++(*index);
         token = vec->elements[*index];
@@ -1634,7 +1618,7 @@ static EnumeratorListNode* create_enumerator_list_node(const Vector* vec, int* i
 }
 
 static EnumSpecifierNode* create_enum_specifier_node(const Vector* vec, int* index) {
-    EnumSpecifierNode* enum_specifier_node = calloc(1, sizeof(EnumSpecifierNode));
+    EnumSpecifierNode* enum_specifier_node = arena_alloc(node_arena, sizeof(EnumSpecifierNode));
 
     const Token* token = vec->elements[*index];
     if (token->type != TK_ENUM) {
@@ -1645,7 +1629,7 @@ static EnumSpecifierNode* create_enum_specifier_node(const Vector* vec, int* ind
 
     token = vec->elements[*index];
     if (token->type == TK_IDENT) {
-        enum_specifier_node->identifier = strdup(token->str);
+        enum_specifier_node->identifier = token->val;
         ++(*index);
     }
 
@@ -1673,7 +1657,7 @@ static EnumSpecifierNode* create_enum_specifier_node(const Vector* vec, int* ind
 }
 
 static TypeSpecifierNode* create_type_specifier_node(const Vector* vec, int* index) {
-    TypeSpecifierNode* type_specifier_node = calloc(1, sizeof(TypeSpecifierNode));
+    TypeSpecifierNode* type_specifier_node = arena_alloc(node_arena, sizeof(TypeSpecifierNode));
 
     type_specifier_node->type_specifier = TYPE_NONE;
 
@@ -1694,11 +1678,11 @@ static TypeSpecifierNode* create_type_specifier_node(const Vector* vec, int* ind
     } 
     case TK_IDENT: { 
         type_specifier_node->type_specifier = TYPE_TYPEDEFNAME;
-        type_specifier_node->struct_name = strptrmap_get(typedef_map, token->str);
-        if (type_specifier_node->struct_name == NULL) {
+        if (!is_typedef_name(token)) {
             error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
             return NULL;
         }
+        type_specifier_node->struct_name = hashmap_get_int(typedef_map, token->val);
         ++(*index);
 
         break;
@@ -1713,7 +1697,7 @@ static TypeSpecifierNode* create_type_specifier_node(const Vector* vec, int* ind
 }
 
 static DeclSpecifierNode* create_decl_specifier_node(const Vector* vec, int* index) {
-    DeclSpecifierNode* decl_specifier_node = calloc(1, sizeof(DeclSpecifierNode));
+    DeclSpecifierNode* decl_specifier_node = arena_alloc(node_arena, sizeof(DeclSpecifierNode));
 
     const Token* token = vec->elements[*index];
     if (token->type == TK_STATIC) {
@@ -1735,24 +1719,34 @@ static DeclSpecifierNode* create_decl_specifier_node(const Vector* vec, int* ind
     return decl_specifier_node;
 }
 
-static DeclarationNode* create_declaration_node(const Vector* vec, int* index) {
-    DeclarationNode* declaration_node = malloc(sizeof(DeclarationNode));
+static Vector* create_decl_specifier_nodes(const Vector* vec, int* index) {
+    Vector* decl_specifier_nodes = create_vector_in(node_arena);
 
-    declaration_node->decl_specifier_nodes  = create_vector();
-    declaration_node->init_declarator_nodes = create_vector();
+    bool has_type_specifier = false;
+    while (is_declaration_specifier(vec, *index)) {
+        // a typedef-name after a type specifier is the declarator, as in int T;
+        if (has_type_specifier && is_typedef_name(vec->elements[*index])) {
+            break;
+        }
+        if (is_type_specifier(vec, *index)) {
+            has_type_specifier = true;
+        }
 
-    const Token* token = vec->elements[*index];
-    while (is_declaration_specifier(vec, *index) && token->type != TK_SEMICOL) {
         DeclSpecifierNode* decl_specifier_node = create_decl_specifier_node(vec, index);
         if (decl_specifier_node == NULL) {
             error("Failed to create declaration-specifier node.\n");
             return NULL;
         }
 
-        vector_push_back(declaration_node->decl_specifier_nodes, decl_specifier_node);
+        vector_push_back(decl_specifier_nodes, decl_specifier_node);
     }
 
-    token = vec->elements[*index];
+    return decl_specifier_nodes;
+}
+
+// parses the remaining init-declarators of a declaration and its ';'
+static DeclarationNode* complete_declaration_node(const Vector* vec, int* index, DeclarationNode* declaration_node) {
+    const Token* token = vec->elements[*index];
     while (token->type != TK_SEMICOL) {
         InitDeclaratorNode* init_declarator_node = create_init_declarator_node(vec, index);
         if (init_declarator_node == NULL) {
@@ -1766,19 +1760,36 @@ static DeclarationNode* create_declaration_node(const Vector* vec, int* index) {
         if (token->type == TK_COMMA) {
             ++(*index);
             token = vec->elements[*index];
-        } 
+        }
+        else if (token->type != TK_SEMICOL) {
+            error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+            return NULL;
+        }
     }
     ++(*index);
 
     return declaration_node;
 }
 
+static DeclarationNode* create_declaration_node(const Vector* vec, int* index) {
+    DeclarationNode* declaration_node = arena_alloc(node_arena, sizeof(DeclarationNode));
+
+    declaration_node->init_declarator_nodes = create_vector_in(node_arena);
+    declaration_node->decl_specifier_nodes  = create_decl_specifier_nodes(vec, index);
+    if (declaration_node->decl_specifier_nodes == NULL) {
+        error("Failed to create declaration-specifier nodes.\n");
+        return NULL;
+    }
+
+    return complete_declaration_node(vec, index, declaration_node);
+}
+
 static bool is_type_specifier(const Vector* vec, int index) {
     const Token* token = vec->elements[index];
     const int type = token->type;
     return (type == TK_VOID   || type == TK_CHAR || type == TK_INT
          || type == TK_DOUBLE || type == TK_STRUCT
-         || (token->str != NULL && strptrmap_contains(typedef_map, token->str))
+         || is_typedef_name(token)
     );
 }
 
@@ -1792,7 +1803,7 @@ static bool is_declaration_specifier(const Vector* vec, int index) {
 }
 
 static BlockItemNode* create_block_item_node(const Vector* vec, int* index) {
-    BlockItemNode* block_item_node = calloc(1, sizeof(BlockItemNode));
+    BlockItemNode* block_item_node = arena_alloc(node_arena, sizeof(BlockItemNode));
 
     if (is_declaration_specifier(vec, *index)) {
         block_item_node->declaration_node = create_declaration_node(vec, index);
@@ -1813,9 +1824,9 @@ static BlockItemNode* create_block_item_node(const Vector* vec, int* index) {
 }
 
 static CompoundStmtNode* create_compound_stmt_node(const Vector* vec, int* index) {
-    CompoundStmtNode* compound_stmt_node = malloc(sizeof(CompoundStmtNode));
+    CompoundStmtNode* compound_stmt_node = arena_alloc(node_arena, sizeof(CompoundStmtNode));
 
-    compound_stmt_node->block_item_nodes = create_vector();
+    compound_stmt_node->block_item_nodes = create_vector_in(node_arena);
 
     const Token* token = vec->elements[*index];
     if (token->type != TK_LBRCKT) {
@@ -1843,87 +1854,268 @@ static CompoundStmtNode* create_compound_stmt_node(const Vector* vec, int* index
     return compound_stmt_node;
 }
 
-static FuncDefNode* create_func_def_node(const Vector* vec, int* index) {
-    FuncDefNode* func_def_node = calloc(1, sizeof(FuncDefNode));
-
-    func_def_node->decl_specifier_nodes = create_vector();
-
-    // {declaration-specifier}*
-    while (is_declaration_specifier(vec, *index)) {
-        DeclSpecifierNode* decl_specifier_node = create_decl_specifier_node(vec, index);
-        if (decl_specifier_node == NULL) {
-            error("Failed to create declaration-specifier node.\n");
-            return NULL;
+// parses the body of a function whose specifiers and declarator are parsed
+static FuncDefNode* create_func_def_node(const Vector* vec, int* index, Vector* decl_specifier_nodes, DeclaratorNode* declarator_node) {
+    FuncDefNode* func_def_node = arena_alloc(node_arena, sizeof(FuncDefNode));
+
+    func_def_node->decl_specifier_nodes = decl_specifier_nodes;
+    func_def_node->declarator_node      = declarator_node;
+    func_def_node->compound_stmt_node   = NULL;
+    func_def_node->expr_pool            = NULL;
+    func_def_node->is_reachable         = false;
+
+    // compound-statement: only its extent is recorded here, by brace matching
+    func_def_node->body_begin = *index;
+    int depth = 0;
+    while (*index < vec->size) {
+        const Token* token = vec->elements[*index];
+        if (token->type == TK_LBRCKT) {
+            ++depth;
+        }
+        else if (token->type == TK_RBRCKT) {
+            --depth;
+            if (depth == 0) {
+                func_def_node->body_end = *index;
+                ++(*index);
+                return func_def_node;
+            }
         }
-        
-        vector_push_back(func_def_node->decl_specifier_nodes, decl_specifier_node);
+        ++(*index);
     }
 
-    // declarator
-    func_def_node->declarator_node = create_declarator_node(vec, index);
-    if (func_def_node->declarator_node == NULL) {
-        error("Failed to create declarator node.\n");
-        return NULL;
+    error("Unterminated compound-statement.\n");
+    return NULL;
+}
+
+CompoundStmtNode* parse_func_body(FuncDefNode* node) {
+    if (node->compound_stmt_node != NULL) {
+        return node->compound_stmt_node;
     }
 
-    // compound-statement
-    func_def_node->compound_stmt_node = create_compound_stmt_node(vec, index);
-    if (func_def_node->compound_stmt_node == NULL) {
+    int index = node->body_begin;
+    typedef_limit            = node->body_begin;
+    node->expr_pool          = expr_pool;
+    node->compound_stmt_node = create_compound_stmt_node(token_vec, &index);
+    if (node->compound_stmt_node == NULL) {
         error("Failed to create compound-statement node\n");
         return NULL;
     }
+    if (index != node->body_end + 1) {
+        error("Invalid compound-statement.\n");
+        node->compound_stmt_node = NULL;
+        return NULL;
+    }
 
-    return func_def_node;
+    return node->compound_stmt_node;
 }
 
-static bool is_func_def(const Vector* vec, int index) {
-    const Token* token = vec->elements[index];
-    while (!(token->type == TK_IDENT && !strptrmap_contains(typedef_map, token->str))) {
-        ++index;
-        token = vec->elements[index];
+#ifdef MINIC_THREADS
+
+typedef struct ParseWorker ParseWorker;
+struct ParseWorker {
+    pthread_t      thread;
+    const Vector*  func_def_nodes; // shared by every worker
+    int*           next;           // index of the next body to take, shared
+    bool*          failed;         // shared
+    Arena*         arena;
+};
+
+static void* run_parse_worker(void* arg) {
+    ParseWorker* worker = arg;
+    node_arena = worker->arena;
+    expr_pool  = create_expr_pool();
+    new_expr(EXPR_CONST, 0, 0, 0, 0); // index 0 stands for "no expression"
+
+    while (true) {
+        const int i = __atomic_fetch_add(worker->next, 1, __ATOMIC_RELAXED);
+        if (i >= worker->func_def_nodes->size) {
+            break;
+        }
+
+        if (parse_func_body(worker->func_def_nodes->elements[i]) == NULL) {
+            __atomic_store_n(worker->failed, true, __ATOMIC_RELAXED);
+        }
     }
-    ++index;
-    token = vec->elements[index];
 
-    if (token->type != TK_LPAREN) {
-        return false;
+    return NULL;
+}
+
+static bool parse_func_bodies_in_parallel(const Vector* func_def_nodes, int jobs) {
+    if (jobs > func_def_nodes->size) {
+        jobs = func_def_nodes->size;
     }
 
-    while (token->type != TK_RPAREN) {
-        ++index;
-        token = vec->elements[index];
+    int  next   = 0;
+    bool failed = false;
+    ParseWorker* workers = calloc(jobs, sizeof(ParseWorker));
+    for (int i = 0; i < jobs; ++i) {
+        workers[i].func_def_nodes = func_def_nodes;
+        workers[i].next           = &next;
+        workers[i].failed         = &failed;
+        workers[i].arena          = create_arena(node_arena->chunk_size);
+        if (pthread_create(&workers[i].thread, NULL, run_parse_worker, &workers[i]) != 0) {
+            error("Failed to start a parser thread.\n");
+            failed = true;
+            jobs   = i;
+        }
     }
-    ++index;
-    token = vec->elements[index];
 
-    return (token->type == TK_LBRCKT);
+    for (int j = 0; j < jobs; ++j) {
+        pthread_join(workers[j].thread, NULL);
+        arena_adopt(node_arena, workers[j].arena);
+        free(workers[j].arena);
+    }
+    free(workers);
+
+    return !failed;
 }
 
-static bool is_func_decl(const Vector* vec, int index) {
-    const Token* token = vec->elements[index];
-    while (!(token->type == TK_IDENT && !strptrmap_contains(typedef_map, token->str))) {
-        ++index;
-        token = vec->elements[index];
+#endif
+
+bool parse_func_bodies(TransUnitNode* node, int jobs) {
+    Vector* func_def_nodes = create_vector();
+    for (int i = 0; i < node->external_decl_nodes->size; ++i) {
+        const ExternalDeclNode* external_decl_node = node->external_decl_nodes->elements[i];
+        FuncDefNode* func_def_node = external_decl_node->func_def_node;
+        if (func_def_node != NULL && func_def_node->is_reachable && func_def_node->compound_stmt_node == NULL) {
+            vector_push_back(func_def_nodes, func_def_node);
+        }
     }
-    ++index;
-    token = vec->elements[index];
 
-    if (token->type != TK_LPAREN) {
-        return false;
+    bool ok = true;
+#ifdef MINIC_THREADS
+    if (jobs <= 0) {
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
     }
+    if (jobs > 1 && func_def_nodes->size > 1) {
+        ok = parse_func_bodies_in_parallel(func_def_nodes, jobs);
+        free(func_def_nodes->elements);
+        free(func_def_nodes);
+        return ok;
+    }
+#endif
 
-    while (token->type != TK_RPAREN) {
-        ++index;
-        token = vec->elements[index];
+    for (int j = 0; j < func_def_nodes->size; ++j) {
+        if (parse_func_body(func_def_nodes->elements[j]) == NULL) {
+            ok = false;
+        }
+    }
+
+    free(func_def_nodes->elements);
+    free(func_def_nodes);
+    return ok;
+}
+
+int count_func_defs(const TransUnitNode* node, bool parsed_only) {
+    int count = 0;
+    for (int i = 0; i < node->external_decl_nodes->size; ++i) {
+        const ExternalDeclNode* external_decl_node = node->external_decl_nodes->elements[i];
+        if (external_decl_node->func_def_node == NULL) {
+            continue;
+        }
+        if (!parsed_only || external_decl_node->func_def_node->compound_stmt_node != NULL) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+Vector* get_expr_pools(const TransUnitNode* node) {
+    Vector* pools = create_vector();
+    vector_push_back(pools, node->expr_pool);
+    for (int i = 0; i < node->external_decl_nodes->size; ++i) {
+        const ExternalDeclNode* external_decl_node = node->external_decl_nodes->elements[i];
+        if (external_decl_node->func_def_node == NULL) {
+            continue;
+        }
+
+        // a worker puts every body it parses in one pool
+        ExprPool* pool = external_decl_node->func_def_node->expr_pool;
+        if (pool == NULL) {
+            continue;
+        }
+        bool found = false;
+        for (int j = 0; j < pools->size; ++j) {
+            if (pools->elements[j] == pool) {
+                found = true;
+            }
+        }
+        if (!found) {
+            vector_push_back(pools, pool);
+        }
+    }
+
+    return pools;
+}
+
+static int get_func_def_name(const FuncDefNode* node) {
+    const DirectDeclaratorNode* current = node->declarator_node->direct_declarator_node;
+    while (current->direct_declarator_node != NULL) {
+        current = current->direct_declarator_node;
+    }
+
+    return current->identifier;
+}
+
+static bool is_static_func_def(const FuncDefNode* node) {
+    for (int i = 0; i < node->decl_specifier_nodes->size; ++i) {
+        const DeclSpecifierNode* decl_specifier_node = node->decl_specifier_nodes->elements[i];
+        if (decl_specifier_node->is_static) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//
+// Marks the function definitions that can be called: every non-static
+// function (main included) is a root, and a function is reached when its
+// name appears in the body of a reached one. The bodies are scanned as
+// tokens, so a static function that is never referred to is never parsed.
+//
+static void mark_reachable_func_defs(const TransUnitNode* node) {
+    HashMap* func_def_map = create_hashmap(256); // function name => func-def
+    Stack*   worklist     = create_stack();
+
+    for (int i = 0; i < node->external_decl_nodes->size; ++i) {
+        const ExternalDeclNode* external_decl_node = node->external_decl_nodes->elements[i];
+        FuncDefNode* func_def_node = external_decl_node->func_def_node;
+        if (func_def_node == NULL) {
+            continue;
+        }
+
+        hashmap_put(func_def_map, get_func_def_name(func_def_node), func_def_node);
+        if (!is_static_func_def(func_def_node)) {
+            func_def_node->is_reachable = true;
+            stack_push(worklist, func_def_node);
+        }
+    }
+
+    while (stack_top(worklist) != NULL) {
+        const FuncDefNode* reached = stack_top(worklist);
+        stack_pop(worklist);
+        for (int j = reached->body_begin; j < reached->body_end; ++j) {
+            const Token* token = token_vec->elements[j];
+            if (token->type != TK_IDENT) {
+                continue;
+            }
+
+            FuncDefNode* callee = hashmap_get(func_def_map, token->val);
+            if (callee != NULL && !callee->is_reachable) {
+                callee->is_reachable = true;
+                stack_push(worklist, callee);
+            }
+        }
     }
-    ++index;
-    token = vec->elements[index];
 
-    return (token->type == TK_SEMICOL);
+    free(worklist->elements);
+    free(worklist);
 }
 
 static ExternalDeclNode* create_external_decl_node(const Vector* vec, int* index) {
-    ExternalDeclNode* external_decl_node = calloc(1, sizeof(ExternalDeclNode));
+    ExternalDeclNode* external_decl_node = arena_alloc(node_arena, sizeof(ExternalDeclNode));
 
     const Token* token = vec->elements[*index];
     if (token->type == TK_TYPEDEF) {
@@ -1941,7 +2133,7 @@ static ExternalDeclNode* create_external_decl_node(const Vector* vec, int* index
             error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
             return NULL;
         }
-        char* struct_name = strdup(token->str);
+        const int struct_name = token->val;
         ++(*index);
 
         token = vec->elements[*index];
@@ -1949,10 +2141,24 @@ static ExternalDeclNode* create_external_decl_node(const Vector* vec, int* index
             error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
             return NULL;
         }
-        char* typedef_name = strdup(token->str);
+        const int typedef_name = token->val;
         ++(*index);
-    
-        strptrmap_put(typedef_map, typedef_name, struct_name); 
+
+        token = vec->elements[*index];
+        if (token->type != TK_SEMICOL) {
+            error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+            return NULL;
+        }
+        ++(*index);
+
+        hashmap_put_int(typedef_map, typedef_name, struct_name);
+        set_symbol_kind(typedef_name, SYMBOL_TYPEDEF_NAME);
+        // a typedef may be repeated; it is known from the first one on
+        if (typedef_end_map != NULL) {
+            if (!hashmap_contains(typedef_end_map, typedef_name)) {
+                hashmap_put_int(typedef_end_map, typedef_name, *index);
+            }
+        }
     }
     else if (token->type == TK_ENUM) {
         external_decl_node->enum_specifier_node = create_enum_specifier_node(vec, index); 
@@ -1969,44 +2175,108 @@ static ExternalDeclNode* create_external_decl_node(const Vector* vec, int* index
 
         ++(*index);
     }
-    else if (is_func_def(vec, *index)) {
-        external_decl_node->func_def_node = create_func_def_node(vec, index);
-        if (external_decl_node->func_def_node == NULL) {
-            error("Failed to create function-definition node.\n");
+    else {
+        //
+        // The specifiers and the first declarator are parsed once; the token
+        // after them tells a function definition from a prototype or a
+        // declaration.
+        //
+        DeclarationNode* declaration_node = arena_alloc(node_arena, sizeof(DeclarationNode));
+
+        declaration_node->init_declarator_nodes = create_vector_in(node_arena);
+        declaration_node->decl_specifier_nodes  = create_decl_specifier_nodes(vec, index);
+        if (declaration_node->decl_specifier_nodes == NULL) {
+            error("Failed to create declaration-specifier nodes.\n");
             return NULL;
         }
-    }
-    else if (is_func_decl(vec, *index)) {
+
+        // e.g. struct-specifier ;
         token = vec->elements[*index];
-        while (token->type != TK_SEMICOL) {
+        if (token->type == TK_SEMICOL) {
             ++(*index);
-            token = vec->elements[*index];
+            external_decl_node->declaration_node = declaration_node;
+            return external_decl_node;
         }
-        ++(*index);
-    }
-    else {
-        external_decl_node->declaration_node = create_declaration_node(vec, index);
-        if (external_decl_node->declaration_node == NULL) {
-            error("Failed to create declaration-definition node.\n");
+
+        const int declarator_index = *index;
+        DeclaratorNode* declarator_node = create_declarator_node(vec, index);
+        if (declarator_node == NULL) {
+            error("Failed to create declarator node.\n");
             return NULL;
         }
-    } 
+        if (*index == declarator_index) {
+            error("Invalid token[%d]=\"%s\".\n", *index, decode_token_type(token->type));
+            return NULL;
+        }
+
+        token = vec->elements[*index];
+        if (token->type == TK_LBRCKT) {
+            external_decl_node->func_def_node = create_func_def_node(vec, index, declaration_node->decl_specifier_nodes, declarator_node);
+            if (external_decl_node->func_def_node == NULL) {
+                error("Failed to create function-definition node.\n");
+                return NULL;
+            }
+        }
+        // a prototype: its declarator is a function declarator
+        else if (token->type == TK_SEMICOL && declarator_node->direct_declarator_node->is_function) {
+            ++(*index);
+        }
+        else {
+            InitDeclaratorNode* init_declarator_node = complete_init_declarator_node(vec, index, declarator_node);
+            if (init_declarator_node == NULL) {
+                error("Failed to create init-declarator node.\n");
+                return NULL;
+            }
+            vector_push_back(declaration_node->init_declarator_nodes, init_declarator_node);
+
+            token = vec->elements[*index];
+            if (token->type == TK_COMMA) {
+                ++(*index);
+            }
+
+            external_decl_node->declaration_node = complete_declaration_node(vec, index, declaration_node);
+            if (external_decl_node->declaration_node == NULL) {
+                error("Failed to create declaration-definition node.\n");
+                return NULL;
+            }
+        }
+    }
 
     return external_decl_node;
 }
 
 static TransUnitNode* create_trans_unit_node() {
-    TransUnitNode* trans_unit_node = malloc(sizeof(TransUnitNode));
+    TransUnitNode* trans_unit_node = arena_alloc(node_arena, sizeof(TransUnitNode));
 
-    trans_unit_node->external_decl_nodes = create_vector();
+    trans_unit_node->external_decl_nodes = create_vector_in(node_arena);
 
     return trans_unit_node;
 }
 
-TransUnitNode* parse(const Vector* vec) {
+void reset_typedef_names() {
+    // the typedef-names declared so far are plain identifiers again
+    if (typedef_map != NULL) {
+        for (int i = 0; i < typedef_map->capacity; ++i) {
+            if (typedef_map->keys[i] != 0) {
+                set_symbol_kind(typedef_map->keys[i], SYMBOL_IDENT);
+            }
+        }
+    }
+    typedef_map = create_hashmap(256);
+}
+
+TransUnitNode* parse(const Vector* vec, Arena* arena) {
     // init
-    typedef_map = create_strptrmap(1024);
+    reset_typedef_names();
+    typedef_end_map = create_hashmap(256);
+    typedef_limit   = vec->size;
+    node_arena      = arena;
+    token_vec       = vec;
+    expr_pool       = create_expr_pool();
+    new_expr(EXPR_CONST, 0, 0, 0, 0); // index 0 stands for "no expression"
+
     TransUnitNode* trans_unit_node = create_trans_unit_node();
+    trans_unit_node->expr_pool     = expr_pool;
 
     int index = 0;
     while (index < vec->size) {
@@ -2019,6 +2289,48 @@ TransUnitNode* parse(const Vector* vec) {
         vector_push_back(trans_unit_node->external_decl_nodes, external_decl_node);
     }
 
+    mark_reachable_func_defs(trans_unit_node);
+
+    return trans_unit_node;
+}
+
+TransUnitNode* parse_external_decl(const Vector* vec, Arena* arena) {
+    // init
+    if (typedef_map == NULL) {
+        typedef_map = create_hashmap(256);
+    }
+    // the body is parsed right away, after every typedef declared so far
+    typedef_end_map = NULL;
+    node_arena = arena;
+    token_vec  = vec;
+    expr_pool  = create_expr_pool();
+    new_expr(EXPR_CONST, 0, 0, 0, 0); // index 0 stands for "no expression"
+
+    TransUnitNode* trans_unit_node = create_trans_unit_node();
+    trans_unit_node->expr_pool     = expr_pool;
+
+    // the last token is not part of the declaration, so that a truncated
+    // declaration fails on it instead of reading past the vector
+    int index = 0;
+    ExternalDeclNode* external_decl_node = create_external_decl_node(vec, &index);
+    if (external_decl_node == NULL) {
+        error("Failed to create external-declaration node.\n");
+        return trans_unit_node;
+    }
+    if (index != vec->size - 1) {
+        error("Invalid token[%d] after external-declaration.\n", index);
+        return trans_unit_node;
+    }
+    if (external_decl_node->func_def_node != NULL) {
+        external_decl_node->func_def_node->is_reachable = true;
+        if (parse_func_body(external_decl_node->func_def_node) == NULL) {
+            error("Failed to parse function body.\n");
+            return trans_unit_node;
+        }
+    }
+
+    vector_push_back(trans_unit_node->external_decl_nodes, external_decl_node);
+
     return trans_unit_node;
 }
 
@@ -2095,28 +2407,29 @@ const char* decode_jump_type(int type) {
     }
 }
 
-const char* decode_unary_type(int type) {
-    switch (type) {
-    case UN_NONE:         { return "UN_NONE";         }
-    case UN_INC:          { return "UN_INC";          }
-    case UN_DEC:          { return "UN_DEC";          }
-    case UN_OP:           { return "UN_OP";           }
-    case UN_SIZEOF_IDENT: { return "UN_SIZEOF_IDENT"; }
-    case UN_SIZEOF_TYPE:  { return "UN_SIZEOF_TYPE";  }
-    default:              { return "INVALID";         }
-    }
-}
-
-const char* decode_postfix_type(int type) {
-    switch (type) {
-    case PS_PRIMARY: { return "PS_PRIMARY"; }
-    case PS_LSQUARE: { return "PS_LSQUARE"; }
-    case PS_LPAREN:  { return "PS_LPAREN";  }
-    case PS_DOT:     { return "PS_DOT";     }
-    case PS_ARROW:   { return "PS_ARROW";   }
-    case PS_INC:     { return "PS_INC";     }
-    case PS_DEC:     { return "PS_DEC";     }
-    default:         { return "INVALID";    }
+const char* decode_expr_kind(int kind) {
+    switch (kind) {
+    case EXPR_CONST:        { return "EXPR_CONST";        }
+    case EXPR_IDENT:        { return "EXPR_IDENT";        }
+    case EXPR_CALL:         { return "EXPR_CALL";         }
+    case EXPR_INDEX:        { return "EXPR_INDEX";        }
+    case EXPR_DOT:          { return "EXPR_DOT";          }
+    case EXPR_ARROW:        { return "EXPR_ARROW";        }
+    case EXPR_POST_INC:     { return "EXPR_POST_INC";     }
+    case EXPR_POST_DEC:     { return "EXPR_POST_DEC";     }
+    case EXPR_PRE_INC:      { return "EXPR_PRE_INC";      }
+    case EXPR_PRE_DEC:      { return "EXPR_PRE_DEC";      }
+    case EXPR_UNARY:        { return "EXPR_UNARY";        }
+    case EXPR_SIZEOF_IDENT: { return "EXPR_SIZEOF_IDENT"; }
+    case EXPR_SIZEOF_TYPE:  { return "EXPR_SIZEOF_TYPE";  }
+    case EXPR_BINARY:       { return "EXPR_BINARY";       }
+    case EXPR_COMPARE:      { return "EXPR_COMPARE";      }
+    case EXPR_LOGAND:       { return "EXPR_LOGAND";       }
+    case EXPR_LOGOR:        { return "EXPR_LOGOR";        }
+    case EXPR_COND:         { return "EXPR_COND";         }
+    case EXPR_ASSIGN:       { return "EXPR_ASSIGN";       }
+    case EXPR_COMMA:        { return "EXPR_COMMA";        }
+    default:                { return "INVALID";           }
     }
 }
 
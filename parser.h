@@ -59,13 +59,27 @@ enum JumpType {
     JMP_RETURN,
 };
 
-enum UnaryType {
-    UN_NONE,         // none
-    UN_INC,          // ++
-    UN_DEC,          // --
-    UN_OP,           // unary-operator
-    UN_SIZEOF_IDENT, // sizeof ( identifier ) 
-    UN_SIZEOF_TYPE,  // sizeof ( type-name )
+enum ExprKind {
+    EXPR_CONST,        // constant (op: ConstType, val: value, or symbol of a string literal)
+    EXPR_IDENT,        // identifier (val)
+    EXPR_CALL,         // identifier ( {assignment-expression}* )  (val, op: argument count, mid: first edge)
+    EXPR_INDEX,        // lhs [ rhs ]
+    EXPR_DOT,          // lhs . identifier (val)
+    EXPR_ARROW,        // lhs -> identifier (val)
+    EXPR_POST_INC,     // lhs ++
+    EXPR_POST_DEC,     // lhs --
+    EXPR_PRE_INC,      // ++ lhs
+    EXPR_PRE_DEC,      // -- lhs
+    EXPR_UNARY,        // unary-operator lhs (op: OperatorType)
+    EXPR_SIZEOF_IDENT, // sizeof ( identifier ) (val)
+    EXPR_SIZEOF_TYPE,  // sizeof ( type-name )  (val: index in type_name_nodes)
+    EXPR_BINARY,       // lhs * / % + - rhs (op: OperatorType)
+    EXPR_COMPARE,      // lhs < > <= >= == != rhs (op: ComparisonOperatorType)
+    EXPR_LOGAND,       // lhs && rhs
+    EXPR_LOGOR,        // lhs || rhs
+    EXPR_COND,         // lhs ? mid : rhs
+    EXPR_ASSIGN,       // lhs assignment-operator rhs (op: OperatorType)
+    EXPR_COMMA,        // lhs , rhs
 };
 
 enum SizeofType {
@@ -75,16 +89,6 @@ enum SizeofType {
     SIZEOFTYPE_IDENT,
 };
 
-enum PostfixType {
-    PS_PRIMARY, // primary-expreesion
-    PS_LSQUARE, // postfix-expression [ <expression> ]
-    PS_LPAREN,  // postfix-expression ( {assignment-expression}* )
-    PS_DOT,     // postfix-expression . identifier
-    PS_ARROW,   // postfix-expression -> identifier
-    PS_INC,     // postfix-expression ++
-    PS_DEC,     // postfix-expression --
-};
-
 enum SelectionStmtType {
     SELECT_IF,
     SELECT_IF_ELSE,
@@ -112,24 +116,7 @@ typedef struct SpecifierQualifierNode SpecifierQualifierNode;
 typedef struct DeclaratorNode DeclaratorNode;
 typedef struct PointerNode PointerNode;
 typedef struct DirectDeclaratorNode DirectDeclaratorNode;
-typedef struct ConditionalExprNode ConditionalExprNode;
-typedef struct LogicalOrExprNode LogicalOrExprNode;
-typedef struct LogicalAndExprNode LogicalAndExprNode;
-typedef struct InclusiveOrExprNode InclusiveOrExprNode;
-typedef struct ExclusiveOrExprNode ExclusiveOrExprNode;
-typedef struct AndExprNode AndExprNode;
-typedef struct EqualityExprNode EqualityExprNode;
-typedef struct RelationalExprNode RelationalExprNode;
-typedef struct ShiftExprNode ShiftExprNode;
-typedef struct AdditiveExprNode AdditiveExprNode;
-typedef struct MultiPlicativeExprNode MultiPlicativeExprNode;
-typedef struct CastExprNode CastExprNode;
-typedef struct UnaryExprNode UnaryExprNode;
-typedef struct PostfixExprNode PostfixExprNode;
-typedef struct PrimaryExprNode PrimaryExprNode;
-typedef struct ConstantNode ConstantNode;
-typedef struct ExprNode ExprNode;
-typedef struct AssignExprNode AssignExprNode;
+typedef struct ExprPool ExprPool;
 typedef struct TypeNameNode TypeNameNode;
 typedef struct ParamTypeListNode ParamTypeListNode;
 typedef struct ParamListNode ParamListNode;
@@ -151,8 +138,13 @@ typedef struct SelectionStmtNode SelectionStmtNode;
 typedef struct ItrStmtNode ItrStmtNode;
 typedef struct JumpStmtNode JumpStmtNode;
 
+//
+// Identifiers in the nodes are symbol ids (see intern()), 0 if absent.
+//
+
 struct TransUnitNode {
-    Vector* external_decl_nodes;
+    Vector*   external_decl_nodes;
+    ExprPool* expr_pool;
 };
 
 struct ExternalDeclNode {
@@ -161,10 +153,21 @@ struct ExternalDeclNode {
     EnumSpecifierNode* enum_specifier_node;
 };
 
+//
+// The body of a function definition is parsed on demand (see
+// parse_func_body()): until then compound_stmt_node is NULL and only the
+// token range of the body is known. The expressions of the body are in
+// expr_pool, which is not the pool of the translation unit when the body
+// was parsed on another thread.
+//
 struct FuncDefNode {
     Vector*           decl_specifier_nodes;
     DeclaratorNode*   declarator_node;
     CompoundStmtNode* compound_stmt_node;
+    ExprPool*         expr_pool;
+    int               body_begin;   // token index of '{'
+    int               body_end;     // token index of the matching '}'
+    bool              is_reachable; // non-static, or called from a reachable body
 };
 
 struct DeclSpecifierNode {
@@ -176,18 +179,18 @@ struct DeclSpecifierNode {
 struct TypeSpecifierNode {
     int                  type_specifier;
     StructSpecifierNode* struct_specifier_node;
-    char*                struct_name;
+    int                  struct_name;
 };
 
 struct StructSpecifierNode {
-    char*      identifier;
+    int        identifier;
     Vector*    struct_declaration_nodes; 
 };
 
 struct StructDeclarationNode {
     Vector*      specifier_qualifier_nodes;
     PointerNode* pointer_node;
-    char*        identifier;
+    int          identifier;
 };
 
 struct SpecifierQualifierNode {
@@ -205,124 +208,31 @@ struct PointerNode {
 };
 
 struct DirectDeclaratorNode {
-    char*                 identifier;
+    int                   identifier;
     DeclaratorNode*       declarator_node;
     DirectDeclaratorNode* direct_declarator_node;  
-    ConditionalExprNode*  conditional_expr_node;
+    int                   conditional_expr;
     ParamTypeListNode*    param_type_list_node;
-    Vector*               identifier_list;
-};
-
-struct ConditionalExprNode {
-    LogicalOrExprNode*   logical_or_expr_node;
-    ExprNode*            expr_node;
-    ConditionalExprNode* conditional_expr_node;
-};
-
-struct LogicalOrExprNode {
-    LogicalAndExprNode* logical_and_expr_node;
-    LogicalOrExprNode*  logical_or_expr_node;
-};
-
-struct LogicalAndExprNode {
-    InclusiveOrExprNode* inclusive_or_expr_node;
-    LogicalAndExprNode*  logical_and_expr_node;
-};
-
-struct InclusiveOrExprNode {
-    ExclusiveOrExprNode* exclusive_or_expr_node;
-    InclusiveOrExprNode* inclusive_or_expr_node;
-};
-
-struct ExclusiveOrExprNode {
-    AndExprNode*         and_expr_node;
-    ExclusiveOrExprNode* exclusive_or_expr_node;
-};
-
-struct AndExprNode {
-    EqualityExprNode* equality_expr_node;
-    AndExprNode*      and_expr_node;
-};
-
-struct EqualityExprNode {
-    int                 cmp_type;
-    RelationalExprNode* relational_expr_node;
-    EqualityExprNode*   equality_expr_node;
-};
-
-struct RelationalExprNode {
-    int                 cmp_type;
-    ShiftExprNode*      shift_expr_node;
-    RelationalExprNode* relational_expr_node;
+    IntVector*            identifier_list;
+    bool                  is_function;  // direct_declarator_node ( parameters )
 };
 
-struct ShiftExprNode {
-    AdditiveExprNode* additive_expr_node;
-    ShiftExprNode*    shift_expr_node;
-};
-
-struct AdditiveExprNode {
-    int                     operator_type;
-    MultiPlicativeExprNode* multiplicative_expr_node;
-    AdditiveExprNode*       additive_expr_node;
-};
-
-struct MultiPlicativeExprNode {
-    int                     operator_type;
-    CastExprNode*           cast_expr_node;
-    MultiPlicativeExprNode* multiplicative_expr_node;
-};
-
-struct CastExprNode {
-    UnaryExprNode* unary_expr_node;
-    CastExprNode*  cast_expr_node;
-    TypeNameNode*  type_name_node;
-};  
-
-struct UnaryExprNode {
-    PostfixExprNode* postfix_expr_node;
-    UnaryExprNode*   unary_expr_node;
-    CastExprNode*    cast_expr_node;
-    TypeNameNode*    type_name_node;
-    int              type;
-    int              op_type;
-    char*            sizeof_name;
-}; 
-
-struct PostfixExprNode {
-    PrimaryExprNode* primary_expr_node;
-    PostfixExprNode* postfix_expr_node;
-    ExprNode*        expr_node;
-    Vector*          assign_expr_nodes;
-    char*            identifier;
-    int              postfix_expr_type; 
-};
-
-struct PrimaryExprNode {
-    ConstantNode* constant_node;
-    ExprNode*     expr_node;
-    char*         string;
-    char*         identifier;
-    int           value_type;
-};
-
-struct ConstantNode {
-    int   const_type;
-    int   integer_constant;
-    int   enumeration_constant;
-    char* character_constant;  
-}; 
-
-struct ExprNode {
-    AssignExprNode* assign_expr_node;
-    ExprNode*       expr_node;
-};
-
-struct AssignExprNode {
-    ConditionalExprNode* conditional_expr_node;
-    UnaryExprNode*       unary_expr_node;
-    AssignExprNode*      assign_expr_node;
-    int                  assign_operator;
+//
+// Expressions are stored column-wise: expression i is element i of every
+// column, and an expression refers to its operands by index (0 = none).
+// The arguments of a call are a contiguous range of edges; the type name
+// of a sizeof is an element of type_name_nodes. Which columns are used
+// depends on the kind.
+//
+struct ExprPool {
+    IntVector* kinds;
+    IntVector* ops;
+    IntVector* vals;
+    IntVector* lhs;
+    IntVector* rhs;
+    IntVector* mid;
+    IntVector* edges; // call arguments
+    Vector*    type_name_nodes;
 };
 
 struct TypeNameNode {
@@ -346,12 +256,12 @@ struct ParamDeclarationNode {
 };
 
 struct EnumSpecifierNode {
-    char*               identifier;
+    int                 identifier;
     EnumeratorListNode* enumerator_list_node;
 };
 
 struct EnumeratorListNode {
-    Vector* identifiers;
+    IntVector* identifiers;
 };
 
 struct DeclarationNode {
@@ -365,7 +275,7 @@ struct InitDeclaratorNode {
 };
 
 struct InitializerNode {
-    AssignExprNode*      assign_expr_node;
+    int                  assign_expr;
     InitializerListNode* initializer_list_node;
 };
 
@@ -392,18 +302,18 @@ struct StmtNode {
 };
 
 struct LabeledStmtNode {
-    int                  labeled_stmt_type;
-    ConditionalExprNode* conditional_expr_node;
-    StmtNode*            stmt_node;
+    int       labeled_stmt_type;
+    int       conditional_expr;
+    StmtNode* stmt_node;
 };
 
 struct ExprStmtNode {
-    ExprNode* expr_node;  
+    int expr;
 };
 
 struct SelectionStmtNode {
     int       selection_type;
-    ExprNode* expr_node;
+    int       expr;
     StmtNode* stmt_node_0;
     StmtNode* stmt_node_1;
 };
@@ -411,23 +321,60 @@ struct SelectionStmtNode {
 struct ItrStmtNode {
     int        itr_type;
     StmtNode*  stmt_node;
-    ExprNode*  expr_node_0;
-    ExprNode*  expr_node_1;
-    ExprNode*  expr_node_2;
+    int        expr_0;
+    int        expr_1;
+    int        expr_2;
     Vector*    declaration_nodes;
 };
 
 struct JumpStmtNode {
     int       jump_type;
-    char*     identifier;
-    ExprNode* expr_node;
+    int       identifier;
+    int       expr;
 };
 
 //
 // parse
 //
 
-TransUnitNode* parse(const Vector* vec);
+TransUnitNode* parse(const Vector* vec, Arena* arena);
+CompoundStmtNode* parse_func_body(FuncDefNode* node);
+// Parses every reachable body up front, on jobs threads (0: one per core)
+// when built with MINIC_THREADS.
+bool parse_func_bodies(TransUnitNode* node, int jobs);
+
+// Incremental parsing: parse_external_decl() parses vec, the tokens of one
+// external declaration followed by one token that ends it, into a unit of
+// its own with the function body parsed, or with no external declaration
+// if the tokens do not parse. The typedef-names declared by earlier calls
+// stay known until reset_typedef_names() or parse().
+TransUnitNode* parse_external_decl(const Vector* vec, Arena* arena);
+void reset_typedef_names();
+int count_func_defs(const TransUnitNode* node, bool parsed_only);
+// The pools holding the expressions of node: its own, followed by those of
+// the bodies parse_func_bodies() parsed on other threads.
+Vector* get_expr_pools(const TransUnitNode* node);
+
+//
+// expression
+//
+
+int expr_kind(const ExprPool* pool, int expr);
+int expr_op(const ExprPool* pool, int expr);
+int expr_val(const ExprPool* pool, int expr);
+int expr_lhs(const ExprPool* pool, int expr);
+int expr_rhs(const ExprPool* pool, int expr);
+int expr_mid(const ExprPool* pool, int expr);
+int expr_arg_count(const ExprPool* pool, int expr);
+int expr_arg(const ExprPool* pool, int expr, int i);
+TypeNameNode* expr_type_name(const ExprPool* pool, int expr);
+
+// bytes held by the pool, and what one node per expression would take
+int expr_pool_bytes(const ExprPool* pool);
+int expr_pointer_layout_bytes(const ExprPool* pool);
+
+// frees the columns; the pool itself is in the arena of its nodes
+void free_expr_pool(ExprPool* pool);
 
 //
 // debug
@@ -441,8 +388,7 @@ const char* decode_operator_type(int operator_type);
 const char* decode_comparison_operator_type(int type);
 const char* decode_const_type(int type);
 const char* decode_jump_type(int type);
-const char* decode_unary_type(int type);
-const char* decode_postfix_type(int type);
+const char* decode_expr_kind(int kind);
 const char* decode_param_list_type(int type);
 const char* decode_selection_stmt_type(int type);
 const char* decode_itr_type(int type);
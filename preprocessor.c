@@ -1,16 +1,143 @@
 #include "preprocessor.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "util.h"
 
-static StrPtrMap* define_map;
+static HashMap* define_map;
+
+// symbols of the directive names
+static int sym_define;
+static int sym_include;
+static int sym_ifdef;
+static int sym_ifndef;
+static int sym_else;
+static int sym_endif;
+static int sym_pragma;
+static int sym_once;
+
+//
+// Include cache
+//
+// Every header is read and tokenized once per compilation. A header whose
+// whole content is wrapped in "#ifndef X ... #endif" is not preprocessed
+// again once X is defined, and a header with "#pragma once" is never
+// preprocessed again.
+//
+
+typedef struct IncludeFile IncludeFile;
+struct IncludeFile {
+    Vector* tokens;
+    int     guard;  // symbol of the include-guard macro, 0 if none
+    bool    once;   // has "#pragma once"
+    bool    included;
+};
+
+static HashMap* include_path_map;  // canonical path => IncludeFile
+static HashMap* include_name_map;  // spelling in #include "..." => IncludeFile
+
+// true if the token at index is on the line of the directive
+static bool has_directive_value(const Vector* in_vec, int index, const Token* directive) {
+    if (index >= in_vec->size) {
+        return false;
+    }
+
+    const Token* token = in_vec->elements[index];
+    return (token->pos < directive->pos + directive->len);
+}
+
+static bool is_directive(const Token* token, int name) {
+    return (token->type == TK_HASH && token->val == name);
+}
+
+// Returns the guard macro if the tokens are "#ifndef X ... #endif" with no
+// other conditional directive in between, otherwise 0.
+static int find_include_guard(const Vector* tokens) {
+    if (tokens->size < 3) {
+        return 0;
+    }
+
+    const Token* first = tokens->elements[0];
+    const Token* guard = tokens->elements[1];
+    const Token* last  = tokens->elements[tokens->size - 1];
+    if (!is_directive(first, sym_ifndef) || guard->type != TK_IDENT || !is_directive(last, sym_endif)) {
+        return 0;
+    }
+
+    for (int i = 2; i < tokens->size - 1; ++i) {
+        const Token* token = tokens->elements[i];
+        if (token->type != TK_HASH) {
+            continue;
+        }
+        if (token->val == sym_ifdef || token->val == sym_ifndef || token->val == sym_else || token->val == sym_endif) {
+            return 0;
+        }
+    }
+
+    return guard->val;
+}
+
+static bool has_pragma_once(const Vector* tokens) {
+    for (int i = 0; i + 1 < tokens->size; ++i) {
+        const Token* token = tokens->elements[i];
+        const Token* next  = tokens->elements[i + 1];
+        if (is_directive(token, sym_pragma) && next->type == TK_IDENT && next->val == sym_once) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static IncludeFile* load_include_file(int name) {
+    if (hashmap_contains(include_name_map, name)) {
+        return hashmap_get(include_name_map, name);
+    }
+
+    char* canonical = realpath(symbol_name(name), NULL);
+    if (canonical == NULL) {
+        error("Failed to load file:\"%s\".\n", symbol_name(name));
+        return NULL;
+    }
+    const int path = intern(canonical, strlen(canonical));
+    free(canonical);
+
+    if (hashmap_contains(include_path_map, path)) {
+        IncludeFile* cached = hashmap_get(include_path_map, path);
+        hashmap_put(include_name_map, name, cached);
+        return cached;
+    }
+
+    char* addr = read_file(symbol_name(path));
+    if (addr == NULL) {
+        error("Failed to load file:\"%s\".\n", symbol_name(path));
+        return NULL;
+    }
+
+    Vector* tokens = tokenize(addr);
+    if (tokens == NULL) {
+        error("Failed to tokenize.\n");
+        return NULL;
+    }
+
+    IncludeFile* file = malloc(sizeof(IncludeFile));
+    file->tokens   = tokens;
+    file->guard    = find_include_guard(tokens);
+    file->once     = has_pragma_once(tokens);
+    file->included = false;
+
+    hashmap_put(include_path_map, path, file);
+    hashmap_put(include_name_map, name, file);
+
+    return file;
+}
 
 static int enabled_read(const Vector* in_vec, int* index, Vector* out_vec) {
     Token* token = in_vec->elements[*index];
     if (token->type != TK_HASH) {
-        if (token->type == TK_IDENT && strptrmap_contains(define_map, token->str)) {
-            Token* value1 = strptrmap_get(define_map, token->str);
+        if (token->type == TK_IDENT && hashmap_contains(define_map, token->val)) {
+            Token* value1 = hashmap_get(define_map, token->val);
             if (value1 != NULL) {
                 vector_push_back(out_vec, value1);
             }
@@ -28,27 +155,27 @@ static int enabled_read(const Vector* in_vec, int* index, Vector* out_vec) {
         //
         // #define
         //
-        if (strncmp("define", token->str, 6) == 0) {
+        if (token->val == sym_define) {
             ++(*index);
             const Token* name = in_vec->elements[*index];
             ++(*index);
 
-            if (token->has_value) {
+            if (has_directive_value(in_vec, *index, token)) {
                 Token* value2 = in_vec->elements[*index];
-                strptrmap_put(define_map, name->str, value2);
+                hashmap_put(define_map, name->val, value2);
                 ++(*index);
 
                 return STATE_ENABLED;
             }
             else  {
-                strptrmap_put(define_map, name->str, NULL);
+                hashmap_put(define_map, name->val, NULL);
                 return STATE_ENABLED;
             }
         }
         //
         // #include
         //
-        else if (strncmp("include", token->str, 7) == 0) { 
+        else if (token->val == sym_include) { 
             ++(*index);
 
             token = in_vec->elements[*index];
@@ -63,19 +190,21 @@ static int enabled_read(const Vector* in_vec, int* index, Vector* out_vec) {
                 return STATE_ENABLED; 
             } 
             else if (token->type == TK_STR) {
-                char* addr = read_file(token->str);
-                if (addr == NULL) {
-                    error("Failed to load file:\"%s\".\n", token->str); 
+                IncludeFile* file = load_include_file(token->val);
+                if (file == NULL) {
                     return STATE_INVALID;
                 }
+                ++(*index);
 
-                const Vector* include_vec = tokenize(addr);
-                if (include_vec == NULL) {
-                    error("Failed to tokenize.\n");
-                    return STATE_INVALID;
+                if (file->guard != 0 && hashmap_contains(define_map, file->guard)) {
+                    return STATE_ENABLED;
+                }
+                if (file->once && file->included) {
+                    return STATE_ENABLED;
                 }
+                file->included = true;
 
-                const Vector* include_processed_vec = preprocess(include_vec);
+                const Vector* include_processed_vec = preprocess(file->tokens);
                 if (include_processed_vec == NULL) {
                     error("Failed to preprocess.\n");
                     return STATE_INVALID;
@@ -84,8 +213,6 @@ static int enabled_read(const Vector* in_vec, int* index, Vector* out_vec) {
                 for (int i = 0; i < include_processed_vec->size; ++i) {
                     vector_push_back(out_vec, include_processed_vec->elements[i]);
                 }
-
-                ++(*index);
             }
             else {
                 error("Invalid token[%d]=\"%s\".\n", index, decode_token_type(token->type));
@@ -97,7 +224,7 @@ static int enabled_read(const Vector* in_vec, int* index, Vector* out_vec) {
         //
         // #ifdef
         //
-        else if (strncmp("ifdef", token->str, 5) == 0) {
+        else if (token->val == sym_ifdef) {
             ++(*index);
 
             token = in_vec->elements[*index];
@@ -107,7 +234,7 @@ static int enabled_read(const Vector* in_vec, int* index, Vector* out_vec) {
             }
             ++(*index);
 
-            if (strptrmap_contains(define_map, token->str)) {
+            if (hashmap_contains(define_map, token->val)) {
                 return STATE_ENABLED;
             } else {
                 return STATE_DISABLED;
@@ -116,7 +243,7 @@ static int enabled_read(const Vector* in_vec, int* index, Vector* out_vec) {
         //
         // #ifndef
         //
-        else if (strncmp("ifndef", token->str, 6) == 0) {
+        else if (token->val == sym_ifndef) {
             ++(*index);
 
             token = in_vec->elements[*index];
@@ -126,23 +253,33 @@ static int enabled_read(const Vector* in_vec, int* index, Vector* out_vec) {
             }
             ++(*index);
 
-            if (strptrmap_contains(define_map, token->str)) {
+            if (hashmap_contains(define_map, token->val)) {
                 return STATE_DISABLED;
             } else {
                 return STATE_ENABLED;
             }
         }
         //
+        // #pragma
+        //
+        else if (token->val == sym_pragma) {
+            ++(*index);
+            while (has_directive_value(in_vec, *index, token)) {
+                ++(*index);
+            }
+            return STATE_ENABLED;
+        }
+        //
         // #else
         //
-        else if (strncmp("else", token->str, 4) == 0) {
+        else if (token->val == sym_else) {
             ++(*index);
             return STATE_DISABLED; 
         }
         //
         // #endif
         //
-        else if (strncmp("endif", token->str, 5) == 0) {
+        else if (token->val == sym_endif) {
             ++(*index);
             return STATE_ENABLED;
         }
@@ -161,21 +298,36 @@ static int disabled_read(const Vector* in_vec, int* index, Vector* out_vec) {
     if (token->type != TK_HASH) {
         return STATE_DISABLED;
     }
-    else if (strncmp("else", token->str, 4) == 0) {
+    else if (token->val == sym_else) {
         return STATE_ENABLED; 
     }
-    else if (strncmp("endif", token->str, 5) == 0) {
+    else if (token->val == sym_endif) {
         return STATE_ENABLED;
     } else {
         return STATE_DISABLED;
     }
 }
 
-Vector* preprocess(const Vector* in_vec) {
-    Vector* out_vec = create_vector();
+static void init_preprocessor() {
     if (define_map == NULL) {
-        define_map = create_strptrmap(32);
+        define_map  = create_hashmap(32);
+        sym_define  = intern("define", 6);
+        sym_include = intern("include", 7);
+        sym_ifdef   = intern("ifdef", 5);
+        sym_ifndef  = intern("ifndef", 6);
+        sym_else    = intern("else", 4);
+        sym_endif   = intern("endif", 5);
+        sym_pragma  = intern("pragma", 6);
+        sym_once    = intern("once", 4);
+
+        include_path_map = create_hashmap(16);
+        include_name_map = create_hashmap(16);
     }
+}
+
+Vector* preprocess(const Vector* in_vec) {
+    Vector* out_vec = create_vector();
+    init_preprocessor();
 
     int state = STATE_ENABLED;
     int index = 0;
@@ -207,3 +359,189 @@ Vector* preprocess(const Vector* in_vec) {
 
     return out_vec;
 }
+
+//
+// Precompiled header
+//
+// A PCH holds the preprocessed tokens of a header and the macros defined at
+// its end. Symbol ids are private to a compilation, so the spellings are
+// stored as well and interned again when the PCH is read. Everything is a
+// ByteBuffer integer:
+//
+//   "MPCH" version
+//   symbol count  {len bytes}*       ids 1 .. count in order
+//   token count   {type val pos len}*
+//   define count  {name 0}* or {name 1 type val pos len}* for a macro with a value
+//   checksum                         of every byte before it
+//
+// pos and len locate a token in the header, as for an #include.
+//
+
+#define PCH_VERSION 3
+
+// A polynomial hash of the bytes. The modulus is below 2^24, so that no
+// step overflows a 32-bit int.
+static int pch_checksum(const char* data, int size) {
+    int sum = 0;
+    for (int i = 0; i < size; ++i) {
+        int byte = data[i];
+        if (byte < 0) {
+            byte += 256;
+        }
+        sum = (sum * 31 + byte) % 16777213;
+    }
+
+    return sum;
+}
+
+// true if the val of a token of the type is a symbol id
+static bool has_symbol_val(int type) {
+    return (type == TK_IDENT || type == TK_STR || type == TK_HASH);
+}
+
+static void put_pch_token(ByteBuffer* buf, const Token* token) {
+    bytebuffer_put_int(buf, token->type);
+    bytebuffer_put_int(buf, token->val);
+    bytebuffer_put_int(buf, token->pos);
+    bytebuffer_put_int(buf, token->len);
+}
+
+// A token that cannot have been written sets overrun, like reading past
+// the end: a type that is no TK_*, or a symbol id not in the file.
+static Token* get_pch_token(ByteBuffer* buf, const IntVector* symbols) {
+    Token* token = calloc(1, sizeof(Token));
+    token->type  = bytebuffer_get_int(buf);
+    token->val   = bytebuffer_get_int(buf);
+    token->pos   = bytebuffer_get_int(buf);
+    token->len   = bytebuffer_get_int(buf);
+    if (token->type < TK_NUM || token->type > TK_ELLIPSIS) {
+        buf->overrun = true;
+        return token;
+    }
+    if (has_symbol_val(token->type)) {
+        if (token->val <= 0 || token->val >= symbols->size) {
+            buf->overrun = true;
+            return token;
+        }
+        token->val = symbols->elements[token->val];
+    }
+
+    return token;
+}
+
+bool write_pch(const Vector* processed_vec, int fd) {
+    init_preprocessor();
+
+    ByteBuffer* buf = create_bytebuffer();
+    bytebuffer_put_bytes(buf, "MPCH", 4);
+    bytebuffer_put_int(buf, PCH_VERSION);
+
+    bytebuffer_put_int(buf, symbol_count() - 1);
+    for (int id = 1; id < symbol_count(); ++id) {
+        bytebuffer_put_int(buf, symbol_len(id));
+        bytebuffer_put_bytes(buf, symbol_name(id), symbol_len(id));
+    }
+
+    bytebuffer_put_int(buf, processed_vec->size);
+    for (int i = 0; i < processed_vec->size; ++i) {
+        put_pch_token(buf, processed_vec->elements[i]);
+    }
+
+    bytebuffer_put_int(buf, define_map->size);
+    for (int slot = 0; slot < define_map->capacity; ++slot) {
+        if (define_map->keys[slot] == 0) {
+            continue;
+        }
+
+        bytebuffer_put_int(buf, define_map->keys[slot]);
+        const Token* value = define_map->vals[slot];
+        if (value == NULL) {
+            bytebuffer_put_int(buf, 0);
+        }
+        else {
+            bytebuffer_put_int(buf, 1);
+            put_pch_token(buf, value);
+        }
+    }
+    bytebuffer_put_int(buf, pch_checksum(buf->data, buf->size));
+
+    return bytebuffer_write(buf, fd);
+}
+
+Vector* read_pch(const char* path) {
+    init_preprocessor();
+
+    int size = 0;
+    char* addr = mmap_readonly(path, &size);
+    if (addr == NULL) {
+        error("Failed to load file:\"%s\".\n", path);
+        return NULL;
+    }
+
+    ByteBuffer* buf = wrap_bytebuffer(addr, size);
+    const char* magic = bytebuffer_get_bytes(buf, 4);
+    if (magic == NULL) {
+        error("\"%s\" is not a precompiled header.\n", path);
+        return NULL;
+    }
+    if (strncmp(magic, "MPCH", 4) != 0 || bytebuffer_get_int(buf) != PCH_VERSION) {
+        error("\"%s\" is not a precompiled header of this version.\n", path);
+        return NULL;
+    }
+
+    // a corrupted file is rejected before any of it is used
+    ByteBuffer* checksum_buf = wrap_bytebuffer(addr + size - 4, 4);
+    if (bytebuffer_get_int(checksum_buf) != pch_checksum(addr, size - 4)) {
+        error("\"%s\" is broken.\n", path);
+        return NULL;
+    }
+    buf->size = size - 4;
+
+    // ids in the file => ids in this compilation
+    IntVector* symbols = create_intvector();
+    intvector_push_back(symbols, 0);
+    const int symbol_total = bytebuffer_get_int(buf);
+    for (int id = 1; id <= symbol_total; ++id) {
+        const int len = bytebuffer_get_int(buf);
+        const char* name = bytebuffer_get_bytes(buf, len);
+        if (name == NULL) {
+            break;
+        }
+        intvector_push_back(symbols, intern(name, len));
+    }
+
+    Vector* tokens = create_vector();
+    const int token_total = bytebuffer_get_int(buf);
+    for (int i = 0; i < token_total; ++i) {
+        if (buf->overrun) {
+            break;
+        }
+        vector_push_back(tokens, get_pch_token(buf, symbols));
+    }
+
+    const int define_total = bytebuffer_get_int(buf);
+    for (int j = 0; j < define_total; ++j) {
+        if (buf->overrun) {
+            break;
+        }
+
+        const int macro = bytebuffer_get_int(buf);
+        if (macro <= 0 || macro >= symbols->size) {
+            buf->overrun = true;
+            break;
+        }
+        if (bytebuffer_get_int(buf) == 0) {
+            hashmap_put(define_map, symbols->elements[macro], NULL);
+        }
+        else {
+            hashmap_put(define_map, symbols->elements[macro], get_pch_token(buf, symbols));
+        }
+    }
+
+    if (buf->overrun) {
+        error("\"%s\" is truncated or broken.\n", path);
+        return NULL;
+    }
+
+    return tokens;
+}
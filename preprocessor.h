@@ -11,4 +11,10 @@ enum State {
 
 Vector* preprocess(const Vector* vec);
 
+// Precompiled headers: write_pch() saves the preprocessed tokens of a header
+// and the macros defined so far; read_pch() defines the macros again and
+// returns the tokens.
+bool write_pch(const Vector* processed_vec, int fd);
+Vector* read_pch(const char* path);
+
 #endif
@@ -0,0 +1,393 @@
+#include "regalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ir.h"
+#include "util.h"
+
+// the largest magnitude of an immediate operand
+#define IMMEDIATE_LIMIT 2147483647
+
+//
+// liveness
+//
+// The registers live at the start of each block are found by iterating
+// over the blocks backward until nothing changes. A phi operand is live at
+// the end of its predecessor only, and a phi is defined at the start of its
+// block, as are the parameters.
+//
+
+static const IrFunc* ra_func;
+static IntVector*    ra_skipped;  // by register, 1 for a constant used as an immediate
+static Vector*       ra_live_ins; // by block id, the registers live at its start
+static IntVector*    ra_marks;    // by register, ra_stamp while in the set being built
+static int           ra_stamp;
+static IntVector*    ra_starts;   // by register, the first position of its interval, -1 if none
+static IntVector*    ra_ends;     // and the last one
+
+bool is_ir_immediate(int value) {
+    return value <= IMMEDIATE_LIMIT && value >= -IMMEDIATE_LIMIT;
+}
+
+static void add_live(IntVector* set, int reg) {
+    if (reg == 0 || ra_skipped->elements[reg] != 0 || ra_marks->elements[reg] == ra_stamp) {
+        return;
+    }
+    ra_marks->elements[reg] = ra_stamp;
+    intvector_push_back(set, reg);
+}
+
+static void add_uses(IntVector* set, const IrInst* inst) {
+    add_live(set, inst->a);
+    add_live(set, inst->b);
+    if (inst->args != NULL) {
+        for (int i = 0; i < inst->args->size; ++i) {
+            add_live(set, inst->args->elements[i]);
+        }
+    }
+}
+
+// the registers live at the end of block, with ra_marks set for them
+static IntVector* collect_live_out(const IrBlock* block) {
+    ++ra_stamp;
+    IntVector* live = create_intvector();
+    for (int i = 0; i < block->succs->size; ++i) {
+        const IrBlock* succ = block->succs->elements[i];
+        for (int j = 0; j < succ->preds->size; ++j) {
+            if (succ->preds->elements[j] != block) {
+                continue;
+            }
+            for (int k = 0; k < succ->phis->size; ++k) {
+                const IrInst* phi = succ->phis->elements[k];
+                add_live(live, phi->args->elements[j]);
+            }
+        }
+
+        const IntVector* succ_live_in = ra_live_ins->elements[succ->id];
+        for (int l = 0; l < succ_live_in->size; ++l) {
+            add_live(live, succ_live_in->elements[l]);
+        }
+    }
+    return live;
+}
+
+// returns true if the registers live at the start of block changed
+static bool update_live_in(const IrBlock* block) {
+    IntVector* live = collect_live_out(block);
+    for (int i = block->insts->size - 1; i >= 0; --i) {
+        const IrInst* inst = block->insts->elements[i];
+        if (inst->dst != 0) {
+            ra_marks->elements[inst->dst] = 0;
+        }
+        add_uses(live, inst);
+    }
+    for (int j = 0; j < block->phis->size; ++j) {
+        const IrInst* phi = block->phis->elements[j];
+        ra_marks->elements[phi->dst] = 0;
+    }
+
+    // a register removed and added again is in the list twice
+    IntVector* live_in = create_intvector();
+    for (int k = 0; k < live->size; ++k) {
+        const int reg = live->elements[k];
+        if (ra_marks->elements[reg] == ra_stamp) {
+            ra_marks->elements[reg] = 0;
+            intvector_push_back(live_in, reg);
+        }
+    }
+    free(live->elements);
+    free(live);
+
+    IntVector* old_live_in = ra_live_ins->elements[block->id];
+    const bool changed = (live_in->size != old_live_in->size);
+    free(old_live_in->elements);
+    free(old_live_in);
+    ra_live_ins->elements[block->id] = live_in;
+    return changed;
+}
+
+static void compute_liveness() {
+    ra_live_ins = create_vector();
+    for (int i = 0; i < ra_func->blocks->size; ++i) {
+        vector_push_back(ra_live_ins, create_intvector());
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int j = ra_func->blocks->size - 1; j >= 0; --j) {
+            if (update_live_in(ra_func->blocks->elements[j])) {
+                changed = true;
+            }
+        }
+    }
+}
+
+//
+// intervals
+//
+// Positions number the start of each block, then each of its instructions,
+// in the block layout.
+//
+
+static void extend_interval(int reg, int position) {
+    if (reg == 0 || ra_skipped->elements[reg] != 0) {
+        return;
+    }
+    if (ra_starts->elements[reg] < 0 || position < ra_starts->elements[reg]) {
+        ra_starts->elements[reg] = position;
+    }
+    if (position > ra_ends->elements[reg]) {
+        ra_ends->elements[reg] = position;
+    }
+}
+
+// Sets ra_starts and ra_ends. Returns the number of calls before each
+// position, and one more for the end.
+static IntVector* build_intervals() {
+    IntVector* calls_before = create_intvector();
+    int calls = 0;
+    int position = 0;
+    for (int i = 0; i < ra_func->blocks->size; ++i) {
+        const IrBlock* block = ra_func->blocks->elements[i];
+        const int block_start = position;
+        intvector_push_back(calls_before, calls);
+        ++position;
+
+        const IntVector* live_in = ra_live_ins->elements[i];
+        for (int j = 0; j < live_in->size; ++j) {
+            extend_interval(live_in->elements[j], block_start);
+        }
+        for (int k = 0; k < block->phis->size; ++k) {
+            const IrInst* phi = block->phis->elements[k];
+            extend_interval(phi->dst, block_start);
+        }
+
+        for (int l = 0; l < block->insts->size; ++l) {
+            const IrInst* inst = block->insts->elements[l];
+            intvector_push_back(calls_before, calls);
+            if (inst->op == IR_PARAM) {
+                extend_interval(inst->dst, block_start);
+            }
+            else {
+                extend_interval(inst->dst, position);
+            }
+            extend_interval(inst->a, position);
+            extend_interval(inst->b, position);
+            if (inst->args != NULL) {
+                for (int m = 0; m < inst->args->size; ++m) {
+                    extend_interval(inst->args->elements[m], position);
+                }
+            }
+            if (inst->op == IR_CALL) {
+                ++calls;
+            }
+            ++position;
+        }
+
+        IntVector* live_out = collect_live_out(block);
+        for (int n = 0; n < live_out->size; ++n) {
+            extend_interval(live_out->elements[n], position - 1);
+        }
+        free(live_out->elements);
+        free(live_out);
+    }
+    intvector_push_back(calls_before, calls);
+    return calls_before;
+}
+
+// the registers with an interval, by its start
+static IntVector* sort_intervals(int position_count) {
+    IntVector* heads = create_intvector();
+    for (int i = 0; i < position_count; ++i) {
+        intvector_push_back(heads, 0);
+    }
+    IntVector* nexts = create_intvector();
+    for (int j = 0; j <= ra_func->reg_count; ++j) {
+        intvector_push_back(nexts, 0);
+    }
+    for (int reg = ra_func->reg_count; reg >= 1; --reg) {
+        const int start = ra_starts->elements[reg];
+        if (start >= 0) {
+            nexts->elements[reg] = heads->elements[start];
+            heads->elements[start] = reg;
+        }
+    }
+
+    IntVector* order = create_intvector();
+    for (int k = 0; k < position_count; ++k) {
+        for (int listed = heads->elements[k]; listed != 0; listed = nexts->elements[listed]) {
+            intvector_push_back(order, listed);
+        }
+    }
+    free(heads->elements);
+    free(heads);
+    free(nexts->elements);
+    free(nexts);
+    return order;
+}
+
+//
+// allocation
+//
+
+static int pick_free_reg(const IntVector* free_regs, int first, int last) {
+    for (int reg = first; reg <= last; ++reg) {
+        if (free_regs->elements[reg] != 0) {
+            return reg;
+        }
+    }
+    return 0;
+}
+
+static void spill_interval(RegAlloc* alloc, int reg) {
+    ++alloc->spill_count;
+    alloc->locations->elements[reg] = -alloc->spill_count;
+}
+
+static void assign_interval(RegAlloc* alloc, IntVector* active, int reg, int machine_reg) {
+    alloc->locations->elements[reg] = machine_reg;
+    alloc->used->elements[machine_reg] = 1;
+    intvector_push_back(active, reg);
+}
+
+static void scan_intervals(RegAlloc* alloc, const IntVector* order, const IntVector* calls_before) {
+    IntVector* free_regs = create_intvector();
+    for (int i = 0; i <= REGALLOC_REGS; ++i) {
+        intvector_push_back(free_regs, 1);
+    }
+    IntVector* active = create_intvector();
+
+    for (int j = 0; j < order->size; ++j) {
+        const int reg   = order->elements[j];
+        const int start = ra_starts->elements[reg];
+        const int end   = ra_ends->elements[reg];
+
+        int kept = 0;
+        for (int k = 0; k < active->size; ++k) {
+            const int other = active->elements[k];
+            if (ra_ends->elements[other] < start) {
+                free_regs->elements[alloc->locations->elements[other]] = 1;
+                continue;
+            }
+            active->elements[kept] = other;
+            ++kept;
+        }
+        active->size = kept;
+
+        bool across_call = false;
+        if (end > start + 1 && calls_before->elements[end] > calls_before->elements[start + 1]) {
+            across_call = true;
+        }
+
+        int machine_reg = 0;
+        if (!across_call) {
+            machine_reg = pick_free_reg(free_regs, 1, REGALLOC_CALLER_SAVED);
+        }
+        if (machine_reg == 0) {
+            machine_reg = pick_free_reg(free_regs, REGALLOC_CALLER_SAVED + 1, REGALLOC_REGS);
+        }
+        if (machine_reg != 0) {
+            free_regs->elements[machine_reg] = 0;
+            assign_interval(alloc, active, reg, machine_reg);
+            continue;
+        }
+
+        // the active interval that ends last, in a register reg may take
+        int victim_index = -1;
+        int victim_end   = end;
+        for (int l = 0; l < active->size; ++l) {
+            const int candidate = active->elements[l];
+            const bool usable = !across_call || alloc->locations->elements[candidate] > REGALLOC_CALLER_SAVED;
+            if (usable && ra_ends->elements[candidate] > victim_end) {
+                victim_index = l;
+                victim_end   = ra_ends->elements[candidate];
+            }
+        }
+        if (victim_index < 0) {
+            spill_interval(alloc, reg);
+            continue;
+        }
+
+        const int victim = active->elements[victim_index];
+        machine_reg = alloc->locations->elements[victim];
+        spill_interval(alloc, victim);
+        active->elements[victim_index] = active->elements[active->size - 1];
+        --active->size;
+        assign_interval(alloc, active, reg, machine_reg);
+    }
+
+    free(free_regs->elements);
+    free(free_regs);
+    free(active->elements);
+    free(active);
+}
+
+RegAlloc* allocate_ir_registers(const IrFunc* func) {
+    ra_func    = func;
+    ra_stamp   = 0;
+    ra_skipped = create_intvector();
+    ra_marks   = create_intvector();
+    ra_starts  = create_intvector();
+    ra_ends    = create_intvector();
+    for (int i = 0; i <= func->reg_count; ++i) {
+        intvector_push_back(ra_skipped, 0);
+        intvector_push_back(ra_marks, 0);
+        intvector_push_back(ra_starts, -1);
+        intvector_push_back(ra_ends, -1);
+    }
+    for (int j = 0; j < func->blocks->size; ++j) {
+        const IrBlock* block = func->blocks->elements[j];
+        for (int k = 0; k < block->insts->size; ++k) {
+            const IrInst* inst = block->insts->elements[k];
+            if (inst->op == IR_CONST && is_ir_immediate(inst->imm)) {
+                ra_skipped->elements[inst->dst] = 1;
+            }
+        }
+    }
+
+    compute_liveness();
+    IntVector* calls_before = build_intervals();
+    IntVector* order = sort_intervals(calls_before->size);
+
+    RegAlloc* alloc = calloc(1, sizeof(RegAlloc));
+    alloc->locations = create_intvector();
+    for (int l = 0; l <= func->reg_count; ++l) {
+        intvector_push_back(alloc->locations, 0);
+    }
+    alloc->used = create_intvector();
+    for (int m = 0; m <= REGALLOC_REGS; ++m) {
+        intvector_push_back(alloc->used, 0);
+    }
+    scan_intervals(alloc, order, calls_before);
+
+    for (int n = 0; n < ra_live_ins->size; ++n) {
+        IntVector* live_in = ra_live_ins->elements[n];
+        free(live_in->elements);
+        free(live_in);
+    }
+    free(ra_live_ins->elements);
+    free(ra_live_ins);
+    free(ra_skipped->elements);
+    free(ra_skipped);
+    free(ra_marks->elements);
+    free(ra_marks);
+    free(ra_starts->elements);
+    free(ra_starts);
+    free(ra_ends->elements);
+    free(ra_ends);
+    free(calls_before->elements);
+    free(calls_before);
+    free(order->elements);
+    free(order);
+    return alloc;
+}
+
+void free_reg_alloc(RegAlloc* alloc) {
+    free(alloc->locations->elements);
+    free(alloc->locations);
+    free(alloc->used->elements);
+    free(alloc->used);
+    free(alloc);
+}
@@ -0,0 +1,39 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "ir.h"
+#include "util.h"
+
+//
+// Linear scan register allocation over the IR of a function (see ir.h),
+// after Poletto and Sarkar: each register gets one live interval, from its
+// first to its last position live in the block layout, and the intervals
+// are given machine registers in the order they start. When none is free,
+// the interval that ends last is spilled to a stack slot.
+//
+// The machine registers are numbered from 1: those a call may clobber
+// first, then those it preserves. An interval across a call only gets one
+// of the latter. The generator names them (see generator.c).
+//
+
+#define REGALLOC_CALLER_SAVED 6
+#define REGALLOC_CALLEE_SAVED 5
+#define REGALLOC_REGS         11
+
+typedef struct RegAlloc RegAlloc;
+
+struct RegAlloc {
+    IntVector* locations;   // by register: a machine register from 1, -s for spill slot s from 1,
+                            // or 0 for a constant used as an immediate (or a register never defined)
+    IntVector* used;        // by machine register, 1 if an interval got it
+    int        spill_count;
+};
+
+RegAlloc* allocate_ir_registers(const IrFunc* func);
+void free_reg_alloc(RegAlloc* alloc);
+
+// true if the constant is used where it is needed rather than held in a
+// register: it fits in the 32 bits of an instruction operand
+bool is_ir_immediate(int value);
+
+#endif
@@ -11,5 +11,9 @@
 #define stderr 2
 #define SEEK_SET 0
 #define SEEK_END 2
+#define PROT_READ 1
+#define MAP_PRIVATE 2
+#define MADV_SEQUENTIAL 2
+#define off_t int
 
 #endif
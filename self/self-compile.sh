@@ -41,12 +41,12 @@ if [[ -f ./self/all.c ]]; then
     rm ./self/all.c
 fi
 
-for file in ./self/def.h util.c tokenizer.c preprocessor.c parser.c generator.c minic.c
+for file in ./self/def.h util.c tokenizer.c preprocessor.c parser.c generator.c ir.c opt.c regalloc.c assembler.c server.c minic.c
 do
     cat ${file} >> ./self/all.c
 done
 
-./minic "./self/all.c" > ./self/self.s
+./minic -o ./self/self.s "./self/all.c"
 gcc -no-pie -o ./self/selfminic ./self/self.s
 
 echo -e "\e[36mCompile completed.\e[0m"
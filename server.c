@@ -0,0 +1,1575 @@
+#include "server.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tokenizer.h"
+#include "parser.h"
+#include "util.h"
+
+//
+// Protocol
+//
+// One request per line and one response per line, both JSON objects:
+//
+//   {"id":1,"method":"open","path":"a.c"}        read a.c, or take "text" as its content
+//   {"id":2,"method":"change","path":"a.c","offset":8,"length":2,"text":"x"}
+//                                                replace length bytes at offset by text
+//   {"id":3,"method":"symbols","path":"a.c"}     the top-level declarations
+//   {"id":4,"method":"diagnostics","path":"a.c"} the declarations that do not parse
+//   {"id":5,"method":"definition","path":"a.c","offset":30}
+//                                                the declaration of the identifier at offset
+//   {"id":6,"method":"close","path":"a.c"}
+//   {"id":7,"method":"shutdown"}
+//
+// The response is {"id":N,"result":...} or {"id":N,"error":"..."}. Offsets
+// are in bytes and lines count from 1. open and change answer with the
+// counts of tokens, declarations and errors, and change also with how many
+// tokens were lexed and declarations parsed for it.
+//
+// Files are not preprocessed: object-like macros are expanded and the
+// typedef-names of the headers of #include "..." are known, but both
+// branches of an #ifdef are parsed.
+//
+
+#define DECL_ARENA_CHUNK_SIZE 4096
+#define DOC_TOKEN_CHUNK_SIZE 16384
+#define MACRO_ARENA_CHUNK_SIZE 4096
+// tokens an edit may leave unused in a document beyond as many as it has
+// before they are moved to a new arena (see compact_tokens())
+#define TOKEN_GARBAGE_SLACK 4096
+// what the standard headers, which are not read, define for the code minic compiles
+#define BUILTIN_MACROS "#define bool int\n#define true 1\n#define false 0\n#define NULL 0\n#define FILE void\n"
+
+#define READ_BUFFER_SIZE 65536
+
+enum DeclKind {
+    DECL_DIRECTIVE,
+    DECL_MACRO,     // #define
+    DECL_FUNCTION,
+    DECL_PROTOTYPE,
+    DECL_VARIABLE,
+    DECL_TYPEDEF,
+    DECL_STRUCT,
+    DECL_ENUM,
+};
+
+//
+// A document keeps its text, its tokens and its external declarations,
+// each a range of the tokens with an AST of its own. An edit re-lexes from
+// the declaration it begins in up to the first declaration that starts
+// after it, or further if a comment or token now runs past that point, and
+// parses only the declarations that the new tokens make up. An edit that
+// touches a typedef or a directive parses every document again, since it
+// can change how any declaration parses.
+//
+// The tokens of a document are allocated in an arena of its own, which is
+// released when the whole text is lexed again or the document is closed,
+// and replaced by a copy of the tokens in use once those that edits
+// replaced outnumber them. The AST of a declaration lives in its arena.
+//
+
+typedef struct Decl Decl;
+struct Decl {
+    int            begin; // index of the first token
+    int            end;   // index past the last token
+    int            kind;  // DeclKind
+    int            name;  // symbol declared, 0 if none
+    bool           valid; // parsed without error, always true for directives
+    Arena*         arena; // holds node
+    TransUnitNode* node;
+};
+
+typedef struct Document Document;
+struct Document {
+    int     path;      // symbol of the path it was opened or included with
+    char*   text;      // NUL-terminated
+    int     size;
+    int     capacity;
+    Vector* tokens;    // NULL if the text does not tokenize
+    Arena*  token_arena; // holds tokens, and those that edits replaced since it was made
+    Vector* decls;     // in source order, covering every token
+    bool    is_header;
+};
+
+typedef struct Request Request;
+struct Request {
+    int   id;
+    int   method;   // symbol, 0 if absent
+    int   path;      // symbol, 0 if absent or not interned
+    char* path_name; // NULL if absent
+    int   path_len;
+    int   offset;
+    int   length;
+    char* text;     // NULL if absent
+    int   text_len;
+};
+
+static HashMap* document_map;  // path => Document, NULL once closed
+static Vector*  document_list; // open documents, in the order opened
+static Vector*  header_list;   // headers, each after the headers it includes
+static HashMap* macro_map;     // name => tokens of an object-like macro
+static Arena*   macro_arena;   // holds copies of those tokens, which outlive the edits of their document
+static Token*   end_token;     // ends the tokens given to parse_external_decl()
+
+// what the last change cost
+static int relexed_count;
+static int reparsed_count;
+
+// input not yet returned by read_request_line()
+static char* input;
+static int   input_size;
+static int   input_capacity;
+static int   input_pos;
+
+// symbols of the protocol and of the directives
+static int sym_id;
+static int sym_method;
+static int sym_path;
+static int sym_offset;
+static int sym_length;
+static int sym_text;
+static int sym_open;
+static int sym_change;
+static int sym_symbols;
+static int sym_diagnostics;
+static int sym_definition;
+static int sym_close;
+static int sym_shutdown;
+static int sym_define;
+static int sym_include;
+
+//
+// tokens and declarations
+//
+
+static Token* get_token(const Document* doc, int index) {
+    return doc->tokens->elements[index];
+}
+
+static Decl* get_decl(const Document* doc, int index) {
+    return doc->decls->elements[index];
+}
+
+// position of the first token of the declaration
+static int get_decl_pos(const Document* doc, int index) {
+    const Decl* decl = get_decl(doc, index);
+    const Token* token = get_token(doc, decl->begin);
+    return token->pos;
+}
+
+static bool starts_line(const Document* doc, const Token* token) {
+    if (token->pos == 0) {
+        return true;
+    }
+    return doc->text[token->pos - 1] == '\n';
+}
+
+static bool is_open_bracket(int type) {
+    return type == TK_LPAREN || type == TK_LBRCKT || type == TK_LSQUARE;
+}
+
+static bool is_close_bracket(int type) {
+    return type == TK_RPAREN || type == TK_RBRCKT || type == TK_RSQUARE;
+}
+
+// index past the tokens on the line of the directive at index
+static int skip_directive(const Document* doc, int index) {
+    const Token* directive = get_token(doc, index);
+    int next = index + 1;
+    while (next < doc->tokens->size) {
+        const Token* token = get_token(doc, next);
+        if (token->pos >= directive->pos + directive->len) {
+            break;
+        }
+        ++next;
+    }
+
+    return next;
+}
+
+//
+// Index past the external declaration or directive that begins at index.
+// A declaration ends with ';', or with '}' at depth 0 for a function. So
+// that an unfinished declaration leaves the ones after it alone, it also
+// ends before a directive at depth 0, after an unbalanced closing bracket,
+// and before a token that starts a line inside brackets, which the code
+// this serves never has.
+//
+static int find_decl_end(const Document* doc, int index) {
+    const Token* first = get_token(doc, index);
+    if (first->type == TK_HASH) {
+        return skip_directive(doc, index);
+    }
+
+    int  depth   = 0;
+    bool is_body = false; // the brackets at depth 0 are a function body
+    int  current = index;
+    while (current < doc->tokens->size) {
+        const Token* token = get_token(doc, current);
+        const int type = token->type;
+        if (type == TK_HASH) {
+            if (depth == 0) {
+                return current;
+            }
+            current = skip_directive(doc, current);
+            continue;
+        }
+        if (depth > 0 && !is_close_bracket(type) && starts_line(doc, token)) {
+            return current;
+        }
+
+        if (is_open_bracket(type)) {
+            if (depth == 0 && type == TK_LBRCKT && current > index) {
+                const Token* prev = get_token(doc, current - 1);
+                is_body = (prev->type == TK_RPAREN);
+            }
+            ++depth;
+        }
+        else if (is_close_bracket(type)) {
+            if (depth == 0) {
+                return current + 1;
+            }
+            --depth;
+            if (depth == 0 && type == TK_RBRCKT && is_body) {
+                return current + 1;
+            }
+        }
+        else if (type == TK_SEMICOL && depth == 0) {
+            return current + 1;
+        }
+        ++current;
+    }
+
+    return current;
+}
+
+// Tells what the declaration declares from its tokens alone, so that a
+// declaration that does not parse is still listed.
+static void classify_decl(const Document* doc, Decl* decl) {
+    decl->name = 0;
+
+    const Token* first = get_token(doc, decl->begin);
+    if (first->type == TK_HASH) {
+        decl->kind = DECL_DIRECTIVE;
+        if (first->val == sym_define && decl->begin + 1 < decl->end) {
+            const Token* macro = get_token(doc, decl->begin + 1);
+            if (macro->type == TK_IDENT) {
+                decl->kind = DECL_MACRO;
+                decl->name = macro->val;
+            }
+        }
+        return;
+    }
+
+    // typedef struct tag typedef-name ;
+    if (first->type == TK_TYPEDEF) {
+        decl->kind = DECL_TYPEDEF;
+        for (int i = decl->begin; i < decl->end; ++i) {
+            const Token* token = get_token(doc, i);
+            if (token->type == TK_IDENT) {
+                decl->name = token->val;
+            }
+        }
+        return;
+    }
+
+    // struct tag { ... } ;
+    if ((first->type == TK_STRUCT || first->type == TK_ENUM) && decl->begin + 2 < decl->end) {
+        const Token* tag   = get_token(doc, decl->begin + 1);
+        const Token* brace = get_token(doc, decl->begin + 2);
+        if (tag->type == TK_IDENT && brace->type == TK_LBRCKT) {
+            decl->kind = DECL_ENUM;
+            if (first->type == TK_STRUCT) {
+                decl->kind = DECL_STRUCT;
+            }
+            decl->name = tag->val;
+            return;
+        }
+    }
+
+    // the identifier before the first '(' at depth 0 names a function, and
+    // the one before '=', ';', ',' or '[' a variable
+    decl->kind = DECL_VARIABLE;
+    int depth = 0;
+    int last_ident = 0;
+    for (int j = decl->begin; j < decl->end; ++j) {
+        const Token* scanned = get_token(doc, j);
+        const int type = scanned->type;
+        if (type == TK_HASH) {
+            j = skip_directive(doc, j) - 1;
+            continue;
+        }
+
+        if (depth == 0) {
+            if (type == TK_IDENT) {
+                last_ident = scanned->val;
+            }
+            else if (type == TK_LPAREN) {
+                const Token* last = get_token(doc, decl->end - 1);
+                decl->kind = DECL_PROTOTYPE;
+                if (last->type == TK_RBRCKT) {
+                    decl->kind = DECL_FUNCTION;
+                }
+                decl->name = last_ident;
+                return;
+            }
+            else if (type == TK_ASSIGN || type == TK_SEMICOL || type == TK_COMMA || type == TK_LSQUARE) {
+                decl->name = last_ident;
+                return;
+            }
+        }
+
+        if (is_open_bracket(type)) {
+            ++depth;
+        }
+        else if (is_close_bracket(type)) {
+            --depth;
+        }
+    }
+    decl->name = last_ident;
+}
+
+static Decl* create_decl(const Document* doc, int begin, int end) {
+    Decl* decl  = calloc(1, sizeof(Decl));
+    decl->begin = begin;
+    decl->end   = end;
+    decl->valid = true;
+    classify_decl(doc, decl);
+
+    return decl;
+}
+
+// typedefs and directives change how other declarations parse
+static bool affects_others(const Decl* decl) {
+    return decl->kind == DECL_TYPEDEF || decl->kind == DECL_MACRO || decl->kind == DECL_DIRECTIVE;
+}
+
+// frees the AST, keeping the declaration
+static void release_decl_node(Decl* decl) {
+    if (decl->node != NULL) {
+        free_expr_pool(decl->node->expr_pool);
+        decl->node = NULL;
+    }
+    if (decl->arena != NULL) {
+        arena_release(decl->arena);
+        free(decl->arena);
+        decl->arena = NULL;
+    }
+}
+
+static void release_decl(Decl* decl) {
+    release_decl_node(decl);
+    free(decl);
+}
+
+static void parse_decl(const Document* doc, Decl* decl) {
+    release_decl_node(decl);
+    decl->valid = true;
+    if (decl->kind == DECL_DIRECTIVE || decl->kind == DECL_MACRO) {
+        return;
+    }
+
+    // the tokens the preprocessor would give the parser, as far as the
+    // declaration alone tells
+    Vector* vec = create_vector();
+    int index = decl->begin;
+    while (index < decl->end) {
+        Token* token = get_token(doc, index);
+        if (token->type == TK_HASH) {
+            index = skip_directive(doc, index);
+            continue;
+        }
+
+        if (token->type == TK_IDENT && hashmap_contains(macro_map, token->val)) {
+            const Vector* body = hashmap_get(macro_map, token->val);
+            for (int i = 0; i < body->size; ++i) {
+                vector_push_back(vec, body->elements[i]);
+            }
+        }
+        else {
+            vector_push_back(vec, token);
+        }
+        ++index;
+    }
+    vector_push_back(vec, end_token);
+
+    decl->arena = create_arena(DECL_ARENA_CHUNK_SIZE);
+    decl->node  = parse_external_decl(vec, decl->arena);
+    decl->valid = (decl->node->external_decl_nodes->size == 1);
+    ++reparsed_count;
+
+    free(vec->elements);
+    free(vec);
+}
+
+//
+// documents
+//
+
+static Document* create_document(int path, const char* text, int size) {
+    Document* doc  = calloc(1, sizeof(Document));
+    doc->path      = path;
+    doc->size      = size;
+    doc->capacity  = size + 1;
+    doc->text      = malloc(doc->capacity);
+    doc->decls     = create_vector();
+    memcpy(doc->text, text, size);
+    doc->text[size] = '\0';
+
+    return doc;
+}
+
+static Document* find_document(int path) {
+    if (path == 0) {
+        return NULL;
+    }
+    return hashmap_get(document_map, path);
+}
+
+static void release_decls(Document* doc) {
+    for (int i = 0; i < doc->decls->size; ++i) {
+        release_decl(get_decl(doc, i));
+    }
+    doc->decls->size = 0;
+}
+
+static void release_tokens(Document* doc) {
+    if (doc->tokens != NULL) {
+        free(doc->tokens->elements);
+        free(doc->tokens);
+        doc->tokens = NULL;
+    }
+    if (doc->token_arena != NULL) {
+        arena_release(doc->token_arena);
+        free(doc->token_arena);
+        doc->token_arena = NULL;
+    }
+}
+
+// Moves the tokens to a new arena and releases the old one, once the
+// tokens that edits replaced outnumber those in use.
+static void compact_tokens(Document* doc) {
+    if (doc->token_arena->alloc_count <= doc->tokens->size * 2 + TOKEN_GARBAGE_SLACK) {
+        return;
+    }
+
+    Arena* arena = create_arena(DOC_TOKEN_CHUNK_SIZE);
+    for (int i = 0; i < doc->tokens->size; ++i) {
+        Token* token = arena_alloc(arena, sizeof(Token));
+        memcpy(token, doc->tokens->elements[i], sizeof(Token));
+        doc->tokens->elements[i] = token;
+    }
+    arena_release(doc->token_arena);
+    free(doc->token_arena);
+    doc->token_arena = arena;
+}
+
+// tokenizes the whole text and splits it into declarations, unparsed
+static void lex_document(Document* doc) {
+    release_decls(doc);
+    release_tokens(doc);
+    doc->token_arena = create_arena(DOC_TOKEN_CHUNK_SIZE);
+    doc->tokens      = tokenize_range(doc->text, 0, -1, NULL, doc->token_arena);
+    if (doc->tokens == NULL) {
+        return;
+    }
+    relexed_count += doc->tokens->size;
+
+    int index = 0;
+    while (index < doc->tokens->size) {
+        Decl* decl = create_decl(doc, index, find_decl_end(doc, index));
+        vector_push_back(doc->decls, decl);
+        index = decl->end;
+    }
+}
+
+static void parse_document(const Document* doc) {
+    for (int i = 0; i < doc->decls->size; ++i) {
+        parse_decl(doc, get_decl(doc, i));
+    }
+}
+
+// real path of an #include "name" of the document, NULL if not found
+static char* resolve_include(const Document* doc, int name) {
+    const char* path = symbol_name(doc->path);
+    const char* slash = strrchr(path, '/');
+    if (slash == NULL) {
+        return realpath(symbol_name(name), NULL);
+    }
+
+    // relative to the directory of the document
+    const int dir_len  = slash - path + 1;
+    const int name_len = symbol_len(name);
+    char* joined = malloc(dir_len + name_len + 1);
+    memcpy(joined, path, dir_len);
+    memcpy(joined + dir_len, symbol_name(name), name_len);
+    joined[dir_len + name_len] = '\0';
+
+    char* resolved = realpath(joined, NULL);
+    free(joined);
+
+    return resolved;
+}
+
+static void load_headers(const Document* doc);
+
+static void load_header(const Document* includer, int name) {
+    char* resolved = resolve_include(includer, name);
+    if (resolved == NULL) {
+        return;
+    }
+    // interned only once it is read, as a document keeps its path
+    const int resolved_len = strlen(resolved);
+    if (find_document(find_symbol(resolved, resolved_len)) != NULL) {
+        free(resolved);
+        return;
+    }
+
+    int size = 0;
+    char* addr = read_file_copy(resolved, &size);
+    if (addr == NULL) {
+        free(resolved);
+        return;
+    }
+    const int path = intern(resolved, resolved_len);
+    free(resolved);
+
+    // listed before its includes are read, so that a cycle ends here
+    Document* header  = create_document(path, addr, size);
+    header->is_header = true;
+    free(addr);
+    hashmap_put(document_map, path, header);
+
+    lex_document(header);
+    load_headers(header);
+    vector_push_back(header_list, header);
+}
+
+static void load_headers(const Document* doc) {
+    for (int i = 0; i < doc->decls->size; ++i) {
+        const Decl* decl = get_decl(doc, i);
+        const Token* directive = get_token(doc, decl->begin);
+        if (decl->kind != DECL_DIRECTIVE || directive->val != sym_include || decl->begin + 1 >= decl->end) {
+            continue;
+        }
+
+        const Token* name = get_token(doc, decl->begin + 1);
+        if (name->type == TK_STR) {
+            load_header(doc, name->val);
+        }
+    }
+}
+
+static void define_macros(const Document* doc) {
+    for (int i = 0; i < doc->decls->size; ++i) {
+        const Decl* decl = get_decl(doc, i);
+        if (decl->kind != DECL_MACRO) {
+            continue;
+        }
+
+        // a function-like macro has '(' right after its name
+        const Token* macro = get_token(doc, decl->begin + 1);
+        if (decl->begin + 2 < decl->end) {
+            const Token* next = get_token(doc, decl->begin + 2);
+            if (next->type == TK_LPAREN && next->pos == macro->pos + macro->len) {
+                continue;
+            }
+        }
+
+        Vector* body = create_vector();
+        for (int j = decl->begin + 2; j < decl->end; ++j) {
+            Token* token = arena_alloc(macro_arena, sizeof(Token));
+            memcpy(token, get_token(doc, j), sizeof(Token));
+            vector_push_back(body, token);
+        }
+        hashmap_put(macro_map, macro->val, body);
+    }
+}
+
+// Parses every document again, headers first, after the typedef-names or
+// the macros may have changed.
+static void refresh_documents() {
+    for (int i = 0; i < document_list->size; ++i) {
+        load_headers(document_list->elements[i]);
+    }
+
+    if (macro_map != NULL) {
+        for (int j = 0; j < macro_map->capacity; ++j) {
+            Vector* body = macro_map->vals[j];
+            if (macro_map->keys[j] != 0 && body != NULL) {
+                free(body->elements);
+                free(body);
+            }
+        }
+        free(macro_map->keys);
+        free(macro_map->vals);
+        free(macro_map->nums);
+        free(macro_map);
+        arena_release(macro_arena);
+        free(macro_arena);
+    }
+    macro_map   = create_hashmap(64);
+    macro_arena = create_arena(MACRO_ARENA_CHUNK_SIZE);
+    for (int k = 0; k < header_list->size; ++k) {
+        define_macros(header_list->elements[k]);
+    }
+    for (int l = 0; l < document_list->size; ++l) {
+        define_macros(document_list->elements[l]);
+    }
+
+    reset_typedef_names();
+    for (int m = 0; m < header_list->size; ++m) {
+        parse_document(header_list->elements[m]);
+    }
+    for (int n = 0; n < document_list->size; ++n) {
+        parse_document(document_list->elements[n]);
+    }
+}
+
+static void reserve_text(Document* doc, int size) {
+    if (size + 1 > doc->capacity) {
+        doc->capacity = (size + 1) * 2;
+        doc->text     = realloc(doc->text, doc->capacity);
+    }
+}
+
+// replaces the elements [begin, end) of vec by those of part
+static void splice_vector(Vector* vec, int begin, int end, const Vector* part) {
+    const int size = vec->size - (end - begin) + part->size;
+    if (size > vec->capacity) {
+        vec->capacity = size * 2;
+        vec->elements = realloc(vec->elements, sizeof(void*) * vec->capacity);
+    }
+
+    memmove(&(vec->elements[begin + part->size]), &(vec->elements[end]), sizeof(void*) * (vec->size - end));
+    memcpy(&(vec->elements[begin]), part->elements, sizeof(void*) * part->size);
+    vec->size = size;
+}
+
+// index of the last declaration that starts at or before pos, -1 if none
+static int find_decl_at(const Document* doc, int pos) {
+    int low  = 0;
+    int high = doc->decls->size;
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        if (get_decl_pos(doc, mid) <= pos) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    return low - 1;
+}
+
+// Lexes the whole document again, after an edit nothing can be reused for.
+static void reload_document(Document* doc) {
+    lex_document(doc);
+    refresh_documents();
+}
+
+// Releases the old declarations from index on that begin before the token
+// index begin, which new declarations now overlap. Returns the index of the
+// first one kept.
+static int drop_decls_before(Document* doc, int index, int begin, bool* refresh_out) {
+    while (index < doc->decls->size) {
+        Decl* decl = get_decl(doc, index);
+        if (decl->begin >= begin) {
+            break;
+        }
+        if (affects_others(decl)) {
+            *refresh_out = true;
+        }
+        release_decl(decl);
+        ++index;
+    }
+
+    return index;
+}
+
+//
+// Replaces length bytes at offset by text, then lexes and parses again
+// what the edit changed (see Document).
+//
+static bool change_document(Document* doc, int offset, int length, const char* text, int text_len) {
+    if (offset < 0 || length < 0 || offset + length > doc->size) {
+        return false;
+    }
+
+    const int delta = text_len - length;
+    reserve_text(doc, doc->size + delta);
+    memmove(doc->text + offset + text_len, doc->text + offset + length, doc->size - offset - length + 1);
+    memcpy(doc->text + offset, text, text_len);
+    doc->size += delta;
+
+    if (doc->tokens == NULL || doc->decls->size == 0) {
+        reload_document(doc);
+        return true;
+    }
+
+    // the declarations [first, last) are lexed again; the one before the
+    // edit is too if the new text could join its last token
+    const int decl_count = doc->decls->size;
+    int first = find_decl_at(doc, offset);
+    if (first < 0) {
+        first = 0;
+    }
+    if (first > 0 && get_decl_pos(doc, first) == offset) {
+        --first;
+    }
+    int last = find_decl_at(doc, offset + length) + 1;
+
+    int lex_pos = 0;
+    if (first > 0) {
+        lex_pos = get_decl_pos(doc, first);
+    }
+    Vector* lexed = create_vector();
+    while (true) {
+        int target = doc->size;
+        if (last < decl_count) {
+            target = get_decl_pos(doc, last) + delta;
+        }
+        if (lex_pos == target) {
+            break;
+        }
+        // a comment or a token now runs past the start of a declaration
+        if (lex_pos > target) {
+            ++last;
+            continue;
+        }
+
+        int stop = 0;
+        Vector* part = tokenize_range(doc->text, lex_pos, target, &stop, doc->token_arena);
+        if (part == NULL) {
+            free(lexed->elements);
+            free(lexed);
+            reload_document(doc);
+            return true;
+        }
+        splice_vector(lexed, lexed->size, lexed->size, part);
+        free(part->elements);
+        free(part);
+        lex_pos = stop;
+    }
+    relexed_count += lexed->size;
+
+    // the tokens of the declarations [first, last) are replaced
+    const Decl* first_decl = get_decl(doc, first);
+    const int token_begin = first_decl->begin;
+    int token_end = doc->tokens->size;
+    if (last < decl_count) {
+        const Decl* last_decl = get_decl(doc, last);
+        token_end = last_decl->begin;
+    }
+    const int token_delta = lexed->size - (token_end - token_begin);
+    splice_vector(doc->tokens, token_begin, token_end, lexed);
+    for (int i = token_begin + lexed->size; i < doc->tokens->size; ++i) {
+        Token* token = doc->tokens->elements[i];
+        token->pos += delta;
+    }
+    free(lexed->elements);
+    free(lexed);
+    compact_tokens(doc);
+
+    // Splits the new tokens into declarations until a split falls where an
+    // old declaration begins, past the new tokens. Old declarations that
+    // the new ones overlap are dropped.
+    bool refresh = false;
+    for (int j = first; j < last; ++j) {
+        refresh = refresh || affects_others(get_decl(doc, j));
+        release_decl(get_decl(doc, j));
+    }
+    Vector* new_decls = create_vector();
+    int kept  = last;
+    int index = token_begin;
+    while (index < doc->tokens->size) {
+        kept = drop_decls_before(doc, kept, index - token_delta, &refresh);
+        if (index >= token_end + token_delta && kept < decl_count) {
+            const Decl* next = get_decl(doc, kept);
+            if (next->begin + token_delta == index) {
+                break;
+            }
+        }
+
+        Decl* decl = create_decl(doc, index, find_decl_end(doc, index));
+        refresh = refresh || affects_others(decl);
+        vector_push_back(new_decls, decl);
+        index = decl->end;
+    }
+    kept = drop_decls_before(doc, kept, index - token_delta, &refresh);
+
+    for (int k = kept; k < decl_count; ++k) {
+        Decl* moved = get_decl(doc, k);
+        moved->begin += token_delta;
+        moved->end   += token_delta;
+    }
+    Vector* rest = create_vector();
+    for (int l = kept; l < decl_count; ++l) {
+        vector_push_back(rest, get_decl(doc, l));
+    }
+    doc->decls->size = first;
+    splice_vector(doc->decls, first, first, new_decls);
+    splice_vector(doc->decls, doc->decls->size, doc->decls->size, rest);
+    free(rest->elements);
+    free(rest);
+
+    if (refresh) {
+        refresh_documents();
+    }
+    else {
+        for (int m = 0; m < new_decls->size; ++m) {
+            parse_decl(doc, new_decls->elements[m]);
+        }
+    }
+    free(new_decls->elements);
+    free(new_decls);
+
+    return true;
+}
+
+static void close_document(Document* doc) {
+    for (int i = 0; i < document_list->size; ++i) {
+        if (document_list->elements[i] == doc) {
+            memmove(&(document_list->elements[i]), &(document_list->elements[i + 1]), sizeof(void*) * (document_list->size - i - 1));
+            --document_list->size;
+            break;
+        }
+    }
+    hashmap_put(document_map, doc->path, NULL);
+
+    release_decls(doc);
+    release_tokens(doc);
+    free(doc->decls->elements);
+    free(doc->decls);
+    free(doc->text);
+    free(doc);
+}
+
+//
+// queries
+//
+
+static int count_newlines(const char* text, int from, int to) {
+    int count = 0;
+    const char* p   = text + from;
+    const char* end = text + to;
+    while (p < end) {
+        p = memchr(p, '\n', end - p);
+        if (p == NULL) {
+            break;
+        }
+        ++count;
+        ++p;
+    }
+
+    return count;
+}
+
+static int get_decl_line(const Document* doc, int index) {
+    return count_newlines(doc->text, 0, get_decl_pos(doc, index)) + 1;
+}
+
+static int count_errors(const Document* doc) {
+    if (doc->tokens == NULL) {
+        return 1;
+    }
+
+    int count = 0;
+    for (int i = 0; i < doc->decls->size; ++i) {
+        const Decl* decl = get_decl(doc, i);
+        if (!decl->valid) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+// index of the token at pos, -1 if pos is not in a token
+static int find_token_at(const Document* doc, int pos) {
+    int low  = 0;
+    int high = doc->tokens->size;
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        const Token* token = get_token(doc, mid);
+        if (token->pos <= pos) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    if (low == 0) {
+        return -1;
+    }
+
+    const Token* found = get_token(doc, low - 1);
+    if (pos >= found->pos + found->len) {
+        return -1;
+    }
+    return low - 1;
+}
+
+// index of the declaration of name in doc, a definition before a
+// prototype, -1 if none
+static int find_definition(const Document* doc, int name) {
+    int prototype = -1;
+    for (int i = 0; i < doc->decls->size; ++i) {
+        const Decl* decl = get_decl(doc, i);
+        if (decl->name != name || decl->kind == DECL_DIRECTIVE) {
+            continue;
+        }
+        if (decl->kind != DECL_PROTOTYPE) {
+            return i;
+        }
+        if (prototype < 0) {
+            prototype = i;
+        }
+    }
+
+    return prototype;
+}
+
+static const char* decode_decl_kind(int kind) {
+    switch (kind) {
+    case DECL_DIRECTIVE: { return "directive"; }
+    case DECL_MACRO:     { return "macro";     }
+    case DECL_FUNCTION:  { return "function";  }
+    case DECL_PROTOTYPE: { return "prototype"; }
+    case DECL_VARIABLE:  { return "variable";  }
+    case DECL_TYPEDEF:   { return "typedef";   }
+    case DECL_STRUCT:    { return "struct";    }
+    case DECL_ENUM:      { return "enum";      }
+    default:             { return "unknown";   }
+    }
+}
+
+//
+// JSON output
+//
+
+static void put_text(ByteBuffer* buf, const char* str) {
+    bytebuffer_put_bytes(buf, str, strlen(str));
+}
+
+static void put_number(ByteBuffer* buf, int n) {
+    char digits[24];
+    snprintf(digits, 24, "%d", n);
+    put_text(buf, digits);
+}
+
+static void put_string(ByteBuffer* buf, const char* str, int len) {
+    put_text(buf, "\"");
+    int run = 0; // start of the bytes that need no escape
+    for (int i = 0; i < len; ++i) {
+        const char c = str[i];
+        if (c != '"' && c != '\\' && (c < 0 || c >= 32)) {
+            continue;
+        }
+
+        bytebuffer_put_bytes(buf, str + run, i - run);
+        run = i + 1;
+        if (c == '"') {
+            put_text(buf, "\\\"");
+        }
+        else if (c == '\\') {
+            put_text(buf, "\\\\");
+        }
+        else if (c == '\n') {
+            put_text(buf, "\\n");
+        }
+        else {
+            char escape[8];
+            snprintf(escape, 8, "\\u%04x", c);
+            put_text(buf, escape);
+        }
+    }
+    bytebuffer_put_bytes(buf, str + run, len - run);
+    put_text(buf, "\"");
+}
+
+static void put_symbol(ByteBuffer* buf, int symbol) {
+    put_string(buf, symbol_name(symbol), symbol_len(symbol));
+}
+
+static void put_field(ByteBuffer* buf, const char* name, int n) {
+    put_text(buf, ",\"");
+    put_text(buf, name);
+    put_text(buf, "\":");
+    put_number(buf, n);
+}
+
+static void put_error(ByteBuffer* buf, int id, const char* message) {
+    put_text(buf, "{\"id\":");
+    put_number(buf, id);
+    put_text(buf, ",\"error\":");
+    put_string(buf, message, strlen(message));
+    put_text(buf, "}\n");
+}
+
+// counts answered to open and change
+static void put_document_counts(ByteBuffer* buf, const Document* doc) {
+    int token_count = 0;
+    if (doc->tokens != NULL) {
+        token_count = doc->tokens->size;
+    }
+    put_text(buf, "{\"size\":");
+    put_number(buf, doc->size);
+    put_field(buf, "tokens", token_count);
+    put_field(buf, "decls", doc->decls->size);
+    put_field(buf, "errors", count_errors(doc));
+}
+
+static void put_symbols(ByteBuffer* buf, const Document* doc) {
+    put_text(buf, "{\"symbols\":[");
+    int  line     = 1;
+    int  line_pos = 0;
+    bool is_first = true;
+    for (int i = 0; i < doc->decls->size; ++i) {
+        const Decl* decl = get_decl(doc, i);
+        if (decl->name == 0 || decl->kind == DECL_DIRECTIVE) {
+            continue;
+        }
+
+        const int pos = get_decl_pos(doc, i);
+        line += count_newlines(doc->text, line_pos, pos);
+        line_pos = pos;
+
+        if (!is_first) {
+            put_text(buf, ",");
+        }
+        is_first = false;
+        put_text(buf, "{\"name\":");
+        put_symbol(buf, decl->name);
+        put_text(buf, ",\"kind\":\"");
+        put_text(buf, decode_decl_kind(decl->kind));
+        put_text(buf, "\"");
+        put_field(buf, "line", line);
+        if (decl->valid) {
+            put_text(buf, ",\"valid\":true}");
+        }
+        else {
+            put_text(buf, ",\"valid\":false}");
+        }
+    }
+    put_text(buf, "]}");
+}
+
+static void put_diagnostics(ByteBuffer* buf, const Document* doc) {
+    put_text(buf, "{\"errors\":[");
+    if (doc->tokens == NULL) {
+        put_text(buf, "{\"line\":1,\"message\":\"invalid token\"}");
+    }
+
+    bool is_first = true;
+    for (int i = 0; i < doc->decls->size; ++i) {
+        const Decl* decl = get_decl(doc, i);
+        if (decl->valid) {
+            continue;
+        }
+
+        if (!is_first) {
+            put_text(buf, ",");
+        }
+        is_first = false;
+        put_text(buf, "{\"line\":");
+        put_number(buf, get_decl_line(doc, i));
+        put_text(buf, ",\"message\":\"syntax error in ");
+        put_text(buf, decode_decl_kind(decl->kind));
+        put_text(buf, "\"");
+        if (decl->name != 0) {
+            put_text(buf, ",\"name\":");
+            put_symbol(buf, decl->name);
+        }
+        put_text(buf, "}");
+    }
+    put_text(buf, "]}");
+}
+
+static void put_definition(ByteBuffer* buf, const Document* doc, int offset) {
+    int name = 0;
+    if (doc->tokens != NULL) {
+        const int index = find_token_at(doc, offset);
+        if (index >= 0) {
+            const Token* token = get_token(doc, index);
+            if (token->type == TK_IDENT) {
+                name = token->val;
+            }
+        }
+    }
+    if (name == 0) {
+        put_text(buf, "null");
+        return;
+    }
+
+    // the document, then the headers
+    const Document* found = doc;
+    int found_index = find_definition(doc, name);
+    for (int i = 0; i < header_list->size && found_index < 0; ++i) {
+        found = header_list->elements[i];
+        found_index = find_definition(found, name);
+    }
+    if (found_index < 0) {
+        put_text(buf, "null");
+        return;
+    }
+
+    const Decl* decl = get_decl(found, found_index);
+    put_text(buf, "{\"name\":");
+    put_symbol(buf, name);
+    put_text(buf, ",\"kind\":\"");
+    put_text(buf, decode_decl_kind(decl->kind));
+    put_text(buf, "\",\"path\":");
+    put_symbol(buf, found->path);
+    put_field(buf, "line", get_decl_line(found, found_index));
+    put_text(buf, "}");
+}
+
+//
+// JSON input
+//
+
+static int skip_json_spaces(const char* line, int pos) {
+    while (line[pos] == ' ' || line[pos] == 9 || line[pos] == 13 || line[pos] == '\n') {
+        ++pos;
+    }
+
+    return pos;
+}
+
+// value of the 4 hex digits at pos, -1 if they are not
+static int read_hex4(const char* line, int pos) {
+    int code = 0;
+    for (int i = 0; i < 4; ++i) {
+        const char c = line[pos + i];
+        int digit = -1;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        }
+        else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        }
+        if (digit < 0) {
+            return -1;
+        }
+        code = code * 16 + digit;
+    }
+
+    return code;
+}
+
+// writes code as UTF-8 at str[len], returns the new length
+static int put_utf8(char* str, int len, int code) {
+    if (code < 128) {
+        str[len] = code;
+        return len + 1;
+    }
+    if (code < 2048) {
+        str[len]     = 192 + code / 64;
+        str[len + 1] = 128 + code % 64;
+        return len + 2;
+    }
+    str[len]     = 224 + code / 4096;
+    str[len + 1] = 128 + code / 64 % 64;
+    str[len + 2] = 128 + code % 64;
+    return len + 3;
+}
+
+// Reads the JSON string at pos into a new NUL-terminated buffer, of
+// *len_out bytes, and sets *pos_out past it. NULL if it is not a string.
+static char* read_json_string(const char* line, int pos, int* len_out, int* pos_out) {
+    if (line[pos] != '"') {
+        return NULL;
+    }
+    ++pos;
+
+    int end = pos;
+    while (line[end] != '\0' && line[end] != '"') {
+        if (line[end] == '\\' && line[end + 1] != '\0') {
+            ++end;
+        }
+        ++end;
+    }
+    if (line[end] != '"') {
+        return NULL;
+    }
+
+    // unescaped, the string is no longer than it is escaped
+    char* str = malloc(end - pos + 1);
+    int len = 0;
+    while (pos < end) {
+        char c = line[pos];
+        ++pos;
+        if (c == '\\') {
+            const char escape = line[pos];
+            ++pos;
+            if (escape == 'u') {
+                const int code = read_hex4(line, pos);
+                if (code < 0) {
+                    free(str);
+                    return NULL;
+                }
+                pos += 4;
+                len = put_utf8(str, len, code);
+                continue;
+            }
+
+            c = escape; // '"', '\\' and '/'
+            if (escape == 'n') {
+                c = '\n';
+            }
+            else if (escape == 't') {
+                c = 9;
+            }
+            else if (escape == 'r') {
+                c = 13;
+            }
+            else if (escape == 'b') {
+                c = 8;
+            }
+            else if (escape == 'f') {
+                c = 12;
+            }
+        }
+        str[len] = c;
+        ++len;
+    }
+    str[len] = '\0';
+
+    *len_out = len;
+    *pos_out = end + 1;
+    return str;
+}
+
+static int read_json_number(const char* line, int pos, int* pos_out) {
+    bool negative = false;
+    if (line[pos] == '-') {
+        negative = true;
+        ++pos;
+    }
+
+    int n = 0;
+    while (line[pos] >= '0' && line[pos] <= '9') {
+        n = n * 10 + (line[pos] - '0');
+        ++pos;
+    }
+
+    *pos_out = pos;
+    if (negative) {
+        return -n;
+    }
+    return n;
+}
+
+// Reads the members of the request that the server knows; the others are
+// skipped, as long as they are not objects or arrays. Keys and values are
+// looked up without interning them, so that requests do not grow the
+// symbol table; only open interns its path.
+static bool read_request(const char* line, Request* req) {
+    req->id       = 0;
+    req->method   = 0;
+    req->path     = 0;
+    req->path_len = 0;
+    req->offset   = 0;
+    req->length   = 0;
+    req->text     = NULL;
+    req->text_len = 0;
+
+    int pos = skip_json_spaces(line, 0);
+    if (line[pos] != '{') {
+        return false;
+    }
+    pos = skip_json_spaces(line, pos + 1);
+    if (line[pos] == '}') {
+        return true;
+    }
+
+    while (true) {
+        int key_len = 0;
+        char* key = read_json_string(line, pos, &key_len, &pos);
+        if (key == NULL) {
+            return false;
+        }
+        const int member = find_symbol(key, key_len);
+        free(key);
+
+        pos = skip_json_spaces(line, pos);
+        if (line[pos] != ':') {
+            return false;
+        }
+        pos = skip_json_spaces(line, pos + 1);
+
+        if (line[pos] == '"') {
+            int value_len = 0;
+            char* value = read_json_string(line, pos, &value_len, &pos);
+            if (value == NULL) {
+                return false;
+            }
+
+            if (member == sym_text) {
+                free(req->text);
+                req->text     = value;
+                req->text_len = value_len;
+            }
+            else if (member == sym_path) {
+                free(req->path_name);
+                req->path      = find_symbol(value, value_len);
+                req->path_name = value;
+                req->path_len  = value_len;
+            }
+            else {
+                if (member == sym_method) {
+                    req->method = find_symbol(value, value_len);
+                }
+                free(value);
+            }
+        }
+        else if (line[pos] == '-' || (line[pos] >= '0' && line[pos] <= '9')) {
+            const int number = read_json_number(line, pos, &pos);
+            if (member == sym_id) {
+                req->id = number;
+            }
+            else if (member == sym_offset) {
+                req->offset = number;
+            }
+            else if (member == sym_length) {
+                req->length = number;
+            }
+        }
+        else {
+            // true, false or null
+            while (line[pos] != '\0' && line[pos] != ',' && line[pos] != '}') {
+                ++pos;
+            }
+        }
+
+        pos = skip_json_spaces(line, pos);
+        if (line[pos] != ',') {
+            return line[pos] == '}';
+        }
+        pos = skip_json_spaces(line, pos + 1);
+    }
+}
+
+// the next line of fd without its newline, NULL at the end of the input
+static char* read_request_line(int fd) {
+    while (true) {
+        char* newline = NULL;
+        if (input_pos < input_size) {
+            newline = memchr(input + input_pos, '\n', input_size - input_pos);
+        }
+        if (newline != NULL) {
+            char* line = input + input_pos;
+            *newline  = '\0';
+            input_pos = newline - input + 1;
+            return line;
+        }
+
+        // keep the partial line and read more after it
+        memmove(input, input + input_pos, input_size - input_pos);
+        input_size -= input_pos;
+        input_pos   = 0;
+        if (input_size + READ_BUFFER_SIZE + 1 > input_capacity) {
+            input_capacity = (input_size + READ_BUFFER_SIZE + 1) * 2;
+            input          = realloc(input, input_capacity);
+        }
+
+        const int len = read(fd, input + input_size, READ_BUFFER_SIZE);
+        if (len <= 0) {
+            if (input_size == 0) {
+                return NULL;
+            }
+
+            // the last line has no newline
+            input[input_size] = '\0';
+            input_pos = input_size;
+            return input;
+        }
+        input_size += len;
+    }
+}
+
+//
+// requests
+//
+
+static Document* open_document(const Request* req) {
+    Document* doc = find_document(req->path);
+    if (doc != NULL) {
+        close_document(doc);
+    }
+
+    char* addr = NULL;
+    int size = 0;
+    if (req->text == NULL) {
+        if (req->path_name == NULL) {
+            return NULL;
+        }
+        addr = read_file_copy(req->path_name, &size);
+        if (addr == NULL) {
+            return NULL;
+        }
+    }
+
+    int path = 0;
+    if (req->path_name != NULL) {
+        path = intern(req->path_name, req->path_len);
+    }
+    if (addr == NULL) {
+        doc = create_document(path, req->text, req->text_len);
+    }
+    else {
+        doc = create_document(path, addr, size);
+        free(addr);
+    }
+    hashmap_put(document_map, path, doc);
+    vector_push_back(document_list, doc);
+
+    reload_document(doc);
+
+    return doc;
+}
+
+// Writes the response to the request into buf. Returns true on shutdown.
+static bool handle_request(const Request* req, ByteBuffer* buf) {
+    relexed_count  = 0;
+    reparsed_count = 0;
+
+    if (req->method == sym_shutdown) {
+        put_text(buf, "{\"id\":");
+        put_number(buf, req->id);
+        put_text(buf, ",\"result\":null}\n");
+        return true;
+    }
+
+    if (req->method != sym_open && req->method != sym_change && req->method != sym_close && req->method != sym_symbols && req->method != sym_diagnostics && req->method != sym_definition) {
+        put_error(buf, req->id, "unknown method");
+        return false;
+    }
+
+    Document* doc = NULL;
+    if (req->method == sym_open) {
+        doc = open_document(req);
+        if (doc == NULL) {
+            put_error(buf, req->id, "cannot read the file");
+            return false;
+        }
+    }
+    else {
+        doc = find_document(req->path);
+        if (doc == NULL) {
+            put_error(buf, req->id, "the document is not open");
+            return false;
+        }
+    }
+
+    if (req->method == sym_change) {
+        if (req->text == NULL) {
+            put_error(buf, req->id, "invalid change");
+            return false;
+        }
+        if (!change_document(doc, req->offset, req->length, req->text, req->text_len)) {
+            put_error(buf, req->id, "invalid change");
+            return false;
+        }
+    }
+    else if (req->method == sym_close) {
+        close_document(doc);
+    }
+
+    put_text(buf, "{\"id\":");
+    put_number(buf, req->id);
+    put_text(buf, ",\"result\":");
+    if (req->method == sym_open) {
+        put_document_counts(buf, doc);
+        put_text(buf, "}");
+    }
+    else if (req->method == sym_change) {
+        put_document_counts(buf, doc);
+        put_field(buf, "relexed", relexed_count);
+        put_field(buf, "reparsed", reparsed_count);
+        put_text(buf, "}");
+    }
+    else if (req->method == sym_symbols) {
+        put_symbols(buf, doc);
+    }
+    else if (req->method == sym_diagnostics) {
+        put_diagnostics(buf, doc);
+    }
+    else if (req->method == sym_definition) {
+        put_definition(buf, doc, req->offset);
+    }
+    else {
+        put_text(buf, "null");
+    }
+    put_text(buf, "}\n");
+
+    return false;
+}
+
+static int intern_str(const char* str) {
+    return intern(str, strlen(str));
+}
+
+int serve(int in_fd, int out_fd) {
+    // init
+    sym_id          = intern_str("id");
+    sym_method      = intern_str("method");
+    sym_path        = intern_str("path");
+    sym_offset      = intern_str("offset");
+    sym_length      = intern_str("length");
+    sym_text        = intern_str("text");
+    sym_open        = intern_str("open");
+    sym_change      = intern_str("change");
+    sym_symbols     = intern_str("symbols");
+    sym_diagnostics = intern_str("diagnostics");
+    sym_definition  = intern_str("definition");
+    sym_close       = intern_str("close");
+    sym_shutdown    = intern_str("shutdown");
+    sym_define      = intern_str("define");
+    sym_include     = intern_str("include");
+    document_map    = create_hashmap(64);
+    document_list   = create_vector();
+    header_list     = create_vector();
+    end_token       = calloc(1, sizeof(Token));
+    end_token->type = TK_HASH;
+    Document* builtin = create_document(intern_str("<built-in>"), BUILTIN_MACROS, strlen(BUILTIN_MACROS));
+    builtin->is_header = true;
+    lex_document(builtin);
+    vector_push_back(header_list, builtin);
+    input_capacity  = READ_BUFFER_SIZE + 1;
+    input           = malloc(input_capacity);
+
+    Request* req = calloc(1, sizeof(Request));
+    char* line = read_request_line(in_fd);
+    while (line != NULL) {
+        ByteBuffer* buf = create_bytebuffer();
+        bool is_shutdown = false;
+        if (read_request(line, req)) {
+            is_shutdown = handle_request(req, buf);
+        }
+        else {
+            put_error(buf, req->id, "invalid request");
+        }
+        bytebuffer_write(buf, out_fd);
+        free(buf->data);
+        free(buf);
+        free(req->text);
+        req->text = NULL;
+        free(req->path_name);
+        req->path_name = NULL;
+
+        if (is_shutdown) {
+            break;
+        }
+        line = read_request_line(in_fd);
+    }
+
+    return 0;
+}
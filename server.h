@@ -0,0 +1,16 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "util.h"
+
+//
+// Language server: answers syntax and symbol queries about open files
+// over a stdio JSON protocol, re-lexing and re-parsing only what an edit
+// touches (see server.c).
+//
+
+// Reads requests from in_fd until "shutdown" or the end of input, and
+// writes a response to out_fd for each. Returns the exit status.
+int serve(int in_fd, int out_fd);
+
+#endif
@@ -0,0 +1,99 @@
+#!/bin/bash
+#
+# Writes a program whose statements or expressions nest deeper than a
+# recursive compiler could handle.
+#
+# usage: gen_nested.sh else-if|binary|paren|right|unary|cond depth
+#
+
+kind="$1"
+depth="$2"
+
+case "${kind}" in
+else-if)
+    # classify(x) is x % 100 through a chain of depth "else if"s
+    awk -v depth="${depth}" 'BEGIN {
+        print "int classify(int x) {"
+        print "    if (x == 0) return 0;"
+        for (i = 1; i < depth; ++i) {
+            printf "    else if (x == %d) return %d;\n", i, i % 100
+        }
+        print "    else return 255;"
+        print "}"
+        printf "int main() { return classify(%d); }\n", depth - 1
+    }'
+    ;;
+binary)
+    # a sum of depth terms, returned modulo 256
+    awk -v depth="${depth}" 'BEGIN {
+        print "int main() {"
+        printf "    int sum = 1"
+        for (i = 1; i < depth; ++i) {
+            printf (i % 16 == 0) ? " +\n        1" : " + 1"
+        }
+        print ";"
+        print "    return sum;"
+        print "}"
+    }'
+    ;;
+paren)
+    # 1 in depth pairs of parentheses
+    awk -v depth="${depth}" 'BEGIN {
+        printf "int main() { return "
+        for (i = 0; i < depth; ++i) {
+            printf (i % 64 == 63) ? "(\n" : "("
+        }
+        printf "1"
+        for (i = 0; i < depth; ++i) {
+            printf (i % 64 == 63) ? ")\n" : ")"
+        }
+        print "; }"
+    }'
+    ;;
+right)
+    # a sum of depth terms, each added to the sum of those after it
+    awk -v depth="${depth}" 'BEGIN {
+        print "int main() {"
+        print "    int x = 1;"
+        printf "    return x"
+        for (i = 1; i < depth; ++i) {
+            printf (i % 16 == 0) ? " + (\n        x" : " + (x"
+        }
+        for (i = 1; i < depth; ++i) {
+            printf (i % 64 == 0) ? ")\n" : ")"
+        }
+        print ";"
+        print "}"
+    }'
+    ;;
+unary)
+    # 1 negated depth times
+    awk -v depth="${depth}" 'BEGIN {
+        print "int main() {"
+        print "    int x = 1;"
+        printf "    return"
+        for (i = 0; i < depth; ++i) {
+            printf (i % 32 == 31) ? " -\n" : " -"
+        }
+        print " x;"
+        print "}"
+    }'
+    ;;
+cond)
+    # classify() of gen_nested.sh else-if as a chain of depth ?:s
+    awk -v depth="${depth}" 'BEGIN {
+        print "int classify(int x) {"
+        printf "    return x == 0 ? 0"
+        for (i = 1; i < depth; ++i) {
+            printf "\n        : x == %d ? %d", i, i % 100
+        }
+        print "\n        : 255;"
+        print "}"
+        printf "int main() { return classify(%d); }\n", depth - 1
+    }'
+    ;;
+*)
+    echo "usage: $0 else-if|binary|paren|right|unary|cond depth" >&2
+    exit 1
+    ;;
+esac
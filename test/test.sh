@@ -37,6 +37,150 @@ function assert_output() {
     fi
 }
 
+function assert_compile_error() {
+    file="$1"
+    option="$2"
+
+    # minic reports the error and exits with 255, as main returns -1
+    ./minic ${option} "./test/${file}" > ./test/tmp.s 2> /dev/null
+    actual="$?"
+
+    printf "\e[1m${file}${option:+ ${option}}:\n  \e[0m"
+    if [[ "${actual}" = "255" ]]; then
+        echo -e "\e[32mExpected: 255, Actual: ${actual} => OK.\e[0m"
+    else
+        echo -e "\e[31mExpected: 255, Actual: ${actual} => NG.\e[0m"
+        exit 1
+    fi
+}
+
+function assert_parallel_parse() {
+    jobs="$1"
+
+    # every test file minic compiles gives the same assembly and the same
+    # expression count with the function bodies parsed on jobs threads
+    count=0
+    for path in ./test/test_*.c; do
+        ./minic -s "${path}" > ./test/tmp.s 2> ./test/tmp.stats || continue
+        ./minic -s -j "${jobs}" "${path}" > ./test/tmp_parallel.s 2> ./test/tmp_parallel.stats
+        if ! cmp -s ./test/tmp.s ./test/tmp_parallel.s; then
+            printf "\e[1m-j ${jobs}:\n  \e[0m"
+            echo -e "\e[31m${path} differs from the serial assembly => NG.\e[0m"
+            exit 1
+        fi
+        if [[ "$(grep "^expressions:" ./test/tmp.stats)" != "$(grep "^expressions:" ./test/tmp_parallel.stats)" ]]; then
+            printf "\e[1m-j ${jobs}:\n  \e[0m"
+            echo -e "\e[31m${path} counts other expressions than the serial parse => NG.\e[0m"
+            exit 1
+        fi
+        count=$((count + 1))
+    done
+
+    printf "\e[1m-j ${jobs}:\n  \e[0m"
+    echo -e "\e[32m${count} files, the same assembly and expression count as the serial parse => OK.\e[0m"
+}
+
+function assert_return_nested() {
+    kind="$1"
+    depth="$2"
+    expected="$3"
+
+    # generated, since the input is megabytes of source
+    ./test/gen_nested.sh "${kind}" "${depth}" > ./test/tmp_nested.c
+    assert_return tmp_nested.c "${expected}"
+}
+
+function assert_return_pch() {
+    header="$1"
+    file="$2"
+    expected="$3"
+
+    ./minic --emit-pch "./test/${header}" -o ./test/tmp.pch
+    ./minic --include-pch ./test/tmp.pch "./test/${file}" > ./test/tmp.s
+    gcc -no-pie -o ./test/tmp ./test/tmp.s
+    ./test/tmp
+    actual="$?"
+
+    printf "\e[1m${header} + ${file}:\n  \e[0m"
+    if [[ "${actual}" = "${expected}" ]]; then
+        echo -e "\e[32mExpected: ${expected}, Actual: ${actual} => OK.\e[0m"
+    else
+        echo -e "\e[31mExpected: ${expected}, Actual: ${actual} => NG.\e[0m"
+        exit 1
+    fi
+}
+
+function assert_server() {
+    requests="$1"
+    expected="$2"
+
+    # the requests edit the file in memory only
+    ./minic --server < "./test/${requests}" > ./test/tmp.out 2> /dev/null
+    printf "\e[1m${requests}:\n  \e[0m"
+    if diff ./test/tmp.out "./test/${expected}" > /dev/null; then
+        echo -e "\e[32mExpected: ${expected} => OK.\e[0m"
+    else
+        echo -e "\e[31mExpected: ${expected} => NG.\e[0m"
+        diff ./test/tmp.out "./test/${expected}"
+        exit 1
+    fi
+}
+
+function assert_return_ir() {
+    file="$1"
+    expected="$2"
+    option="${3:--fir}"
+
+    ./minic ${option} "./test/${file}" > ./test/tmp.s
+    gcc -no-pie -o ./test/tmp ./test/tmp.s
+    ./test/tmp
+    actual="$?"
+
+    printf "\e[1m${file} (${option}):\n  \e[0m"
+    if [[ "${actual}" = "${expected}" ]]; then
+        echo -e "\e[32mExpected: ${expected}, Actual: ${actual} => OK.\e[0m"
+    else
+        echo -e "\e[31mExpected: ${expected}, Actual: ${actual} => NG.\e[0m"
+        exit 1
+    fi
+}
+
+function assert_return_obj() {
+    file="$1"
+    expected="$2"
+    option="$3"
+
+    # assembled by minic itself, only linked by gcc
+    ./minic -c ${option} -o ./test/tmp.o "./test/${file}"
+    gcc -no-pie -o ./test/tmp ./test/tmp.o
+    ./test/tmp
+    actual="$?"
+
+    printf "\e[1m${file} (-c${option:+ ${option}}):\n  \e[0m"
+    if [[ "${actual}" = "${expected}" ]]; then
+        echo -e "\e[32mExpected: ${expected}, Actual: ${actual} => OK.\e[0m"
+    else
+        echo -e "\e[31mExpected: ${expected}, Actual: ${actual} => NG.\e[0m"
+        exit 1
+    fi
+}
+
+function assert_dump_ir() {
+    file="$1"
+    expected="$2"
+    option="${3:--O0}"
+
+    ./minic --dump-ir "${option}" "./test/${file}" > ./test/tmp.out
+    printf "\e[1m${file} (--dump-ir ${option}):\n  \e[0m"
+    if diff ./test/tmp.out "./test/${expected}" > /dev/null; then
+        echo -e "\e[32mExpected: ${expected} => OK.\e[0m"
+    else
+        echo -e "\e[31mExpected: ${expected} => NG.\e[0m"
+        diff ./test/tmp.out "./test/${expected}"
+        exit 1
+    fi
+}
+
 assert_return test_return.c 42
 assert_return test_return_add.c 7
 assert_return test_return_add_2.c 12
@@ -50,9 +194,15 @@ assert_return test_return_div_2.c 4
 assert_return test_return_mod.c 2
 assert_return test_return_mod_2.c 0
 assert_return test_return_mix.c 33
+assert_return test_return_mix_2.c 24
 assert_return test_return_paren.c 50
 assert_return test_return_paren_2.c 35
 assert_return test_return_minus.c 1
+assert_return test_return_minus_2.c 128
+assert_return_ir test_return_minus_2.c 128 -O2
+
+assert_compile_error test_syntax_error.c
+assert_compile_error test_syntax_error.c -O2
 
 assert_return test_localvar.c 42
 assert_return test_localvar_2.c 7
@@ -62,6 +212,7 @@ assert_return test_localvar_5.c 34
 assert_return test_localvar_6.c 34
 assert_return test_localvar_7.c 120
 assert_return test_localvar_8.c 31
+assert_return test_localvar_9.c 244
 
 assert_return test_func.c 42
 assert_return test_func_2.c 5
@@ -74,6 +225,7 @@ assert_return test_func_8.c 20
 assert_return test_func_9.c 15
 assert_return test_func_10.c 150
 assert_output test_func_11.c "usage"
+assert_return test_func_12.c 21
 
 assert_return test_if.c 100
 assert_return test_if_2.c 2
@@ -108,6 +260,7 @@ assert_return test_dec_2.c 1
 assert_return test_for.c 10
 assert_return test_for_2.c 10
 assert_return test_for_3.c 10
+assert_return test_for_4.c 194
 
 assert_return test_break.c 6
 assert_return test_break_2.c 6
@@ -140,6 +293,8 @@ assert_return test_global.c 9
 assert_return test_global_2.c 10
 assert_output test_global_3.c "Hello"
 assert_return test_global_4.c 3
+assert_return test_global_5.c 14
+assert_return test_global_6.c 18
 
 assert_return test_struct.c 6
 assert_return test_struct_2.c 15
@@ -156,18 +311,56 @@ assert_return test_switch_2.c 14
 assert_return test_switch_3.c 70
 assert_return test_switch_4.c 6
 assert_return test_switch_5.c 2
+assert_return test_switch_6.c 173
 
 assert_return test_sizeof.c 17
 assert_return test_sizeof_2.c 32
 assert_return test_sizeof_3.c 80
 
 assert_return test_typedef.c 3
+assert_return test_typedef_2.c 31
+assert_return test_typedef_3.c 34
 
 assert_return test_preprocess.c 42
 assert_return test_preprocess_2.c 3
 assert_return test_preprocess_3.c 1
 assert_return test_preprocess_4.c 9
 assert_return test_preprocess_5.c 6
+assert_return test_preprocess_6.c 7
+
+assert_return_pch test_pch.h test_pch.c 42
+
+assert_server test_server.jsonl test_server.out
+assert_server test_server_2.jsonl test_server_2.out
+
+assert_return test_ir.c 109
+assert_return_ir test_ir.c 109
+assert_dump_ir test_ir.c test_ir.out
+assert_return test_ir_2.c 1
+assert_return_ir test_ir_2.c 1
+assert_return_ir test_ir_2.c 1 -O2
+assert_return_ir test_ir_2.c 1 "-O2 -fno-regalloc"
+
+assert_return test_opt.c 173
+assert_return_ir test_opt.c 173 -O1
+assert_return_ir test_opt.c 173 -O2
+assert_return_ir test_opt.c 173 "-O2 -fno-regalloc"
+assert_dump_ir test_opt.c test_opt.out -O2
+
+assert_return test_regalloc.c 33
+assert_return_ir test_regalloc.c 33 -O2
+assert_return_ir test_regalloc.c 33 "-O2 -fno-regalloc"
+
+assert_return test_regexpr.c 122
+assert_return_ir test_regexpr.c 122 -O1
+assert_return_ir test_regexpr.c 122 -O2
+
+assert_return test_object.c 231
+assert_return_obj test_object.c 231
+assert_return_obj test_object.c 231 -O1
+assert_return_obj test_object.c 231 -O2
+assert_return_obj test_regexpr.c 122 -O1
+assert_return_obj test_regalloc.c 33 -O2
 
 assert_return test_enum.c 4
 
@@ -198,6 +391,8 @@ assert_return test_vector.c 30
 
 assert_return test_stack.c 6
 
+assert_return test_arena.c 117
+
 assert_return test_strptrmap.c 10
 
 assert_output test_printf.c "Hello, World."
@@ -209,7 +404,17 @@ assert_return test_tokenizer_2.c 20
 assert_return test_tokenizer_3.c 51
 assert_return test_tokenizer_4.c 202
 assert_return test_tokenizer_5.c 45
+assert_return test_tokenizer_6.c 109
 
 assert_return test_preprocessor.c 202
 
+assert_parallel_parse 4
+
+assert_return_nested else-if 100000 99
+assert_return_nested binary 1000000 64
+assert_return_nested paren 200000 1
+assert_return_nested right 100000 160
+assert_return_nested unary 100000 1
+assert_return_nested cond 100000 99
+
 echo -e "\e[36mPassed all tests.\e[0m"
@@ -0,0 +1,99 @@
+#define NULL 0
+
+typedef struct ArenaChunk ArenaChunk;
+struct ArenaChunk {
+    char*       addr;
+    int         used;
+    int         capacity;
+    ArenaChunk* next;
+};
+
+typedef struct Arena Arena;
+struct Arena {
+    ArenaChunk* head;
+    int         chunk_size;
+    int         alloc_count;
+    int         alloc_bytes;
+    int         chunk_count;
+};
+
+Arena* create_arena(int chunk_size) {
+    Arena* arena      = calloc(1, sizeof(Arena));
+    arena->head       = NULL;
+    arena->chunk_size = chunk_size;
+
+    return arena;
+}
+
+ArenaChunk* add_arena_chunk(Arena* arena, int size) {
+    int capacity = arena->chunk_size;
+    if (capacity < size) {
+        capacity = size;
+    }
+
+    ArenaChunk* chunk = malloc(sizeof(ArenaChunk));
+    chunk->addr       = calloc(capacity, sizeof(char));
+    chunk->used       = 0;
+    chunk->capacity   = capacity;
+    chunk->next       = arena->head;
+
+    arena->head = chunk;
+    ++(arena->chunk_count);
+
+    return chunk;
+}
+
+void* arena_alloc(Arena* arena, int size) {
+    size = (size + 7) / 8 * 8;
+
+    ArenaChunk* chunk = arena->head;
+    if (chunk == NULL) {
+        chunk = add_arena_chunk(arena, size);
+    }
+    else if (chunk->used + size > chunk->capacity) {
+        chunk = add_arena_chunk(arena, size);
+    }
+
+    void* addr = chunk->addr + chunk->used;
+    chunk->used += size;
+
+    ++(arena->alloc_count);
+    arena->alloc_bytes += size;
+
+    return addr;
+}
+
+void arena_release(Arena* arena) {
+    ArenaChunk* chunk = arena->head;
+    while (chunk != NULL) {
+        ArenaChunk* next = chunk->next;
+        free(chunk->addr);
+        free(chunk);
+        chunk = next;
+    }
+
+    arena->head = NULL;
+}
+
+int main() {
+    Arena* arena = create_arena(32);
+
+    int* a = arena_alloc(arena, 8);
+    int* b = arena_alloc(arena, 5);
+    int* c = arena_alloc(arena, 24);
+    int* d = arena_alloc(arena, 64);
+
+    *a = 1;
+    *b = 2;
+    *c = 3;
+    *d = *a + *b + *c;
+
+    int r = *d;                 // 6
+    r += arena->alloc_count;    // 4
+    r += arena->alloc_bytes;    // 8 + 8 + 24 + 64
+    r += arena->chunk_count;    // 3
+
+    arena_release(arena);
+
+    return r;
+}
@@ -0,0 +1,15 @@
+int f(int x) {
+    return x;
+}
+
+int main() {
+    int a = 0;
+    int b = 0;
+    for (int i = 0; i < 3000000; i++) {
+        f(i);
+        a++;
+        b = 1, f(b);
+        f(a), b = 2;
+    }
+    return a % 256 + b;
+}
@@ -0,0 +1,21 @@
+static int twice(int x);
+
+static int add_one(int x) {
+    return twice(x) + 1;
+}
+
+// never called: not parsed, so what minic cannot compile does not matter
+static int unused(int x) {
+    do {
+        x = x - 1;
+    } while (x > 0);
+    return x;
+}
+
+int main() {
+    return add_one(10);
+}
+
+static int twice(int x) {
+    return x * 2;
+}
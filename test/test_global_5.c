@@ -0,0 +1,19 @@
+int add(int a, int b);
+int seven();
+static const char* name(int n);
+
+int x = 3, y;
+char* greeting = "hi";
+
+int add(int a, int b) {
+    return a + b;
+}
+
+int seven() {
+    return 7;
+}
+
+int main() {
+    y = 4;
+    return add(x, y) + seven();
+}
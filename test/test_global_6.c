@@ -0,0 +1,14 @@
+int (x);
+int (y)[3];
+int (triple)(int n);
+
+int triple(int n) {
+    return n * 3;
+}
+
+int main() {
+    int (z) = 5;
+    x = 3;
+    y[2] = 4;
+    return triple(x) + y[2] + z;
+}
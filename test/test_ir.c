@@ -0,0 +1,71 @@
+int total;
+
+int sum_to(int n) {
+    int s = 0;
+    for (int i = 1; i <= n; ++i) {
+        if (i % 3 == 0) {
+            continue;
+        }
+        s += i;
+        if (s > 1000) {
+            break;
+        }
+    }
+    return s;
+}
+
+int classify(int x) {
+    if (x < 0) {
+        return -1;
+    } else if (x == 0) {
+        return 0;
+    } else if (x < 10) {
+        return 1;
+    }
+    return x > 100 ? 3 : 2;
+}
+
+int swap_loop(int n) {
+    int a = 1;
+    int b = 2;
+    while (n > 0) {
+        int t = a;
+        a = b;
+        b = t;
+        n--;
+    }
+    return a * 10 + b;
+}
+
+int shadow(int x) {
+    int y = x;
+    {
+        int x = 5;
+        y = y + x;
+    }
+    return y + x;
+}
+
+int count(int n) {
+    int c = 0;
+    while (n > 0 && n % 7 != 0) {
+        total++;
+        c = c + 1;
+        n = n - 1;
+    }
+    return c;
+}
+
+int first(char* s) {
+    return s[0];
+}
+
+int main() {
+    int r = sum_to(20);
+    r = r + classify(-5) + classify(0) + classify(5) + classify(50) + classify(500);
+    r = r + swap_loop(3) + swap_loop(4);
+    r = r + shadow(2);
+    r = r + count(20) + total;
+    r = r - first("a");
+    return r;
+}
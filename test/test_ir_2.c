@@ -0,0 +1,22 @@
+int first(int a, int b) {
+    return a;
+}
+
+// the && leaves through a block whose both successors have phis, and the
+// then block is the one numbered next
+int branch(int a) {
+    int y = 5;
+    int z = 0;
+    if (a) {
+        for (int i = 0; i < 1; i++) {
+            for (int j = 0; j < 1; j++) {
+            }
+            y = first(1, z && a);
+        }
+    }
+    return y;
+}
+
+int main() {
+    return branch(7);
+}
@@ -0,0 +1,26 @@
+int x = 5;
+
+int main() {
+    int a = x;
+    int x = 10;
+    int sum = a + x;
+    {
+        int x = 100;
+        sum = sum + x;
+        {
+            int x = 1000;
+            sum = sum + x;
+        }
+        sum = sum + x;
+    }
+    for (int x = 0; x < 3; x++) {
+        sum = sum + x;
+    }
+    for (int i = 0; i < 2; i++) {
+        int x = 20;
+        sum = sum + x;
+    }
+    sum = sum + x;
+
+    return sum % 256;
+}
@@ -0,0 +1,38 @@
+int counter;
+int limit = 1000000;
+char* greeting = "hi\n";
+char* names[3] = { "r8", "tab\there", "quote\"\\" };
+
+// string escapes, which the built-in assembler decodes itself
+int escapes() {
+    char* s = "a\tb\n\101\x42\"\\";
+    int sum = 0;
+    for (int i = 0; s[i] != 0; i = i + 1) {
+        sum = sum + s[i];
+    }
+    return sum + strlen(s);
+}
+
+// negative and large immediates and displacements
+int immediates(int x) {
+    int big = limit * 3 - 2999999;
+    int small = -129;
+    int local[40];
+    local[0] = x;
+    local[39] = big + small;
+    return local[0] + local[39] + (x < -200) + (x >= 128);
+}
+
+// calls to libc go through the PLT, globals are read rip-relative
+int globals() {
+    counter = counter + strlen(greeting);
+    counter = counter + strlen(names[1]) + strlen(names[2]);
+    if (strcmp(names[0], "r8") == 0) {
+        counter = counter + 1;
+    }
+    return counter;
+}
+
+int main() {
+    return escapes() % 100 + immediates(5) + globals();
+}
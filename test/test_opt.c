@@ -0,0 +1,65 @@
+int g;
+
+// constfold and simplifycfg: the branch on a constant goes away
+int folded(int x) {
+    int k = 6 * 7;
+    if (k - 42) {
+        return x + 1;
+    }
+    return x * 1 + 0 + k;
+}
+
+// cse: a * b once, and b > a is a < b
+int common(int a, int b) {
+    int x = a * b + 1;
+    int y = a * b + 2;
+    if (b > a) {
+        return x + y + (a < b);
+    }
+    return x - y;
+}
+
+// licm: n * n is computed before the loop
+int invariant(int n) {
+    int s = 0;
+    for (int i = 0; i < 10; ++i) {
+        s = s + n * n + i;
+    }
+    return s;
+}
+
+// dce: unused is dropped, the store to g is kept
+int dead(int x) {
+    int unused = x * 3;
+    g = x;
+    return x;
+}
+
+// a division by 0 and an overflow are left to run time
+int guarded(int x) {
+    if (x != 0) {
+        return 1 / 0 + 2147483647 * 2;
+    }
+    int big = 2147483647;
+    return big + 0 - 2147483600;
+}
+
+// simplifycfg: the exit of the inner loop bypasses its empty block, so the
+// outer loop leaves into the join of the if, where y has a phi, and its
+// branch has copies on both edges
+int nested(int n) {
+    int y = 5;
+    if (n) {
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+            }
+            y = y + i;
+        }
+    }
+    return y;
+}
+
+int main() {
+    int r = folded(5) + common(3, 4) + invariant(3) + dead(4) + g + guarded(0) + nested(3);
+    return r - 100;
+}
@@ -0,0 +1,6 @@
+int main() {
+    Pair pair;
+    pair.first  = PCH_BASE;
+    pair.second = BLUE;
+    return sum(&pair);
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_PCH_H
+#define TEST_PCH_H
+
+#define PCH_BASE 40
+
+typedef struct Pair Pair;
+struct Pair {
+    int first;
+    int second;
+};
+
+enum Color {
+    RED,
+    GREEN,
+    BLUE
+};
+
+int sum(Pair* pair) {
+    return pair->first + pair->second;
+}
+
+#endif
@@ -0,0 +1,10 @@
+#include "test/test_preprocess_6.h"
+#include "test/test_preprocess_7.h"
+#include "test/test_preprocess_6.h"
+#include "./test/test_preprocess_6.h"
+#include "test/test_preprocess_7.h"
+#include "./test/../test/test_preprocess_7.h"
+
+int main() {
+    return guarded() + once();
+}
@@ -0,0 +1,8 @@
+#ifndef TEST_PREPROCESS_6_H
+#define TEST_PREPROCESS_6_H
+
+int guarded() {
+    return 2;
+}
+
+#endif
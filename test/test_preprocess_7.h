@@ -0,0 +1,5 @@
+#pragma once
+
+int once() {
+    return 5;
+}
@@ -0,0 +1,62 @@
+int g;
+
+int sub(int a, int b) {
+    return a - b;
+}
+
+int sum6(int a, int b, int c, int d, int e, int f) {
+    return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f;
+}
+
+// more values live at once than there are registers: some are spilled
+int pressure(int x) {
+    int a = x + 1;
+    int b = x + 2;
+    int c = x + 3;
+    int d = x + 4;
+    int e = x + 5;
+    int f = x + 6;
+    int h = x + 7;
+    int i = x + 8;
+    int j = x + 9;
+    int k = x + 10;
+    int l = x + 11;
+    int m = x + 12;
+    int n = x + 13;
+    int o = x + 14;
+    g = o;
+    return a * b - c * d + e * f - h * i + j * k - l * m + n * o / a % 7;
+}
+
+// values live across calls stay in the callee-saved registers
+int across(int x, int y) {
+    int a = x * 3;
+    int b = y * 5;
+    int c = sub(b, a);
+    int d = sub(a, c) + sub(c, b);
+    return a + b + c + d;
+}
+
+// the arguments are the parameters swapped: a cycle of moves
+int rotate(int a, int b, int c, int d, int e, int f) {
+    return sum6(f, a, b, c, d, e) - sum6(b, a, d, c, f, e);
+}
+
+// the phis of the loop swap a and b each time around
+int swap(int n) {
+    int a = 1;
+    int b = 2;
+    int c = 0;
+    for (int i = 0; i < n; ++i) {
+        int t = a;
+        a = b;
+        b = t;
+        c = c * 2 + a;
+    }
+    return c + a * 10 + b;
+}
+
+int main() {
+    int r = pressure(1) + across(4, 7) + rotate(1, 2, 3, 4, 5, 6) + swap(5) + g;
+    return r % 256;
+}
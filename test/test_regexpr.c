@@ -0,0 +1,123 @@
+int g;
+int table[4];
+
+enum Kind {
+    ZERO,
+    ONE,
+    TWO,
+};
+
+// mixes the operand kinds: constants, enumerators, ints, chars, globals,
+// dereferences, and a division and a remainder in the middle of a tree
+int arith(int x, int y) {
+    char c = 200;
+    int* p = &x;
+    g = TWO * 5 + ZERO;
+    return x - (y / (x % 4 + ONE)) * (x % y) + c / 7 - *p * g + (y < x) + !y;
+}
+
+// compound assignments to variables and through addresses
+int assign(int n) {
+    int x = n;
+    char c = 0;
+    c = n * 30 - 1;
+    x += n * 2;
+    x -= n - 1;
+    x *= 3;
+    x /= n - 2;
+    x %= 100;
+    table[1] = x;
+    table[1] += c;
+    table[2] = table[1] * 2;
+    table[2] -= x;
+    table[2] /= 2;
+    int* p = &table[3];
+    *p = n;
+    *p *= 7;
+    *p %= 10;
+    return table[1] + table[2] + table[3];
+}
+
+// compares as conditions, and || as a value
+int conds(int n) {
+    int s = 0;
+    for (int i = 0; i < n; ++i) {
+        if (i % 3 == 0) {
+            s = s + i;
+        }
+        else if (i > n - 3 || i == 1) {
+            s = s + 100;
+        }
+    }
+    int j = n;
+    while (j >= 0) {
+        j = j - 4;
+    }
+    return s + j;
+}
+
+// needs more registers than there are: they run out at the root
+int spill() {
+    char a = 3;
+    char b = 7;
+    char c = 11;
+    char d = 2;
+    char e = 5;
+    char f = 13;
+    return
+        (((((((((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 + 6)) - (((c - d) + (e
+        - f)) / (((a - b) + (c - d)) % 5 + 6))) + ((((e - f) + (a - b)) / (((c - d)
+        + (e - f)) % 5 + 6)) - (((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 +
+        6)))) / ((((((c - d) + (e - f)) / (((a - b) + (c - d)) % 5 + 6)) - (((e - f)
+        + (a - b)) / (((c - d) + (e - f)) % 5 + 6))) + ((((a - b) + (c - d)) / (((e
+        - f) + (a - b)) % 5 + 6)) - (((c - d) + (e - f)) / (((a - b) + (c - d)) % 5
+        + 6)))) % 5 + 6)) - ((((((e - f) + (a - b)) / (((c - d) + (e - f)) % 5 + 6))
+        - (((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 + 6))) + ((((c - d) + (e -
+        f)) / (((a - b) + (c - d)) % 5 + 6)) - (((e - f) + (a - b)) / (((c - d) + (e
+        - f)) % 5 + 6)))) / ((((((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 + 6))
+        - (((c - d) + (e - f)) / (((a - b) + (c - d)) % 5 + 6))) + ((((e - f) + (a -
+        b)) / (((c - d) + (e - f)) % 5 + 6)) - (((a - b) + (c - d)) / (((e - f) + (a
+        - b)) % 5 + 6)))) % 5 + 6))) + (((((((c - d) + (e - f)) / (((a - b) + (c -
+        d)) % 5 + 6)) - (((e - f) + (a - b)) / (((c - d) + (e - f)) % 5 + 6))) +
+        ((((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 + 6)) - (((c - d) + (e -
+        f)) / (((a - b) + (c - d)) % 5 + 6)))) / ((((((e - f) + (a - b)) / (((c - d)
+        + (e - f)) % 5 + 6)) - (((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 +
+        6))) + ((((c - d) + (e - f)) / (((a - b) + (c - d)) % 5 + 6)) - (((e - f) +
+        (a - b)) / (((c - d) + (e - f)) % 5 + 6)))) % 5 + 6)) - ((((((a - b) + (c -
+        d)) / (((e - f) + (a - b)) % 5 + 6)) - (((c - d) + (e - f)) / (((a - b) + (c
+        - d)) % 5 + 6))) + ((((e - f) + (a - b)) / (((c - d) + (e - f)) % 5 + 6)) -
+        (((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 + 6)))) / ((((((c - d) + (e
+        - f)) / (((a - b) + (c - d)) % 5 + 6)) - (((e - f) + (a - b)) / (((c - d) +
+        (e - f)) % 5 + 6))) + ((((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 + 6))
+        - (((c - d) + (e - f)) / (((a - b) + (c - d)) % 5 + 6)))) % 5 + 6)))) /
+        (((((((((e - f) + (a - b)) / (((c - d) + (e - f)) % 5 + 6)) - (((a - b) + (c
+        - d)) / (((e - f) + (a - b)) % 5 + 6))) + ((((c - d) + (e - f)) / (((a - b)
+        + (c - d)) % 5 + 6)) - (((e - f) + (a - b)) / (((c - d) + (e - f)) % 5 +
+        6)))) / ((((((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 + 6)) - (((c - d)
+        + (e - f)) / (((a - b) + (c - d)) % 5 + 6))) + ((((e - f) + (a - b)) / (((c
+        - d) + (e - f)) % 5 + 6)) - (((a - b) + (c - d)) / (((e - f) + (a - b)) % 5
+        + 6)))) % 5 + 6)) - ((((((c - d) + (e - f)) / (((a - b) + (c - d)) % 5 + 6))
+        - (((e - f) + (a - b)) / (((c - d) + (e - f)) % 5 + 6))) + ((((a - b) + (c -
+        d)) / (((e - f) + (a - b)) % 5 + 6)) - (((c - d) + (e - f)) / (((a - b) + (c
+        - d)) % 5 + 6)))) / ((((((e - f) + (a - b)) / (((c - d) + (e - f)) % 5 + 6))
+        - (((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 + 6))) + ((((c - d) + (e -
+        f)) / (((a - b) + (c - d)) % 5 + 6)) - (((e - f) + (a - b)) / (((c - d) + (e
+        - f)) % 5 + 6)))) % 5 + 6))) + (((((((a - b) + (c - d)) / (((e - f) + (a -
+        b)) % 5 + 6)) - (((c - d) + (e - f)) / (((a - b) + (c - d)) % 5 + 6))) +
+        ((((e - f) + (a - b)) / (((c - d) + (e - f)) % 5 + 6)) - (((a - b) + (c -
+        d)) / (((e - f) + (a - b)) % 5 + 6)))) / ((((((c - d) + (e - f)) / (((a - b)
+        + (c - d)) % 5 + 6)) - (((e - f) + (a - b)) / (((c - d) + (e - f)) % 5 +
+        6))) + ((((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 + 6)) - (((c - d) +
+        (e - f)) / (((a - b) + (c - d)) % 5 + 6)))) % 5 + 6)) - ((((((e - f) + (a -
+        b)) / (((c - d) + (e - f)) % 5 + 6)) - (((a - b) + (c - d)) / (((e - f) + (a
+        - b)) % 5 + 6))) + ((((c - d) + (e - f)) / (((a - b) + (c - d)) % 5 + 6)) -
+        (((e - f) + (a - b)) / (((c - d) + (e - f)) % 5 + 6)))) / ((((((a - b) + (c
+        - d)) / (((e - f) + (a - b)) % 5 + 6)) - (((c - d) + (e - f)) / (((a - b) +
+        (c - d)) % 5 + 6))) + ((((e - f) + (a - b)) / (((c - d) + (e - f)) % 5 + 6))
+        - (((a - b) + (c - d)) / (((e - f) + (a - b)) % 5 + 6)))) % 5 + 6)))) % 5 +
+        6));
+}
+
+int main() {
+    return (arith(23, 5) + assign(6) + conds(10) + spill() + 1000) % 256;
+}
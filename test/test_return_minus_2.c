@@ -0,0 +1,5 @@
+// the literal is the minimum int where int has 32 bits
+int main() {
+    int min = -2147483648;
+    return min / -16777216;
+}
@@ -0,0 +1,10 @@
+int main() {
+    int a = 3;
+    int b = 3;
+
+    int r = 20 - 5 - 3 + a * b / 3 % 2;
+    r += 1 < 2 == 1;
+    r += (a == 3) ? (b == 4) ? 100 : 10 : 1;
+
+    return r;
+}
@@ -0,0 +1,26 @@
+int main() {
+    int s = 0;
+    for (int i = 0; i < 3000000; ++i) {
+        switch (i % 3) {
+        case 0: {
+            s = s + 1;
+            continue;
+        }
+        case 1: {
+            switch (i % 2) {
+            case 0: { continue; }
+            default: { s = s + 2; break; }
+            }
+            break;
+        }
+        }
+        s = s + 3;
+    }
+    int j = 0;
+    while (j < 5) {
+        ++j;
+        switch (j) { case 2: { continue; } }
+        s = s + j;
+    }
+    return s % 256;
+}
@@ -0,0 +1,4 @@
+int main() {
+    int x = 3;
+    return x +* ;
+}
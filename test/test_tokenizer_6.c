@@ -0,0 +1,84 @@
+char** names;
+int* lens;
+int* types;
+
+int calc_hash(char* p, int len) {
+    return (len + p[0] * 22 + p[len - 1] * 14) % 64;
+}
+
+int add_keyword(char* name, int type) {
+    int len = strlen(name);
+    int h = calc_hash(name, len);
+    if (names[h] != 0) {
+        return 0;
+    }
+
+    names[h] = name;
+    lens[h]  = len;
+    types[h] = type;
+
+    return 1;
+}
+
+int find_keyword(char* p, int len) {
+    if (len < 2 || len > 8) {
+        return 0;
+    }
+
+    int h = calc_hash(p, len);
+    if (lens[h] != len) {
+        return 0;
+    }
+    if (memcmp(names[h], p, len) != 0) {
+        return 0;
+    }
+
+    return types[h];
+}
+
+int main() {
+    names = calloc(64, sizeof(char*));
+    lens  = calloc(64, sizeof(int));
+    types = calloc(64, sizeof(int));
+
+    char* keywords = malloc(sizeof(char) * 256);
+    strncpy(keywords, "static typedef void char short int long unsigned double struct union enum const if else for while do switch case default goto break continue return sizeof", 256);
+
+    int type = 0;
+    int pos = 0;
+    int len = 0;
+    while (keywords[pos]) {
+        len = 0;
+        while (isalpha(keywords[pos + len])) {
+            ++len;
+        }
+        ++type;
+        if (!add_keyword(strndup(&keywords[pos], len), type)) {
+            return 255;
+        }
+        pos += len;
+        while (isspace(keywords[pos])) {
+            ++pos;
+        }
+    }
+
+    char* str = malloc(sizeof(char) * 256);
+    strncpy(str, "while hoge do dox long unsigned goto gotoo sizeof x union", 256);
+
+    int ret = 0;
+    pos = 0;
+    while (str[pos]) {
+        if (isspace(str[pos])) {
+            ++pos;
+            continue;
+        }
+        len = 0;
+        while (isalpha(str[pos + len])) {
+            ++len;
+        }
+        ret += find_keyword(&str[pos], len);
+        pos += len;
+    }
+
+    return ret; // 17 + 18 + 7 + 8 + 22 + 26 + 11
+}
@@ -0,0 +1,18 @@
+typedef struct Pair Pair;
+struct Pair {
+    int first;
+    int second;
+};
+
+int sum(Pair* pair) {
+    return pair->first + pair->second;
+}
+
+int main() {
+    Pair pair;
+    pair.first  = 3;
+    pair.second = 4;
+    int size = sizeof(Pair);
+
+    return sum(&pair) + size + sizeof(size);
+}
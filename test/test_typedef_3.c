@@ -0,0 +1,23 @@
+// T is declared as a typedef-name after f, so it is a variable in f
+int f() {
+    int T = 3;
+    return T;
+}
+
+struct S {
+    int a;
+};
+typedef struct S T;
+
+// after a type specifier, T is the declarator
+int g() {
+    int T = 4;
+    return T;
+}
+
+int main() {
+    T s;
+    s.a = f() * 10;
+
+    return s.a + g();
+}
@@ -7,6 +7,43 @@
 
 #include "util.h"
 
+#ifdef MINIC_SIMD
+#include <stdint.h>
+#include <immintrin.h>
+#endif
+
+#define TOKEN_ARENA_CHUNK_SIZE 65536
+
+static Arena* shared_token_arena; // holds the tokens of tokenize()
+static Arena* token_arena;        // the tokens being read are allocated in
+static bool   tokenizer_ready;
+
+//
+// Character classes
+//
+
+enum CharClass {
+    CC_OTHER,
+    CC_SPACE,
+    CC_IDENT,   // letter or '_'
+    CC_DIGIT,
+    CC_SYMBOL,
+    CC_SLASH,   // '/' begins a comment or a symbol
+    CC_HASH,
+    CC_QUOTE,
+    CC_DQUOTE
+};
+
+// Same set as isspace() in the "C" locale; '\v' is written in octal for the assembler.
+#define SPACE_CHARS " \t\n\013\f\r"
+
+static int* char_classes;
+
+// Runs of whitespace, comments and string literals are skipped 16 or 32
+// bytes at a time with SSE2 or AVX2 when built with MINIC_SIMD, and with
+// the libc string functions otherwise, instead of byte by byte.
+static bool vector_scan = true;
+
 static bool is_symbol(char p) {
     switch (p) {
     case '+': case '-':
@@ -30,44 +67,403 @@ static bool is_symbol(char p) {
     }
 }
 
-static Token* read_directive(const char* p, int* pos) {
-    ++(*pos);
+static void init_char_classes() {
+    char_classes = calloc(256, sizeof(int));
+    for (int c = 1; c < 256; ++c) {
+        if (isspace(c)) {
+            char_classes[c] = CC_SPACE;
+        }
+        else if (isalpha(c) || c == '_') {
+            char_classes[c] = CC_IDENT;
+        }
+        else if (isdigit(c)) {
+            char_classes[c] = CC_DIGIT;
+        }
+        else if (is_symbol(c)) {
+            char_classes[c] = CC_SYMBOL;
+        }
+    }
+    char_classes['/']  = CC_SLASH;
+    char_classes['#']  = CC_HASH;
+    char_classes['\''] = CC_QUOTE;
+    char_classes['"']  = CC_DQUOTE;
+}
 
-    int len = 0;
-    while (p[*pos + len] != ' ' && p[*pos + len] != '\n') {
-        ++len;
+static int char_class(char c) {
+    int index = c;
+    if (index < 0) {
+        index += 256;
+    }
+    return char_classes[index];
+}
+
+static bool is_ident_char(char c) {
+    const int cc = char_class(c);
+    return (cc == CC_IDENT || cc == CC_DIGIT);
+}
+
+void set_vector_scan(bool enable) {
+    vector_scan = enable;
+}
+
+//
+// Scanning
+//
+
+#ifdef MINIC_SIMD
+
+// The scanners load aligned blocks, starting with the one that holds pos.
+// An aligned load never crosses a page, so reading past the terminating
+// '\0' to the end of its block is safe, though not to ASan. The bytes of
+// the first block before pos are shifted out of the match mask. The build
+// has no -O, and intrinsics at -O0 are slower than the byte loops, so the
+// scanners are optimized on their own.
+
+static bool simd_avx2; // set by init_simd_scan()
+
+static void init_simd_scan() {
+    __builtin_cpu_init();
+    simd_avx2 = __builtin_cpu_supports("avx2");
+}
+
+// The mask has a bit per byte of the block that is c0, c1 or '\0'.
+__attribute__((optimize("O2"), no_sanitize_address))
+static unsigned int simd_match_mask_16(const char* block, char c0, char c1) {
+    const __m128i x = _mm_load_si128((const __m128i*)block);
+    const __m128i match = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(c0)), _mm_cmpeq_epi8(x, _mm_set1_epi8(c1)));
+    return _mm_movemask_epi8(_mm_or_si128(match, _mm_cmpeq_epi8(x, _mm_setzero_si128())));
+}
+
+__attribute__((target("avx2"), optimize("O2"), no_sanitize_address))
+static unsigned int simd_match_mask_32(const char* block, char c0, char c1) {
+    const __m256i x = _mm256_load_si256((const __m256i*)block);
+    const __m256i match = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(c0)), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(c1)));
+    return _mm256_movemask_epi8(_mm256_or_si256(match, _mm256_cmpeq_epi8(x, _mm256_setzero_si256())));
+}
+
+__attribute__((optimize("O2"), no_sanitize_address))
+static int simd_find_16(const char* p, int pos, char c0, char c1) {
+    const int skip = (uintptr_t)(p + pos) % 16;
+    const char* block = p + pos - skip;
+    const unsigned int mask = simd_match_mask_16(block, c0, c1) >> skip;
+    if (mask != 0) {
+        return pos + __builtin_ctz(mask);
+    }
+
+    while (true) {
+        block += 16;
+        const unsigned int next_mask = simd_match_mask_16(block, c0, c1);
+        if (next_mask != 0) {
+            return (block - p) + __builtin_ctz(next_mask);
+        }
+    }
+}
+
+__attribute__((target("avx2"), optimize("O2"), no_sanitize_address))
+static int simd_find_32(const char* p, int pos, char c0, char c1) {
+    const int skip = (uintptr_t)(p + pos) % 32;
+    const char* block = p + pos - skip;
+    const unsigned int mask = simd_match_mask_32(block, c0, c1) >> skip;
+    if (mask != 0) {
+        return pos + __builtin_ctz(mask);
+    }
+
+    while (true) {
+        block += 32;
+        const unsigned int next_mask = simd_match_mask_32(block, c0, c1);
+        if (next_mask != 0) {
+            return (block - p) + __builtin_ctz(next_mask);
+        }
+    }
+}
+
+// Returns the position of the first of c0, c1 and '\0' from pos.
+static int simd_find(const char* p, int pos, char c0, char c1) {
+    if (simd_avx2) {
+        return simd_find_32(p, pos, c0, c1);
+    }
+    return simd_find_16(p, pos, c0, c1);
+}
+
+// SPACE_CHARS are ' ' and '\t' .. '\r': x is in the range when x - '\t',
+// as an unsigned byte, is at most 4. The mask has a bit per other byte.
+__attribute__((optimize("O2"), no_sanitize_address))
+static unsigned int simd_non_space_mask_16(const char* block) {
+    const __m128i x = _mm_load_si128((const __m128i*)block);
+    const __m128i d = _mm_sub_epi8(x, _mm_set1_epi8('\t'));
+    const __m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(4)), d));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(is_space, _mm_setzero_si128()));
+}
+
+__attribute__((target("avx2"), optimize("O2"), no_sanitize_address))
+static unsigned int simd_non_space_mask_32(const char* block) {
+    const __m256i x = _mm256_load_si256((const __m256i*)block);
+    const __m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8('\t'));
+    const __m256i is_space = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(4)), d));
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(is_space, _mm256_setzero_si256()));
+}
+
+__attribute__((optimize("O2"), no_sanitize_address))
+static int simd_skip_spaces_16(const char* p, int pos) {
+    const int skip = (uintptr_t)(p + pos) % 16;
+    const char* block = p + pos - skip;
+    const unsigned int mask = simd_non_space_mask_16(block) >> skip;
+    if (mask != 0) {
+        return pos + __builtin_ctz(mask);
+    }
+
+    while (true) {
+        block += 16;
+        const unsigned int next_mask = simd_non_space_mask_16(block);
+        if (next_mask != 0) {
+            return (block - p) + __builtin_ctz(next_mask);
+        }
+    }
+}
+
+__attribute__((target("avx2"), optimize("O2"), no_sanitize_address))
+static int simd_skip_spaces_32(const char* p, int pos) {
+    const int skip = (uintptr_t)(p + pos) % 32;
+    const char* block = p + pos - skip;
+    const unsigned int mask = simd_non_space_mask_32(block) >> skip;
+    if (mask != 0) {
+        return pos + __builtin_ctz(mask);
     }
 
-    Token* token  = calloc(1, sizeof(Token));
-    token->type   = TK_HASH;
-    token->strlen = len;
-    token->str    = malloc(sizeof(char) * token->strlen + 1);
-    strncpy(token->str, &p[*pos], token->strlen);
-    token->str[token->strlen] = '\0';
+    while (true) {
+        block += 32;
+        const unsigned int next_mask = simd_non_space_mask_32(block);
+        if (next_mask != 0) {
+            return (block - p) + __builtin_ctz(next_mask);
+        }
+    }
+}
 
-    *pos += len; 
+#endif
 
-    int a = 0;
-    while (p[*pos + a] == ' ') {
-        ++a;
+static int skip_spaces(const char* p, int pos) {
+    if (vector_scan) {
+#ifdef MINIC_SIMD
+        // between most tokens there is no space or a single one
+        if (char_class(p[pos]) != CC_SPACE) {
+            return pos;
+        }
+        if (char_class(p[pos + 1]) != CC_SPACE) {
+            return pos + 1;
+        }
+        if (simd_avx2) {
+            return simd_skip_spaces_32(p, pos);
+        }
+        return simd_skip_spaces_16(p, pos);
+#else
+        return pos + strspn(&p[pos], SPACE_CHARS);
+#endif
     }
 
-    while (isalpha(p[*pos + a]) || p[*pos + a] == '_' || isdigit(p[*pos +a])) {
-        ++a;
+    while (char_class(p[pos]) == CC_SPACE) {
+        ++pos;
     }
+    return pos;
+}
 
-    while (p[*pos + a] == ' ') {
-        ++a;
+// Returns the position of the '\n' ending the line, or of the terminating '\0'.
+static int find_line_end(const char* p, int pos) {
+    if (vector_scan) {
+#ifdef MINIC_SIMD
+        return simd_find(p, pos, '\n', '\n');
+#else
+        const char* end = strchr(&p[pos], '\n');
+        if (end == NULL) {
+            return pos + strlen(&p[pos]);
+        }
+        return end - p;
+#endif
     }
 
-    if (p[*pos + a] != '\n') {
-        token->has_value = true;
+    while (p[pos] != '\n' && p[pos] != '\0') {
+        ++pos;
     }
+    return pos;
+}
+
+// pos is at "/*". Returns the position just after "*/", or of the terminating '\0'.
+static int skip_block_comment(const char* p, int pos) {
+    pos += 2;
+    if (vector_scan) {
+#ifdef MINIC_SIMD
+        while (true) {
+            pos = simd_find(p, pos, '*', '*');
+            if (p[pos] == '\0') {
+                return pos;
+            }
+            if (p[pos + 1] == '/') {
+                return pos + 2;
+            }
+            ++pos;
+        }
+#else
+        const char* end = strstr(&p[pos], "*/");
+        if (end == NULL) {
+            return pos + strlen(&p[pos]);
+        }
+        return (end - p) + 2;
+#endif
+    }
+
+    while (p[pos] != '\0') {
+        if (p[pos] == '*' && p[pos + 1] == '/') {
+            return pos + 2;
+        }
+        ++pos;
+    }
+    return pos;
+}
+
+// pos is just after the opening '"'. Returns the position of the closing '"',
+// or of the terminating '\0' when the literal is not closed.
+static int find_string_end(const char* p, int pos) {
+    while (true) {
+        if (vector_scan) {
+#ifdef MINIC_SIMD
+            pos = simd_find(p, pos, '"', '\\');
+#else
+            pos += strcspn(&p[pos], "\"\\");
+#endif
+        }
+        else {
+            while (p[pos] != '"' && p[pos] != '\\' && p[pos] != '\0') {
+                ++pos;
+            }
+        }
+
+        if (p[pos] != '\\' || p[pos + 1] == '\0') {
+            return pos;
+        }
+        pos += 2;
+    }
+}
+
+//
+// Keywords
+//
+// A perfect hash of the length and the first and last characters maps every
+// keyword to its own slot, so an identifier is recognized with one slot
+// lookup and one memcmp. The multipliers were searched offline for the
+// keywords below; init_keywords() reports a collision when a new keyword
+// needs them to be searched again.
+//
+
+#define KEYWORD_SLOT_COUNT 64
+#define KEYWORD_MIN_LEN    2
+#define KEYWORD_MAX_LEN    8
+#define KEYWORD_HASH_FIRST 22
+#define KEYWORD_HASH_LAST  14
+
+static const char** keyword_names;
+static int*         keyword_lens;
+static int*         keyword_types;
+
+static int calc_keyword_hash(const char* p, int len) {
+    return (len + p[0] * KEYWORD_HASH_FIRST + p[len - 1] * KEYWORD_HASH_LAST) % KEYWORD_SLOT_COUNT;
+}
+
+static bool add_keyword(const char* name, int type) {
+    const int len = strlen(name);
+    const int h   = calc_keyword_hash(name, len);
+    if (keyword_names[h] != NULL) {
+        error("Keywords \"%s\" and \"%s\" collide.\n", keyword_names[h], name);
+        return false;
+    }
+
+    keyword_names[h] = name;
+    keyword_lens[h]  = len;
+    keyword_types[h] = type;
+
+    return true;
+}
+
+static bool init_keywords() {
+    keyword_names = calloc(KEYWORD_SLOT_COUNT, sizeof(char*));
+    keyword_lens  = calloc(KEYWORD_SLOT_COUNT, sizeof(int));
+    keyword_types = calloc(KEYWORD_SLOT_COUNT, sizeof(int));
+
+    return add_keyword("static",   TK_STATIC)
+        && add_keyword("typedef",  TK_TYPEDEF)
+        && add_keyword("void",     TK_VOID)
+        && add_keyword("char",     TK_CHAR)
+        && add_keyword("short",    TK_SHORT)
+        && add_keyword("int",      TK_INT)
+        && add_keyword("long",     TK_LONG)
+        && add_keyword("unsigned", TK_UNSIGNED)
+        && add_keyword("double",   TK_DOUBLE)
+        && add_keyword("struct",   TK_STRUCT)
+        && add_keyword("union",    TK_UNION)
+        && add_keyword("enum",     TK_ENUM)
+        && add_keyword("const",    TK_CONST)
+        && add_keyword("if",       TK_IF)
+        && add_keyword("else",     TK_ELSE)
+        && add_keyword("for",      TK_FOR)
+        && add_keyword("while",    TK_WHILE)
+        && add_keyword("do",       TK_DO)
+        && add_keyword("switch",   TK_SWITCH)
+        && add_keyword("case",     TK_CASE)
+        && add_keyword("default",  TK_DEFAULT)
+        && add_keyword("goto",     TK_GOTO)
+        && add_keyword("break",    TK_BREAK)
+        && add_keyword("continue", TK_CONTINUE)
+        && add_keyword("return",   TK_RETURN)
+        && add_keyword("sizeof",   TK_SIZEOF);
+}
+
+// Returns the keyword type of the identifier p[0, len), or TK_IDENT.
+static int find_keyword(const char* p, int len) {
+    if (len < KEYWORD_MIN_LEN || len > KEYWORD_MAX_LEN) {
+        return TK_IDENT;
+    }
+
+    const int h = calc_keyword_hash(p, len);
+    if (keyword_lens[h] != len) {
+        return TK_IDENT;
+    }
+    if (memcmp(keyword_names[h], p, len) != 0) {
+        return TK_IDENT;
+    }
+
+    return keyword_types[h];
+}
+
+//
+// Tokens
+//
+
+static Token* new_token(int type, int pos) {
+    Token* token = arena_alloc(token_arena, sizeof(Token));
+    token->type  = type;
+    token->pos   = pos;
+
+    return token;
+}
+
+static Token* read_directive(const char* p, int* pos) {
+    Token* token = new_token(TK_HASH, *pos);
+    ++(*pos);
+
+    int len = 0;
+    while (p[*pos + len] != ' ' && p[*pos + len] != '\n' && p[*pos + len] != '\0') {
+        ++len;
+    }
+    token->val = intern(&p[*pos], len);
+    *pos += len;
+
+    // The slice spans the whole directive line, so that the preprocessor can tell
+    // whether a following token belongs to the directive (e.g. the value of #define).
+    token->len = find_line_end(p, *pos) - token->pos;
 
     return token;
 }
 
 static Token* read_character(const char* p, int* pos) {
+    const int begin = *pos;
     ++(*pos);
 
     char c = p[*pos];
@@ -101,46 +497,35 @@ static Token* read_character(const char* p, int* pos) {
     }
     ++(*pos);
 
-    Token* token = calloc(1, sizeof(Token));
-    token->type = TK_BYTE;
-    token->num  = c;
+    Token* token = new_token(TK_BYTE, begin);
+    token->val   = c;
+    token->len   = *pos - begin;
 
     return token;
 }
 
 static Token* read_string(const char* p, int* pos) {
+    const int begin = *pos;
     ++(*pos);
-    int len = 0;
-    bool escape = false;
-    while (true) {
-        if (!escape && p[*pos + len] == '"') {
-            break;
-        }
-
-        if (p[*pos + len] == '\\') { 
-            escape = true;
-            ++len;
-        }
-        else {
-            escape = false;
-            ++len;
-        }
+    const int end = find_string_end(p, *pos);
+    if (p[end] != '"') {
+        error("String literal is not closed.\n");
+        return NULL;
     }
+    const int len = end - *pos;
 
-    Token* token  = calloc(1, sizeof(Token));
-    token->type   = TK_STR;
-    token->strlen = len;
-    token->str    = malloc(sizeof(char) * token->strlen + 1);
-    strncpy(token->str, &p[*pos], token->strlen);
-    token->str[token->strlen] = '\0';
+    Token* token = new_token(TK_STR, begin);
+    token->val   = intern(&p[*pos], len);
 
     *pos += (len + 1);
+    token->len = *pos - begin;
 
     return token;
 }
 
 static Token* read_symbol(const char* p, int* pos) {
-    Token* token = calloc(1, sizeof(Token));
+    // the length of the slice is set by the caller
+    Token* token = new_token(TK_HASH, *pos);
 
     const char f = p[*pos];
     ++(*pos);
@@ -398,210 +783,76 @@ static Token* read_symbol(const char* p, int* pos) {
 }
 
 static Token* read_identifier(const char* p, int* pos) {
-    Token* token = calloc(1, sizeof(Token));
-    token->type = TK_IDENT; // Default
+    Token* token = new_token(TK_IDENT, *pos); // Default
 
     int len = 0;
-    while (isdigit(p[*pos + len]) || isalpha(p[*pos + len]) || p[*pos + len] == '_') {
+    while (is_ident_char(p[*pos + len])) {
         ++len;
     }
 
-    //
-    // Check if string equals to keywords.
-    // For speed, avoid comparing with all keywords by using head character.
-    //
-
-    switch (p[*pos]) {
-    case 'b': {
-        if (len != 5) {
-            break;
-        }
-
-        if (strncmp("break", &p[*pos], 5) == 0) {
-            token->type = TK_BREAK;
-        }
-
-        break;
-    }
-    case 'c': {
-        if (len != 4 && len != 5 && len != 8) {
-            break;
-        }
-
-        if      (strncmp("char",     &p[*pos], 4) == 0) { token->type = TK_CHAR;     }
-        else if (strncmp("case",     &p[*pos], 4) == 0) { token->type = TK_CASE;     }
-        else if (strncmp("const",    &p[*pos], 5) == 0) { token->type = TK_CONST;    }
-        else if (strncmp("continue", &p[*pos], 8) == 0) { token->type = TK_CONTINUE; }
-
-        break;
-    }
-    case 'd': {
-        if (len != 6 && len != 7) {
-            break;
-        }
-
-        if      (strncmp("double",  &p[*pos], 6) == 0) { token->type = TK_DOUBLE;  }
-        else if (strncmp("default", &p[*pos], 7) == 0) { token->type = TK_DEFAULT; }
-
-        break;
-    }
-    case 'e': {
-        if (len != 4) {
-            break;
-        }
-
-        if      (strncmp("else",   &p[*pos], 4) == 0) { token->type = TK_ELSE; } 
-        else if (strncmp("enum",   &p[*pos], 4) == 0) { token->type = TK_ENUM; }
-
-        break;
-    }
-    case 'f': {
-        if (len != 3) {
-            break;
-        }
-
-        if (strncmp("for",&p[*pos], 3) == 0) { 
-            token->type = TK_FOR;   
-        }
-
-        break;
-    }
-    case 'i': {
-        if (len != 2 && len != 3) {
-            break;
-        }
-
-        if      (strncmp("if",  &p[*pos], 2) == 0) { token->type = TK_IF;  }
-        else if (strncmp("int", &p[*pos], 3) == 0) { token->type = TK_INT; }
-
-        break;
-    }
-    case 'r': {
-        if (len != 6) {
-            break;
-        }
-
-        if (strncmp("return", &p[*pos], 6) == 0) {
-            token->type = TK_RETURN;   
-        }
-
-        break;
-    }
-    case 's': {
-        if (len != 6) {
-            break;
-        }
-
-        if      (strncmp("struct", &p[*pos], 6) == 0) { token->type = TK_STRUCT; }
-        else if (strncmp("switch", &p[*pos], 6) == 0) { token->type = TK_SWITCH; }
-        else if (strncmp("static", &p[*pos], 6) == 0) { token->type = TK_STATIC; }
-        else if (strncmp("sizeof", &p[*pos], 6) == 0) { token->type = TK_SIZEOF; }
-
-        break;
-    }
-    case 't': {
-        if (len != 7) {
-            break;
-        }
-
-        if (strncmp("typedef", &p[*pos], 7) == 0) { 
-            token->type = TK_TYPEDEF;
-        }
-
-        break;
-    }
-    case 'v': {
-        if (len != 4) {
-            break;
-        }
-
-        if (strncmp("void", &p[*pos], 4) == 0) { 
-            token->type = TK_VOID;
-        }
-
-        break;
-    }
-    case 'w': {
-        if (len != 5) {
-            break;
-        }
-
-        if (strncmp("while", &p[*pos], 5) == 0) {
-            token->type = TK_WHILE;
-        }
-
-        break;
-    }
-    default: {
-        break;
-    }
-    }
-
+    token->type = find_keyword(&p[*pos], len);
     if (token->type == TK_IDENT) {
-        token->str    = calloc(1, sizeof(char) * len + 1);
-        token->strlen = len + 1;
-        strncpy(token->str, &p[*pos], len);
-        token->str[len] = '\0';
+        token->val = intern(&p[*pos], len);
     }
 
+    token->len = len;
     *(pos) += len;
 
     return token;
 }
 
 static Token* read_number(const char* p, int* pos) {
-    Token* token = calloc(1, sizeof(Token));
-    token->type = TK_NUM;
+    Token* token = new_token(TK_NUM, *pos);
 
     int len = 0;
-    while (isdigit(p[*pos + len])) {
+    while (char_class(p[*pos + len]) == CC_DIGIT) {
+        token->val *= 10;
+        token->val += p[*pos + len] - '0';
         ++len;
     }
 
-    char buf[32];
-    strncpy(buf, &p[*pos], 32);
-    buf[len] = '\0';
-
-    token->num = atoi(buf);
+    token->len = len;
     *pos += len;
 
     return token;
 }
 
-static bool is_line_comment(const char* p, int pos) {
-    return (strncmp(&p[pos], "//", 2) == 0);
-}
-
-static bool is_block_comment_begin(const char* p, int pos) {
-    return (strncmp(&p[pos], "/*", 2) == 0);
-}
-
-static bool is_block_comment_end(const char* p, int pos) {
-    return (strncmp(&p[pos], "*/", 2) == 0);
+Vector* tokenize(char* addr) {
+    if (shared_token_arena == NULL) {
+        shared_token_arena = create_arena(TOKEN_ARENA_CHUNK_SIZE);
+    }
+    return tokenize_range(addr, 0, -1, NULL, shared_token_arena);
 }
 
-Vector* tokenize(char* addr) {
+Vector* tokenize_range(char* addr, int begin, int end, int* end_out, Arena* arena) {
     Vector* vec = create_vector();
+    if (!tokenizer_ready) {
+        init_char_classes();
+#ifdef MINIC_SIMD
+        init_simd_scan();
+#endif
+        if (!init_keywords()) {
+            return NULL;
+        }
+        tokenizer_ready = true;
+    }
+    token_arena = arena;
 
-    int pos = 0;
+    int pos = begin;
     const char* p = addr;
     Token* token = NULL;
-    while (p[pos]) {
-        if (isspace(p[pos])) {
-            ++pos;
+    while (p[pos] && (end < 0 || pos < end)) {
+        const int cc = char_class(p[pos]);
+        if (cc == CC_SPACE) {
+            pos = skip_spaces(p, pos);
         }
-        else if (is_line_comment(p, pos)) {
-            while (p[pos] != '\n') {
-                ++pos;
-            } 
+        else if (cc == CC_SLASH && p[pos + 1] == '/') {
+            pos = find_line_end(p, pos);
         }
-        else if (is_block_comment_begin(p, pos)) {
-            while (!is_block_comment_end(p, pos)) {
-                ++pos;
-            }
-            pos += 2;
+        else if (cc == CC_SLASH && p[pos + 1] == '*') {
+            pos = skip_block_comment(p, pos);
         }
-        else if (p[pos] == '#') {
+        else if (cc == CC_HASH) {
             token = read_directive(p, &pos);
             if (token == NULL) {
                 error("Failed to read directive.\n");
@@ -609,7 +860,7 @@ Vector* tokenize(char* addr) {
             }
             vector_push_back(vec, token);
         }
-        else if (p[pos] == '\'') {
+        else if (cc == CC_QUOTE) {
             token = read_character(p, &pos);
             if (token == NULL) {
                 error("Failed to read character.\n");
@@ -617,7 +868,7 @@ Vector* tokenize(char* addr) {
             }
             vector_push_back(vec, token);
         }
-        else if (p[pos] == '"') {
+        else if (cc == CC_DQUOTE) {
             token = read_string(p, &pos);
             if (token == NULL) {
                 error("Failed to read string.\n");
@@ -625,15 +876,16 @@ Vector* tokenize(char* addr) {
             }
             vector_push_back(vec, token);
         }
-        else if (is_symbol(p[pos])) {
+        else if (cc == CC_SYMBOL || cc == CC_SLASH) {
             token = read_symbol(p, &pos);
             if (token == NULL) {
                 error("Failed to read symbol.\n");
                 return NULL;
             }
+            token->len = pos - token->pos;
             vector_push_back(vec, token);
         }
-        else if (isalpha(p[pos]) || p[pos] == '_') {
+        else if (cc == CC_IDENT) {
             token = read_identifier(p, &pos);
             if (token == NULL) {
                 error("Failed to read identifier.\n");
@@ -641,7 +893,7 @@ Vector* tokenize(char* addr) {
             }
             vector_push_back(vec, token);
         }
-        else if (isdigit(p[pos])) {
+        else if (cc == CC_DIGIT) {
             token = read_number(p, &pos);
             if (token == NULL) {
                 error("Failed to read number.\n");
@@ -655,6 +907,10 @@ Vector* tokenize(char* addr) {
         }
     }
 
+    if (end_out != NULL) {
+        *end_out = pos;
+    }
+
     return vec;
 }
 
@@ -683,6 +939,12 @@ const char* decode_token_type(int type) {
     case TK_CONTINUE: { return "TK_CONTINUE"; }
     case TK_RETURN:   { return "TK_RETURN";   }
     case TK_SIZEOF:   { return "TK_SIZEOF";   }
+    case TK_UNSIGNED: { return "TK_UNSIGNED"; }
+    case TK_LONG:     { return "TK_LONG";     }
+    case TK_SHORT:    { return "TK_SHORT";    }
+    case TK_UNION:    { return "TK_UNION";    }
+    case TK_DO:       { return "TK_DO";       }
+    case TK_GOTO:     { return "TK_GOTO";     }
     case TK_PLUS:     { return "TK_PLUS";     }
     case TK_MINUS:    { return "TK_MINUS";    }
     case TK_ASTER:    { return "TK_ASTER";    }
@@ -31,6 +31,12 @@ enum TokenType {
     TK_CONTINUE,  // "continue"
     TK_RETURN,    // "return"
     TK_SIZEOF,    // "sizeof"
+    TK_UNSIGNED,  // "unsigned"
+    TK_LONG,      // "long"
+    TK_SHORT,     // "short"
+    TK_UNION,     // "union"
+    TK_DO,        // "do"
+    TK_GOTO,      // "goto"
     TK_PLUS,      // +
     TK_MINUS,     // -
     TK_ASTER,     // *
@@ -76,19 +82,36 @@ enum TokenType {
     TK_AND_EQ,    // &=
     TK_XOR_EQ,    // ^=
     TK_OR_EQ,     // |=
-    TK_ELLIPSIS   // ...
+    TK_ELLIPSIS   // ... (the last type, see get_pch_token())
 };
 
+//
+// Tokens do not own their text. A token refers to its spelling by the slice
+// [pos, pos + len) of the buffer it was read from, and identifiers, string
+// literals and directives carry the id of their interned spelling.
+// A directive's slice covers the rest of its line.
+//
+
 typedef struct Token Token;
 struct Token {
-    int   type;
-    int   num;
-    char* str;
-    int   strlen;
-    bool  has_value; // true if token is "#define" and has value (#define key value)
+    int type;
+    int val;  // TK_NUM, TK_BYTE: value / TK_IDENT, TK_STR, TK_HASH: symbol id
+    int pos;
+    int len;
 };
 
+// The tokens are kept until the process exits.
 Vector* tokenize(char* addr);
+// Tokenizes from begin until a token, comment or run of spaces ends at or
+// after end (end < 0: the end of addr), where *end_out is set to stop.
+// Positions are offsets in addr. The tokens are allocated in arena, so
+// they go when the caller releases it.
+Vector* tokenize_range(char* addr, int begin, int end, int* end_out, Arena* arena);
+
+// Skip whitespace, comments and string literals 16 or 32 bytes at a time
+// (default; SSE2 or AVX2 with MINIC_SIMD, the libc string functions
+// otherwise) or with the byte-by-byte scanner.
+void set_vector_scan(bool enable);
 
 //
 // debug
@@ -49,23 +49,145 @@ void error(const char* fmt, ...) {
 // read file
 //
 
-char* read_file(const char* file_path) {
+#define READ_CHUNK_SIZE 65536
+// sizes are kept in int, so inputs stay below 1 GiB and the buffer
+// read_fd() doubles past them still fits
+#define READ_SIZE_LIMIT 1073741824
+
+// mmap's MAP_FAILED is (void*)-1, which the self build cannot write: the
+// address just below NULL.
+static bool is_map_failed(char* addr) {
+#ifdef MAP_FAILED
+    return addr == MAP_FAILED;
+#else
+    return addr + 1 == NULL;
+#endif
+}
+
+// Reads the rest of a stream that cannot be mapped (pipes, stdin).
+static char* read_fd(int fd, int* size_out) {
+    int capacity = READ_CHUNK_SIZE;
+    int size     = 0;
+    char* addr   = malloc(capacity + 1);
+    while (true) {
+        const int len = read(fd, addr + size, capacity - size);
+        if (len <= 0) {
+            break;
+        }
+
+        size += len;
+        if (size == capacity) {
+            if (capacity >= READ_SIZE_LIMIT) {
+                error("Input is 1 GiB or larger.\n");
+                free(addr);
+                return NULL;
+            }
+            capacity *= 2;
+            addr = realloc(addr, capacity + 1);
+        }
+    }
+    addr[size] = '\0';
+    if (size_out != NULL) {
+        *size_out = size;
+    }
+
+    return addr;
+}
+
+void* mmap_readonly(const char* file_path, int* size_out) {
     FILE* fp = fopen(file_path, "r");
     if (fp == NULL) {
         return NULL;
     }
 
-    fseek(fp, 0, SEEK_END);
-    int fsize = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+    const int fd       = fileno(fp);
+    const off_t length = lseek(fd, 0, SEEK_END);
+
+    // a pipe or a terminal cannot seek, so it is read as a stream
+    if (length < 0) {
+        char* stream = read_fd(fd, size_out);
+        fclose(fp);
+        return stream;
+    }
+    if (length >= READ_SIZE_LIMIT) {
+        error("File is 1 GiB or larger.\n");
+        fclose(fp);
+        return NULL;
+    }
+    const int size = length;
+
+    // The zero fill of the last page terminates the mapping with NUL,
+    // which only holds if the file does not end on a page boundary.
+    char* addr = NULL;
+    if (size > 0 && size % getpagesize() != 0) {
+        addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (is_map_failed(addr)) {
+            addr = NULL;
+        } else {
+            madvise(addr, size, MADV_SEQUENTIAL);
+        }
+    }
+
+    if (addr == NULL) {
+        lseek(fd, 0, SEEK_SET);
+        addr = read_fd(fd, NULL);
+    }
+    fclose(fp);
+
+    if (size_out != NULL) {
+        *size_out = size;
+    }
+
+    return addr;
+}
+
+char* read_file_copy(const char* file_path, int* size_out) {
+    FILE* fp = fopen(file_path, "r");
+    if (fp == NULL) {
+        return NULL;
+    }
 
-    char* addr = calloc(fsize, sizeof(char) + 1);
-    fread(addr, sizeof(char), fsize, fp);
+    char* addr = read_fd(fileno(fp), size_out);
     fclose(fp);
 
     return addr;
 }
 
+char* read_file(const char* file_path) {
+    if (strcmp(file_path, "-") == 0) {
+        return read_fd(0, NULL);
+    }
+
+    return mmap_readonly(file_path, NULL);
+}
+
+//
+// clock
+//
+
+#define CLOCK_WRAP_SEC 2000
+
+int clock_usec() {
+#ifdef MINIC_DEV
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec % CLOCK_WRAP_SEC) * 1000000 + ts.tv_nsec / 1000;
+#else
+    // the fields of struct timespec are as large as an int here
+    int ts[2];
+    clock_gettime(1, ts);
+    return (ts[0] % CLOCK_WRAP_SEC) * 1000000 + ts[1] / 1000;
+#endif
+}
+
+int elapsed_usec(int start) {
+    const int usec = clock_usec() - start;
+    if (usec < 0) {
+        return usec + CLOCK_WRAP_SEC * 1000000;
+    }
+    return usec;
+}
+
 //
 // Vector for Pointers
 //
@@ -75,6 +197,17 @@ Vector* create_vector() {
     vec->elements = calloc(16, sizeof(void*));
     vec->capacity = 16;
     vec->size     = 0;
+    vec->arena    = NULL;
+
+    return vec;
+}
+
+Vector* create_vector_in(Arena* arena) {
+    Vector* vec   = arena_alloc(arena, sizeof(Vector));
+    vec->elements = arena_alloc(arena, sizeof(void*) * 16);
+    vec->capacity = 16;
+    vec->size     = 0;
+    vec->arena    = arena;
 
     return vec;
 }
@@ -82,13 +215,159 @@ Vector* create_vector() {
 void vector_push_back(Vector* vec, void* e) {
     if (vec->size == vec->capacity) {
         vec->capacity *= 2;
-        vec->elements = realloc(vec->elements, sizeof(void*) * vec->capacity);
+        if (vec->arena != NULL) {
+            void** elements = arena_alloc(vec->arena, sizeof(void*) * vec->capacity);
+            memcpy(elements, vec->elements, sizeof(void*) * vec->size);
+            vec->elements = elements;
+        }
+        else {
+            vec->elements = realloc(vec->elements, sizeof(void*) * vec->capacity);
+        }
+    }
+
+    vec->elements[vec->size] = e;
+    ++(vec->size);
+}
+
+//
+// Vector for Integer
+//
+
+IntVector* create_intvector() {
+    IntVector* vec = malloc(sizeof(IntVector));
+    vec->elements  = calloc(16, sizeof(int));
+    vec->capacity  = 16;
+    vec->size      = 0;
+    vec->arena     = NULL;
+
+    return vec;
+}
+
+IntVector* create_intvector_in(Arena* arena) {
+    IntVector* vec = arena_alloc(arena, sizeof(IntVector));
+    vec->elements  = arena_alloc(arena, sizeof(int) * 16);
+    vec->capacity  = 16;
+    vec->size      = 0;
+    vec->arena     = arena;
+
+    return vec;
+}
+
+void intvector_push_back(IntVector* vec, int e) {
+    if (vec->size == vec->capacity) {
+        vec->capacity *= 2;
+        if (vec->arena != NULL) {
+            int* elements = arena_alloc(vec->arena, sizeof(int) * vec->capacity);
+            memcpy(elements, vec->elements, sizeof(int) * vec->size);
+            vec->elements = elements;
+        }
+        else {
+            vec->elements = realloc(vec->elements, sizeof(int) * vec->capacity);
+        }
     }
 
     vec->elements[vec->size] = e;
     ++(vec->size);
 }
 
+//
+// Byte buffer
+//
+
+ByteBuffer* create_bytebuffer() {
+    ByteBuffer* buf = malloc(sizeof(ByteBuffer));
+    buf->data       = malloc(256);
+    buf->size       = 0;
+    buf->capacity   = 256;
+    buf->pos        = 0;
+    buf->overrun    = false;
+
+    return buf;
+}
+
+ByteBuffer* wrap_bytebuffer(char* data, int size) {
+    ByteBuffer* buf = malloc(sizeof(ByteBuffer));
+    buf->data       = data;
+    buf->size       = size;
+    buf->capacity   = size;
+    buf->pos        = 0;
+    buf->overrun    = false;
+
+    return buf;
+}
+
+static void bytebuffer_reserve(ByteBuffer* buf, int len) {
+    while (buf->size + len > buf->capacity) {
+        buf->capacity *= 2;
+        buf->data = realloc(buf->data, buf->capacity);
+    }
+}
+
+void bytebuffer_put_int(ByteBuffer* buf, int val) {
+    bytebuffer_reserve(buf, 4);
+    for (int i = 0; i < 4; ++i) {
+        const char byte = val % 256;
+        buf->data[buf->size] = byte;
+        ++(buf->size);
+        val /= 256;
+    }
+}
+
+void bytebuffer_put_bytes(ByteBuffer* buf, const char* bytes, int len) {
+    bytebuffer_reserve(buf, len);
+    memcpy(buf->data + buf->size, bytes, len);
+    buf->size += len;
+}
+
+int bytebuffer_get_int(ByteBuffer* buf) {
+    if (buf->pos + 4 > buf->size) {
+        buf->overrun = true;
+        return 0;
+    }
+
+    // from the most significant byte down, taking that byte as signed, so
+    // that no step overflows; a broken file can give a negative value
+    int val = 0;
+    for (int i = 3; i >= 0; --i) {
+        int byte = buf->data[buf->pos + i];
+        if (byte < 0) {
+            byte += 256;
+        }
+        if (i == 3 && byte >= 128) {
+            byte -= 256;
+        }
+        val = val * 256 + byte;
+    }
+    buf->pos += 4;
+
+    return val;
+}
+
+const char* bytebuffer_get_bytes(ByteBuffer* buf, int len) {
+    if (len < 0 || buf->pos + len > buf->size) {
+        buf->overrun = true;
+        return NULL;
+    }
+
+    const char* bytes = buf->data + buf->pos;
+    buf->pos += len;
+
+    return bytes;
+}
+
+bool bytebuffer_write(const ByteBuffer* buf, int fd) {
+    int written = 0;
+    while (written < buf->size) {
+        const int len = write(fd, buf->data + written, buf->size - written);
+        if (len <= 0) {
+            return false;
+        }
+        written += len;
+    }
+
+    return true;
+}
+
 //
 // Stack for Pointers
 //
@@ -161,164 +440,350 @@ void intstack_pop(IntStack* stack) {
 }
 
 //
-// Hashmap of char* => int
+// Arena allocator
 //
 
-StrPtrMap* create_strptrmap(int capacity) {
-    StrPtrMap* map = malloc(sizeof(StrPtrMap));
-    map->size      = 0;
-    map->capacity  = capacity;
-    map->entries   = calloc(capacity, sizeof(StrPtrMapEntry*));
+Arena* create_arena(int chunk_size) {
+    Arena* arena      = calloc(1, sizeof(Arena));
+    arena->head       = NULL;
+    arena->chunk_size = chunk_size;
 
-    return map;
+    return arena;
 }
 
-static int calc_hash(const char* str) {
-    int h = 0, pos = 0;
-    while (str[pos] != '\0') {
-        h += str[pos];
-        ++pos;
+static ArenaChunk* add_arena_chunk(Arena* arena, int size) {
+    int capacity = arena->chunk_size;
+    if (capacity < size) {
+        capacity = size;
     }
 
-    return h;
+    ArenaChunk* chunk = malloc(sizeof(ArenaChunk));
+    chunk->addr       = calloc(capacity, sizeof(char));
+    chunk->used       = 0;
+    chunk->capacity   = capacity;
+    chunk->next       = arena->head;
+
+    arena->head = chunk;
+    ++(arena->chunk_count);
+
+    return chunk;
 }
 
-void strptrmap_put(StrPtrMap* map, const char* key, void* val) {
-    const int hash  = calc_hash(key);
-    const int index = hash % map->capacity;
-    if (map->entries[index] == NULL) {
-        map->entries[index]       = calloc(1, sizeof(StrPtrMapEntry));
-        map->entries[index]->key  = strdup(key);
-        map->entries[index]->val  = val;
-        map->entries[index]->next = NULL;
+void* arena_alloc(Arena* arena, int size) {
+    // keep every block 8-byte aligned
+    size = (size + 7) / 8 * 8;
+
+    ArenaChunk* chunk = arena->head;
+    if (chunk == NULL) {
+        chunk = add_arena_chunk(arena, size);
     }
-    else {
-        StrPtrMapEntry* current = map->entries[index];
-        while (current->next != NULL) {
-            current = current->next;
-        }
-        current->next       = calloc(1, sizeof(StrPtrMapEntry));
-        current->next->key  = strdup(key);
-        current->next->val  = val;
-        current->next->next = NULL;
+    else if (chunk->used + size > chunk->capacity) {
+        chunk = add_arena_chunk(arena, size);
     }
 
-    ++(map->size);
+    void* addr = chunk->addr + chunk->used;
+    chunk->used += size;
+
+    ++(arena->alloc_count);
+    arena->alloc_bytes += size;
+
+    return addr;
 }
 
-bool strptrmap_contains(StrPtrMap* map, const char* key) {
-    const int hash  = calc_hash(key);
-    const int index = hash % map->capacity;
+char* arena_strdup(Arena* arena, const char* str) {
+    const int len = strlen(str);
+    char* addr = arena_alloc(arena, len + 1);
+    strncpy(addr, str, len + 1);
 
-    if (map->entries[index] == NULL) {
-        return false;
+    return addr;
+}
+
+void arena_adopt(Arena* arena, Arena* other) {
+    if (other->head == NULL) {
+        return;
+    }
+
+    // keep the current chunk of arena at the head
+    ArenaChunk* last = other->head;
+    while (last->next != NULL) {
+        last = last->next;
+    }
+    if (arena->head == NULL) {
+        arena->head = other->head;
     }
     else {
-        StrPtrMapEntry* current = map->entries[index];
-        while (current != NULL) {
-            if (strcmp(current->key, key) == 0) {
-                return true;
-            }
-            current = current->next;
-        }
+        last->next        = arena->head->next;
+        arena->head->next = other->head;
+    }
 
-        return false;
+    arena->alloc_count += other->alloc_count;
+    arena->alloc_bytes += other->alloc_bytes;
+    arena->chunk_count += other->chunk_count;
+
+    other->head        = NULL;
+    other->alloc_count = 0;
+    other->alloc_bytes = 0;
+    other->chunk_count = 0;
+}
+
+void arena_release(Arena* arena) {
+    ArenaChunk* chunk = arena->head;
+    while (chunk != NULL) {
+        ArenaChunk* next = chunk->next;
+        free(chunk->addr);
+        free(chunk);
+        chunk = next;
     }
+
+    arena->head = NULL;
 }
 
-void* strptrmap_get(StrPtrMap* map, const char* key) {
-    const int hash  = calc_hash(key);
-    const int index = hash % map->capacity;
-    if (map->entries[index] == NULL) {
-        return NULL;
+//
+// Symbol table (interned strings)
+//
+
+#define SYMBOL_SLOT_COUNT 4096
+#define SYMBOL_ARENA_CHUNK_SIZE 65536
+
+static int*    symbol_slots;      // open addressing table of symbol ids, 0 = empty
+static int     symbol_slot_count;
+static Vector* symbol_list;       // id => Symbol*, id 0 is reserved for "no symbol"
+static Arena*  symbol_arena;
+
+// Polynomial string hash. h stays below 2^26 between steps so that h * 31 + c
+// fits in a 32-bit int, and the division is only paid once h gets that large.
+#define SYMBOL_HASH_LIMIT 67108864
+#define SYMBOL_HASH_PRIME 67108859
+
+static int calc_symbol_hash(const char* str, int len) {
+    int h = 0;
+    for (int i = 0; i < len; ++i) {
+        int c = str[i];
+        if (c < 0) {
+            c += 256;
+        }
+
+        h = h * 31 + c;
+        if (h >= SYMBOL_HASH_LIMIT) {
+            h = h % SYMBOL_HASH_PRIME;
+        }
     }
-    else {
-        StrPtrMapEntry* current = map->entries[index];
-        while (current != NULL) {
-            if (strcmp(current->key, key) == 0) {
-                return current->val;
-            }
 
-            current = current->next;
+    return h;
+}
+
+static Symbol* add_symbol(const char* str, int len, int hash) {
+    Symbol* symbol = arena_alloc(symbol_arena, sizeof(Symbol));
+    symbol->name   = arena_alloc(symbol_arena, len + 1); // zeroed, so already NUL-terminated
+    symbol->len    = len;
+    symbol->id     = symbol_list->size;
+    symbol->hash   = hash;
+    symbol->kind   = SYMBOL_IDENT;
+    strncpy(symbol->name, str, len);
+    vector_push_back(symbol_list, symbol);
+
+    return symbol;
+}
+
+static int find_symbol_slot(const char* str, int len, int hash) {
+    int index = hash % symbol_slot_count;
+    while (symbol_slots[index] != 0) {
+        const Symbol* symbol = symbol_list->elements[symbol_slots[index]];
+        if (symbol->hash == hash && symbol->len == len && strncmp(symbol->name, str, len) == 0) {
+            return index;
         }
 
-        return NULL;
+        ++index;
+        if (index == symbol_slot_count) {
+            index = 0;
+        }
+    }
+
+    return index;
+}
+
+static void grow_symbol_slots() {
+    free(symbol_slots);
+    symbol_slot_count *= 2;
+    symbol_slots = calloc(symbol_slot_count, sizeof(int));
+
+    for (int id = 1; id < symbol_list->size; ++id) {
+        const Symbol* symbol = symbol_list->elements[id];
+        const int index = find_symbol_slot(symbol->name, symbol->len, symbol->hash);
+        symbol_slots[index] = id;
     }
 }
 
+int intern(const char* str, int len) {
+    if (symbol_list == NULL) {
+        symbol_slot_count = SYMBOL_SLOT_COUNT;
+        symbol_slots      = calloc(symbol_slot_count, sizeof(int));
+        symbol_list       = create_vector();
+        symbol_arena      = create_arena(SYMBOL_ARENA_CHUNK_SIZE);
+        add_symbol("", 0, 0);
+    }
+
+    const int hash = calc_symbol_hash(str, len);
+    const int index = find_symbol_slot(str, len, hash);
+    if (symbol_slots[index] != 0) {
+        return symbol_slots[index];
+    }
+
+    const Symbol* symbol = add_symbol(str, len, hash);
+    symbol_slots[index] = symbol->id;
+
+    // keep the load factor at or below 1/2
+    if (symbol_list->size * 2 > symbol_slot_count) {
+        grow_symbol_slots();
+    }
+
+    return symbol->id;
+}
+
+int find_symbol(const char* str, int len) {
+    if (symbol_list == NULL) {
+        return 0;
+    }
+    return symbol_slots[find_symbol_slot(str, len, calc_symbol_hash(str, len))];
+}
+
+const char* symbol_name(int id) {
+    Symbol* symbol = symbol_list->elements[id];
+    return symbol->name;
+}
+
+int symbol_len(int id) {
+    Symbol* symbol = symbol_list->elements[id];
+    return symbol->len;
+}
+
+int symbol_kind(int id) {
+    Symbol* symbol = symbol_list->elements[id];
+    return symbol->kind;
+}
+
+void set_symbol_kind(int id, int kind) {
+    Symbol* symbol = symbol_list->elements[id];
+    symbol->kind = kind;
+}
+
+int symbol_count() {
+    if (symbol_list == NULL) {
+        return 0;
+    }
+
+    return symbol_list->size;
+}
+
 //
-// Hashmap of char* => int
+// Hashmap of symbol => pointer / int
 //
 
-StrIntMap* create_strintmap(int capacity) {
-    StrIntMap* map = malloc(sizeof(StrIntMap));
-    map->size      = 0;
-    map->capacity  = capacity;
-    map->entries   = calloc(capacity, sizeof(StrIntMapEntry*));
+#define HASHMAP_MIN_CAPACITY 16
+
+HashMap* create_hashmap(int capacity) {
+    if (capacity < HASHMAP_MIN_CAPACITY) {
+        capacity = HASHMAP_MIN_CAPACITY;
+    }
+
+    HashMap* map  = malloc(sizeof(HashMap));
+    map->keys     = calloc(capacity, sizeof(int));
+    map->vals     = calloc(capacity, sizeof(void*));
+    map->nums     = calloc(capacity, sizeof(int));
+    map->size     = 0;
+    map->capacity = capacity;
 
     return map;
 }
 
-void strintmap_put(StrIntMap* map, const char* key, int val) {
-    const int hash  = calc_hash(key);
-    const int index = hash % map->capacity;
-    if (map->entries[index] == NULL) {
-        map->entries[index]       = calloc(1, sizeof(StrIntMapEntry));
-        map->entries[index]->key  = strdup(key);
-        map->entries[index]->val  = val;
-        map->entries[index]->next = NULL;
-    }
-    else {
-        StrIntMapEntry* current = map->entries[index];
-        while (current->next != NULL) {
-            current = current->next;
+// Symbol ids are dense, so the id itself spreads keys evenly over the slots.
+// Returns the slot holding the key, or the empty slot where it would go.
+static int find_hashmap_slot(const HashMap* map, int key) {
+    int index = key % map->capacity;
+    while (map->keys[index] != 0) {
+        if (map->keys[index] == key) {
+            return index;
+        }
+
+        ++index;
+        if (index == map->capacity) {
+            index = 0;
         }
-        current->next       = calloc(1, sizeof(StrIntMapEntry));
-        current->next->key  = strdup(key);
-        current->next->val  = val;
-        current->next->next = NULL;
     }
 
-    ++(map->size);
+    return index;
 }
 
-bool strintmap_contains(StrIntMap* map, const char* key) {
-    const int hash  = calc_hash(key);
-    const int index = hash % map->capacity;
-
-    if (map->entries[index] == NULL) {
-        return false;
-    }
-    else {
-        StrIntMapEntry* current = map->entries[index];
-        while (current != NULL) {
-            if (strcmp(current->key, key) == 0) {
-                return true;
-            }
-            current = current->next;
+static void grow_hashmap(HashMap* map) {
+    int*   old_keys     = map->keys;
+    void** old_vals     = map->vals;
+    int*   old_nums     = map->nums;
+    const int old_capacity = map->capacity;
+
+    map->capacity = old_capacity * 2;
+    map->keys     = calloc(map->capacity, sizeof(int));
+    map->vals     = calloc(map->capacity, sizeof(void*));
+    map->nums     = calloc(map->capacity, sizeof(int));
+
+    for (int i = 0; i < old_capacity; ++i) {
+        if (old_keys[i] != 0) {
+            const int index = find_hashmap_slot(map, old_keys[i]);
+            map->keys[index] = old_keys[i];
+            map->vals[index] = old_vals[i];
+            map->nums[index] = old_nums[i];
         }
-        return false;
     }
+
+    free(old_keys);
+    free(old_vals);
+    free(old_nums);
 }
 
-int strintmap_get(StrIntMap* map, const char* key) {
-    const int hash  = calc_hash(key);
-    const int index = hash % map->capacity;
-    if (map->entries[index] == NULL) {
-        fprintf(stderr, "no key=\"%s\"\n", key);
-        exit(-1);
+// Returns the slot of the key, inserting it if absent. Only a new key can
+// grow the table, so updating one never rehashes.
+static int insert_hashmap_slot(HashMap* map, int key) {
+    int index = find_hashmap_slot(map, key);
+    if (map->keys[index] != 0) {
+        return index;
     }
-    else {
-        StrIntMapEntry* current = map->entries[index];
-        while (current != NULL) {
-            if (strcmp(current->key, key) == 0) {
-                return current->val;
-            }
 
-            current = current->next;
-        }
+    // keep the load factor at or below 1/2
+    if ((map->size + 1) * 2 > map->capacity) {
+        grow_hashmap(map);
+        index = find_hashmap_slot(map, key);
+    }
+
+    map->keys[index] = key;
+    ++(map->size);
+    return index;
+}
 
-        fprintf(stderr, "no key=\"%s\"\n", key);
+void hashmap_put(HashMap* map, int key, void* val) {
+    const int index = insert_hashmap_slot(map, key);
+    map->vals[index] = val;
+}
+
+void hashmap_put_int(HashMap* map, int key, int val) {
+    const int index = insert_hashmap_slot(map, key);
+    map->nums[index] = val;
+}
+
+bool hashmap_contains(const HashMap* map, int key) {
+    const int index = find_hashmap_slot(map, key);
+    return (map->keys[index] != 0);
+}
+
+void* hashmap_get(const HashMap* map, int key) {
+    const int index = find_hashmap_slot(map, key);
+    return map->vals[index];
+}
+
+int hashmap_get_int(const HashMap* map, int key) {
+    const int index = find_hashmap_slot(map, key);
+    if (map->keys[index] == 0) {
+        fprintf(stderr, "no key=\"%s\"\n", symbol_name(key));
         exit(-1);
     }
+
+    return map->nums[index];
 }
@@ -34,7 +34,45 @@ void error(const char* fmt, ...);
 //
 
 char* read_file(const char* file_path);
-// void* mmap_readonly(const char* file_path);
+void* mmap_readonly(const char* file_path, int* size_out);
+// reads the file into memory the caller frees, NULL if it cannot be read
+char* read_file_copy(const char* file_path, int* size_out);
+
+//
+// clock
+//
+
+// microseconds of a monotonic clock, which wraps around every 2000 seconds
+int clock_usec();
+// microseconds since start, a value of clock_usec()
+int elapsed_usec(int start);
+
+//
+// Arena allocator
+//
+
+typedef struct ArenaChunk ArenaChunk;
+struct ArenaChunk {
+    char*       addr;
+    int         used;
+    int         capacity;
+    ArenaChunk* next;
+};
+
+typedef struct Arena Arena;
+struct Arena {
+    ArenaChunk* head;
+    int         chunk_size;
+    int         alloc_count; // number of arena_alloc() calls
+    int         alloc_bytes; // bytes handed out, including alignment
+    int         chunk_count; // number of chunks taken from the heap
+};
+
+Arena* create_arena(int chunk_size);
+void* arena_alloc(Arena* arena, int size);
+char* arena_strdup(Arena* arena, const char* str);
+void arena_adopt(Arena* arena, Arena* other); // moves the chunks of other into arena
+void arena_release(Arena* arena);
 
 //
 // Vector for Pointers
@@ -45,11 +83,54 @@ struct Vector {
     void** elements;
     int    size;
     int    capacity;
+    Arena* arena; // holds elements, NULL for the heap
 };
 
 Vector* create_vector();
+// A vector taken from arena, which it grows in; it goes when the arena is
+// released and must not be freed by itself.
+Vector* create_vector_in(Arena* arena);
 void vector_push_back(Vector* vec, void* e);
 
+//
+// Vector for Integer
+//
+
+typedef struct IntVector IntVector;
+struct IntVector {
+    int*   elements;
+    int    size;
+    int    capacity;
+    Arena* arena; // holds elements, NULL for the heap
+};
+
+IntVector* create_intvector();
+IntVector* create_intvector_in(Arena* arena); // see create_vector_in()
+void intvector_push_back(IntVector* vec, int e);
+
+//
+// Byte buffer for the binary formats
+// (integers are stored as 4 little-endian bytes and must be non-negative;
+// reading past the end sets overrun instead of failing)
+//
+
+typedef struct ByteBuffer ByteBuffer;
+struct ByteBuffer {
+    char* data;
+    int   size;
+    int   capacity;
+    int   pos;      // read position
+    bool  overrun;
+};
+
+ByteBuffer* create_bytebuffer();
+ByteBuffer* wrap_bytebuffer(char* data, int size);
+void bytebuffer_put_int(ByteBuffer* buf, int val);
+void bytebuffer_put_bytes(ByteBuffer* buf, const char* bytes, int len);
+int bytebuffer_get_int(ByteBuffer* buf);
+const char* bytebuffer_get_bytes(ByteBuffer* buf, int len);
+bool bytebuffer_write(const ByteBuffer* buf, int fd);
+
 //
 // Stack for Pointers
 //
@@ -83,49 +164,50 @@ int intstack_top(IntStack* stack);
 void intstack_pop(IntStack* stack);
 
 //
-// Hashmap for string => pointer
+// Symbol table (interned strings)
 //
 
-typedef struct StrPtrMapEntry StrPtrMapEntry;
-struct StrPtrMapEntry {
-    char*            key;
-    void*            val;
-    StrPtrMapEntry* next;
+enum SymbolKind {
+    SYMBOL_IDENT,        // any identifier
+    SYMBOL_TYPEDEF_NAME, // declared by typedef, so it starts a type
 };
 
-typedef struct StrPtrMap StrPtrMap;
-struct StrPtrMap {
-    StrPtrMapEntry** entries;
-    int               size;
-    int               capacity;
+typedef struct Symbol Symbol;
+struct Symbol {
+    char* name; // NUL-terminated copy of the spelling
+    int   len;
+    int   id;
+    int   hash;
+    int   kind; // SymbolKind, kept up to date by the parser
 };
 
-StrPtrMap* create_strptrmap(int capacity);
-void strptrmap_put(StrPtrMap* map, const char* key, void* val);
-bool strptrmap_contains(StrPtrMap* map, const char* key);
-void* strptrmap_get(StrPtrMap* map, const char* key);
+int intern(const char* str, int len);
+int find_symbol(const char* str, int len); // the id of str if interned, 0 if not
+const char* symbol_name(int id);
+int symbol_len(int id);
+int symbol_kind(int id);
+void set_symbol_kind(int id, int kind);
+int symbol_count();
 
 //
-// Hashmap for string => int
+// Hashmap for symbol => pointer / int
+// (open addressing with linear probing, grows to keep the load factor <= 1/2)
 //
 
-typedef struct StrIntMapEntry StrIntMapEntry;
-struct StrIntMapEntry {
-    char*           key;
-    int             val;
-    StrIntMapEntry* next;
-};
-
-typedef struct StrIntMap StrIntMap;
-struct StrIntMap {
-    StrIntMapEntry** entries;
-    int              size;
-    int              capacity;
+typedef struct HashMap HashMap;
+struct HashMap {
+    int*   keys; // symbol ids, 0 marks an empty slot
+    void** vals;
+    int*   nums;
+    int    size;
+    int    capacity;
 };
 
-StrIntMap* create_strintmap(int capacity);
-void strintmap_put(StrIntMap* map, const char* key, int val);
-bool strintmap_contains(StrIntMap* map, const char* key);
-int strintmap_get(StrIntMap* map, const char* key);
+HashMap* create_hashmap(int capacity);
+void hashmap_put(HashMap* map, int key, void* val);
+void hashmap_put_int(HashMap* map, int key, int val);
+bool hashmap_contains(const HashMap* map, int key);
+void* hashmap_get(const HashMap* map, int key);
+int hashmap_get_int(const HashMap* map, int key);
 
 #endif